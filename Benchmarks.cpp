@@ -0,0 +1,723 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <../glm/gtc/matrix_transform.hpp>
+
+#include "Bvh.h"
+#include "ClusteredLighting.h"
+#include "CpuFeatures.h"
+#include "EntityStore.h"
+#include "HandlePool.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "TransformBatch.h"
+
+namespace {
+	// Average milliseconds of one call over iterations runs (after one warm up run)
+	double timeMilliseconds(int iterations, const std::function<void()>& run)
+	{
+		run();
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			run();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	}
+
+	// - OCCLUSION ------------------------------------------------------------------------------------------------------------
+	// Street of wall occluders with small boxes scattered behind and between them
+	void benchmarkOcclusion(JobSystem& jobSystem)
+	{
+		const uint32_t width = 256, height = 192;
+		const int iterations = 50;
+
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(width) / float(height), 0.1f, 200.0f);
+		projection[1][1] *= -1;
+		glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f, 1.5f, 0.0f), glm::vec3(0.0f, 1.5f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		// Unit cube, outward facing
+		std::vector<glm::vec3> cube = {
+			{ -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 }, { -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 }
+		};
+		std::vector<uint32_t> cubeIndices = {
+			0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,  3, 7, 6, 3, 6, 2,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5
+		};
+
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<glm::mat4> occluders;
+		for (int i = 0; i < 60; i++)
+		{
+			glm::vec3 position(unit(random) * 60.0f - 30.0f, unit(random) * 2.0f, -5.0f - unit(random) * 60.0f);
+			glm::vec3 size(1.0f + unit(random) * 3.0f, 1.0f + unit(random) * 2.0f, 0.2f + unit(random));
+			occluders.push_back(viewProjection * glm::scale(glm::translate(glm::mat4(1.0f), position), size));
+		}
+
+		std::vector<glm::mat4> boxes;
+		for (int i = 0; i < 10000; i++)
+		{
+			glm::vec3 position(unit(random) * 100.0f - 50.0f, unit(random) * 4.0f, -5.0f - unit(random) * 120.0f);
+			boxes.push_back(viewProjection * glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.2f + unit(random) * 0.5f)));
+		}
+
+		// Reference: per pixel depth
+		ReferenceOcclusionCuller reference(width, height);
+		double referenceRasterMs = timeMilliseconds(iterations, [&]()
+		{
+			reference.clear();
+			for (const glm::mat4& occluder : occluders)
+			{
+				reference.addOccluder(cube.data(), cube.size(), cubeIndices.data(), cubeIndices.size(), occluder);
+			}
+		});
+
+		std::vector<bool> referenceVisible(boxes.size());
+		uint32_t referenceCulled = 0;
+		double referenceTestMs = timeMilliseconds(iterations, [&]()
+		{
+			referenceCulled = 0;
+			for (size_t i = 0; i < boxes.size(); i++)
+			{
+				referenceVisible[i] = reference.testAabb(glm::vec3(-1.0f), glm::vec3(1.0f), boxes[i]);
+				referenceCulled += referenceVisible[i] ? 0 : 1;
+			}
+		});
+
+		std::printf("Occlusion culling: %u x %u, %zu occluder triangles, %zu boxes\n", width, height,
+			occluders.size() * cubeIndices.size() / 3, boxes.size());
+		std::printf("  %-24s raster %8.3f ms  test %8.3f ms  culled %5u\n", "reference (scalar)", referenceRasterMs, referenceTestMs, referenceCulled);
+
+		const CpuFeatures& features = getCpuFeatures();
+		const char* simdNames[] = { "scalar", "sse4.1", "avx2" };
+		bool simdSupported[] = { true, features.sse41, features.avx2 };
+
+		for (int simd = OCCLUSION_SIMD_SCALAR; simd <= OCCLUSION_SIMD_AVX2; simd++)
+		{
+			if (!simdSupported[simd]) { continue; }
+
+			for (int threaded = 0; threaded < 2; threaded++)
+			{
+				MaskedOcclusionCuller masked(width, height, static_cast<OcclusionSimd>(simd), threaded ? &jobSystem : nullptr);
+				double rasterMs = timeMilliseconds(iterations, [&]()
+				{
+					masked.clear();
+					for (const glm::mat4& occluder : occluders)
+					{
+						masked.addOccluder(cube.data(), cube.size(), cubeIndices.data(), cubeIndices.size(), occluder);
+					}
+					masked.rasterize();
+				});
+
+				// Masked depth is conservative: it may keep boxes the reference hides, never the other way round
+				uint32_t culled = 0, wronglyCulled = 0;
+				double testMs = timeMilliseconds(iterations, [&]()
+				{
+					culled = 0;
+					wronglyCulled = 0;
+					for (size_t i = 0; i < boxes.size(); i++)
+					{
+						bool visible = masked.testAabb(glm::vec3(-1.0f), glm::vec3(1.0f), boxes[i]);
+						culled += visible ? 0 : 1;
+						wronglyCulled += !visible && referenceVisible[i] ? 1 : 0;
+					}
+				});
+
+				char name[64];
+				std::snprintf(name, sizeof(name), "masked %s%s", simdNames[simd], threaded ? " (jobs)" : "");
+				std::printf("  %-24s raster %8.3f ms  test %8.3f ms  culled %5u  wrongly culled %u\n", name, rasterMs, testMs, culled, wronglyCulled);
+			}
+		}
+	}
+
+	// - SCENE GRAPH ----------------------------------------------------------------------------------------------------------
+	// 100k nodes as 1000 objects of 100 (random parent within the object), a fraction of random nodes moves each frame
+	void benchmarkSceneGraph()
+	{
+		const uint32_t objectCount = 1000, nodesPerObject = 100;
+		const int iterations = 20;
+
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		SceneGraph sceneGraph;
+		std::vector<uint32_t> nodes;
+		for (uint32_t object = 0; object < objectCount; object++)
+		{
+			uint32_t firstNode = static_cast<uint32_t>(nodes.size());
+			nodes.push_back(sceneGraph.createNode());
+			for (uint32_t i = 1; i < nodesPerObject; i++)
+			{
+				uint32_t parent = nodes[firstNode + static_cast<uint32_t>(unit(random) * i) % i];
+				nodes.push_back(sceneGraph.createNode(parent));
+			}
+		}
+
+		auto sortStart = std::chrono::high_resolution_clock::now();
+		sceneGraph.updateWorldTransforms();
+		double sortMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sortStart).count();
+		std::printf("\nScene graph: %u nodes, first update (sort + full) %.3f ms\n", sceneGraph.getNodeCount(), sortMs);
+
+		const float movingFractions[] = { 0.01f, 0.05f, 0.25f, 1.0f };
+		for (float fraction : movingFractions)
+		{
+			uint32_t movingCount = static_cast<uint32_t>(nodes.size() * fraction);
+			std::vector<uint32_t> moving(movingCount);
+			for (uint32_t& node : moving)
+			{
+				node = nodes[static_cast<uint32_t>(unit(random) * nodes.size()) % nodes.size()];
+			}
+
+			float angle = 0.0f;
+			uint64_t updated = 0;
+			double updateMs = timeMilliseconds(iterations, [&]()
+			{
+				angle += 0.01f;
+				glm::quat rotation = glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f));
+				for (uint32_t node : moving)
+				{
+					sceneGraph.setLocalTransform(node, glm::vec3(1.0f, 0.0f, 0.0f), rotation, glm::vec3(1.0f));
+				}
+				sceneGraph.updateWorldTransforms();
+				updated += sceneGraph.getLastUpdatedCount();
+			});
+
+			std::printf("  %5.1f%% moving   set + update %8.3f ms   world matrices recomputed %7llu\n", fraction * 100.0f, updateMs,
+				static_cast<unsigned long long>(updated / (iterations + 1)));
+		}
+	}
+
+	// - TRANSFORMS -----------------------------------------------------------------------------------------------------------
+	void benchmarkTransforms()
+	{
+		const uint32_t objectCount = 100000;
+		const int iterations = 50;
+
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		// Structure of arrays TRS with unit quaternions
+		std::vector<float> components[10];
+		for (std::vector<float>& component : components)
+		{
+			component.resize(objectCount);
+		}
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+			components[0][i] = unit(random) * 10.0f;
+			components[1][i] = unit(random) * 10.0f;
+			components[2][i] = unit(random) * 10.0f;
+			components[3][i] = rotation.x;
+			components[4][i] = rotation.y;
+			components[5][i] = rotation.z;
+			components[6][i] = rotation.w;
+			components[7][i] = 0.5f + unit(random) * 0.25f;
+			components[8][i] = 0.5f + unit(random) * 0.25f;
+			components[9][i] = 0.5f + unit(random) * 0.25f;
+		}
+		TrsArrays trs = {
+			{ components[0].data(), components[1].data(), components[2].data() },
+			{ components[3].data(), components[4].data(), components[5].data(), components[6].data() },
+			{ components[7].data(), components[8].data(), components[9].data() }
+		};
+
+		// Random forest in depth first order (parents before children), a root every 100 nodes
+		std::vector<uint32_t> parents(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			parents[i] = i % 100 == 0 ? 0xffffffff : i - 1 - static_cast<uint32_t>(random() % (i % 100));
+		}
+
+		std::vector<glm::mat4> locals(objectCount), worlds(objectCount), results(objectCount);
+		composeTrsBatch(trs, objectCount, locals.data(), TRANSFORM_SIMD_SCALAR);
+		glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 1.5f, 0.1f, 100.0f) *
+			glm::lookAt(glm::vec3(0.0f, 5.0f, 20.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		// The per object way the main loop used to build model matrices
+		double chainMs = timeMilliseconds(iterations, [&]()
+		{
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				glm::quat rotation(components[6][i], components[3][i], components[4][i], components[5][i]);
+				results[i] = glm::translate(glm::mat4(1.0f), glm::vec3(components[0][i], components[1][i], components[2][i])) *
+					glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), glm::vec3(components[7][i], components[8][i], components[9][i]));
+			}
+		});
+
+		std::printf("\nTransforms: %u objects, glm translate * rotate * scale chain %.3f ms\n", objectCount, chainMs);
+
+		const TransformSimd kernels[] = { TRANSFORM_SIMD_SCALAR, TRANSFORM_SIMD_SSE41, TRANSFORM_SIMD_AVX2 };
+		const char* kernelNames[] = { "scalar (glm)", "SSE4.1", "AVX2" };
+		TransformSimd best = getBestTransformSimd();
+		std::vector<glm::mat4> expected[4];
+		for (TransformSimd kernel : kernels)
+		{
+			if (kernel > best) { continue; }
+
+			double trsMs = timeMilliseconds(iterations, [&]() { composeTrsBatch(trs, objectCount, results.data(), kernel); });
+			std::vector<glm::mat4> outputs[4];
+			outputs[0] = results;
+
+			double productMs = timeMilliseconds(iterations, [&]() { multiplyMatricesBatch(locals.data(), outputs[0].data(), objectCount, results.data(), kernel); });
+			outputs[1] = results;
+
+			double viewProjectionMs = timeMilliseconds(iterations, [&]() { multiplyMatrixBatch(viewProjection, locals.data(), objectCount, results.data(), kernel); });
+			outputs[2] = results;
+
+			double hierarchyMs = timeMilliseconds(iterations, [&]() { propagateTransforms(parents.data(), locals.data(), worlds.data(), 0, objectCount, kernel); });
+			outputs[3] = worlds;
+
+			// Every kernel does the same float operations as glm, so results match exactly
+			uint32_t mismatches = 0;
+			for (int output = 0; output < 4; output++)
+			{
+				if (kernel == TRANSFORM_SIMD_SCALAR) { expected[output] = outputs[output]; }
+				mismatches += std::memcmp(expected[output].data(), outputs[output].data(), sizeof(glm::mat4) * objectCount) != 0 ? 1 : 0;
+			}
+
+			std::printf("  %-12s  TRS %7.3f ms   mat x mat %7.3f ms   VP x model %7.3f ms   hierarchy %7.3f ms   %s\n", kernelNames[kernel],
+				trsMs, productMs, viewProjectionMs, hierarchyMs, mismatches == 0 ? "matches glm" : "DIFFERS FROM GLM");
+		}
+	}
+
+	// - ENTITIES -------------------------------------------------------------------------------------------------------------
+	// Object laid out like the old Mesh: per object transforms next to GPU handles and containers the loop never reads
+	struct MeshLikeObject
+	{
+		glm::mat4 model;
+		glm::mat4 transform;
+		glm::mat4 dequantization;
+		glm::vec4 boundingSphere;
+		std::vector<uint32_t> lods;
+		std::vector<uint32_t> meshlets;
+		uint64_t vertexBuffer, vertexMemory, indexBuffer, indexMemory;
+		void* physicalDevice;
+		void* device;
+		uint32_t mesh, material, flags;
+	};
+
+	// World space bounding sphere in front of a plane, the core of every culling loop
+	inline uint32_t sphereVisible(const glm::mat4& transform, const glm::vec4& sphere)
+	{
+		glm::vec3 centre = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+		return centre.z - sphere.w < 10.0f ? 1 : 0;
+	}
+
+	void benchmarkEntities()
+	{
+		std::printf("\nEntities: visibility loop (transform bounds, test a plane) over packed components vs array of Mesh-like objects\n");
+
+		const uint32_t entityCounts[] = { 10000, 100000, 1000000 };
+		for (uint32_t entityCount : entityCounts)
+		{
+			std::mt19937 random(entityCount);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			int iterations = entityCount >= 1000000 ? 5 : 50;
+
+			EntityStore store;
+			std::vector<EntityHandle> handles;
+			handles.reserve(entityCount);
+			double createMs = timeMilliseconds(1, [&]()
+			{
+				store = EntityStore();
+				handles.clear();
+				for (uint32_t i = 0; i < entityCount; i++)
+				{
+					handles.push_back(store.createEntity(RENDERABLE_COMPONENTS));
+				}
+			});
+			for (EntityHandle entity : handles)
+			{
+				store.getTransform(entity) = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random) * 20.0f));
+				store.getBounds(entity) = glm::vec4(0.0f, 0.0f, 0.0f, unit(random));
+			}
+
+			uint32_t visibleCount = 0;
+			double packedMs = timeMilliseconds(iterations, [&]()
+			{
+				visibleCount = 0;
+				store.forEachArchetype(COMPONENT_TRANSFORM | COMPONENT_BOUNDS | COMPONENT_FLAGS, [&](Archetype& archetype)
+				{
+					for (uint32_t i = 0; i < archetype.size(); i++)
+					{
+						archetype.flags[i] = sphereVisible(archetype.transforms[i], archetype.bounds[i]);
+						visibleCount += archetype.flags[i];
+					}
+				});
+			});
+
+			std::vector<MeshLikeObject> objects(entityCount);
+			for (uint32_t i = 0; i < entityCount; i++)
+			{
+				objects[i].transform = store.getTransform(handles[i]);
+				objects[i].boundingSphere = store.getBounds(handles[i]);
+			}
+
+			uint32_t objectVisibleCount = 0;
+			double objectMs = timeMilliseconds(iterations, [&]()
+			{
+				objectVisibleCount = 0;
+				for (MeshLikeObject& object : objects)
+				{
+					object.flags = sphereVisible(object.transform, object.boundingSphere);
+					objectVisibleCount += object.flags;
+				}
+			});
+
+			// Despawn and respawn a tenth of the entities (handles reused through the free list)
+			double churnMs = timeMilliseconds(iterations, [&]()
+			{
+				for (uint32_t i = 0; i < entityCount; i += 10)
+				{
+					store.destroyEntity(handles[i]);
+				}
+				for (uint32_t i = 0; i < entityCount; i += 10)
+				{
+					handles[i] = store.createEntity(RENDERABLE_COMPONENTS);
+				}
+			});
+
+			std::printf("  %8u entities   create %8.3f ms   packed %8.3f ms   objects %8.3f ms   10%% churn %8.3f ms   visible %u / %u\n",
+				entityCount, createMs, packedMs, objectMs, churnMs, visibleCount, objectVisibleCount);
+		}
+	}
+
+	// - HANDLES --------------------------------------------------------------------------------------------------------------
+	struct PooledObject					// About the size of the renderer's per resource records
+	{
+		uint64_t buffer, memory;
+		glm::vec4 bounds;
+	};
+
+	void benchmarkHandles()
+	{
+		std::printf("\nHandles: generational pool vs id -> object hash map (lookup every live object, despawn + respawn a tenth)\n");
+
+		const uint32_t objectCounts[] = { 1000, 10000, 100000 };
+		for (uint32_t objectCount : objectCounts)
+		{
+			int iterations = objectCount >= 100000 ? 10 : 100;
+
+			HandlePool<PooledObject> pool;
+			std::vector<Handle<PooledObject>> handles(objectCount);
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				handles[i] = pool.create(PooledObject{ i, i, glm::vec4(1.0f) });
+			}
+
+			uint64_t poolSum = 0;
+			double poolLookupMs = timeMilliseconds(iterations, [&]()
+			{
+				for (Handle<PooledObject> handle : handles)
+				{
+					poolSum += pool.get(handle)->buffer;
+				}
+			});
+
+			uint32_t staleFound = 0;
+			double poolChurnMs = timeMilliseconds(iterations, [&]()
+			{
+				for (uint32_t i = 0; i < objectCount; i += 10)
+				{
+					Handle<PooledObject> old = handles[i];
+					pool.destroy(old);
+					handles[i] = pool.create(PooledObject{ i, i, glm::vec4(1.0f) });
+					staleFound += pool.isValid(old) ? 1 : 0;	// Reused slot must not resolve the old handle
+				}
+			});
+
+			std::unordered_map<uint32_t, PooledObject> map;
+			std::vector<uint32_t> ids(objectCount);
+			uint32_t nextId = 0;
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				ids[i] = nextId++;
+				map.emplace(ids[i], PooledObject{ i, i, glm::vec4(1.0f) });
+			}
+
+			uint64_t mapSum = 0;
+			double mapLookupMs = timeMilliseconds(iterations, [&]()
+			{
+				for (uint32_t id : ids)
+				{
+					mapSum += map.find(id)->second.buffer;
+				}
+			});
+
+			double mapChurnMs = timeMilliseconds(iterations, [&]()
+			{
+				for (uint32_t i = 0; i < objectCount; i += 10)
+				{
+					map.erase(ids[i]);
+					ids[i] = nextId++;
+					map.emplace(ids[i], PooledObject{ i, i, glm::vec4(1.0f) });
+				}
+			});
+
+			std::printf("  %7u objects   pool lookup %7.3f ms  churn %7.3f ms   map lookup %7.3f ms  churn %7.3f ms   stale hits %u   sums %s\n",
+				objectCount, poolLookupMs, poolChurnMs, mapLookupMs, mapChurnMs, staleFound, poolSum == mapSum ? "match" : "DIFFER");
+		}
+	}
+
+	// - BVH ------------------------------------------------------------------------------------------------------------------
+	// A million small boxes scattered over a 2 km square city, camera at street level looking along it
+	void benchmarkBvh(JobSystem& jobSystem)
+	{
+		const uint32_t boxCount = 1000000;
+		const int iterations = 20;
+
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<Aabb> boxes(boxCount);
+		for (Aabb& box : boxes)
+		{
+			glm::vec3 centre(unit(random) * 2000.0f - 1000.0f, unit(random) * 30.0f, unit(random) * 2000.0f - 1000.0f);
+			glm::vec3 halfSize(0.5f + unit(random) * 2.0f);
+			box = { centre - halfSize, centre + halfSize };
+		}
+
+		Bvh bvh;
+		for (uint32_t i = 0; i < boxCount; i++)
+		{
+			bvh.createProxy(boxes[i], i);
+		}
+		double buildMs = timeMilliseconds(1, [&]() { bvh.rebuild(); });
+
+		std::printf("\nBVH: %u boxes, %u nodes, SAH cost %.1f\n", boxCount, bvh.getNodeCount(), bvh.getCost());
+		std::printf("  build %8.2f ms\n", buildMs);
+
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+		projection[1][1] *= -1;
+		glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(1.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = extractFrustum(viewProjection);
+
+		// Brute force: every box against every plane
+		std::vector<uint32_t> bruteResults;
+		double bruteMs = timeMilliseconds(iterations / 4, [&]()
+		{
+			bruteResults.clear();
+			for (uint32_t i = 0; i < boxCount; i++)
+			{
+				bool inside = true;
+				for (const glm::vec4& plane : frustum.planes)
+				{
+					glm::vec3 farthest(plane.x > 0.0f ? boxes[i].max.x : boxes[i].min.x, plane.y > 0.0f ? boxes[i].max.y : boxes[i].min.y,
+						plane.z > 0.0f ? boxes[i].max.z : boxes[i].min.z);
+					if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f) { inside = false; break; }
+				}
+				if (inside) { bruteResults.push_back(i); }
+			}
+		});
+
+		std::vector<uint32_t> results;
+		double frustumMs = timeMilliseconds(iterations, [&]() { results.clear(); bvh.queryFrustum(frustum, results); });
+		std::vector<uint32_t> parallelResults;
+		double parallelFrustumMs = timeMilliseconds(iterations, [&]() { parallelResults.clear(); bvh.queryFrustum(frustum, jobSystem, parallelResults); });
+
+		std::sort(results.begin(), results.end());
+		std::sort(parallelResults.begin(), parallelResults.end());
+		std::printf("  frustum  brute force %8.3f ms   bvh %8.3f ms   bvh (jobs) %8.3f ms   visible %zu   results %s\n", bruteMs, frustumMs,
+			parallelFrustumMs, bruteResults.size(), results == bruteResults && parallelResults == bruteResults ? "match" : "DIFFER");
+
+		// Moving 5% of the boxes a little each frame: refit, with the occasional rebuild when the tree degrades
+		uint32_t rebuildsBefore = bvh.getRebuildCount();
+		double moveMs = timeMilliseconds(iterations, [&]()
+		{
+			for (uint32_t i = 0; i < boxCount; i += 20)
+			{
+				glm::vec3 offset(unit(random) - 0.5f, 0.0f, unit(random) - 0.5f);
+				boxes[i] = { boxes[i].min + offset, boxes[i].max + offset };
+				bvh.moveProxy(i, boxes[i]);
+			}
+			bvh.commit();
+		});
+		std::printf("  move 5%% + commit %8.3f ms   rebuilds %u   SAH cost %.1f\n", moveMs, bvh.getRebuildCount() - rebuildsBefore, bvh.getCost());
+
+		// Rays from street level, spheres and boxes around random points
+		const uint32_t queryCount = 10000;
+		std::vector<glm::vec3> points(queryCount), directions(queryCount);
+		for (uint32_t i = 0; i < queryCount; i++)
+		{
+			points[i] = glm::vec3(unit(random) * 2000.0f - 1000.0f, unit(random) * 30.0f, unit(random) * 2000.0f - 1000.0f);
+			directions[i] = glm::normalize(glm::vec3(unit(random) - 0.5f, unit(random) * 0.2f - 0.1f, unit(random) - 0.5f));
+		}
+
+		uint32_t hits = 0;
+		double rayMs = timeMilliseconds(iterations / 4, [&]()
+		{
+			hits = 0;
+			for (uint32_t i = 0; i < queryCount; i++)
+			{
+				float distance;
+				hits += bvh.raycast(points[i], directions[i], 500.0f, distance) != Bvh::INVALID_PROXY ? 1 : 0;
+			}
+		});
+
+		size_t sphereFound = 0, boxFound = 0;
+		double sphereMs = timeMilliseconds(iterations / 4, [&]()
+		{
+			results.clear();
+			for (uint32_t i = 0; i < queryCount; i++)
+			{
+				bvh.querySphere(points[i], 10.0f, results);
+			}
+			sphereFound = results.size();
+		});
+		double boxMs = timeMilliseconds(iterations / 4, [&]()
+		{
+			results.clear();
+			for (uint32_t i = 0; i < queryCount; i++)
+			{
+				bvh.queryAabb({ points[i] - glm::vec3(10.0f), points[i] + glm::vec3(10.0f) }, results);
+			}
+			boxFound = results.size();
+		});
+
+		std::printf("  %u rays %8.3f ms (%u hit)   spheres %8.3f ms (%zu found)   boxes %8.3f ms (%zu found)\n",
+			queryCount, rayMs, hits, sphereMs, sphereFound, boxMs, boxFound);
+	}
+
+	// - CLUSTERED LIGHTS -----------------------------------------------------------------------------------------------------
+	// Point and spot lights over a 24 x 40 street, binned by the CPU reference of the binning pass: how many lights a
+	// fragment loops over in its cluster against every light (the GPU timings come from --light-benchmark)
+	void benchmarkClusteredLights()
+	{
+		VkExtent2D extent = { 1280, 720 };
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), float(extent.width) / float(extent.height), 0.1f, 100.0f);
+		projection[1][1] *= -1;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.5f, 2.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		std::printf("\nClustered lights (%ux%ux%u clusters, %ux%u)\n", LIGHT_TILES_X, LIGHT_TILES_Y, LIGHT_SLICES, extent.width, extent.height);
+
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<uint32_t> counts;
+		std::vector<uint16_t> indices;
+		for (uint32_t lightCount : { 10u, 100u, 1000u, 10000u })
+		{
+			std::vector<Light> lights;
+			for (uint32_t i = 0; i < lightCount; i++)
+			{
+				glm::vec3 position(unit(random) * 24.0f - 12.0f, unit(random) * 3.0f - 0.5f, 1.0f - unit(random) * 40.0f);
+				glm::vec3 colour(unit(random), unit(random), unit(random));
+				lights.push_back(i % 4 == 0
+					? makeSpotLight(position, glm::vec3(0.0f, -1.0f, 0.0f), 3.0f, glm::radians(20.0f), glm::radians(35.0f), colour)
+					: makePointLight(position, 1.5f, colour));
+			}
+
+			LightGridData grid = makeLightGridData(view, projection, extent, lightCount);
+			double binMs = timeMilliseconds(lightCount >= 10000 ? 2 : 10, [&]()
+			{
+				binLights(grid, lights, counts, indices);
+			});
+
+			uint64_t listed = 0;
+			uint32_t occupied = 0, maxCount = 0, full = 0;
+			for (uint32_t count : counts)
+			{
+				listed += count;
+				occupied += count > 0 ? 1 : 0;
+				maxCount = std::max(maxCount, count);
+				full += count == MAX_CLUSTER_LIGHTS ? 1 : 0;
+			}
+			std::printf("  %5u lights: bin %8.3f ms (CPU)   lights per occupied cluster %6.1f (max %u, %u full)   vs %u per fragment unclustered\n",
+				lightCount, binMs, occupied > 0 ? double(listed) / occupied : 0.0, maxCount, full, lightCount);
+		}
+	}
+
+	// - RENDER QUEUE ---------------------------------------------------------------------------------------------------------
+	// Draws of 200 meshes in 50 materials scattered over a street: radix sort of their keys against std::sort, and the
+	// vertex buffer binds a recorder that skips unchanged state needs in submission and in sorted order
+	void benchmarkRenderQueue(JobSystem& jobSystem)
+	{
+		const uint32_t drawCount = 1000000;
+		const int iterations = 10;
+
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<uint64_t> keys(drawCount);
+		std::vector<uint32_t> drawMeshes(drawCount);
+		for (uint32_t i = 0; i < drawCount; i++)
+		{
+			drawMeshes[i] = random() % 200;
+			keys[i] = makeOpaqueKey(1, 0, drawMeshes[i] % 50, drawMeshes[i], unit(random));
+		}
+
+		RenderQueue queue;
+		auto fill = [&]()
+		{
+			queue.clear();
+			for (uint32_t i = 0; i < drawCount; i++)
+			{
+				queue.push(keys[i], i);
+			}
+		};
+
+		// Pushing alone first, so the queue is left sorted by the last timing below
+		double fillMs = timeMilliseconds(iterations, fill);
+
+		std::vector<RenderItem> reference;
+		double stdSortMs = timeMilliseconds(iterations, [&]()
+		{
+			fill();
+			reference = queue.getItems();
+			std::stable_sort(reference.begin(), reference.end(), [](const RenderItem& a, const RenderItem& b) { return a.key < b.key; });
+		});
+		double serialMs = timeMilliseconds(iterations, [&]() { fill(); queue.sort(); });
+		bool serialMatch = std::equal(reference.begin(), reference.end(), queue.getItems().begin(),
+			[](const RenderItem& a, const RenderItem& b) { return a.draw == b.draw; });
+		double parallelMs = timeMilliseconds(iterations, [&]() { fill(); queue.sort(jobSystem); });
+		bool parallelMatch = std::equal(reference.begin(), reference.end(), queue.getItems().begin(),
+			[](const RenderItem& a, const RenderItem& b) { return a.draw == b.draw; });
+		uint32_t unsortedBinds = 0, sortedBinds = 0;
+		uint32_t bound = UINT32_MAX;
+		for (uint32_t i = 0; i < drawCount; i++)
+		{
+			unsortedBinds += drawMeshes[i] != bound ? 1 : 0;
+			bound = drawMeshes[i];
+		}
+		bound = UINT32_MAX;
+		for (const RenderItem& item : queue.getItems())
+		{
+			sortedBinds += drawMeshes[item.draw] != bound ? 1 : 0;
+			bound = drawMeshes[item.draw];
+		}
+
+		std::printf("\nRender queue: %u draws (sort times include %.3f ms of pushing)\n", drawCount, fillMs);
+		std::printf("  std::stable_sort %8.3f ms   radix %8.3f ms   radix (jobs) %8.3f ms   order %s\n", stdSortMs, serialMs, parallelMs,
+			serialMatch && parallelMatch ? "match" : "DIFFER");
+		std::printf("  vertex buffer binds: submission order %u   sorted %u\n", unsortedBinds, sortedBinds);
+	}
+}
+
+int runBenchmarks()
+{
+	JobSystem jobSystem;
+	std::printf("Job system: %u threads\n\n", jobSystem.getThreadCount());
+
+	benchmarkOcclusion(jobSystem);
+	benchmarkSceneGraph();
+	benchmarkTransforms();
+	benchmarkEntities();
+	benchmarkHandles();
+	benchmarkBvh(jobSystem);
+	benchmarkClusteredLights();
+	benchmarkRenderQueue(jobSystem);
+
+	return 0;
+}
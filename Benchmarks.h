@@ -0,0 +1,5 @@
+#pragma once
+
+// CPU micro benchmarks, run with "--benchmark" instead of opening a window
+// Prints timings to stdout, returns the process exit code
+int runBenchmarks();
@@ -0,0 +1,679 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "JobSystem.h"
+
+namespace {
+	enum ProxyState
+	{
+		PROXY_FREE,
+		PROXY_PENDING,
+		PROXY_IN_TREE
+	};
+
+	enum CullResult
+	{
+		CULL_OUTSIDE,
+		CULL_INTERSECT,
+		CULL_INSIDE			// Whole box passes, the subtree needs no more tests
+	};
+
+	const uint32_t BIN_COUNT = 12;
+	const uint32_t MAX_DEPTH = 64;			// Deeper splits fall back to the median, bounds the raycast stack
+	const float REBUILD_COST_RATIO = 1.5f;	// Refitted tree this much worse than the built one
+
+	float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	Aabb emptyAabb()
+	{
+		return { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()) };
+	}
+
+	void growAabb(Aabb& box, const Aabb& other)
+	{
+		box.min = glm::min(box.min, other.min);
+		box.max = glm::max(box.max, other.max);
+	}
+
+	bool sameAabb(const Aabb& a, const Aabb& b)
+	{
+		return a.min == b.min && a.max == b.max;
+	}
+
+	// Box against every plane: outside as soon as its most positive corner is behind one
+	int classifyFrustum(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max)
+	{
+		int result = CULL_INSIDE;
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			glm::vec3 positive(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+			glm::vec3 negative(plane.x >= 0.0f ? min.x : max.x, plane.y >= 0.0f ? min.y : max.y, plane.z >= 0.0f ? min.z : max.z);
+			if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) { return CULL_OUTSIDE; }
+			if (glm::dot(glm::vec3(plane), negative) + plane.w < 0.0f) { result = CULL_INTERSECT; }
+		}
+		return result;
+	}
+
+	// Slab test, entry distance (clamped to the ray start) in entry
+	bool rayHitsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& min, const glm::vec3& max,
+		float maxDistance, float& entry)
+	{
+		glm::vec3 t0 = (min - origin) * inverseDirection;
+		glm::vec3 t1 = (max - origin) * inverseDirection;
+		glm::vec3 entries = glm::min(t0, t1);
+		glm::vec3 exits = glm::max(t0, t1);
+		float tNear = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+		float tFar = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+		entry = tNear;
+		return tNear <= tFar;
+	}
+}
+
+Aabb transformAabb(const Aabb& box, const glm::mat4& transform)
+{
+	// Centre moves with the matrix, the half size through its absolute values
+	glm::vec3 centre = (box.min + box.max) * 0.5f;
+	glm::vec3 extent = (box.max - box.min) * 0.5f;
+	glm::vec3 newCentre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+	glm::vec3 newExtent = glm::abs(glm::vec3(transform[0])) * extent.x + glm::abs(glm::vec3(transform[1])) * extent.y
+		+ glm::abs(glm::vec3(transform[2])) * extent.z;
+	return { newCentre - newExtent, newCentre + newExtent };
+}
+
+Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];		// Left
+	frustum.planes[1] = rows[3] - rows[0];		// Right
+	frustum.planes[2] = rows[3] + rows[1];		// Bottom
+	frustum.planes[3] = rows[3] - rows[1];		// Top
+	frustum.planes[4] = rows[3] + rows[2];		// Near
+	frustum.planes[5] = rows[3] - rows[2];		// Far
+	return frustum;
+}
+
+// - PROXIES ------------------------------------------------------------------------------------------------------------------
+
+uint32_t Bvh::createProxy(const Aabb& bounds, uint32_t userData)
+{
+	uint32_t proxy;
+	if (!freeProxies.empty())
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = static_cast<uint32_t>(proxies.size());
+		proxies.push_back({});
+	}
+
+	proxies[proxy] = { bounds, userData, static_cast<uint32_t>(pendingProxies.size()), PROXY_PENDING };
+	pendingProxies.push_back(proxy);
+	return proxy;
+}
+
+void Bvh::destroyProxy(uint32_t proxy)
+{
+	if (proxy >= proxies.size() || proxies[proxy].state == PROXY_FREE) { return; }
+
+	Proxy& record = proxies[proxy];
+	if (record.state == PROXY_IN_TREE)
+	{
+		// Slot stays in its leaf (skipped by queries) until the next rebuild
+		slotProxies[record.slot] = INVALID_PROXY;
+		deadSlots++;
+	}
+	else
+	{
+		uint32_t last = pendingProxies.back();
+		pendingProxies[record.slot] = last;
+		proxies[last].slot = record.slot;
+		pendingProxies.pop_back();
+	}
+
+	record.state = PROXY_FREE;
+	freeProxies.push_back(proxy);
+}
+
+void Bvh::moveProxy(uint32_t proxy, const Aabb& bounds)
+{
+	Proxy& record = proxies[proxy];
+	if (sameAabb(record.bounds, bounds)) { return; }
+
+	record.bounds = bounds;
+	if (record.state != PROXY_IN_TREE) { return; }
+
+	slotBounds[record.slot] = bounds;
+	if (!slotMoved[record.slot])
+	{
+		slotMoved[record.slot] = 1;
+		movedSlots.push_back(record.slot);
+	}
+}
+
+void Bvh::setUserData(uint32_t proxy, uint32_t userData)
+{
+	Proxy& record = proxies[proxy];
+	record.userData = userData;
+	if (record.state == PROXY_IN_TREE)
+	{
+		slotUserData[record.slot] = userData;
+	}
+}
+
+uint32_t Bvh::getUserData(uint32_t proxy) const
+{
+	return proxies[proxy].userData;
+}
+
+const Aabb& Bvh::getBounds(uint32_t proxy) const
+{
+	return proxies[proxy].bounds;
+}
+
+// - BUILD --------------------------------------------------------------------------------------------------------------------
+
+void Bvh::commit()
+{
+	uint32_t slotCount = static_cast<uint32_t>(slotBounds.size());
+	if (pendingProxies.size() > 32 + slotCount / 8 || deadSlots > slotCount / 4)
+	{
+		rebuild();
+		return;
+	}
+
+	if (!movedSlots.empty())
+	{
+		refitMoved();
+		if (cost > builtCost * REBUILD_COST_RATIO)
+		{
+			rebuild();
+		}
+	}
+}
+
+void Bvh::rebuild()
+{
+	// Every live proxy, from the old tree and the pending list, copied out so the build partitions contiguous records
+	std::vector<BuildItem> items;
+	items.reserve(slotProxies.size() - deadSlots + pendingProxies.size());
+	auto addItem = [&](uint32_t proxy)
+	{
+		const Aabb& bounds = proxies[proxy].bounds;
+		items.push_back({ bounds, (bounds.min + bounds.max) * 0.5f, proxy });
+	};
+	for (uint32_t proxy : slotProxies)
+	{
+		if (proxy != INVALID_PROXY) { addItem(proxy); }
+	}
+	for (uint32_t proxy : pendingProxies)
+	{
+		addItem(proxy);
+	}
+
+	// Leaves take the build order as their slots
+	uint32_t proxyCount = static_cast<uint32_t>(items.size());
+	nodes.clear();
+	nodeParents.clear();
+	slotLeaves.assign(proxyCount, 0);
+	if (proxyCount > 0)
+	{
+		nodes.reserve(proxyCount / 2 + 1);
+		nodeParents.reserve(proxyCount / 2 + 1);
+		buildNode(items, 0, proxyCount, INVALID_PROXY, 0);
+	}
+
+	slotBounds.resize(proxyCount);
+	slotUserData.resize(proxyCount);
+	slotProxies.resize(proxyCount);
+	for (uint32_t slot = 0; slot < proxyCount; slot++)
+	{
+		Proxy& record = proxies[items[slot].proxy];
+		record.slot = slot;
+		record.state = PROXY_IN_TREE;
+		slotBounds[slot] = record.bounds;
+		slotUserData[slot] = record.userData;
+		slotProxies[slot] = items[slot].proxy;
+	}
+
+	pendingProxies.clear();
+	movedSlots.clear();
+	slotMoved.assign(proxyCount, 0);
+	deadSlots = 0;
+
+	refitAll();
+	builtCost = cost;
+	rebuildCount++;
+}
+
+uint32_t Bvh::buildNode(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, uint32_t parent, uint32_t depth)
+{
+	uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.push_back({});
+	nodeParents.push_back(parent);
+	nodes[index].firstSlot = begin;
+
+	uint32_t count = end - begin;
+	if (count <= MAX_LEAF_SIZE)
+	{
+		nodes[index].skipOrCount = LEAF_BIT | count;
+		std::fill(slotLeaves.begin() + begin, slotLeaves.begin() + end, index);
+		return index;
+	}
+
+	Aabb centroidBounds = emptyAabb();
+	for (uint32_t i = begin; i < end; i++)
+	{
+		centroidBounds.min = glm::min(centroidBounds.min, items[i].centroid);
+		centroidBounds.max = glm::max(centroidBounds.max, items[i].centroid);
+	}
+	glm::vec3 centroidExtent = centroidBounds.max - centroidBounds.min;
+
+	// Binned SAH: bin the centroids on every axis in one pass, cost of a split = area * count of both sides
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+	float bestCost = std::numeric_limits<float>::max();
+	glm::vec3 binScale(0.0f);
+	if (depth < MAX_DEPTH)
+	{
+		Aabb binBounds[3][BIN_COUNT];
+		uint32_t binCounts[3][BIN_COUNT] = {};
+		for (int axis = 0; axis < 3; axis++)
+		{
+			std::fill(binBounds[axis], binBounds[axis] + BIN_COUNT, emptyAabb());
+			binScale[axis] = centroidExtent[axis] > 0.0f ? BIN_COUNT / centroidExtent[axis] : 0.0f;
+		}
+		for (uint32_t i = begin; i < end; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				uint32_t bin = std::min(static_cast<uint32_t>((items[i].centroid[axis] - centroidBounds.min[axis]) * binScale[axis]), BIN_COUNT - 1);
+				growAabb(binBounds[axis][bin], items[i].bounds);
+				binCounts[axis][bin]++;
+			}
+		}
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (centroidExtent[axis] <= 0.0f) { continue; }
+
+			// Right side areas swept from the end, then the left side from the start
+			float rightAreas[BIN_COUNT];
+			uint32_t rightCounts[BIN_COUNT];
+			Aabb right = emptyAabb();
+			uint32_t rightCount = 0;
+			for (uint32_t bin = BIN_COUNT - 1; bin > 0; bin--)
+			{
+				growAabb(right, binBounds[axis][bin]);
+				rightCount += binCounts[axis][bin];
+				rightAreas[bin] = surfaceArea(right.min, right.max);
+				rightCounts[bin] = rightCount;
+			}
+
+			Aabb left = emptyAabb();
+			uint32_t leftCount = 0;
+			for (uint32_t bin = 0; bin < BIN_COUNT - 1; bin++)
+			{
+				growAabb(left, binBounds[axis][bin]);
+				leftCount += binCounts[axis][bin];
+				if (leftCount == 0 || rightCounts[bin + 1] == 0) { continue; }
+
+				float splitCost = surfaceArea(left.min, left.max) * leftCount + rightAreas[bin + 1] * rightCounts[bin + 1];
+				if (splitCost < bestCost)
+				{
+					bestCost = splitCost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+	}
+
+	uint32_t middle;
+	if (bestAxis >= 0)
+	{
+		float axisScale = binScale[bestAxis];
+		float binMin = centroidBounds.min[bestAxis];
+		middle = static_cast<uint32_t>(std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem& item)
+		{
+			return std::min(static_cast<uint32_t>((item.centroid[bestAxis] - binMin) * axisScale), BIN_COUNT - 1) <= bestBin;
+		}) - items.begin());
+	}
+	else
+	{
+		// Identical centroids or too deep: halve along the widest axis
+		int axis = centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z ? 0 : (centroidExtent.y >= centroidExtent.z ? 1 : 2);
+		middle = begin + count / 2;
+		std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [&](const BuildItem& a, const BuildItem& b)
+		{
+			return a.centroid[axis] < b.centroid[axis];
+		});
+	}
+
+	buildNode(items, begin, middle, index, depth + 1);
+	buildNode(items, middle, end, index, depth + 1);
+	nodes[index].skipOrCount = static_cast<uint32_t>(nodes.size());
+	return index;
+}
+
+// - REFIT --------------------------------------------------------------------------------------------------------------------
+
+void Bvh::setNodeBounds(uint32_t node)
+{
+	Node& target = nodes[node];
+	Aabb bounds = emptyAabb();
+	if (target.skipOrCount & LEAF_BIT)
+	{
+		// Destroyed slots still count until the next rebuild (conservative)
+		for (uint32_t slot = target.firstSlot; slot < getSlotEnd(node); slot++)
+		{
+			growAabb(bounds, slotBounds[slot]);
+		}
+	}
+	else
+	{
+		uint32_t left = node + 1;
+		uint32_t right = getSubtreeEnd(left);
+		bounds.min = glm::min(nodes[left].min, nodes[right].min);
+		bounds.max = glm::max(nodes[left].max, nodes[right].max);
+	}
+	target.min = bounds.min;
+	target.max = bounds.max;
+}
+
+void Bvh::refitAll()
+{
+	// Children come after their parent
+	for (uint32_t node = static_cast<uint32_t>(nodes.size()); node-- > 0;)
+	{
+		setNodeBounds(node);
+	}
+
+	// SAH cost: one traversal step per interior node, one test per leaf slot, weighted by area
+	cost = 0.0f;
+	if (nodes.empty()) { return; }
+
+	float rootArea = std::max(surfaceArea(nodes[0].min, nodes[0].max), std::numeric_limits<float>::min());
+	for (const Node& node : nodes)
+	{
+		float weight = (node.skipOrCount & LEAF_BIT) ? static_cast<float>(node.skipOrCount & ~LEAF_BIT) : 1.0f;
+		cost += surfaceArea(node.min, node.max) * weight;
+	}
+	cost /= rootArea;
+}
+
+void Bvh::refitMoved()
+{
+	// Many moved: one sweep over all nodes is cheaper than walking up from each (and re-measures the cost)
+	if (movedSlots.size() * 8 > nodes.size())
+	{
+		refitAll();
+	}
+	else
+	{
+		// Walk up from each moved leaf until a node's bounds stop changing
+		for (uint32_t slot : movedSlots)
+		{
+			for (uint32_t node = slotLeaves[slot]; node != INVALID_PROXY; node = nodeParents[node])
+			{
+				Aabb old = { nodes[node].min, nodes[node].max };
+				setNodeBounds(node);
+				if (old.min == nodes[node].min && old.max == nodes[node].max) { break; }
+			}
+		}
+	}
+
+	for (uint32_t slot : movedSlots)
+	{
+		slotMoved[slot] = 0;
+	}
+	movedSlots.clear();
+}
+
+uint32_t Bvh::getSubtreeEnd(uint32_t node) const
+{
+	return (nodes[node].skipOrCount & LEAF_BIT) ? node + 1 : nodes[node].skipOrCount;
+}
+
+uint32_t Bvh::getSlotEnd(uint32_t node) const
+{
+	const Node& target = nodes[node];
+	if (target.skipOrCount & LEAF_BIT) { return target.firstSlot + (target.skipOrCount & ~LEAF_BIT); }
+
+	// The next subtree starts where this one's slots end
+	return target.skipOrCount < nodes.size() ? nodes[target.skipOrCount].firstSlot : static_cast<uint32_t>(slotBounds.size());
+}
+
+// - QUERIES ------------------------------------------------------------------------------------------------------------------
+
+template <typename Classify>
+void Bvh::traverse(uint32_t beginNode, uint32_t endNode, const Classify& classify, std::vector<uint32_t>& results) const
+{
+	uint32_t node = beginNode;
+	while (node < endNode)
+	{
+		const Node& current = nodes[node];
+		int result = classify(current.min, current.max);
+		if (result == CULL_OUTSIDE)
+		{
+			node = getSubtreeEnd(node);
+			continue;
+		}
+
+		if (result == CULL_INSIDE)
+		{
+			uint32_t slotEnd = getSlotEnd(node);
+			for (uint32_t slot = current.firstSlot; slot < slotEnd; slot++)
+			{
+				if (slotProxies[slot] != INVALID_PROXY) { results.push_back(slotUserData[slot]); }
+			}
+			node = getSubtreeEnd(node);
+			continue;
+		}
+
+		if (current.skipOrCount & LEAF_BIT)
+		{
+			uint32_t slotEnd = getSlotEnd(node);
+			for (uint32_t slot = current.firstSlot; slot < slotEnd; slot++)
+			{
+				if (slotProxies[slot] != INVALID_PROXY && classify(slotBounds[slot].min, slotBounds[slot].max) != CULL_OUTSIDE)
+				{
+					results.push_back(slotUserData[slot]);
+				}
+			}
+		}
+		node++;
+	}
+}
+
+template <typename Classify>
+void Bvh::testPending(const Classify& classify, std::vector<uint32_t>& results) const
+{
+	for (uint32_t proxy : pendingProxies)
+	{
+		if (classify(proxies[proxy].bounds.min, proxies[proxy].bounds.max) != CULL_OUTSIDE)
+		{
+			results.push_back(proxies[proxy].userData);
+		}
+	}
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const
+{
+	auto classify = [&](const glm::vec3& min, const glm::vec3& max) { return classifyFrustum(frustum, min, max); };
+	traverse(0, static_cast<uint32_t>(nodes.size()), classify, results);
+	testPending(classify, results);
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, JobSystem& jobSystem, std::vector<uint32_t>& results) const
+{
+	auto classify = [&](const glm::vec3& min, const glm::vec3& max) { return classifyFrustum(frustum, min, max); };
+
+	// Split the top of the tree into subtrees of about grain proxies, in depth first order so results keep the serial order
+	uint32_t grain = std::max(static_cast<uint32_t>(slotBounds.size()) / (jobSystem.getThreadCount() * 8), 1024u);
+	std::vector<uint32_t> subtrees;
+	uint32_t node = 0;
+	while (node < nodes.size())
+	{
+		int result = classify(nodes[node].min, nodes[node].max);
+		if (result == CULL_OUTSIDE)
+		{
+			node = getSubtreeEnd(node);
+		}
+		else if (result == CULL_INSIDE || (nodes[node].skipOrCount & LEAF_BIT) || getSlotEnd(node) - nodes[node].firstSlot <= grain)
+		{
+			subtrees.push_back(node);
+			node = getSubtreeEnd(node);
+		}
+		else
+		{
+			node++;
+		}
+	}
+
+	std::vector<std::vector<uint32_t>> subtreeResults(subtrees.size());
+	jobSystem.parallelFor(static_cast<uint32_t>(subtrees.size()), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			traverse(subtrees[i], getSubtreeEnd(subtrees[i]), classify, subtreeResults[i]);
+		}
+	});
+
+	for (const std::vector<uint32_t>& subtreeResult : subtreeResults)
+	{
+		results.insert(results.end(), subtreeResult.begin(), subtreeResult.end());
+	}
+	testPending(classify, results);
+}
+
+void Bvh::queryAabb(const Aabb& box, std::vector<uint32_t>& results) const
+{
+	auto classify = [&](const glm::vec3& min, const glm::vec3& max)
+	{
+		if (glm::any(glm::lessThan(max, box.min)) || glm::any(glm::greaterThan(min, box.max))) { return CULL_OUTSIDE; }
+		return glm::all(glm::greaterThanEqual(min, box.min)) && glm::all(glm::lessThanEqual(max, box.max)) ? CULL_INSIDE : CULL_INTERSECT;
+	};
+	traverse(0, static_cast<uint32_t>(nodes.size()), classify, results);
+	testPending(classify, results);
+}
+
+void Bvh::querySphere(const glm::vec3& centre, float radius, std::vector<uint32_t>& results) const
+{
+	float radiusSquared = radius * radius;
+	auto classify = [&](const glm::vec3& min, const glm::vec3& max)
+	{
+		// Nearest point of the box to the centre, then the farthest corner for containment
+		glm::vec3 nearest = glm::clamp(centre, min, max);
+		if (glm::dot(nearest - centre, nearest - centre) > radiusSquared) { return CULL_OUTSIDE; }
+
+		glm::vec3 farthest = glm::max(glm::abs(min - centre), glm::abs(max - centre));
+		return glm::dot(farthest, farthest) <= radiusSquared ? CULL_INSIDE : CULL_INTERSECT;
+	};
+	traverse(0, static_cast<uint32_t>(nodes.size()), classify, results);
+	testPending(classify, results);
+}
+
+uint32_t Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const
+{
+	glm::vec3 inverseDirection = 1.0f / direction;
+	uint32_t hitProxy = INVALID_PROXY;
+	float nearest = maxDistance;
+	float entry;
+
+	// Closer child first, subtrees entered beyond the nearest hit are skipped
+	uint32_t stack[MAX_DEPTH * 2 + 2];
+	float stackEntries[MAX_DEPTH * 2 + 2];
+	uint32_t stackSize = 0;
+	if (!nodes.empty() && rayHitsBox(origin, inverseDirection, nodes[0].min, nodes[0].max, nearest, entry))
+	{
+		stack[stackSize] = 0;
+		stackEntries[stackSize++] = entry;
+	}
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		uint32_t node = stack[stackSize];
+		if (stackEntries[stackSize] > nearest) { continue; }
+
+		const Node& current = nodes[node];
+		if (current.skipOrCount & LEAF_BIT)
+		{
+			uint32_t slotEnd = getSlotEnd(node);
+			for (uint32_t slot = current.firstSlot; slot < slotEnd; slot++)
+			{
+				if (slotProxies[slot] != INVALID_PROXY && rayHitsBox(origin, inverseDirection, slotBounds[slot].min, slotBounds[slot].max, nearest, entry))
+				{
+					nearest = entry;
+					hitProxy = slotProxies[slot];
+				}
+			}
+			continue;
+		}
+
+		uint32_t children[2] = { node + 1, getSubtreeEnd(node + 1) };
+		float childEntries[2];
+		bool childHits[2];
+		for (int child = 0; child < 2; child++)
+		{
+			childHits[child] = rayHitsBox(origin, inverseDirection, nodes[children[child]].min, nodes[children[child]].max, nearest, childEntries[child]);
+		}
+
+		// Push the farther one first so the closer one is popped next
+		int first = childHits[0] && childHits[1] && childEntries[1] < childEntries[0] ? 1 : 0;
+		for (int i = 1; i >= 0; i--)
+		{
+			int child = i == 0 ? first : 1 - first;
+			if (!childHits[child]) { continue; }
+			stack[stackSize] = children[child];
+			stackEntries[stackSize++] = childEntries[child];
+		}
+	}
+
+	for (uint32_t proxy : pendingProxies)
+	{
+		if (rayHitsBox(origin, inverseDirection, proxies[proxy].bounds.min, proxies[proxy].bounds.max, nearest, entry))
+		{
+			nearest = entry;
+			hitProxy = proxy;
+		}
+	}
+
+	hitDistance = nearest;
+	return hitProxy;
+}
+
+uint32_t Bvh::getProxyCount() const
+{
+	return static_cast<uint32_t>(proxies.size() - freeProxies.size());
+}
+
+uint32_t Bvh::getNodeCount() const
+{
+	return static_cast<uint32_t>(nodes.size());
+}
+
+uint32_t Bvh::getRebuildCount() const
+{
+	return rebuildCount;
+}
+
+float Bvh::getCost() const
+{
+	return cost;
+}
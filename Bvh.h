@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+class JobSystem;
+
+// Box around a box after an affine transform
+Aabb transformAabb(const Aabb& box, const glm::mat4& transform);
+
+// Planes (xyz normal pointing inside, w offset) of a view-projection with GL clip space depth (-w <= z <= w)
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// Dynamic bounding volume hierarchy over boxes (proxies), for culling and spatial queries
+// Nodes are flat and depth first (a node's subtree is the range up to its skip index, its proxies are contiguous),
+// built with binned SAH. Moved proxies are refitted at commit, new ones are tested linearly until the next rebuild,
+// which commit does once enough has changed (or the refitted tree got too much worse than the built one)
+class Bvh
+{
+public:
+	static constexpr uint32_t INVALID_PROXY = 0xffffffff;
+	static const uint32_t MAX_LEAF_SIZE = 4;
+
+	// Proxy ids are stable until destroyed, then reused
+	uint32_t createProxy(const Aabb& bounds, uint32_t userData);
+	void destroyProxy(uint32_t proxy);
+	void moveProxy(uint32_t proxy, const Aabb& bounds);
+	void setUserData(uint32_t proxy, uint32_t userData);
+	uint32_t getUserData(uint32_t proxy) const;
+	const Aabb& getBounds(uint32_t proxy) const;
+
+	// Applies the changes since the last commit (queries see moved proxies at their old place until then)
+	void commit();
+	void rebuild();
+
+	// Add the userData of every proxy whose box passes, in the same order every time for the same tree
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const;
+	void queryFrustum(const Frustum& frustum, JobSystem& jobSystem, std::vector<uint32_t>& results) const;	// Subtrees in parallel, same results
+	void queryAabb(const Aabb& box, std::vector<uint32_t>& results) const;
+	void querySphere(const glm::vec3& centre, float radius, std::vector<uint32_t>& results) const;
+
+	// Proxy whose box the ray enters first within maxDistance (direction needn't be normalized, distances are in its units)
+	uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const;
+
+	uint32_t getProxyCount() const;
+	uint32_t getNodeCount() const;
+	uint32_t getRebuildCount() const;
+	float getCost() const;				// SAH cost of the tree as last built or refitted, relative to the root area
+
+private:
+	static const uint32_t LEAF_BIT = 0x80000000;
+
+	struct Node
+	{
+		glm::vec3 min;
+		uint32_t firstSlot;				// First proxy slot of the subtree
+		glm::vec3 max;
+		uint32_t skipOrCount;			// Interior: node after the subtree, leaf: LEAF_BIT | slot count
+	};
+
+	struct Proxy
+	{
+		Aabb bounds;
+		uint32_t userData;
+		uint32_t slot;					// Leaf slot, or index in pendingProxies
+		uint8_t state;					// PROXY_*
+	};
+
+	struct BuildItem
+	{
+		Aabb bounds;
+		glm::vec3 centroid;
+		uint32_t proxy;
+	};
+
+	// - Tree
+	std::vector<Node> nodes;
+	std::vector<uint32_t> nodeParents;
+	std::vector<Aabb> slotBounds;		// Proxy boxes in leaf order (kept in sync by moveProxy)
+	std::vector<uint32_t> slotUserData;
+	std::vector<uint32_t> slotProxies;	// INVALID_PROXY once destroyed
+	std::vector<uint32_t> slotLeaves;
+	uint32_t deadSlots = 0;
+	float builtCost = 0.0f;
+	float cost = 0.0f;
+	uint32_t rebuildCount = 0;
+
+	// - Proxies
+	std::vector<Proxy> proxies;
+	std::vector<uint32_t> freeProxies;
+	std::vector<uint32_t> pendingProxies;	// Created since the last rebuild
+	std::vector<uint32_t> movedSlots;		// Since the last commit
+	std::vector<uint8_t> slotMoved;
+
+	uint32_t buildNode(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, uint32_t parent, uint32_t depth);
+	void refitAll();
+	void refitMoved();
+	void setNodeBounds(uint32_t node);
+	uint32_t getSubtreeEnd(uint32_t node) const;
+	uint32_t getSlotEnd(uint32_t node) const;
+
+	template <typename Classify>
+	void traverse(uint32_t beginNode, uint32_t endNode, const Classify& classify, std::vector<uint32_t>& results) const;
+	template <typename Classify>
+	void testPending(const Classify& classify, std::vector<uint32_t>& results) const;
+};
@@ -0,0 +1,108 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+Light makePointLight(const glm::vec3& position, float range, const glm::vec3& colour)
+{
+	Light light;
+	light.positionRange = glm::vec4(position, range);
+	light.colour = glm::vec4(colour, -1.5f);
+	light.direction = glm::vec4(0.0f, 0.0f, -1.0f, -2.0f);	// Every direction is inside the cone
+	return light;
+}
+
+Light makeSpotLight(const glm::vec3& position, const glm::vec3& direction, float range, float innerAngle, float outerAngle,
+	const glm::vec3& colour)
+{
+	outerAngle = std::min(outerAngle, glm::radians(89.0f));
+	innerAngle = std::min(innerAngle, outerAngle * 0.99f);
+
+	Light light;
+	light.positionRange = glm::vec4(position, range);
+	light.colour = glm::vec4(colour, std::cos(innerAngle));
+	light.direction = glm::vec4(glm::normalize(direction), std::cos(outerAngle));
+	return light;
+}
+
+LightGridData makeLightGridData(const glm::mat4& view, const glm::mat4& projection, VkExtent2D extent, uint32_t lightCount)
+{
+	float nearDistance = projection[3][2] / (projection[2][2] - 1.0f);
+	float farDistance = projection[3][2] / (projection[2][2] + 1.0f);
+	float sliceScale = LIGHT_SLICES / std::log(farDistance / nearDistance);
+
+	LightGridData grid;
+	grid.view = view;
+	grid.projection = glm::vec4(projection[0][0], projection[1][1], nearDistance, farDistance);
+	grid.slicing = glm::vec4(sliceScale, std::log(nearDistance) * sliceScale,
+		static_cast<float>(LIGHT_TILES_X) / extent.width, static_cast<float>(LIGHT_TILES_Y) / extent.height);
+	grid.lightCount = glm::uvec4(std::min(lightCount, MAX_LIGHTS), 0, 0, 0);
+	return grid;
+}
+
+uint32_t getLightCluster(const LightGridData& grid, const glm::vec2& fragCoord, float viewDepth)
+{
+	float slice = std::log(viewDepth) * grid.slicing.x - grid.slicing.y;
+	uint32_t z = static_cast<uint32_t>(std::min(std::max(slice, 0.0f), static_cast<float>(LIGHT_SLICES - 1)));
+	uint32_t x = std::min(static_cast<uint32_t>(fragCoord.x * grid.slicing.z), LIGHT_TILES_X - 1);
+	uint32_t y = std::min(static_cast<uint32_t>(fragCoord.y * grid.slicing.w), LIGHT_TILES_Y - 1);
+	return (z * LIGHT_TILES_Y + y) * LIGHT_TILES_X + x;
+}
+
+void binLights(const LightGridData& grid, const std::vector<Light>& lights, std::vector<uint32_t>& counts,
+	std::vector<uint16_t>& indices)
+{
+	counts.assign(LIGHT_CLUSTER_COUNT, 0);
+	indices.resize(static_cast<size_t>(LIGHT_CLUSTER_COUNT) * MAX_CLUSTER_LIGHTS);
+
+	// Lights in view space, as the workgroup's shared batches hold them
+	uint32_t lightCount = std::min(grid.lightCount.x, static_cast<uint32_t>(lights.size()));
+	std::vector<glm::vec4> spheres(lightCount), cones(lightCount);
+	for (uint32_t i = 0; i < lightCount; i++)
+	{
+		spheres[i] = glm::vec4(glm::vec3(grid.view * glm::vec4(glm::vec3(lights[i].positionRange), 1.0f)), lights[i].positionRange.w);
+		cones[i] = glm::vec4(glm::mat3(grid.view) * glm::vec3(lights[i].direction), lights[i].direction.w);
+	}
+
+	float depthRatio = grid.projection.w / grid.projection.z;
+	for (uint32_t cluster = 0; cluster < LIGHT_CLUSTER_COUNT; cluster++)
+	{
+		// View space box around the cluster: its screen rectangle over the near and far depth of its slice
+		uint32_t x = cluster % LIGHT_TILES_X;
+		uint32_t y = (cluster / LIGHT_TILES_X) % LIGHT_TILES_Y;
+		uint32_t z = cluster / (LIGHT_TILES_X * LIGHT_TILES_Y);
+		glm::vec2 ndcMin = glm::vec2(-1.0f) + 2.0f * glm::vec2(x, y) / glm::vec2(LIGHT_TILES_X, LIGHT_TILES_Y);
+		glm::vec2 ndcMax = ndcMin + 2.0f / glm::vec2(LIGHT_TILES_X, LIGHT_TILES_Y);
+		float depthNear = grid.projection.z * std::pow(depthRatio, static_cast<float>(z) / LIGHT_SLICES);
+		float depthFar = grid.projection.z * std::pow(depthRatio, static_cast<float>(z + 1) / LIGHT_SLICES);
+
+		glm::vec2 scale = 1.0f / glm::vec2(grid.projection.x, grid.projection.y);
+		glm::vec2 a = ndcMin * scale * depthNear, b = ndcMax * scale * depthNear;
+		glm::vec2 c = ndcMin * scale * depthFar, d = ndcMax * scale * depthFar;
+		glm::vec3 boxMin = glm::vec3(glm::min(glm::min(a, b), glm::min(c, d)), -depthFar);
+		glm::vec3 boxMax = glm::vec3(glm::max(glm::max(a, b), glm::max(c, d)), -depthNear);
+		glm::vec3 boxCentre = (boxMin + boxMax) * 0.5f;
+		float boxRadius = glm::length(boxMax - boxMin) * 0.5f;
+
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < lightCount && count < MAX_CLUSTER_LIGHTS; i++)
+		{
+			glm::vec3 centre = glm::vec3(spheres[i]);
+			glm::vec3 offset = glm::clamp(centre, boxMin, boxMax) - centre;
+			if (glm::dot(offset, offset) > spheres[i].w * spheres[i].w) { continue; }
+
+			// Spot: the box's bounding sphere has to reach into the cone
+			if (cones[i].w > -1.0f)
+			{
+				glm::vec3 toBox = boxCentre - centre;
+				float axial = glm::dot(toBox, glm::vec3(cones[i]));
+				float lateral = std::sqrt(std::max(glm::dot(toBox, toBox) - axial * axial, 0.0f));
+				float closest = cones[i].w * lateral - std::sqrt(1.0f - cones[i].w * cones[i].w) * axial;
+				if (closest > boxRadius || axial < -boxRadius) { continue; }
+			}
+
+			indices[static_cast<size_t>(cluster) * MAX_CLUSTER_LIGHTS + count++] = static_cast<uint16_t>(i);
+		}
+		counts[cluster] = count;
+	}
+}
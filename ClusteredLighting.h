@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+// Light clusters: screen tiles split into exponential view depth slices (matches Shaders/clustered_lighting.glsl)
+const uint32_t LIGHT_TILES_X = 16;
+const uint32_t LIGHT_TILES_Y = 9;
+const uint32_t LIGHT_SLICES = 24;
+const uint32_t LIGHT_CLUSTER_COUNT = LIGHT_TILES_X * LIGHT_TILES_Y * LIGHT_SLICES;
+const uint32_t MAX_CLUSTER_LIGHTS = 256;		// Per cluster, further lights are dropped (even: indices are stored in pairs)
+const uint32_t MAX_LIGHTS = 16384;				// Per frame (16-bit light indices)
+
+// Point or spot light (matches Light in Shaders/clustered_lighting.glsl)
+struct Light
+{
+	glm::vec4 positionRange;			// World position, range (no light past it)
+	glm::vec4 colour;					// Linear colour times intensity, w = cos of the inner cone angle
+	glm::vec4 direction;				// Spot direction, w = cos of the outer cone angle (below -1 for point lights)
+};
+
+Light makePointLight(const glm::vec3& position, float range, const glm::vec3& colour);
+// Angles in radians from the axis, full intensity inside the inner cone fading out to the outer one (below 90 degrees)
+Light makeSpotLight(const glm::vec3& position, const glm::vec3& direction, float range, float innerAngle, float outerAngle,
+	const glm::vec3& colour);
+
+// Grid of one frame (matches LightGrid in Shaders/clustered_lighting.glsl)
+struct LightGridData
+{
+	glm::mat4 view;
+	glm::vec4 projection;				// P[0][0], P[1][1], near and far distance
+	glm::vec4 slicing;					// Slice = log(view depth) * x - y, z and w = tiles per pixel
+	glm::uvec4 lightCount;				// x = lights this frame
+};
+
+// Slices from the near to the far plane of a GL style perspective projection (y may be flipped)
+LightGridData makeLightGridData(const glm::mat4& view, const glm::mat4& projection, VkExtent2D extent, uint32_t lightCount);
+
+// Cluster of a fragment at a framebuffer position and view depth
+uint32_t getLightCluster(const LightGridData& grid, const glm::vec2& fragCoord, float viewDepth);
+
+// CPU reference of Shaders/light_binning.comp: counts per cluster, indices MAX_CLUSTER_LIGHTS apart (unpacked)
+void binLights(const LightGridData& grid, const std::vector<Light>& lights, std::vector<uint32_t>& counts,
+	std::vector<uint16_t>& indices);
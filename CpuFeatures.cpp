@@ -0,0 +1,53 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+	CpuFeatures detectCpuFeatures()
+	{
+		CpuFeatures features = {};
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		int leaf1[4] = {};
+		int leaf7[4] = {};
+#if defined(_MSC_VER)
+		__cpuid(leaf1, 1);
+		__cpuidex(leaf7, 7, 0);
+#else
+		__cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+		__cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+
+		features.sse41 = (leaf1[2] & (1 << 19)) != 0;
+
+		// AVX state must also be enabled by the OS (OSXSAVE + XCR0 saving XMM and YMM registers)
+		bool osAvx = false;
+		if ((leaf1[2] & (1 << 27)) != 0 && (leaf1[2] & (1 << 28)) != 0)
+		{
+#if defined(_MSC_VER)
+			unsigned long long xcr0 = _xgetbv(0);
+#else
+			unsigned int xcr0Low = 0, xcr0High = 0;
+			__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+			unsigned long long xcr0 = xcr0Low;
+#endif
+			osAvx = (xcr0 & 0x6) == 0x6;
+		}
+
+		features.avx2 = osAvx && (leaf7[1] & (1 << 5)) != 0;
+		features.fma = osAvx && (leaf1[2] & (1 << 12)) != 0;
+#endif
+
+		return features;
+	}
+}
+
+const CpuFeatures& getCpuFeatures()
+{
+	static const CpuFeatures features = detectCpuFeatures();
+	return features;
+}
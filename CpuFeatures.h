@@ -0,0 +1,21 @@
+#pragma once
+
+// Instruction sets the running CPU (and OS) supports, detected once at first use
+struct CpuFeatures
+{
+	bool sse41;
+	bool avx2;
+	bool fma;
+};
+
+const CpuFeatures& getCpuFeatures();
+
+// Lets a function use intrinsics above the compiler's baseline (MSVC allows this without flags)
+// Only call such functions after checking getCpuFeatures()
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CPU_TARGET_SSE41
+#define CPU_TARGET_AVX2
+#else
+#define CPU_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
@@ -0,0 +1,62 @@
+#include "DeletionQueue.h"
+
+#include <algorithm>
+
+DeletionQueue::DeletionQueue(VkDevice newDevice)
+	: device(newDevice)
+{
+}
+
+void DeletionQueue::destroyBuffer(uint64_t lastUseValue, VkBuffer buffer, VkDeviceMemory memory)
+{
+	push(lastUseValue, buffer, VK_NULL_HANDLE, VK_NULL_HANDLE, memory);
+}
+
+void DeletionQueue::destroyImage(uint64_t lastUseValue, VkImage image, VkImageView view, VkDeviceMemory memory)
+{
+	push(lastUseValue, VK_NULL_HANDLE, image, view, memory);
+}
+
+uint32_t DeletionQueue::flush(uint64_t completedValue)
+{
+	uint32_t count = 0;
+	while (!pending.empty() && pending.front().lastUseValue <= completedValue)
+	{
+		destroy(pending.front());
+		pending.pop_front();
+		count++;
+	}
+	return count;
+}
+
+void DeletionQueue::flushAll()
+{
+	for (const PendingDestroy& request : pending)
+	{
+		destroy(request);
+	}
+	pending.clear();
+}
+
+size_t DeletionQueue::getPendingCount() const
+{
+	return pending.size();
+}
+
+void DeletionQueue::push(uint64_t lastUseValue, VkBuffer buffer, VkImage image, VkImageView view, VkDeviceMemory memory)
+{
+	if (!pending.empty())
+	{
+		lastUseValue = std::max(lastUseValue, pending.back().lastUseValue);
+	}
+	pending.push_back({ lastUseValue, buffer, image, view, memory });
+}
+
+void DeletionQueue::destroy(const PendingDestroy& request)
+{
+	// Views before their image, objects before their memory
+	if (request.view != VK_NULL_HANDLE) { vkDestroyImageView(device, request.view, nullptr); }
+	if (request.image != VK_NULL_HANDLE) { vkDestroyImage(device, request.image, nullptr); }
+	if (request.buffer != VK_NULL_HANDLE) { vkDestroyBuffer(device, request.buffer, nullptr); }
+	if (request.memory != VK_NULL_HANDLE) { vkFreeMemory(device, request.memory, nullptr); }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <deque>
+
+#include "utilities.h"
+
+// Destroy requests waiting for the GPU: each is queued with the timeline value of the last submission that may use the
+// resource and carried out once the timeline has reached it, so unloading at runtime never waits for the device
+class DeletionQueue
+{
+public:
+	explicit DeletionQueue(VkDevice newDevice);
+
+	// Null handles are skipped. Values lower than an earlier request's are raised to it (later is always safe)
+	void destroyBuffer(uint64_t lastUseValue, VkBuffer buffer, VkDeviceMemory memory);
+	void destroyImage(uint64_t lastUseValue, VkImage image, VkImageView view, VkDeviceMemory memory);
+
+	// Destroys what the GPU is done with (queued at or below completedValue), returns how many requests that was
+	uint32_t flush(uint64_t completedValue);
+	void flushAll();						// Device idle: destroys everything
+
+	size_t getPendingCount() const;
+
+private:
+	struct PendingDestroy
+	{
+		uint64_t lastUseValue;
+		VkBuffer buffer;
+		VkImage image;
+		VkImageView view;
+		VkDeviceMemory memory;
+	};
+
+	VkDevice device;
+	std::deque<PendingDestroy> pending;		// Queue order, values never decrease
+
+	void push(uint64_t lastUseValue, VkBuffer buffer, VkImage image, VkImageView view, VkDeviceMemory memory);
+	void destroy(const PendingDestroy& request);
+};
@@ -0,0 +1,220 @@
+#include "EntityStore.h"
+
+#include <stdexcept>
+
+namespace {
+	// Fill the hole with the last row (rows aren't kept in any order)
+	template <typename T>
+	void swapRemove(std::vector<T>& column, uint32_t row)
+	{
+		if (column.empty()) { return; }
+
+		column[row] = column.back();
+		column.pop_back();
+	}
+}
+
+EntityHandle EntityStore::createEntity(uint32_t componentMask)
+{
+	EntityHandle entity;
+	if (!freeRecords.empty())
+	{
+		entity.index = freeRecords.back();
+		freeRecords.pop_back();
+	}
+	else
+	{
+		entity.index = static_cast<uint32_t>(records.size());
+		records.push_back({ 0, 0, 0 });
+	}
+	entity.generation = records[entity.index].generation;
+
+	uint32_t archetypeIndex = findArchetype(componentMask);
+	records[entity.index].archetype = archetypeIndex;
+	records[entity.index].row = appendRow(archetypeIndex, entity);
+
+	return entity;
+}
+
+void EntityStore::destroyEntity(EntityHandle entity)
+{
+	if (!isAlive(entity)) { return; }
+
+	EntityRecord& record = records[entity.index];
+	removeRow(record.archetype, record.row);
+
+	// Old handles no longer match
+	record.generation++;
+	freeRecords.push_back(entity.index);
+}
+
+bool EntityStore::isAlive(EntityHandle entity) const
+{
+	return entity.index < records.size() && records[entity.index].generation == entity.generation;
+}
+
+void EntityStore::addComponents(EntityHandle entity, uint32_t componentMask)
+{
+	moveEntity(entity, getComponentMask(entity) | componentMask);
+}
+
+void EntityStore::removeComponents(EntityHandle entity, uint32_t componentMask)
+{
+	moveEntity(entity, getComponentMask(entity) & ~componentMask);
+}
+
+uint32_t EntityStore::getComponentMask(EntityHandle entity) const
+{
+	return archetypes[getRecord(entity).archetype].componentMask;
+}
+
+glm::mat4& EntityStore::getTransform(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_TRANSFORM, row).transforms[row];
+}
+
+glm::vec4& EntityStore::getBounds(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_BOUNDS, row).bounds[row];
+}
+
+MeshHandle& EntityStore::getMesh(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_MESH, row).meshes[row];
+}
+
+uint32_t& EntityStore::getMaterial(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_MATERIAL, row).materials[row];
+}
+
+uint32_t& EntityStore::getFlags(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_FLAGS, row).flags[row];
+}
+
+uint32_t& EntityStore::getSceneNode(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_SCENE_NODE, row).sceneNodes[row];
+}
+
+uint32_t& EntityStore::getSpatialProxy(EntityHandle entity)
+{
+	uint32_t row;
+	return getArchetype(entity, COMPONENT_SPATIAL, row).spatialProxies[row];
+}
+
+uint32_t EntityStore::countEntities(uint32_t requiredMask) const
+{
+	uint32_t count = 0;
+	for (const Archetype& archetype : archetypes)
+	{
+		if ((archetype.componentMask & requiredMask) == requiredMask)
+		{
+			count += archetype.size();
+		}
+	}
+	return count;
+}
+
+uint32_t EntityStore::findArchetype(uint32_t componentMask)
+{
+	// Few distinct masks in practice, a linear search is enough
+	for (uint32_t i = 0; i < archetypes.size(); i++)
+	{
+		if (archetypes[i].componentMask == componentMask) { return i; }
+	}
+
+	Archetype archetype = {};
+	archetype.componentMask = componentMask;
+	archetypes.push_back(archetype);
+	return static_cast<uint32_t>(archetypes.size() - 1);
+}
+
+const EntityStore::EntityRecord& EntityStore::getRecord(EntityHandle entity) const
+{
+	if (!isAlive(entity))
+	{
+		throw std::runtime_error("Entity handle is stale or invalid!");
+	}
+	return records[entity.index];
+}
+
+Archetype& EntityStore::getArchetype(EntityHandle entity, uint32_t component, uint32_t& row)
+{
+	const EntityRecord& record = getRecord(entity);
+	Archetype& archetype = archetypes[record.archetype];
+	if ((archetype.componentMask & component) == 0)
+	{
+		throw std::runtime_error("Entity does not have the requested component!");
+	}
+
+	row = record.row;
+	return archetype;
+}
+
+uint32_t EntityStore::appendRow(uint32_t archetypeIndex, EntityHandle entity)
+{
+	Archetype& archetype = archetypes[archetypeIndex];
+	uint32_t mask = archetype.componentMask;
+
+	archetype.entities.push_back(entity);
+	if (mask & COMPONENT_TRANSFORM) { archetype.transforms.push_back(glm::mat4(1.0f)); }
+	if (mask & COMPONENT_BOUNDS) { archetype.bounds.push_back(glm::vec4(0.0f)); }
+	if (mask & COMPONENT_MESH) { archetype.meshes.push_back(MeshHandle()); }
+	if (mask & COMPONENT_MATERIAL) { archetype.materials.push_back(0); }
+	if (mask & COMPONENT_FLAGS) { archetype.flags.push_back(0); }
+	if (mask & COMPONENT_SCENE_NODE) { archetype.sceneNodes.push_back(0); }
+	if (mask & COMPONENT_SPATIAL) { archetype.spatialProxies.push_back(0); }
+
+	return archetype.size() - 1;
+}
+
+void EntityStore::removeRow(uint32_t archetypeIndex, uint32_t row)
+{
+	Archetype& archetype = archetypes[archetypeIndex];
+
+	// The last entity takes over the row
+	EntityHandle moved = archetype.entities.back();
+	records[moved.index].row = row;
+
+	swapRemove(archetype.entities, row);
+	swapRemove(archetype.transforms, row);
+	swapRemove(archetype.bounds, row);
+	swapRemove(archetype.meshes, row);
+	swapRemove(archetype.materials, row);
+	swapRemove(archetype.flags, row);
+	swapRemove(archetype.sceneNodes, row);
+	swapRemove(archetype.spatialProxies, row);
+}
+
+void EntityStore::moveEntity(EntityHandle entity, uint32_t newMask)
+{
+	EntityRecord record = getRecord(entity);
+	uint32_t newArchetypeIndex = findArchetype(newMask);
+	if (newArchetypeIndex == record.archetype) { return; }
+
+	uint32_t newRow = appendRow(newArchetypeIndex, entity);
+
+	// References taken after appendRow, which may have grown the archetype list
+	Archetype& oldArchetype = archetypes[record.archetype];
+	Archetype& newArchetype = archetypes[newArchetypeIndex];
+	uint32_t shared = oldArchetype.componentMask & newMask;
+	if (shared & COMPONENT_TRANSFORM) { newArchetype.transforms[newRow] = oldArchetype.transforms[record.row]; }
+	if (shared & COMPONENT_BOUNDS) { newArchetype.bounds[newRow] = oldArchetype.bounds[record.row]; }
+	if (shared & COMPONENT_MESH) { newArchetype.meshes[newRow] = oldArchetype.meshes[record.row]; }
+	if (shared & COMPONENT_MATERIAL) { newArchetype.materials[newRow] = oldArchetype.materials[record.row]; }
+	if (shared & COMPONENT_FLAGS) { newArchetype.flags[newRow] = oldArchetype.flags[record.row]; }
+	if (shared & COMPONENT_SCENE_NODE) { newArchetype.sceneNodes[newRow] = oldArchetype.sceneNodes[record.row]; }
+	if (shared & COMPONENT_SPATIAL) { newArchetype.spatialProxies[newRow] = oldArchetype.spatialProxies[record.row]; }
+
+	removeRow(record.archetype, record.row);
+	records[entity.index].archetype = newArchetypeIndex;
+	records[entity.index].row = newRow;
+}
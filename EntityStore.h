@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+#include "GpuResources.h"
+
+// Component types an entity can have (bit mask)
+enum ComponentBits
+{
+	COMPONENT_TRANSFORM = 1 << 0,		// World matrix
+	COMPONENT_BOUNDS = 1 << 1,			// Object space bounding sphere (centre xyz, radius w)
+	COMPONENT_MESH = 1 << 2,			// Renderer mesh drawn
+	COMPONENT_MATERIAL = 1 << 3,		// Material index
+	COMPONENT_FLAGS = 1 << 4,			// ENTITY_FLAG_*
+	COMPONENT_SCENE_NODE = 1 << 5,		// Scene graph node the transform is copied from
+	COMPONENT_SPATIAL = 1 << 6			// Proxy in the renderer's BVH
+};
+
+// Everything the renderer needs to draw an entity
+const uint32_t RENDERABLE_COMPONENTS = COMPONENT_TRANSFORM | COMPONENT_BOUNDS | COMPONENT_MESH | COMPONENT_MATERIAL | COMPONENT_FLAGS;
+
+enum EntityFlags
+{
+	ENTITY_FLAG_HIDDEN = 1 << 0,		// Not drawn
+	ENTITY_FLAG_OCCLUDER = 1 << 1,		// Rasterized by software occlusion culling
+	ENTITY_FLAG_STATIC = 1 << 2			// Doesn't move: its shadow is cached
+};
+
+// Index of an entity's record plus the generation it was created in, stale once the entity is destroyed
+struct EntityHandle
+{
+	uint32_t index;
+	uint32_t generation;
+
+	bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+const EntityHandle INVALID_ENTITY = { 0xffffffff, 0 };
+
+// Every entity with exactly the same component mask, one packed array per component (unused ones stay empty)
+struct Archetype
+{
+	uint32_t componentMask;
+
+	std::vector<EntityHandle> entities;
+	std::vector<glm::mat4> transforms;
+	std::vector<glm::vec4> bounds;
+	std::vector<MeshHandle> meshes;
+	std::vector<uint32_t> materials;
+	std::vector<uint32_t> flags;
+	std::vector<uint32_t> sceneNodes;
+	std::vector<uint32_t> spatialProxies;
+
+	uint32_t size() const { return static_cast<uint32_t>(entities.size()); }
+};
+
+// Archetype based entity / component storage: systems walk the dense arrays of every archetype they need,
+// handles stay valid while other entities are created, destroyed or moved between archetypes
+class EntityStore
+{
+public:
+	// Components start zeroed (identity transform)
+	EntityHandle createEntity(uint32_t componentMask);
+	void destroyEntity(EntityHandle entity);		// Stale handles are ignored
+	bool isAlive(EntityHandle entity) const;
+
+	// Moves the entity to the archetype with the new mask, keeping the components both have
+	void addComponents(EntityHandle entity, uint32_t componentMask);
+	void removeComponents(EntityHandle entity, uint32_t componentMask);
+	uint32_t getComponentMask(EntityHandle entity) const;
+
+	// Single entity access, throws if the entity is dead or lacks the component
+	glm::mat4& getTransform(EntityHandle entity);
+	glm::vec4& getBounds(EntityHandle entity);
+	MeshHandle& getMesh(EntityHandle entity);
+	uint32_t& getMaterial(EntityHandle entity);
+	uint32_t& getFlags(EntityHandle entity);
+	uint32_t& getSceneNode(EntityHandle entity);
+	uint32_t& getSpatialProxy(EntityHandle entity);
+
+	// Calls function(Archetype&) for every non empty archetype with all of requiredMask, always in the same order
+	// Don't create, destroy or move entities inside function
+	template <typename Function>
+	void forEachArchetype(uint32_t requiredMask, Function function)
+	{
+		for (Archetype& archetype : archetypes)
+		{
+			if ((archetype.componentMask & requiredMask) == requiredMask && !archetype.entities.empty())
+			{
+				function(archetype);
+			}
+		}
+	}
+
+	uint32_t countEntities(uint32_t requiredMask) const;
+
+private:
+	struct EntityRecord
+	{
+		uint32_t generation;
+		uint32_t archetype;
+		uint32_t row;
+	};
+
+	std::vector<Archetype> archetypes;
+	std::vector<EntityRecord> records;		// Indexed by EntityHandle::index
+	std::vector<uint32_t> freeRecords;
+
+	uint32_t findArchetype(uint32_t componentMask);
+	const EntityRecord& getRecord(EntityHandle entity) const;
+	Archetype& getArchetype(EntityHandle entity, uint32_t component, uint32_t& row);
+
+	uint32_t appendRow(uint32_t archetypeIndex, EntityHandle entity);
+	void removeRow(uint32_t archetypeIndex, uint32_t row);
+	void moveEntity(EntityHandle entity, uint32_t newMask);
+};
@@ -0,0 +1,72 @@
+#include "FrameCommandPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	const uint32_t MIN_GROWTH = 4;		// Buffers per allocation call at least, lists double past it
+}
+
+FrameCommandPool::FrameCommandPool(VkDevice newDevice, uint32_t queueFamilyIndex)
+	: device(newDevice)
+{
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;		// Rerecorded every frame, reset as a whole only
+	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create frame command pool!");
+	}
+}
+
+void FrameCommandPool::reset()
+{
+	if (vkResetCommandPool(device, pool, 0) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to reset frame command pool!");
+	}
+	primaries.used = 0;
+	secondaries.used = 0;
+}
+
+VkCommandBuffer FrameCommandPool::allocate(VkCommandBufferLevel level)
+{
+	return take(level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? primaries : secondaries, level);
+}
+
+uint32_t FrameCommandPool::getBufferCount() const
+{
+	return static_cast<uint32_t>(primaries.buffers.size() + secondaries.buffers.size());
+}
+
+void FrameCommandPool::destroy()
+{
+	// Frees the pool's buffers with it
+	vkDestroyCommandPool(device, pool, nullptr);
+	pool = VK_NULL_HANDLE;
+	primaries = FreeList();
+	secondaries = FreeList();
+}
+
+VkCommandBuffer FrameCommandPool::take(FreeList& list, VkCommandBufferLevel level)
+{
+	if (list.used == list.buffers.size())
+	{
+		uint32_t growth = std::max(static_cast<uint32_t>(list.buffers.size()), MIN_GROWTH);
+
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferAllocateInfo.commandPool = pool;
+		commandBufferAllocateInfo.level = level;
+		commandBufferAllocateInfo.commandBufferCount = growth;
+
+		list.buffers.resize(list.used + growth);
+		if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &list.buffers[list.used]) != VK_SUCCESS)
+		{
+			list.buffers.resize(list.used);
+			throw std::runtime_error("Failed to allocate frame command buffers!");
+		}
+	}
+	return list.buffers[list.used++];
+}
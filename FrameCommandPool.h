@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+// Transient command pool of one frame in flight on one queue family. Command buffers are never reset one by one:
+// reset() recycles the whole pool in a single call once the frame's submissions have finished, and allocate() hands out
+// its buffers again from the free lists, growing them only when a frame records more than any frame before it
+class FrameCommandPool
+{
+public:
+	FrameCommandPool(VkDevice newDevice, uint32_t queueFamilyIndex);
+
+	// The GPU has to be done with every buffer handed out since the last reset
+	void reset();
+	// Next free buffer of the level, valid until the next reset (begin it before recording)
+	VkCommandBuffer allocate(VkCommandBufferLevel level);
+
+	uint32_t getBufferCount() const;		// Allocated from the driver so far, both levels
+
+	void destroy();
+
+private:
+	struct FreeList
+	{
+		std::vector<VkCommandBuffer> buffers;
+		uint32_t used = 0;					// Handed out since the last reset, the rest are free
+	};
+
+	VkDevice device;
+	VkCommandPool pool = VK_NULL_HANDLE;
+	FreeList primaries;
+	FreeList secondaries;
+
+	VkCommandBuffer take(FreeList& list, VkCommandBufferLevel level);
+};
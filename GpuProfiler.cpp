@@ -0,0 +1,191 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+GpuProfiler::GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, uint32_t newFrameCount, uint32_t newMaxScopes,
+	const std::string& newQueueName)
+	: device(newDevice), queueName(newQueueName), frameCount(newFrameCount), maxScopes(newMaxScopes), frames(newFrameCount)
+{
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+	if (validBits == 0) { return; }
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = frameCount * maxScopes * 2;
+	if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create timestamp Query Pool!");
+	}
+}
+
+bool GpuProfiler::isSupported() const
+{
+	return queryPool != VK_NULL_HANDLE;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (!isSupported()) { return; }
+
+	FrameQueries& queries = frames[frame % frameCount];
+	uint32_t firstQuery = (frame % frameCount) * maxScopes * 2;
+
+	// The slot's last submission is complete once its command buffer is being recorded again, NOT_READY keeps the old timings
+	if (queries.recorded && !queries.names.empty())
+	{
+		std::vector<uint64_t> ticks(queries.names.size() * 2);
+		VkResult result = vkGetQueryPoolResults(device, queryPool, firstQuery, static_cast<uint32_t>(ticks.size()),
+			ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS)
+		{
+			timings.clear();
+			for (size_t i = 0; i < queries.names.size(); i++)
+			{
+				uint64_t elapsed = (ticks[i * 2 + 1] - ticks[i * 2]) & timestampMask;
+				double start = (ticks[i * 2] & timestampMask) * timestampPeriod * 1e-6;
+				timings.push_back({ queries.names[i], elapsed * timestampPeriod * 1e-6, start, queueName });
+			}
+		}
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery, maxScopes * 2);
+	queries.names.clear();
+	queries.recorded = true;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& name)
+{
+	FrameQueries& queries = frames[frame % frameCount];
+	if (!isSupported() || queries.names.size() >= maxScopes) { return maxScopes; }
+
+	uint32_t scope = static_cast<uint32_t>(queries.names.size());
+	queries.names.push_back(name);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, ((frame % frameCount) * maxScopes + scope) * 2);
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t scope)
+{
+	if (scope >= maxScopes) { return; }
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, ((frame % frameCount) * maxScopes + scope) * 2 + 1);
+}
+
+const std::vector<GpuTiming>& GpuProfiler::getTimings() const
+{
+	return timings;
+}
+
+double GpuProfiler::getTiming(const std::string& name) const
+{
+	for (const GpuTiming& timing : timings)
+	{
+		if (timing.name == name) { return timing.milliseconds; }
+	}
+	return 0.0;
+}
+
+void GpuProfiler::destroy()
+{
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+}
+
+// Innermost scopes of a queue as sorted, merged [begin, end) intervals
+static std::vector<std::pair<double, double>> getBusyIntervals(const std::vector<GpuTiming>& timings, const std::string& queue)
+{
+	std::vector<std::pair<double, double>> scopes;
+	for (const GpuTiming& timing : timings)
+	{
+		if (timing.queue == queue) { scopes.push_back({ timing.startMilliseconds, timing.startMilliseconds + timing.milliseconds }); }
+	}
+
+	std::vector<std::pair<double, double>> intervals;
+	for (size_t i = 0; i < scopes.size(); i++)
+	{
+		bool holdsScope = false;
+		for (size_t j = 0; j < scopes.size() && !holdsScope; j++)
+		{
+			holdsScope = scopes[j] != scopes[i] && scopes[j].first >= scopes[i].first && scopes[j].second <= scopes[i].second;
+		}
+		if (!holdsScope) { intervals.push_back(scopes[i]); }
+	}
+
+	std::sort(intervals.begin(), intervals.end());
+	std::vector<std::pair<double, double>> merged;
+	for (const auto& interval : intervals)
+	{
+		if (!merged.empty() && interval.first <= merged.back().second)
+		{
+			merged.back().second = std::max(merged.back().second, interval.second);
+		}
+		else
+		{
+			merged.push_back(interval);
+		}
+	}
+	return merged;
+}
+
+double getQueueOverlap(const std::vector<GpuTiming>& timings, const std::string& queueA, const std::string& queueB)
+{
+	std::vector<std::pair<double, double>> a = getBusyIntervals(timings, queueA);
+	std::vector<std::pair<double, double>> b = getBusyIntervals(timings, queueB);
+
+	double overlap = 0.0;
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size())
+	{
+		overlap += std::max(std::min(a[i].second, b[j].second) - std::max(a[i].first, b[j].first), 0.0);
+		if (a[i].second < b[j].second) { i++; } else { j++; }
+	}
+	return overlap;
+}
+
+void writeChromeTrace(const std::string& path, const std::vector<GpuTiming>& timings)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open " + path + "!");
+	}
+
+	double origin = 0.0;
+	std::vector<std::string> queues;
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		origin = i == 0 ? timings[i].startMilliseconds : std::min(origin, timings[i].startMilliseconds);
+		if (std::find(queues.begin(), queues.end(), timings[i].queue) == queues.end()) { queues.push_back(timings[i].queue); }
+	}
+
+	// Complete events ("X") in microseconds, a thread per queue named by a metadata event
+	file << "{\"traceEvents\":[";
+	for (size_t q = 0; q < queues.size(); q++)
+	{
+		file << (q == 0 ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << q
+			<< ",\"args\":{\"name\":\"" << queues[q] << "\"}}";
+	}
+	for (const GpuTiming& timing : timings)
+	{
+		size_t tid = std::find(queues.begin(), queues.end(), timing.queue) - queues.begin();
+		file << ",\n{\"name\":\"" << timing.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+			<< ",\"ts\":" << (timing.startMilliseconds - origin) * 1000.0 << ",\"dur\":" << timing.milliseconds * 1000.0 << "}";
+	}
+	file << "\n]}\n";
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "utilities.h"
+
+struct GpuTiming
+{
+	std::string name;
+	double milliseconds;
+	double startMilliseconds;		// Device timestamp of the begin (only comparable within one device)
+	std::string queue;				// Queue the scope ran on
+};
+
+// Milliseconds both queues were busy at once: the overlap of their innermost scopes (ones holding no other scope of
+// the same queue), e.g. how much of an async compute queue's work ran alongside graphics
+double getQueueOverlap(const std::vector<GpuTiming>& timings, const std::string& queueA, const std::string& queueB);
+
+// Chrome trace event JSON (chrome://tracing, Perfetto) with one track per queue, times relative to the earliest scope
+void writeChromeTrace(const std::string& path, const std::vector<GpuTiming>& timings);
+
+// Timestamp queries around named scopes of a command buffer. Each frame slot (e.g. swapchain image) has its own
+// queries; beginFrame reads back what the slot recorded last time, once the GPU has finished it, and resets them.
+// One profiler per queue: its timings are tagged with the queue name
+class GpuProfiler
+{
+public:
+	// Does nothing (no scopes, no timings) if the queue family can't write timestamps
+	GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, uint32_t newFrameCount, uint32_t newMaxScopes = 32,
+		const std::string& newQueueName = "graphics");
+
+	bool isSupported() const;
+
+	// Outside any render pass, before the frame's scopes
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	// Scopes may nest, past maxScopes in a frame they are ignored
+	uint32_t beginScope(VkCommandBuffer commandBuffer, uint32_t frame, const std::string& name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t scope);
+
+	// Scopes of the most recently finished frame, in begin order
+	const std::vector<GpuTiming>& getTimings() const;
+	double getTiming(const std::string& name) const;	// 0 if the scope wasn't recorded
+
+	void destroy();
+
+private:
+	struct FrameQueries
+	{
+		std::vector<std::string> names;		// Scope i uses queries 2i (begin) and 2i + 1 (end)
+		bool recorded = false;				// Submitted since the last read back
+	};
+
+	VkDevice device;
+	std::string queueName;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	uint32_t frameCount;
+	uint32_t maxScopes;
+	double timestampPeriod = 0.0;			// Nanoseconds per tick
+	uint64_t timestampMask = 0;				// Valid bits of the queue family
+
+	std::vector<FrameQueries> frames;
+	std::vector<GpuTiming> timings;
+};
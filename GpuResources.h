@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "HandlePool.h"
+
+// Buffer and its memory, owned by the renderer's buffer pool
+struct GpuBuffer
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr;		// Host visible buffers mapped for their whole life (freeing the memory unmaps it)
+};
+
+// Image, its memory and a view of the whole image, owned by the renderer's image pool
+struct GpuImage
+{
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent = { 0, 0 };
+};
+
+class Mesh;
+
+typedef Handle<Mesh> MeshHandle;
+typedef Handle<GpuBuffer> BufferHandle;
+typedef Handle<GpuImage> ImageHandle;
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Slot index in a HandlePool plus the generation the object was created in
+// Once the object is destroyed the slot's generation moves on, so the handle fails lookup instead of aliasing the next object
+template <typename T>
+struct Handle
+{
+	uint32_t index = 0xffffffff;
+	uint32_t generation = 0;
+
+	bool isNull() const { return index == 0xffffffff; }
+	bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// Owns objects of one type in fixed size blocks that never move
+// Create, destroy and lookup are O(1), freed slots are reused (free list) and pointers stay valid until their object is destroyed
+template <typename T>
+class HandlePool
+{
+public:
+	static const uint32_t BLOCK_SIZE = 256;
+
+	HandlePool() = default;
+	~HandlePool() { clear(); }
+
+	HandlePool(const HandlePool&) = delete;
+	HandlePool& operator=(const HandlePool&) = delete;
+
+	// Constructs the object in place (it is never copied or moved)
+	template <typename... Args>
+	Handle<T> create(Args&&... args)
+	{
+		uint32_t index;
+		if (!freeSlots.empty())
+		{
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			if (slotCount % BLOCK_SIZE == 0)
+			{
+				blocks.emplace_back(new Slot[BLOCK_SIZE]);
+			}
+			index = slotCount++;
+		}
+
+		Slot& slot = getSlot(index);
+		new (slot.storage) T(std::forward<Args>(args)...);
+		slot.alive = true;
+		liveCount++;
+
+		Handle<T> handle;
+		handle.index = index;
+		handle.generation = slot.generation;
+		return handle;
+	}
+
+	// Stale handles are ignored
+	void destroy(Handle<T> handle)
+	{
+		T* object = get(handle);
+		if (object == nullptr) { return; }
+
+		object->~T();
+		Slot& slot = getSlot(handle.index);
+		slot.alive = false;
+		slot.generation++;
+		freeSlots.push_back(handle.index);
+		liveCount--;
+	}
+
+	// nullptr if the handle is stale or null
+	T* get(Handle<T> handle)
+	{
+		if (handle.index >= slotCount) { return nullptr; }
+
+		Slot& slot = getSlot(handle.index);
+		return slot.alive && slot.generation == handle.generation ? reinterpret_cast<T*>(slot.storage) : nullptr;
+	}
+
+	const T* get(Handle<T> handle) const
+	{
+		return const_cast<HandlePool*>(this)->get(handle);
+	}
+
+	bool isValid(Handle<T> handle) const
+	{
+		return get(handle) != nullptr;
+	}
+
+	uint32_t size() const { return liveCount; }
+	uint32_t getSlotCount() const { return slotCount; }		// Upper bound of handle indices, for arrays kept alongside the pool
+
+	// Calls function(Handle<T>, T&) for every live object in slot order
+	template <typename Function>
+	void forEach(Function function)
+	{
+		for (uint32_t index = 0; index < slotCount; index++)
+		{
+			Slot& slot = getSlot(index);
+			if (!slot.alive) { continue; }
+
+			Handle<T> handle;
+			handle.index = index;
+			handle.generation = slot.generation;
+			function(handle, *reinterpret_cast<T*>(slot.storage));
+		}
+	}
+
+	// Destroys every object (outstanding handles all become stale)
+	void clear()
+	{
+		for (uint32_t index = 0; index < slotCount; index++)
+		{
+			Slot& slot = getSlot(index);
+			if (!slot.alive) { continue; }
+
+			reinterpret_cast<T*>(slot.storage)->~T();
+			slot.alive = false;
+			slot.generation++;
+			freeSlots.push_back(index);
+		}
+		liveCount = 0;
+	}
+
+private:
+	struct Slot
+	{
+		alignas(T) unsigned char storage[sizeof(T)];
+		uint32_t generation = 0;
+		bool alive = false;
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> blocks;
+	std::vector<uint32_t> freeSlots;
+	uint32_t slotCount = 0;
+	uint32_t liveCount = 0;
+
+	Slot& getSlot(uint32_t index) { return blocks[index / BLOCK_SIZE][index % BLOCK_SIZE]; }
+};
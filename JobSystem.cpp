@@ -0,0 +1,106 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::workerLoop, this);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		stopping = true;
+	}
+	batchAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+uint32_t JobSystem::getThreadCount() const
+{
+	return static_cast<uint32_t>(workers.size()) + 1;
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& job)
+{
+	if (count == 0) { return; }
+	batchSize = std::max(batchSize, 1u);
+
+	uint32_t batchCount = (count + batchSize - 1) / batchSize;
+	if (batchCount == 1 || workers.empty())
+	{
+		job(0, count);
+		return;
+	}
+
+	std::atomic<uint32_t> remaining(batchCount);
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		for (uint32_t begin = 0; begin < count; begin += batchSize)
+		{
+			batches.push_back({ &job, begin, std::min(begin + batchSize, count), &remaining });
+		}
+	}
+	batchAvailable.notify_all();
+
+	// Help out until the queue is empty, then wait for batches still running on workers
+	while (true)
+	{
+		Batch batch;
+		{
+			std::unique_lock<std::mutex> lock(batchMutex);
+			if (batches.empty())
+			{
+				batchFinished.wait(lock, [&remaining]() { return remaining.load() == 0; });
+				return;
+			}
+			batch = batches.front();
+			batches.pop_front();
+		}
+		runBatch(batch);
+	}
+}
+
+void JobSystem::workerLoop()
+{
+	while (true)
+	{
+		Batch batch;
+		{
+			std::unique_lock<std::mutex> lock(batchMutex);
+			batchAvailable.wait(lock, [this]() { return stopping || !batches.empty(); });
+			if (stopping && batches.empty()) { return; }
+
+			batch = batches.front();
+			batches.pop_front();
+		}
+		runBatch(batch);
+	}
+}
+
+void JobSystem::runBatch(const Batch& batch)
+{
+	(*batch.job)(batch.begin, batch.end);
+
+	// Last batch of a parallelFor wakes its caller (lock so the wake can't slip in before it waits)
+	if (batch.remaining->fetch_sub(1) == 1)
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		batchFinished.notify_all();
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads that run batches of a range in parallel
+// The calling thread takes part in the work, so a pool with 0 workers runs everything inline
+class JobSystem
+{
+public:
+	// workerCount 0 = one per hardware thread, minus the calling thread
+	explicit JobSystem(uint32_t workerCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Threads that work on a parallelFor (workers + caller)
+	uint32_t getThreadCount() const;
+
+	// Calls job(begin, end) over [0, count) in batches of batchSize and returns once every batch has finished
+	void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& job);
+
+private:
+	struct Batch
+	{
+		const std::function<void(uint32_t, uint32_t)>* job;
+		uint32_t begin;
+		uint32_t end;
+		std::atomic<uint32_t>* remaining;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<Batch> batches;
+	std::mutex batchMutex;
+	std::condition_variable batchAvailable;
+	std::condition_variable batchFinished;
+	bool stopping = false;
+
+	void workerLoop();
+	void runBatch(const Batch& batch);
+};
@@ -1,29 +1,124 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <limits>
+
 Mesh::Mesh()
 {
 }
 
 Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue,
-	VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+	VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+	VertexFormat newVertexFormat, const std::vector<MeshLod>* newLods)
 {
 	vertexCount = static_cast<uint32_t>(vertices->size());
 	indexCount = static_cast<uint32_t>(indices->size());
+	vertexFormat = newVertexFormat;
 	physicalDevice = newPhysicalDevice;
 	device = newDevice;
-	createVertexBuffer(transferQueue, transferCommandPool, vertices);
+
+	// Convert to the GPU layout before upload
+	std::vector<uint8_t> vertexData = packVertices(vertexFormat, *vertices, dequantization);
+	createVertexBuffer(transferQueue, transferCommandPool, &vertexData);
+
+	// De-interleaved copy of the positions so depth-only passes fetch only what they use
+	std::vector<uint8_t> positionData = extractPositions(vertexFormat, vertexData);
+	createStagedBuffer(physicalDevice, device, transferQueue, transferCommandPool, positionData.data(), positionData.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, positionBuffer, positionBufferMemory);
 	createIndexBuffer(transferQueue, transferCommandPool, indices);
 
-	model.model = glm::mat4(1.0f); // Initialize model matrix to identity
+	// Without a LOD chain the whole index buffer is the only level
+	if (newLods != nullptr && !newLods->empty())
+	{
+		lods = *newLods;
+	}
+	else
+	{
+		lods = { { 0, static_cast<uint32_t>(indexCount), 0.0f } };
+	}
+
+	// Split every level into meshlets
+	for (const MeshLod& lod : lods)
+	{
+		lodMeshlets.push_back(buildMeshlets(*vertices, indices->data() + lod.firstIndex, lod.indexCount, meshletData));
+	}
+
+	// Bounding box, and a sphere around its centre
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (const Vertex& vertex : *vertices)
+	{
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+	if (vertices->empty())
+	{
+		minPos = maxPos = glm::vec3(0.0f);
+	}
+	boundingBox = { minPos, maxPos };
+
+	glm::vec3 centre = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (const Vertex& vertex : *vertices)
+	{
+		radius = std::max(radius, glm::length(vertex.pos - centre));
+	}
+	boundingSphere = glm::vec4(centre, radius);
+}
+
+const glm::mat4& Mesh::getDequantization() const
+{
+	return dequantization;
+}
+
+const glm::vec4& Mesh::getBoundingSphere() const
+{
+	return boundingSphere;
+}
+
+const Aabb& Mesh::getBoundingBox() const
+{
+	return boundingBox;
+}
+
+uint32_t Mesh::getLodCount() const
+{
+	return static_cast<uint32_t>(lods.size());
+}
+
+const MeshLod& Mesh::getLod(uint32_t lodIndex) const
+{
+	return lods[lodIndex];
 }
 
-void Mesh::setModel(glm::mat4 newModel)
+VertexFormat Mesh::getVertexFormat()
 {
-	model.model = newModel;
+	return vertexFormat;
 }
 
-const Model& Mesh::getUboModel() const {
-	return model;
+const MeshletData& Mesh::getMeshletData() const
+{
+	return meshletData;
+}
+
+const MeshletRange& Mesh::getLodMeshlets(uint32_t lodIndex) const
+{
+	return lodMeshlets[lodIndex];
+}
+
+uint32_t Mesh::getMaxLodTriangleCount() const
+{
+	return lods[0].indexCount / 3;	// Coarser levels only ever remove triangles
+}
+
+uint32_t Mesh::getMaxLodMeshletCount() const
+{
+	uint32_t meshletCount = 0;
+	for (const MeshletRange& range : lodMeshlets)
+	{
+		meshletCount = std::max(meshletCount, range.meshletCount);
+	}
+	return meshletCount;
 }
 
 int Mesh::getVertexCount()
@@ -36,9 +131,14 @@ VkBuffer Mesh::getVertexBuffer()
 	return vertexBuffer;
 }
 
+VkBuffer Mesh::getPositionBuffer()
+{
+	return positionBuffer;
+}
+
 int Mesh::getIndexCount()
 {
-	return indexCount;
+	return lods[0].indexCount;	// Base level (the buffer also holds the coarser levels)
 }
 
 VkBuffer Mesh::getIndexBuffer()
@@ -50,17 +150,26 @@ void Mesh::destroyBuffers()
 {
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
 	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	vkDestroyBuffer(device, positionBuffer, nullptr);
+	vkFreeMemory(device, positionBufferMemory, nullptr);
 	vkDestroyBuffer(device, indexBuffer, nullptr);
 	vkFreeMemory(device, indexBufferMemory, nullptr);
 }
 
+void Mesh::destroyBuffers(DeletionQueue& deletionQueue, uint64_t lastUseValue)
+{
+	deletionQueue.destroyBuffer(lastUseValue, vertexBuffer, vertexBufferMemory);
+	deletionQueue.destroyBuffer(lastUseValue, positionBuffer, positionBufferMemory);
+	deletionQueue.destroyBuffer(lastUseValue, indexBuffer, indexBufferMemory);
+}
+
 Mesh::~Mesh()
 {
 }
 
-void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices)
+void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint8_t>* vertexData)
 {
-	VkDeviceSize bufferSize = sizeof(Vertex) * vertices->size();	// Calculate size of vertex buffer
+	VkDeviceSize bufferSize = vertexData->size();	// Calculate size of vertex buffer (already packed to vertexFormat)
 
 	// Temporary buffer to "stage" vertex data before transfering it to GPU
 	VkBuffer stagingBuffer;
@@ -74,12 +183,13 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 	// Map memory to vertex Buffer
 	void* data;						// Create a pointer to point to the allocated memory
 	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);	// Map allocated memory to pointer
-	memcpy(data, vertices->data(), (size_t)bufferSize);	// Copy vertex data to mapped memory
+	memcpy(data, vertexData->data(), (size_t)bufferSize);	// Copy vertex data to mapped memory
 	vkUnmapMemory(device, stagingBufferMemory);	// Unmap the memory from the pointer
 
 	// Create Buffer with TRANSFER_DST_BIT to move data from staging buffer to vertex buffer
 	// Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not the CPU (host)
-	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+	// Also readable as a storage buffer so mesh shaders can fetch vertices themselves
+	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
 
 	// Copy data from staging buffer to vertex buffer
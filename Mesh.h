@@ -6,38 +6,66 @@
 #include <vector>
 
 #include "utilities.h"
-
-struct Model
-{
-	glm::mat4 model;
-};
+#include "VertexFormat.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+#include "DeletionQueue.h"
 
 class Mesh
 {
 public:
 	Mesh();
 	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, 
-		VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+		VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+		VertexFormat newVertexFormat = VERTEX_FORMAT_FLOAT, const std::vector<MeshLod>* newLods = nullptr);
+
+	// Owns raw Vulkan handles: lives in the renderer's mesh pool and is never copied
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	const glm::mat4& getDequantization() const;		// Stored (quantized) positions -> object space, goes before the model matrix
 
-	void setModel(glm::mat4 newModel);
-	const Model& getUboModel() const;
+	const glm::vec4& getBoundingSphere() const;		// Object space centre (xyz) and radius (w)
+	const Aabb& getBoundingBox() const;				// Object space
+
+	uint32_t getLodCount() const;
+	const MeshLod& getLod(uint32_t lodIndex) const;
+
+	const MeshletData& getMeshletData() const;
+	const MeshletRange& getLodMeshlets(uint32_t lodIndex) const;	// Meshlets (into getMeshletData) covering a LOD level
+	uint32_t getMaxLodTriangleCount() const;						// Largest level, sizes cluster culling output
+	uint32_t getMaxLodMeshletCount() const;							// Most meshlets of any level, sizes per draw visibility
+
+	VertexFormat getVertexFormat();
 
 	int getVertexCount();
 	VkBuffer getVertexBuffer();
+	VkBuffer getPositionBuffer();		// Positions alone (getPositionInputDescription), for depth-only passes
 
 	int getIndexCount();
 	VkBuffer getIndexBuffer();
 
 	void destroyBuffers();
+	void destroyBuffers(DeletionQueue& deletionQueue, uint64_t lastUseValue);	// Once the GPU has passed lastUseValue
 
 	~Mesh();
 
 private:
-	Model model;
+	glm::mat4 dequantization;		// Maps stored (quantized) positions back to object space
+
+	glm::vec4 boundingSphere;
+	Aabb boundingBox;
+	std::vector<MeshLod> lods;		// All levels live in the one index buffer
+
+	MeshletData meshletData;					// Clusters of every level, built at load for cluster culling
+	std::vector<MeshletRange> lodMeshlets;
 
+	VertexFormat vertexFormat;
 	int vertexCount;
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferMemory;
+	VkBuffer positionBuffer;
+	VkDeviceMemory positionBufferMemory;
 
 	int indexCount;
 	VkBuffer indexBuffer;
@@ -46,7 +74,7 @@ private:
 	VkPhysicalDevice physicalDevice;
 	VkDevice device;
 
-	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices);
+	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint8_t>* vertexData);
 	void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices);
 };
 
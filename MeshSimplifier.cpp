@@ -0,0 +1,301 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+	// Symmetric 4x4 error quadric (plane equations summed up), w is the accumulated area weight
+	struct Quadric
+	{
+		double a2, b2, c2, d2;
+		double ab, ac, ad;
+		double bc, bd, cd;
+		double w;
+	};
+
+	Quadric quadricFromPlane(double a, double b, double c, double d, double weight)
+	{
+		Quadric q;
+		q.a2 = a * a * weight;	q.b2 = b * b * weight;	q.c2 = c * c * weight;	q.d2 = d * d * weight;
+		q.ab = a * b * weight;	q.ac = a * c * weight;	q.ad = a * d * weight;
+		q.bc = b * c * weight;	q.bd = b * d * weight;	q.cd = c * d * weight;
+		q.w = weight;
+		return q;
+	}
+
+	void quadricAdd(Quadric& q, const Quadric& r)
+	{
+		q.a2 += r.a2;	q.b2 += r.b2;	q.c2 += r.c2;	q.d2 += r.d2;
+		q.ab += r.ab;	q.ac += r.ac;	q.ad += r.ad;
+		q.bc += r.bc;	q.bd += r.bd;	q.cd += r.cd;
+		q.w += r.w;
+	}
+
+	// Weighted sum of squared distances from p to all planes in the quadric
+	double quadricEval(const Quadric& q, const glm::vec3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double rx = q.a2 * x + q.ab * y + q.ac * z;
+		double ry = q.ab * x + q.b2 * y + q.bc * z;
+		double rz = q.ac * x + q.bc * y + q.c2 * z;
+		double r = rx * x + ry * y + rz * z + 2.0 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+		return r < 0.0 ? 0.0 : r;
+	}
+
+	// Error of a collapse as a distance (so it can be projected to screen space)
+	double collapseError(const Quadric& a, const Quadric& b, const glm::vec3& p)
+	{
+		Quadric q = a;
+		quadricAdd(q, b);
+		return q.w > 0.0 ? std::sqrt(quadricEval(q, p) / q.w) : 0.0;
+	}
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	// Would moving 'from' onto 'to' flip (or squash) any triangle that survives the collapse?
+	bool collapseFlipsTriangle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const std::vector<uint32_t>& adjacencyOffsets, const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to)
+	{
+		for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++)
+		{
+			const uint32_t* tri = &indices[adjacency[a] * 3];
+			if (tri[0] == to || tri[1] == to || tri[2] == to) { continue; }	// Triangle disappears with the collapse
+
+			glm::vec3 p[3];
+			for (int k = 0; k < 3; k++) { p[k] = vertices[tri[k]].pos; }
+			glm::vec3 oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			for (int k = 0; k < 3; k++) { if (tri[k] == from) { p[k] = vertices[to].pos; } }
+			glm::vec3 newNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			// Reject if the face turns more than ~75 degrees (also catches it degenerating)
+			if (glm::dot(oldNormal, newNormal) <= 0.25f * glm::length(oldNormal) * glm::length(newNormal))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float maxError, float* resultError)
+{
+	std::vector<uint32_t> result = indices;
+	double largestError = 0.0;
+	size_t vertexCount = vertices.size();
+
+	// Vertices sharing a position (UV/normal seams) are locked so the seam never tears open
+	std::vector<bool> locked(vertexCount, false);
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				uint32_t h[3];
+				memcpy(h, &p, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			auto inserted = firstAtPosition.emplace(vertices[v].pos, v);
+			if (!inserted.second)
+			{
+				locked[v] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+	}
+
+	// - QUADRICS ------------------------------------------------
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	std::unordered_map<uint64_t, uint32_t> edgeUse;
+	for (size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = vertices[result[i]].pos;
+		const glm::vec3& p1 = vertices[result[i + 1]].pos;
+		const glm::vec3& p2 = vertices[result[i + 2]].pos;
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float doubleArea = glm::length(normal);
+		if (doubleArea <= 0.0f) { continue; }
+		normal /= doubleArea;
+
+		// Plane of the triangle weighted by its area, shared by all 3 corners
+		Quadric q = quadricFromPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), doubleArea * 0.5);
+		for (int k = 0; k < 3; k++)
+		{
+			quadricAdd(quadrics[result[i + k]], q);
+			edgeUse[edgeKey(result[i + k], result[i + (k + 1) % 3])]++;
+		}
+	}
+
+	// Border edges get a heavy plane perpendicular to the face so open borders keep their shape
+	for (size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = vertices[result[i]].pos;
+		glm::vec3 faceNormal = glm::cross(vertices[result[i + 1]].pos - p0, vertices[result[i + 2]].pos - p0);
+		if (glm::length(faceNormal) <= 0.0f) { continue; }
+		faceNormal = glm::normalize(faceNormal);
+
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t a = result[i + k];
+			uint32_t b = result[i + (k + 1) % 3];
+			if (edgeUse[edgeKey(a, b)] != 1) { continue; }
+
+			glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+			float length = glm::length(edge);
+			if (length <= 0.0f) { continue; }
+
+			glm::vec3 borderNormal = glm::normalize(glm::cross(edge, faceNormal));
+			Quadric q = quadricFromPlane(borderNormal.x, borderNormal.y, borderNormal.z,
+				-glm::dot(borderNormal, vertices[a].pos), double(length) * length * 10.0);
+			quadricAdd(quadrics[a], q);
+			quadricAdd(quadrics[b], q);
+		}
+	}
+
+	// - COLLAPSE PASSES ------------------------------------------------
+	// Each pass collapses the cheapest independent edges, then the index list is rebuilt
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::unordered_set<uint64_t> seenEdges;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Vertex -> triangle adjacency
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : result) { adjacencyOffsets[index + 1]++; }
+		for (size_t v = 0; v < vertexCount; v++) { adjacencyOffsets[v + 1] += adjacencyOffsets[v]; }
+		adjacency.resize(result.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++) { adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3); }
+
+		// Cheapest direction of every edge
+		collapses.clear();
+		seenEdges.clear();
+		seenEdges.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t a = result[i + k];
+				uint32_t b = result[i + (k + 1) % 3];
+				// Interior edges appear twice (once per direction), border edges once: dedupe regardless of winding
+				uint64_t edgeKey = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+				if (!seenEdges.insert(edgeKey).second) { continue; }
+
+				double errorAB = locked[a] ? std::numeric_limits<double>::max() : collapseError(quadrics[a], quadrics[b], vertices[b].pos);
+				double errorBA = locked[b] ? std::numeric_limits<double>::max() : collapseError(quadrics[a], quadrics[b], vertices[a].pos);
+				if (locked[a] && locked[b]) { continue; }
+
+				collapses.push_back(errorAB <= errorBA ? Collapse{ a, b, errorAB } : Collapse{ b, a, errorBA });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.error < r.error; });
+
+		for (size_t v = 0; v < vertexCount; v++) { remap[v] = static_cast<uint32_t>(v); }
+		std::fill(touched.begin(), touched.end(), false);
+
+		size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > maxError) { break; }
+			if (touched[collapse.from] || touched[collapse.to]) { continue; }
+			if (collapseFlipsTriangle(vertices, result, adjacencyOffsets, adjacency, collapse.from, collapse.to)) { continue; }
+
+			remap[collapse.from] = collapse.to;
+			quadricAdd(quadrics[collapse.to], quadrics[collapse.from]);
+			largestError = std::max(largestError, collapse.error);
+			collapseCount++;
+
+			// Freeze the whole neighbourhood for this pass, its adjacency is now stale
+			for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+			{
+				const uint32_t* tri = &result[adjacency[a] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) { trianglesRemoved++; }
+			}
+
+			if (trianglesRemoved >= trianglesToRemove) { break; }
+		}
+
+		if (collapseCount == 0) { break; }	// Nothing left that is cheap enough / safe to collapse
+
+		// Rebuild index list, dropping triangles that became degenerate
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t i0 = remap[result[t * 3]];
+			uint32_t i1 = remap[result[t * 3 + 1]];
+			uint32_t i2 = remap[result[t * 3 + 2]];
+			if (i0 == i1 || i1 == i2 || i2 == i0) { continue; }
+
+			result[write++] = i0;
+			result[write++] = i1;
+			result[write++] = i2;
+		}
+		result.resize(write);
+	}
+
+	if (resultError) { *resultError = static_cast<float>(largestError); }
+	return result;
+}
+
+void buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods,
+	uint32_t maxLodCount, float reduction)
+{
+	lods.clear();
+	lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	// Every level is simplified from the base mesh so its error is measured against the real surface
+	const std::vector<uint32_t> baseIndices = indices;
+	size_t previousCount = baseIndices.size();
+
+	for (uint32_t level = 1; level < maxLodCount; level++)
+	{
+		size_t targetCount = static_cast<size_t>(previousCount / 3 * reduction) * 3;
+		if (targetCount < 3) { break; }
+
+		float error = 0.0f;
+		std::vector<uint32_t> lodIndices = simplifyMesh(vertices, baseIndices, targetCount, std::numeric_limits<float>::max(), &error);
+
+		// Not worth another level if simplification stalled
+		if (lodIndices.empty() || lodIndices.size() > previousCount * 9 / 10) { break; }
+
+		MeshLod lod = {};
+		lod.firstIndex = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.error = std::max(error, lods.back().error);		// Keep errors monotonic for selection
+		lods.push_back(lod);
+
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		previousCount = lodIndices.size();
+	}
+}
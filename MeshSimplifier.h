@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+// One level of detail inside a mesh's index buffer
+struct MeshLod
+{
+	uint32_t firstIndex;	// Offset into the shared index buffer
+	uint32_t indexCount;	// Number of indices to draw for this level
+	float error;			// Geometric error vs the base mesh, in object space units
+};
+
+// Quadric error metric simplification (edge collapse onto existing vertices, so all levels share one vertex buffer)
+// Returns the simplified index list, aiming for targetIndexCount indices without exceeding maxError
+// resultError (optional) gets the largest error introduced, in object space units
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float maxError, float* resultError);
+
+// Appends progressively coarser levels to indices and describes every level (lods[0] is the base mesh)
+// Each level aims for reduction * the previous level's triangles, stops early when a mesh won't simplify further
+void buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods,
+	uint32_t maxLodCount = 4, float reduction = 0.5f);
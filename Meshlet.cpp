@@ -0,0 +1,130 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	// Fill in the bounding sphere and normal cone of a finished meshlet
+	void computeMeshletBounds(const std::vector<Vertex>& vertices, const MeshletData& meshletData, Meshlet& meshlet)
+	{
+		// - BOUNDING SPHERE ------------------------------------------------
+		glm::vec3 minPos(std::numeric_limits<float>::max());
+		glm::vec3 maxPos(-std::numeric_limits<float>::max());
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+		{
+			const glm::vec3& pos = vertices[meshletData.vertices[meshlet.vertexOffset + v]].pos;
+			minPos = glm::min(minPos, pos);
+			maxPos = glm::max(maxPos, pos);
+		}
+
+		glm::vec3 centre = (minPos + maxPos) * 0.5f;
+		float radius = 0.0f;
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+		{
+			radius = std::max(radius, glm::length(vertices[meshletData.vertices[meshlet.vertexOffset + v]].pos - centre));
+		}
+		meshlet.boundingSphere = glm::vec4(centre, radius);
+
+		// - NORMAL CONE ------------------------------------------------
+		// Axis is the average face normal, cutoff is the widest angle any face makes with it
+		std::vector<glm::vec3> normals;
+		normals.reserve(meshlet.triangleCount);
+		glm::vec3 axis(0.0f);
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			uint32_t packed = meshletData.triangles[meshlet.triangleOffset + t];
+			const glm::vec3& p0 = vertices[meshletData.vertices[meshlet.vertexOffset + (packed & 0xff)]].pos;
+			const glm::vec3& p1 = vertices[meshletData.vertices[meshlet.vertexOffset + ((packed >> 8) & 0xff)]].pos;
+			const glm::vec3& p2 = vertices[meshletData.vertices[meshlet.vertexOffset + ((packed >> 16) & 0xff)]].pos;
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length <= 0.0f) { continue; }	// Degenerate triangles don't constrain the cone
+
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		meshlet.cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);	// Default: cone test disabled
+		if (normals.empty() || glm::length(axis) <= 0.0f) { return; }
+
+		axis = glm::normalize(axis);
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(axis, normal));
+		}
+
+		// Faces spread over (nearly) a hemisphere, the cone would never cull anything
+		if (minDot <= 0.1f) { return; }
+
+		// Stored as sin so the shader test is: dot(centre - camera, axis) >= cutoff * distance + radius
+		meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+	}
+}
+
+MeshletRange buildMeshlets(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount, MeshletData& meshletData)
+{
+	MeshletRange range = {};
+	range.firstMeshlet = static_cast<uint32_t>(meshletData.meshlets.size());
+
+	// Meshlet-local slot of each mesh vertex (0xff = not in the current meshlet)
+	std::vector<uint8_t> localIndex(vertices.size(), 0xff);
+
+	Meshlet meshlet = {};
+	meshlet.vertexOffset = static_cast<uint32_t>(meshletData.vertices.size());
+	meshlet.triangleOffset = static_cast<uint32_t>(meshletData.triangles.size());
+
+	auto finishMeshlet = [&]()
+	{
+		if (meshlet.triangleCount == 0) { return; }
+
+		computeMeshletBounds(vertices, meshletData, meshlet);
+		meshletData.meshlets.push_back(meshlet);
+
+		for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+		{
+			localIndex[meshletData.vertices[meshlet.vertexOffset + v]] = 0xff;
+		}
+
+		meshlet = {};
+		meshlet.vertexOffset = static_cast<uint32_t>(meshletData.vertices.size());
+		meshlet.triangleOffset = static_cast<uint32_t>(meshletData.triangles.size());
+	};
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+		// How many new vertices this triangle would add
+		uint32_t newVertices = 0;
+		if (localIndex[a] == 0xff) { newVertices++; }
+		if (localIndex[b] == 0xff && b != a) { newVertices++; }
+		if (localIndex[c] == 0xff && c != a && c != b) { newVertices++; }
+
+		if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES || meshlet.triangleCount >= MESHLET_MAX_TRIANGLES)
+		{
+			finishMeshlet();
+		}
+
+		uint32_t corner[3] = { a, b, c };
+		uint32_t packed = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (localIndex[corner[k]] == 0xff)
+			{
+				localIndex[corner[k]] = static_cast<uint8_t>(meshlet.vertexCount++);
+				meshletData.vertices.push_back(corner[k]);
+			}
+			packed |= uint32_t(localIndex[corner[k]]) << (8 * k);
+		}
+
+		meshletData.triangles.push_back(packed);
+		meshlet.triangleCount++;
+	}
+	finishMeshlet();
+
+	range.meshletCount = static_cast<uint32_t>(meshletData.meshlets.size()) - range.firstMeshlet;
+	return range;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+// Cluster size limits (124 triangles keeps the packed index data of a meshlet under 128 entries on NV hardware)
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// A small cluster of triangles with bounds for culling (layout mirrored by std430 struct in Shaders/meshlet_common.glsl)
+struct Meshlet
+{
+	glm::vec4 boundingSphere;	// Object space centre (xyz) and radius (w)
+	glm::vec4 cone;				// Normal cone axis (xyz) and sin of the cone cutoff (w), w = 1 means never backface culled
+	uint32_t vertexOffset;		// First entry in meshletVertices
+	uint32_t triangleOffset;	// First entry in meshletTriangles
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+// Meshlets of a mesh plus the data they index
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices;		// Mesh vertex index of each meshlet-local vertex
+	std::vector<uint32_t> triangles;	// 3 meshlet-local vertex indices packed as bytes (i0 | i1 << 8 | i2 << 16)
+};
+
+// Range of meshlets that make up one LOD level
+struct MeshletRange
+{
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+};
+
+// Splits an index list into meshlets (appended to meshletData) and computes their bounds and normal cones
+// Triangles are taken in order, so an index list optimised for vertex reuse gives the tightest clusters
+MeshletRange buildMeshlets(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount, MeshletData& meshletData);
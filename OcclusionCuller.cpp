@@ -0,0 +1,600 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <immintrin.h>
+
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+namespace {
+	const float NEAR_W = 1e-5f;		// Clip w below this is treated as crossing the camera plane
+
+	// Screen space setup of a clip space triangle, false if it can't cover any pixel centre
+	bool setupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2, uint32_t width, uint32_t height,
+		OcclusionTriangle& triangle)
+	{
+		const glm::vec4* clip[3] = { &clip0, &clip1, &clip2 };
+		glm::vec3 screen[3];
+		for (int k = 0; k < 3; k++)
+		{
+			if (clip[k]->w <= NEAR_W) { return false; }
+
+			float invW = 1.0f / clip[k]->w;
+			screen[k] = glm::vec3((clip[k]->x * invW * 0.5f + 0.5f) * width, (clip[k]->y * invW * 0.5f + 0.5f) * height, clip[k]->z * invW);
+		}
+
+		// Order the vertices so the edge functions are positive inside
+		float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+		if (!(std::abs(area) > 0.0f) || !std::isfinite(area)) { return false; }
+		if (area < 0.0f)
+		{
+			std::swap(screen[1], screen[2]);
+			area = -area;
+		}
+
+		float minX = std::min(screen[0].x, std::min(screen[1].x, screen[2].x));
+		float maxX = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+		float minY = std::min(screen[0].y, std::min(screen[1].y, screen[2].y));
+		float maxY = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+
+		// Pixels whose centre can be inside
+		int32_t firstColumn = static_cast<int32_t>(std::ceil(std::max(minX - 0.5f, 0.0f)));
+		int32_t lastColumn = static_cast<int32_t>(std::floor(std::min(maxX - 0.5f, width - 1.0f)));
+		int32_t firstRow = static_cast<int32_t>(std::ceil(std::max(minY - 0.5f, 0.0f)));
+		int32_t lastRow = static_cast<int32_t>(std::floor(std::min(maxY - 0.5f, height - 1.0f)));
+		if (firstColumn > lastColumn || firstRow > lastRow) { return false; }
+
+		triangle.minTileX = firstColumn / static_cast<int32_t>(MaskedOcclusionCuller::TILE_WIDTH);
+		triangle.maxTileX = lastColumn / static_cast<int32_t>(MaskedOcclusionCuller::TILE_WIDTH);
+		triangle.minTileY = firstRow / static_cast<int32_t>(MaskedOcclusionCuller::TILE_HEIGHT);
+		triangle.maxTileY = lastRow / static_cast<int32_t>(MaskedOcclusionCuller::TILE_HEIGHT);
+		triangle.minY = minY;
+		triangle.maxY = maxY;
+
+		// Column where each edge crosses a row, the side it bounds depends on which way the edge goes
+		for (int e = 0; e < 3; e++)
+		{
+			const glm::vec3& from = screen[e];
+			const glm::vec3& to = screen[(e + 1) % 3];
+			triangle.vertices[e] = glm::vec2(from);
+
+			float deltaY = to.y - from.y;
+			if (std::abs(deltaY) < 1e-4f)
+			{
+				triangle.edgeType[e] = OCCLUSION_EDGE_NONE;
+				triangle.edgeSlope[e] = 0.0f;
+				triangle.edgeOffset[e] = 0.0f;
+				continue;
+			}
+
+			triangle.edgeSlope[e] = (to.x - from.x) / deltaY;
+			triangle.edgeOffset[e] = from.x - from.y * triangle.edgeSlope[e] - 0.5f;	// - 0.5 tests pixel centres
+			triangle.edgeType[e] = deltaY < 0.0f ? OCCLUSION_EDGE_START : OCCLUSION_EDGE_END;
+		}
+
+		// Depth is linear in screen space
+		float depthX = ((screen[1].z - screen[0].z) * (screen[2].y - screen[0].y) - (screen[2].z - screen[0].z) * (screen[1].y - screen[0].y)) / area;
+		float depthY = ((screen[2].z - screen[0].z) * (screen[1].x - screen[0].x) - (screen[1].z - screen[0].z) * (screen[2].x - screen[0].x)) / area;
+		triangle.depthPlane = glm::vec3(depthX, depthY, screen[0].z - depthX * screen[0].x - depthY * screen[0].y);
+		triangle.minDepth = std::min(screen[0].z, std::min(screen[1].z, screen[2].z));
+		triangle.maxDepth = std::max(screen[0].z, std::max(screen[1].z, screen[2].z));
+
+		return true;
+	}
+
+	// Covered columns [first, last) of the row whose centre is at y (same maths as the SIMD kernels)
+	void rowSpan(const OcclusionTriangle& triangle, float y, float columnLimit, float& first, float& last)
+	{
+		first = 0.0f;
+		last = columnLimit;
+		if (y < triangle.minY || y > triangle.maxY)
+		{
+			last = 0.0f;
+			return;
+		}
+
+		for (int e = 0; e < 3; e++)
+		{
+			if (triangle.edgeType[e] == OCCLUSION_EDGE_NONE) { continue; }
+
+			float column = std::min(std::max(triangle.edgeSlope[e] * y + triangle.edgeOffset[e], -1.0f), columnLimit + 1.0f);
+			if (triangle.edgeType[e] == OCCLUSION_EDGE_START)
+			{
+				first = std::max(first, std::ceil(column));
+			}
+			else
+			{
+				last = std::min(last, std::floor(column) + 1.0f);
+			}
+		}
+	}
+
+	// Bits [start, end) of a 32 pixel tile row
+	uint32_t spanMask(int32_t start, int32_t end)
+	{
+		start = std::min(std::max(start, 0), 32);
+		end = std::min(std::max(end, 0), 32);
+		if (start >= end) { return 0; }
+		return static_cast<uint32_t>(((1ull << end) - 1) & ~((1ull << start) - 1));
+	}
+
+	enum BoxProjection
+	{
+		BOX_ON_SCREEN,
+		BOX_OFF_SCREEN,
+		BOX_CROSSES_CAMERA		// Can't be bounded on screen, always visible
+	};
+
+	// Pixel rectangle (inclusive) and nearest depth of a box
+	BoxProjection projectBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelViewProjection,
+		uint32_t width, uint32_t height, int32_t rect[4], float& nearestDepth)
+	{
+		glm::vec2 minScreen(std::numeric_limits<float>::max());
+		glm::vec2 maxScreen(-std::numeric_limits<float>::max());
+		nearestDepth = std::numeric_limits<float>::max();
+
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+			glm::vec4 clip = modelViewProjection * glm::vec4(corner, 1.0f);
+			if (clip.w <= NEAR_W) { return BOX_CROSSES_CAMERA; }
+
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			glm::vec2 screen((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+			minScreen = glm::min(minScreen, screen);
+			maxScreen = glm::max(maxScreen, screen);
+			nearestDepth = std::min(nearestDepth, ndc.z);
+		}
+
+		// Every pixel the rectangle touches
+		rect[0] = static_cast<int32_t>(std::floor(std::max(minScreen.x, 0.0f)));
+		rect[1] = static_cast<int32_t>(std::floor(std::max(minScreen.y, 0.0f)));
+		rect[2] = static_cast<int32_t>(std::ceil(std::min(maxScreen.x, static_cast<float>(width)))) - 1;
+		rect[3] = static_cast<int32_t>(std::ceil(std::min(maxScreen.y, static_cast<float>(height)))) - 1;
+		rect[2] = std::min(rect[2], static_cast<int32_t>(width) - 1);
+		rect[3] = std::min(rect[3], static_cast<int32_t>(height) - 1);
+
+		if (rect[0] > rect[2] || rect[1] > rect[3]) { return BOX_OFF_SCREEN; }
+		return BOX_ON_SCREEN;
+	}
+}
+
+OcclusionSimd getBestOcclusionSimd()
+{
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx2) { return OCCLUSION_SIMD_AVX2; }
+	if (features.sse41) { return OCCLUSION_SIMD_SSE41; }
+	return OCCLUSION_SIMD_SCALAR;
+}
+
+// - MASKED -------------------------------------------------------------------------------------------------------------------
+
+MaskedOcclusionCuller::MaskedOcclusionCuller(uint32_t width, uint32_t height, OcclusionSimd newSimd, JobSystem* newJobSystem)
+{
+	tilesX = std::max((width + TILE_WIDTH - 1) / TILE_WIDTH, 1u);
+	tilesY = std::max((height + TILE_HEIGHT - 1) / TILE_HEIGHT, 1u);
+	this->width = tilesX * TILE_WIDTH;
+	this->height = tilesY * TILE_HEIGHT;
+
+	simd = newSimd;
+	jobSystem = newJobSystem;
+
+	tileFarDepth.resize(tilesX * tilesY);
+	tileWorkingDepth.resize(tilesX * tilesY);
+	tileMasks.resize(tilesX * tilesY * TILE_HEIGHT);
+	rowTriangles.resize(tilesY);
+
+	clear();
+}
+
+void MaskedOcclusionCuller::setSimd(OcclusionSimd newSimd)
+{
+	simd = newSimd;
+}
+
+void MaskedOcclusionCuller::setJobSystem(JobSystem* newJobSystem)
+{
+	jobSystem = newJobSystem;
+}
+
+uint32_t MaskedOcclusionCuller::getWidth() const
+{
+	return width;
+}
+
+uint32_t MaskedOcclusionCuller::getHeight() const
+{
+	return height;
+}
+
+void MaskedOcclusionCuller::clear()
+{
+	std::fill(tileFarDepth.begin(), tileFarDepth.end(), 1.0f);
+	std::fill(tileWorkingDepth.begin(), tileWorkingDepth.end(), 1.0f);
+	std::fill(tileMasks.begin(), tileMasks.end(), 0u);
+	triangles.clear();
+}
+
+void MaskedOcclusionCuller::addOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+	const glm::mat4& modelViewProjection)
+{
+	clipPositions.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		clipPositions[i] = modelViewProjection * glm::vec4(positions[i], 1.0f);
+	}
+
+	OcclusionTriangle triangle;
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (setupTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]], width, height, triangle))
+		{
+			triangles.push_back(triangle);
+		}
+	}
+}
+
+void MaskedOcclusionCuller::rasterize()
+{
+	// Bin by row of tiles, each row is then owned by a single job
+	for (std::vector<uint32_t>& row : rowTriangles)
+	{
+		row.clear();
+	}
+	for (uint32_t i = 0; i < triangles.size(); i++)
+	{
+		for (int32_t tileY = triangles[i].minTileY; tileY <= triangles[i].maxTileY; tileY++)
+		{
+			rowTriangles[tileY].push_back(i);
+		}
+	}
+
+	if (jobSystem != nullptr)
+	{
+		jobSystem->parallelFor(tilesY, 1, [this](uint32_t begin, uint32_t end) { rasterizeTileRows(begin, end); });
+	}
+	else
+	{
+		rasterizeTileRows(0, tilesY);
+	}
+
+	triangles.clear();
+}
+
+bool MaskedOcclusionCuller::testAabb(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelViewProjection) const
+{
+	int32_t rect[4];
+	float nearestDepth;
+	BoxProjection projection = projectBox(boundsMin, boundsMax, modelViewProjection, width, height, rect, nearestDepth);
+	if (projection != BOX_ON_SCREEN) { return projection == BOX_CROSSES_CAMERA; }
+
+	// Visible if its nearest point is in front of the farthest depth of any tile it touches
+	for (int32_t tileY = rect[1] / static_cast<int32_t>(TILE_HEIGHT); tileY <= rect[3] / static_cast<int32_t>(TILE_HEIGHT); tileY++)
+	{
+		for (int32_t tileX = rect[0] / static_cast<int32_t>(TILE_WIDTH); tileX <= rect[2] / static_cast<int32_t>(TILE_WIDTH); tileX++)
+		{
+			if (nearestDepth <= tileFarDepth[tileY * tilesX + tileX]) { return true; }
+		}
+	}
+	return false;
+}
+
+void MaskedOcclusionCuller::rasterizeTileRows(uint32_t firstRow, uint32_t endRow)
+{
+	for (uint32_t tileRow = firstRow; tileRow < endRow; tileRow++)
+	{
+		for (uint32_t triangleIndex : rowTriangles[tileRow])
+		{
+			switch (simd)
+			{
+			case OCCLUSION_SIMD_AVX2:
+				rasterizeTileRowAvx2(triangles[triangleIndex], tileRow);
+				break;
+			case OCCLUSION_SIMD_SSE41:
+				rasterizeTileRowSse41(triangles[triangleIndex], tileRow);
+				break;
+			default:
+				rasterizeTileRowScalar(triangles[triangleIndex], tileRow);
+				break;
+			}
+		}
+	}
+}
+
+void MaskedOcclusionCuller::rasterizeTileRowScalar(const OcclusionTriangle& triangle, uint32_t tileRow)
+{
+	int32_t start[TILE_HEIGHT], end[TILE_HEIGHT];
+	for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+	{
+		float first, last;
+		rowSpan(triangle, static_cast<float>(tileRow * TILE_HEIGHT) + 0.5f + row, static_cast<float>(width), first, last);
+		start[row] = static_cast<int32_t>(first);
+		end[row] = static_cast<int32_t>(last);
+	}
+
+	updateTileRow(triangle, tileRow, start, end);
+}
+
+CPU_TARGET_SSE41 void MaskedOcclusionCuller::rasterizeTileRowSse41(const OcclusionTriangle& triangle, uint32_t tileRow)
+{
+	alignas(16) int32_t start[TILE_HEIGHT];
+	alignas(16) int32_t end[TILE_HEIGHT];
+
+	const __m128 columnMin = _mm_set1_ps(-1.0f);
+	const __m128 columnMax = _mm_set1_ps(static_cast<float>(width) + 1.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minY = _mm_set1_ps(triangle.minY);
+	const __m128 maxY = _mm_set1_ps(triangle.maxY);
+
+	// Two halves of 4 rows
+	for (uint32_t half = 0; half < 2; half++)
+	{
+		__m128 y = _mm_add_ps(_mm_set1_ps(static_cast<float>(tileRow * TILE_HEIGHT + half * 4) + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+		__m128 first = _mm_setzero_ps();
+		__m128 last = _mm_set1_ps(static_cast<float>(width));
+
+		for (int e = 0; e < 3; e++)
+		{
+			if (triangle.edgeType[e] == OCCLUSION_EDGE_NONE) { continue; }
+
+			__m128 column = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeSlope[e]), y), _mm_set1_ps(triangle.edgeOffset[e]));
+			column = _mm_min_ps(_mm_max_ps(column, columnMin), columnMax);
+			if (triangle.edgeType[e] == OCCLUSION_EDGE_START)
+			{
+				first = _mm_max_ps(first, _mm_ceil_ps(column));
+			}
+			else
+			{
+				last = _mm_min_ps(last, _mm_add_ps(_mm_floor_ps(column), one));
+			}
+		}
+
+		// Rows outside the triangle's vertical extent cover nothing
+		__m128 inside = _mm_and_ps(_mm_cmpge_ps(y, minY), _mm_cmple_ps(y, maxY));
+		first = _mm_and_ps(first, inside);
+		last = _mm_and_ps(last, inside);
+
+		_mm_store_si128(reinterpret_cast<__m128i*>(start + half * 4), _mm_cvttps_epi32(first));
+		_mm_store_si128(reinterpret_cast<__m128i*>(end + half * 4), _mm_cvttps_epi32(last));
+	}
+
+	updateTileRow(triangle, tileRow, start, end);
+}
+
+CPU_TARGET_AVX2 void MaskedOcclusionCuller::rasterizeTileRowAvx2(const OcclusionTriangle& triangle, uint32_t tileRow)
+{
+	const __m256 columnMin = _mm256_set1_ps(-1.0f);
+	const __m256 columnMax = _mm256_set1_ps(static_cast<float>(width) + 1.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	// All 8 rows of the tile at once
+	__m256 y = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(tileRow * TILE_HEIGHT) + 0.5f),
+		_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+	__m256 first = _mm256_setzero_ps();
+	__m256 last = _mm256_set1_ps(static_cast<float>(width));
+
+	for (int e = 0; e < 3; e++)
+	{
+		if (triangle.edgeType[e] == OCCLUSION_EDGE_NONE) { continue; }
+
+		__m256 column = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeSlope[e]), y), _mm256_set1_ps(triangle.edgeOffset[e]));
+		column = _mm256_min_ps(_mm256_max_ps(column, columnMin), columnMax);
+		if (triangle.edgeType[e] == OCCLUSION_EDGE_START)
+		{
+			first = _mm256_max_ps(first, _mm256_ceil_ps(column));
+		}
+		else
+		{
+			last = _mm256_min_ps(last, _mm256_add_ps(_mm256_floor_ps(column), one));
+		}
+	}
+
+	__m256 inside = _mm256_and_ps(_mm256_cmp_ps(y, _mm256_set1_ps(triangle.minY), _CMP_GE_OQ),
+		_mm256_cmp_ps(y, _mm256_set1_ps(triangle.maxY), _CMP_LE_OQ));
+	__m256i start = _mm256_cvttps_epi32(_mm256_and_ps(first, inside));
+	__m256i end = _mm256_cvttps_epi32(_mm256_and_ps(last, inside));
+
+	// Coverage masks straight from the spans: bits >= start and not >= end (shifts of 32 give 0)
+	const __m256i allBits = _mm256_set1_epi32(-1);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i tileWidth = _mm256_set1_epi32(TILE_WIDTH);
+
+	// Depth plane maximum over the tile row (the column part is added per tile, as in triangleTileDepth)
+	float y0 = static_cast<float>(tileRow * TILE_HEIGHT);
+	float rowDepth = triangle.depthPlane.z + std::max(triangle.depthPlane.y * y0, triangle.depthPlane.y * (y0 + TILE_HEIGHT));
+
+	for (int32_t tileX = triangle.minTileX; tileX <= triangle.maxTileX; tileX++)
+	{
+		__m256i tileColumn = _mm256_set1_epi32(tileX * static_cast<int32_t>(TILE_WIDTH));
+		__m256i localStart = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(start, tileColumn), zero), tileWidth);
+		__m256i localEnd = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(end, tileColumn), zero), tileWidth);
+		__m256i triangleMask = _mm256_andnot_si256(_mm256_sllv_epi32(allBits, localEnd), _mm256_sllv_epi32(allBits, localStart));
+		if (_mm256_testz_si256(triangleMask, triangleMask)) { continue; }
+
+		float x0 = static_cast<float>(tileX * static_cast<int32_t>(TILE_WIDTH));
+		float triangleDepth = std::min(rowDepth + std::max(triangle.depthPlane.x * x0, triangle.depthPlane.x * (x0 + TILE_WIDTH)), triangle.maxDepth);
+
+		// updateTile with the whole tile mask in one register (calling the SSE version here would stall on the AVX -> SSE transition)
+		uint32_t tileIndex = tileRow * tilesX + tileX;
+		float& farDepth = tileFarDepth[tileIndex];
+		float& workingDepth = tileWorkingDepth[tileIndex];
+		if (triangleDepth >= farDepth) { continue; }
+
+		__m256i* tileMask = reinterpret_cast<__m256i*>(&tileMasks[tileIndex * TILE_HEIGHT]);
+		__m256i workingMask = _mm256_loadu_si256(tileMask);
+		if (_mm256_testz_si256(workingMask, workingMask))
+		{
+			workingDepth = triangleDepth;
+		}
+		else if (workingDepth - triangleDepth > farDepth - workingDepth)
+		{
+			workingMask = zero;
+			workingDepth = triangleDepth;
+		}
+		else
+		{
+			workingDepth = std::max(workingDepth, triangleDepth);
+		}
+
+		workingMask = _mm256_or_si256(workingMask, triangleMask);
+		if (_mm256_testc_si256(workingMask, allBits))
+		{
+			farDepth = workingDepth;
+			workingMask = zero;
+		}
+		_mm256_storeu_si256(tileMask, workingMask);
+	}
+}
+
+void MaskedOcclusionCuller::updateTileRow(const OcclusionTriangle& triangle, uint32_t tileRow, const int32_t start[TILE_HEIGHT], const int32_t end[TILE_HEIGHT])
+{
+	uint32_t mask[TILE_HEIGHT];
+	for (int32_t tileX = triangle.minTileX; tileX <= triangle.maxTileX; tileX++)
+	{
+		int32_t tileColumn = tileX * static_cast<int32_t>(TILE_WIDTH);
+		uint32_t anyCovered = 0;
+		for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+		{
+			mask[row] = spanMask(start[row] - tileColumn, end[row] - tileColumn);
+			anyCovered |= mask[row];
+		}
+
+		if (anyCovered != 0)
+		{
+			updateTile(tileRow * tilesX + tileX, mask, triangleTileDepth(triangle, tileX, tileRow));
+		}
+	}
+}
+
+void MaskedOcclusionCuller::updateTile(uint32_t tileIndex, const uint32_t mask[TILE_HEIGHT], float triangleDepth)
+{
+	float& farDepth = tileFarDepth[tileIndex];
+	float& workingDepth = tileWorkingDepth[tileIndex];
+	uint32_t* tileMask = &tileMasks[tileIndex * TILE_HEIGHT];
+
+	// Behind everything already in the tile, nothing to gain
+	if (triangleDepth >= farDepth) { return; }
+
+	bool workingEmpty = true;
+	for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+	{
+		workingEmpty = workingEmpty && tileMask[row] == 0;
+	}
+
+	if (workingEmpty)
+	{
+		workingDepth = triangleDepth;
+	}
+	else if (workingDepth - triangleDepth > farDepth - workingDepth)
+	{
+		// Much nearer than the working layer: restart the layer from this triangle (dropping coverage is always safe)
+		std::fill(tileMask, tileMask + TILE_HEIGHT, 0u);
+		workingDepth = triangleDepth;
+	}
+	else
+	{
+		workingDepth = std::max(workingDepth, triangleDepth);
+	}
+
+	bool full = true;
+	for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+	{
+		tileMask[row] |= mask[row];
+		full = full && tileMask[row] == 0xffffffffu;
+	}
+
+	// Working layer covers the whole tile, so nothing in it is farther than the working depth
+	if (full)
+	{
+		farDepth = workingDepth;
+		std::fill(tileMask, tileMask + TILE_HEIGHT, 0u);
+	}
+}
+
+float MaskedOcclusionCuller::triangleTileDepth(const OcclusionTriangle& triangle, uint32_t tileX, uint32_t tileY) const
+{
+	// Plane is linear so its maximum over the tile is at a corner
+	float x0 = static_cast<float>(tileX * TILE_WIDTH);
+	float y0 = static_cast<float>(tileY * TILE_HEIGHT);
+	float planeMax = triangle.depthPlane.z
+		+ std::max(triangle.depthPlane.x * x0, triangle.depthPlane.x * (x0 + TILE_WIDTH))
+		+ std::max(triangle.depthPlane.y * y0, triangle.depthPlane.y * (y0 + TILE_HEIGHT));
+	return std::min(planeMax, triangle.maxDepth);
+}
+
+// - REFERENCE ----------------------------------------------------------------------------------------------------------------
+
+ReferenceOcclusionCuller::ReferenceOcclusionCuller(uint32_t width, uint32_t height)
+{
+	// Same rounding as the masked culler so both see identical pixels
+	this->width = std::max((width + MaskedOcclusionCuller::TILE_WIDTH - 1) / MaskedOcclusionCuller::TILE_WIDTH, 1u) * MaskedOcclusionCuller::TILE_WIDTH;
+	this->height = std::max((height + MaskedOcclusionCuller::TILE_HEIGHT - 1) / MaskedOcclusionCuller::TILE_HEIGHT, 1u) * MaskedOcclusionCuller::TILE_HEIGHT;
+	depth.resize(this->width * this->height);
+	clear();
+}
+
+void ReferenceOcclusionCuller::clear()
+{
+	std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+void ReferenceOcclusionCuller::addOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+	const glm::mat4& modelViewProjection)
+{
+	clipPositions.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		clipPositions[i] = modelViewProjection * glm::vec4(positions[i], 1.0f);
+	}
+
+	OcclusionTriangle triangle;
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (setupTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]], width, height, triangle))
+		{
+			rasterizeTriangle(triangle);
+		}
+	}
+}
+
+bool ReferenceOcclusionCuller::testAabb(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelViewProjection) const
+{
+	int32_t rect[4];
+	float nearestDepth;
+	BoxProjection projection = projectBox(boundsMin, boundsMax, modelViewProjection, width, height, rect, nearestDepth);
+	if (projection != BOX_ON_SCREEN) { return projection == BOX_CROSSES_CAMERA; }
+
+	for (int32_t y = rect[1]; y <= rect[3]; y++)
+	{
+		for (int32_t x = rect[0]; x <= rect[2]; x++)
+		{
+			if (nearestDepth <= depth[y * width + x]) { return true; }
+		}
+	}
+	return false;
+}
+
+void ReferenceOcclusionCuller::rasterizeTriangle(const OcclusionTriangle& triangle)
+{
+	int32_t firstRow = triangle.minTileY * static_cast<int32_t>(MaskedOcclusionCuller::TILE_HEIGHT);
+	int32_t endRow = (triangle.maxTileY + 1) * static_cast<int32_t>(MaskedOcclusionCuller::TILE_HEIGHT);
+
+	for (int32_t y = firstRow; y < endRow; y++)
+	{
+		float centreY = static_cast<float>(y) + 0.5f;
+		float first, last;
+		rowSpan(triangle, centreY, static_cast<float>(width), first, last);
+
+		for (int32_t x = static_cast<int32_t>(first); x < static_cast<int32_t>(last); x++)
+		{
+			float centreX = static_cast<float>(x) + 0.5f;
+			float pixelDepth = triangle.depthPlane.x * centreX + triangle.depthPlane.y * centreY + triangle.depthPlane.z;
+			pixelDepth = std::min(std::max(pixelDepth, triangle.minDepth), triangle.maxDepth);
+
+			float& stored = depth[y * width + x];
+			stored = std::min(stored, pixelDepth);
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+class JobSystem;
+
+// Kernel used to build the coverage masks of a row of tiles
+enum OcclusionSimd
+{
+	OCCLUSION_SIMD_SCALAR,
+	OCCLUSION_SIMD_SSE41,		// 4 rows at a time
+	OCCLUSION_SIMD_AVX2			// A whole 8 row tile at a time, masks built with variable shifts
+};
+
+// Widest kernel the running CPU supports
+OcclusionSimd getBestOcclusionSimd();
+
+// Occluder triangle in screen space, ready for rasterizing
+struct OcclusionTriangle
+{
+	// Each edge bounds the covered pixel columns of a row: column = edgeSlope * rowCentreY + edgeOffset
+	float edgeSlope[3];
+	float edgeOffset[3];
+	int32_t edgeType[3];		// OCCLUSION_EDGE_*
+
+	float minY, maxY;			// Rows whose centre lies outside are not covered
+	glm::vec3 depthPlane;		// depth = x * depthPlane.x + y * depthPlane.y + depthPlane.z
+	float minDepth, maxDepth;	// Of the vertices, bounds the plane inside the triangle
+
+	glm::vec2 vertices[3];		// Pixel coordinates, ordered so the edge functions are positive inside
+	int32_t minTileX, maxTileX, minTileY, maxTileY;
+};
+
+const int32_t OCCLUSION_EDGE_START = 0;		// Covered columns start at ceil(column)
+const int32_t OCCLUSION_EDGE_END = 1;		// Covered columns end after floor(column)
+const int32_t OCCLUSION_EDGE_NONE = 2;		// Horizontal, handled by minY / maxY
+
+// Masked software occlusion culling
+// Occluders are rasterized into 32x8 pixel tiles that keep a coverage mask and two conservative depth layers
+// (instead of per pixel depth), bounding boxes are then tested against the farthest depth of the tiles they cover
+// Depth follows the renderer: NDC z, larger is farther
+class MaskedOcclusionCuller
+{
+public:
+	static const uint32_t TILE_WIDTH = 32;
+	static const uint32_t TILE_HEIGHT = 8;
+
+	// Size is rounded up to whole tiles. Rasterization runs in parallel over rows of tiles when given a job system
+	MaskedOcclusionCuller(uint32_t width, uint32_t height, OcclusionSimd newSimd = getBestOcclusionSimd(), JobSystem* newJobSystem = nullptr);
+
+	void setSimd(OcclusionSimd newSimd);
+	void setJobSystem(JobSystem* newJobSystem);
+
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+
+	// Forget all occluders, every tile back at the far plane
+	void clear();
+
+	// Transforms and sets up an occluder's triangles, they are rasterized by the next rasterize()
+	// Triangles crossing the near plane are skipped (less occlusion, never wrong occlusion)
+	void addOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+		const glm::mat4& modelViewProjection);
+
+	void rasterize();
+
+	// False only if the box (object space, transformed by modelViewProjection) is off screen or hidden by occluders
+	bool testAabb(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelViewProjection) const;
+
+private:
+	uint32_t width, height;
+	uint32_t tilesX, tilesY;
+	OcclusionSimd simd;
+	JobSystem* jobSystem;
+
+	// Per tile (structure of arrays)
+	std::vector<float> tileFarDepth;		// Reference layer: farthest depth anywhere in the tile
+	std::vector<float> tileWorkingDepth;	// Working layer: farthest depth of the triangles that cover tileMasks
+	std::vector<uint32_t> tileMasks;		// 8 words per tile, one 32 pixel row each
+
+	std::vector<OcclusionTriangle> triangles;
+	std::vector<std::vector<uint32_t>> rowTriangles;	// Triangles touching each row of tiles
+	std::vector<glm::vec4> clipPositions;				// Scratch for addOccluder
+
+	void rasterizeTileRows(uint32_t firstRow, uint32_t endRow);
+	void rasterizeTileRowScalar(const OcclusionTriangle& triangle, uint32_t tileRow);
+	void rasterizeTileRowSse41(const OcclusionTriangle& triangle, uint32_t tileRow);
+	void rasterizeTileRowAvx2(const OcclusionTriangle& triangle, uint32_t tileRow);
+
+	// Builds the masks of the tiles a row's spans [start, end) touch and merges them (scalar / SSE4.1)
+	void updateTileRow(const OcclusionTriangle& triangle, uint32_t tileRow, const int32_t start[TILE_HEIGHT], const int32_t end[TILE_HEIGHT]);
+
+	// Merges a triangle's coverage of one tile into its depth layers (the AVX2 kernel has its own copy)
+	void updateTile(uint32_t tileIndex, const uint32_t mask[TILE_HEIGHT], float triangleDepth);
+	float triangleTileDepth(const OcclusionTriangle& triangle, uint32_t tileX, uint32_t tileY) const;
+};
+
+// Scalar reference: full depth per pixel, same interface as MaskedOcclusionCuller
+// Tighter (hides everything the masked culler hides) but much slower, used to check and benchmark it
+class ReferenceOcclusionCuller
+{
+public:
+	ReferenceOcclusionCuller(uint32_t width, uint32_t height);
+
+	void clear();
+	void addOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount,
+		const glm::mat4& modelViewProjection);
+	bool testAabb(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelViewProjection) const;
+
+private:
+	uint32_t width, height;
+	std::vector<float> depth;
+	std::vector<glm::vec4> clipPositions;
+
+	void rasterizeTriangle(const OcclusionTriangle& triangle);
+};
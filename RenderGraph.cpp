@@ -0,0 +1,1626 @@
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	bool hasStencil(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	struct MemoryBlock
+	{
+		VkDeviceSize size = 0;
+		uint32_t memoryTypeBits = 0;
+		bool lazy = false;						// Lazily allocated images only
+		std::vector<uint32_t> occupants;		// Transient images, by first use
+	};
+
+	const VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+		| VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	// Memory type that is only committed if the attachment actually needs backing (tilers keep it on chip), INVALID if none
+	uint32_t findLazyMemoryType(VkPhysicalDevice physicalDevice, uint32_t allowedTypes)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((allowedTypes & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+			{
+				return i;
+			}
+		}
+		return 0xffffffff;
+	}
+
+	// Bytes per texel of the usual attachment formats (traffic estimate only, stencil left out)
+	VkDeviceSize getTexelSize(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_UNORM:
+			return 1;
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R16_SFLOAT:
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+			return 2;
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 8;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+}
+
+RenderGraph::RenderGraph(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice)
+	: physicalDevice(newPhysicalDevice), device(newDevice)
+{
+}
+
+// - RESOURCES ----------------------------------------------------------------------------------------------------------------
+
+RenderGraph::Resource RenderGraph::createImage(const std::string& name, VkExtent2D extent, VkFormat format, VkImageAspectFlags aspect,
+	VkSampleCountFlagBits samples)
+{
+	ResourceInfo info;
+	info.name = name;
+	info.extent = extent;
+	info.format = format;
+	info.aspect = aspect;
+	info.samples = samples;
+	resources.push_back(info);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importImage(const std::string& name, VkExtent2D extent, VkFormat format, VkImageAspectFlags aspect,
+	VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags waitStages)
+{
+	ResourceInfo info;
+	info.name = name;
+	info.imported = true;
+	info.extent = extent;
+	info.format = format;
+	info.aspect = aspect;
+	info.initialLayout = initialLayout;
+	info.finalLayout = finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ? initialLayout : finalLayout;
+	info.waitStages = waitStages;
+	resources.push_back(info);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const std::string& name)
+{
+	ResourceInfo info;
+	info.name = name;
+	info.isImage = false;
+	info.imported = true;
+	resources.push_back(info);
+	return static_cast<Resource>(resources.size() - 1);
+}
+
+void RenderGraph::bindImage(Resource image, const std::vector<VkImage>& newImages, const std::vector<VkImageView>& newViews)
+{
+	ResourceInfo& info = resources.at(image);
+	if (!info.imported || !info.isImage || newImages.empty() || newImages.size() != newViews.size())
+	{
+		throw std::runtime_error("Render graph can't bind these images to " + info.name + "!");
+	}
+	info.images = newImages;
+	info.views = newViews;
+}
+
+void RenderGraph::bindBuffer(Resource buffer, const std::vector<VkBuffer>& newBuffers)
+{
+	ResourceInfo& info = resources.at(buffer);
+	if (info.isImage || newBuffers.empty())
+	{
+		throw std::runtime_error("Render graph can't bind these buffers to " + info.name + "!");
+	}
+	info.buffers = newBuffers;
+}
+
+VkImageView RenderGraph::getImageView(Resource image, uint32_t frame) const
+{
+	const ResourceInfo& info = resources.at(image);
+	return info.views.empty() ? VK_NULL_HANDLE : info.views[frame % info.views.size()];
+}
+
+// - PASSES -------------------------------------------------------------------------------------------------------------------
+
+uint32_t RenderGraph::addGraphicsPass(const std::string& name, RecordFunction record)
+{
+	return addPass(name, true, record);
+}
+
+uint32_t RenderGraph::addComputePass(const std::string& name, RecordFunction record)
+{
+	return addPass(name, false, record);
+}
+
+uint32_t RenderGraph::addAsyncComputePass(const std::string& name, RecordFunction record)
+{
+	uint32_t pass = addPass(name, false, record);
+	passes[pass].asyncCandidate = true;
+	return pass;
+}
+
+uint32_t RenderGraph::addSubpass(const std::string& name, RecordFunction record)
+{
+	if (passes.empty() || !passes.back().graphics)
+	{
+		throw std::runtime_error("Render graph subpass " + name + " must follow a graphics pass!");
+	}
+
+	uint32_t pass = addPass(name, true, record);
+	passes[pass].subpass = true;
+	return pass;
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, bool graphics, RecordFunction record)
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph is already compiled!");
+	}
+
+	Pass pass;
+	pass.name = name;
+	pass.graphics = graphics;
+	pass.record = record;
+	passes.push_back(pass);
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::addColorAttachment(uint32_t pass, Resource image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor)
+{
+	addUsage(pass, image, RENDER_USAGE_COLOR_ATTACHMENT, 0, loadOp == VK_ATTACHMENT_LOAD_OP_LOAD);
+
+	Attachment attachment = { image, loadOp, {} };
+	attachment.clearValue.color = clearColor;
+	passes[pass].colorAttachments.push_back(attachment);
+}
+
+void RenderGraph::setDepthAttachment(uint32_t pass, Resource image, VkAttachmentLoadOp loadOp, bool depthWrite, float clearDepth)
+{
+	addUsage(pass, image, depthWrite ? RENDER_USAGE_DEPTH_ATTACHMENT : RENDER_USAGE_DEPTH_READ_ATTACHMENT, 0,
+		loadOp == VK_ATTACHMENT_LOAD_OP_LOAD);
+
+	Attachment attachment = { image, loadOp, {} };
+	attachment.clearValue.depthStencil = { clearDepth, 0 };
+	passes[pass].depthAttachment = attachment;
+}
+
+void RenderGraph::addResolveAttachment(uint32_t pass, Resource source, Resource target)
+{
+	std::vector<Attachment>& colorAttachments = passes.at(pass).colorAttachments;
+	auto attachment = std::find_if(colorAttachments.begin(), colorAttachments.end(), [&](const Attachment& candidate)
+	{
+		return candidate.image == source;
+	});
+	const ResourceInfo& sourceInfo = resources.at(source);
+	const ResourceInfo& targetInfo = resources.at(target);
+	if (attachment == colorAttachments.end() || sourceInfo.samples == VK_SAMPLE_COUNT_1_BIT || targetInfo.samples != VK_SAMPLE_COUNT_1_BIT
+		|| sourceInfo.format != targetInfo.format)
+	{
+		throw std::runtime_error("Render graph can't resolve " + sourceInfo.name + " into " + targetInfo.name + "!");
+	}
+
+	addUsage(pass, target, RENDER_USAGE_COLOR_ATTACHMENT, 0, false);	// Written by the resolve, like an attachment
+	attachment->resolveImage = target;
+}
+
+void RenderGraph::addInputAttachment(uint32_t pass, Resource image)
+{
+	addUsage(pass, image, RENDER_USAGE_INPUT_ATTACHMENT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, true);
+	passes[pass].inputAttachments.push_back({ image, VK_ATTACHMENT_LOAD_OP_LOAD, {} });
+}
+
+void RenderGraph::use(uint32_t pass, Resource resource, RenderUsage usage, VkPipelineStageFlags shaderStages)
+{
+	if (usage <= RENDER_USAGE_INPUT_ATTACHMENT)
+	{
+		throw std::runtime_error("Render graph attachments are set with addColorAttachment / setDepthAttachment / addInputAttachment!");
+	}
+	addUsage(pass, resource, usage, shaderStages, true);
+}
+
+void RenderGraph::setPassCache(uint32_t pass, CacheKeyFunction cacheKey)
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph is already compiled!");
+	}
+	if (!passes.at(pass).graphics)
+	{
+		throw std::runtime_error("Render graph only caches graphics passes, not " + passes[pass].name + "!");
+	}
+	passes[pass].cacheKey = cacheKey;
+}
+
+void RenderGraph::addUsage(uint32_t pass, Resource resource, RenderUsage usage, VkPipelineStageFlags shaderStages, bool loads)
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph is already compiled!");
+	}
+
+	Pass& target = passes.at(pass);
+	ResourceInfo& info = resources.at(resource);
+	for (const PassUsage& existing : target.usages)
+	{
+		if (existing.resource == resource)
+		{
+			throw std::runtime_error("Render graph pass " + target.name + " uses " + info.name + " twice!");
+		}
+	}
+
+	PassUsage passUsage = { resource, usage, shaderStages, 0, VK_IMAGE_LAYOUT_UNDEFINED, true, false };
+	bool imageOnly = true;
+	bool shaderUsage = false;
+	switch (usage)
+	{
+	case RENDER_USAGE_COLOR_ATTACHMENT:
+		passUsage.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		passUsage.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (loads ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+		passUsage.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		passUsage.reads = loads;
+		passUsage.writes = true;
+		info.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		break;
+	case RENDER_USAGE_DEPTH_ATTACHMENT:
+		passUsage.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		passUsage.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		passUsage.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		passUsage.reads = loads;
+		passUsage.writes = true;
+		info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		break;
+	case RENDER_USAGE_DEPTH_READ_ATTACHMENT:
+		passUsage.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		passUsage.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		passUsage.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		break;
+	case RENDER_USAGE_INPUT_ATTACHMENT:
+		passUsage.access = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+		passUsage.layout = (info.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		info.usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		break;
+	case RENDER_USAGE_SAMPLED:
+		passUsage.access = VK_ACCESS_SHADER_READ_BIT;
+		passUsage.layout = (info.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+		shaderUsage = true;
+		break;
+	case RENDER_USAGE_STORAGE_READ:
+	case RENDER_USAGE_STORAGE_WRITE:
+		passUsage.access = VK_ACCESS_SHADER_READ_BIT | (usage == RENDER_USAGE_STORAGE_WRITE ? VK_ACCESS_SHADER_WRITE_BIT : 0);
+		passUsage.layout = info.isImage ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		passUsage.writes = usage == RENDER_USAGE_STORAGE_WRITE;
+		info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		imageOnly = false;
+		shaderUsage = true;
+		break;
+	case RENDER_USAGE_INDEX_BUFFER:
+		passUsage.stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		passUsage.access = VK_ACCESS_INDEX_READ_BIT;
+		imageOnly = false;
+		break;
+	case RENDER_USAGE_INDIRECT_BUFFER:
+		passUsage.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		passUsage.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		imageOnly = false;
+		break;
+	case RENDER_USAGE_TRANSFER_SRC:
+		passUsage.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		passUsage.access = VK_ACCESS_TRANSFER_READ_BIT;
+		passUsage.layout = info.isImage ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageOnly = false;
+		break;
+	case RENDER_USAGE_TRANSFER_DST:
+		passUsage.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		passUsage.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		passUsage.layout = info.isImage ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		passUsage.reads = false;
+		passUsage.writes = true;
+		info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageOnly = false;
+		break;
+	}
+
+	if ((imageOnly && !info.isImage) || (info.isImage && (usage == RENDER_USAGE_INDEX_BUFFER || usage == RENDER_USAGE_INDIRECT_BUFFER)))
+	{
+		throw std::runtime_error("Render graph pass " + target.name + " can't use " + info.name + " that way!");
+	}
+	if (shaderUsage && shaderStages == 0)
+	{
+		throw std::runtime_error("Render graph pass " + target.name + " needs the shader stages using " + info.name + "!");
+	}
+
+	target.usages.push_back(passUsage);
+}
+
+// - COMPILE ------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::setDynamicRendering(PFN_vkCmdBeginRenderingKHR newCmdBeginRendering, PFN_vkCmdEndRenderingKHR newCmdEndRendering)
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph rendering mode must be set before compile!");
+	}
+	cmdBeginRendering = newCmdBeginRendering;
+	cmdEndRendering = newCmdEndRendering;
+}
+
+bool RenderGraph::isDynamicRendering() const
+{
+	return cmdBeginRendering != nullptr;
+}
+
+void RenderGraph::setAsyncCompute(uint32_t newGraphicsFamily, uint32_t newComputeFamily)
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph async compute must be set before compile!");
+	}
+	if (newGraphicsFamily == newComputeFamily)
+	{
+		throw std::runtime_error("Render graph async compute needs a queue family other than the graphics one!");
+	}
+	graphicsFamily = newGraphicsFamily;
+	computeFamily = newComputeFamily;
+}
+
+void RenderGraph::setSecondaryCommandPool(VkCommandPool commandPool)
+{
+	secondaryCommandPool = commandPool;
+}
+
+void RenderGraph::compile()
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph is already compiled!");
+	}
+
+	cullPasses();
+	assignSubpasses();
+	assignQueues();
+
+	for (const Pass& pass : passes)
+	{
+		if (!pass.cacheKey || pass.culled) { continue; }
+		if (!pass.endsRenderPass)
+		{
+			throw std::runtime_error("Render graph pass " + pass.name + " is cached but a subpass follows it!");
+		}
+		if (secondaryCommandPool == VK_NULL_HANDLE)
+		{
+			throw std::runtime_error("Render graph caches passes without a secondary command pool!");
+		}
+	}
+	createTransientImages();
+
+	// First run finds the state every resource ends the frame in, which is where the next frame starts from
+	planBarriers(false);
+	planBarriers(true);
+
+	resolveAttachments();
+	if (cmdBeginRendering == nullptr)
+	{
+		createRenderPasses();
+	}
+
+	stats.passCount = static_cast<uint32_t>(passes.size());
+	stats.barrierCount = static_cast<uint32_t>(finalBarriers.barriers.size());
+	stats.barrierBatchCount = finalBarriers.barriers.empty() ? 0 : 1;
+	for (const Pass& pass : passes)
+	{
+		stats.culledPassCount += pass.culled ? 1 : 0;
+		stats.renderPassCount += pass.graphics && !pass.culled && pass.subpassIndex == 0 ? 1 : 0;
+		stats.barrierCount += static_cast<uint32_t>(pass.barriers.barriers.size());
+		stats.barrierBatchCount += pass.barriers.barriers.empty() ? 0 : 1;
+		stats.asyncPassCount += pass.asyncQueue ? 1 : 0;
+		stats.cachedPassCount += pass.cacheKey && !pass.culled ? 1 : 0;
+	}
+	stats.barrierCount += static_cast<uint32_t>(asyncReleaseBarriers.barriers.size() + asyncAcquireBarriers.barriers.size());
+	stats.barrierBatchCount += (asyncReleaseBarriers.barriers.empty() ? 0 : 1) + (asyncAcquireBarriers.barriers.empty() ? 0 : 1);
+
+	compiled = true;
+}
+
+void RenderGraph::cullPasses()
+{
+	// Backwards: a pass is kept if it writes something imported (outlives the frame) or something a kept pass after it reads.
+	// Subpasses of one render pass stay or go together, a kept one keeps the rest (and whatever they read) on the next run
+	std::vector<uint8_t> forced(passes.size(), 0);
+	bool changed = true;
+	while (changed)
+	{
+		std::vector<uint8_t> needed(resources.size(), 0);
+		for (size_t p = passes.size(); p-- > 0;)
+		{
+			Pass& pass = passes[p];
+			bool keep = forced[p] != 0;
+			for (const PassUsage& usage : pass.usages)
+			{
+				keep |= usage.writes && (resources[usage.resource].imported || needed[usage.resource]);
+			}
+
+			pass.culled = !keep;
+			if (!keep) { continue; }
+
+			// Overwritten without being read: earlier writers don't matter for it
+			for (const PassUsage& usage : pass.usages)
+			{
+				if (usage.writes && !usage.reads) { needed[usage.resource] = 0; }
+			}
+			for (const PassUsage& usage : pass.usages)
+			{
+				if (usage.reads) { needed[usage.resource] = 1; }
+			}
+		}
+
+		changed = false;
+		for (size_t first = 0; first < passes.size();)
+		{
+			size_t end = first + 1;
+			while (end < passes.size() && passes[end].subpass) { end++; }
+
+			bool anyKept = false;
+			bool anyCulled = false;
+			for (size_t p = first; p < end; p++)
+			{
+				anyKept |= !passes[p].culled;
+				anyCulled |= passes[p].culled;
+			}
+			if (anyKept && anyCulled)
+			{
+				std::fill(forced.begin() + first, forced.begin() + end, 1);
+				changed = true;
+			}
+			first = end;
+		}
+	}
+}
+
+void RenderGraph::assignSubpasses()
+{
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		if (cmdBeginRendering != nullptr && (pass.subpass || !pass.inputAttachments.empty()))
+		{
+			throw std::runtime_error("Render graph pass " + pass.name + " needs render pass objects, not dynamic rendering!");
+		}
+
+		pass.renderPassOwner = p;
+		pass.subpassIndex = 0;
+		if (pass.subpass)
+		{
+			Pass& previous = passes[p - 1];
+			pass.renderPassOwner = previous.renderPassOwner;
+			pass.subpassIndex = previous.subpassIndex + 1;
+			previous.endsRenderPass = false;
+		}
+	}
+}
+
+void RenderGraph::assignQueues()
+{
+	// An async pass overlaps every graphics queue pass before the join: it may share buffers with later graphics passes
+	// that read them only. Moving a pass back to the graphics queue can break that for others, so repeat until stable
+	for (Pass& pass : passes)
+	{
+		pass.asyncQueue = pass.asyncCandidate && !pass.culled && computeFamily != VK_QUEUE_FAMILY_IGNORED;
+	}
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (uint32_t p = 0; p < passes.size(); p++)
+		{
+			Pass& pass = passes[p];
+			if (!pass.asyncQueue) { continue; }
+
+			bool fits = true;
+			for (const PassUsage& usage : pass.usages)
+			{
+				fits &= !resources[usage.resource].isImage;
+				for (uint32_t other = 0; other < passes.size() && fits; other++)
+				{
+					if (passes[other].culled || passes[other].asyncQueue) { continue; }
+					const PassUsage* otherUsage = findUsage(passes[other], usage.resource);
+					fits &= otherUsage == nullptr || (other > p && !otherUsage->writes);
+				}
+			}
+			if (!fits)
+			{
+				pass.asyncQueue = false;
+				changed = true;
+			}
+		}
+	}
+
+	for (ResourceInfo& info : resources)
+	{
+		info.async = false;
+	}
+	for (const Pass& pass : passes)
+	{
+		if (!pass.asyncQueue) { continue; }
+		for (const PassUsage& usage : pass.usages)
+		{
+			resources[usage.resource].async = true;
+		}
+	}
+
+	// The graphics queue waits for the async work before the first render pass (or pass) using its results
+	asyncJoinPass = static_cast<uint32_t>(passes.size());
+	asyncWaitStages = 0;
+	for (const Pass& pass : passes)
+	{
+		if (pass.culled || pass.asyncQueue) { continue; }
+		for (const PassUsage& usage : pass.usages)
+		{
+			if (!resources[usage.resource].async) { continue; }
+			asyncJoinPass = std::min(asyncJoinPass, pass.renderPassOwner);
+			asyncWaitStages |= usage.stages;
+		}
+	}
+	if (asyncWaitStages == 0)
+	{
+		asyncWaitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;		// Nothing uses the results, the frame still ends after them
+	}
+}
+
+void RenderGraph::createTransientImages()
+{
+	// Lifetimes over the kept passes
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		if (passes[p].culled) { continue; }
+		for (const PassUsage& usage : passes[p].usages)
+		{
+			ResourceInfo& info = resources[usage.resource];
+			if (info.firstPass == INVALID) { info.firstPass = p; }
+			info.lastPass = p;
+		}
+	}
+
+	std::vector<uint32_t> transients;
+	for (uint32_t r = 0; r < resources.size(); r++)
+	{
+		ResourceInfo& info = resources[r];
+		if (info.imported || info.firstPass == INVALID) { continue; }
+
+		// Contents that never leave the render pass they are made in (its subpasses only, not loaded, only ever an
+		// attachment) need no memory behind them on tilers: TRANSIENT_ATTACHMENT lets them use LAZILY_ALLOCATED memory
+		if (passes[info.firstPass].renderPassOwner == passes[info.lastPass].renderPassOwner && (info.usage & ~ATTACHMENT_USAGE) == 0)
+		{
+			const Attachment* attachment = findAttachment(passes[info.firstPass], r);
+			info.lazy = attachment != nullptr && getLoadOp(info.firstPass, *attachment) != VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.extent = { info.extent.width, info.extent.height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.format = info.format;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageCreateInfo.usage = info.usage | (info.lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+		imageCreateInfo.samples = info.samples;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkImage image;
+		if (vkCreateImage(device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create render graph image " + info.name + "!");
+		}
+		info.images.push_back(image);
+		vkGetImageMemoryRequirements(device, image, &info.memoryRequirements);
+		info.lazy = info.lazy && findLazyMemoryType(physicalDevice, info.memoryRequirements.memoryTypeBits) != INVALID;
+		transients.push_back(r);
+	}
+
+	// Largest first, each into the first block of a compatible memory type whose occupants' lifetimes it doesn't overlap
+	std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b)
+	{
+		return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+	});
+
+	std::vector<MemoryBlock> blocks;
+	for (uint32_t r : transients)
+	{
+		ResourceInfo& info = resources[r];
+		uint32_t chosen = INVALID;
+		for (uint32_t b = 0; b < blocks.size() && chosen == INVALID; b++)
+		{
+			if (!(blocks[b].memoryTypeBits & info.memoryRequirements.memoryTypeBits) || blocks[b].lazy != info.lazy) { continue; }
+
+			bool overlaps = false;
+			for (uint32_t occupant : blocks[b].occupants)
+			{
+				overlaps |= info.firstPass <= resources[occupant].lastPass && resources[occupant].firstPass <= info.lastPass;
+			}
+			if (!overlaps) { chosen = b; }
+		}
+
+		if (chosen == INVALID)
+		{
+			chosen = static_cast<uint32_t>(blocks.size());
+			blocks.push_back({ 0, info.memoryRequirements.memoryTypeBits, info.lazy, {} });
+		}
+
+		MemoryBlock& block = blocks[chosen];
+		block.size = std::max(block.size, info.memoryRequirements.size);
+		block.memoryTypeBits &= info.memoryRequirements.memoryTypeBits;
+		block.occupants.push_back(r);
+		info.memoryBlock = chosen;
+
+		stats.transientImageCount++;
+		stats.lazyImageCount += info.lazy ? 1 : 0;
+		stats.transientBytes += info.memoryRequirements.size;
+	}
+
+	for (MemoryBlock& block : blocks)
+	{
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = block.size;
+		memoryAllocateInfo.memoryTypeIndex = block.lazy ? findLazyMemoryType(physicalDevice, block.memoryTypeBits)
+			: findMemoryTypeIndex(physicalDevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate render graph memory!");
+		}
+		memoryBlocks.push_back(memory);
+		stats.allocatedBytes += block.size;
+		stats.lazyBytes += block.lazy ? block.size : 0;
+
+		// Occupants hand the memory over in order, the first one takes it from the last one of the previous frame
+		std::sort(block.occupants.begin(), block.occupants.end(), [&](uint32_t a, uint32_t b)
+		{
+			return resources[a].firstPass < resources[b].firstPass;
+		});
+		for (size_t i = 0; i < block.occupants.size(); i++)
+		{
+			ResourceInfo& info = resources[block.occupants[i]];
+			info.aliasPredecessor = block.occupants[(i + block.occupants.size() - 1) % block.occupants.size()];
+			vkBindImageMemory(device, info.images[0], memory, 0);
+
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.image = info.images[0];
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = info.format;
+			viewCreateInfo.subresourceRange = { info.aspect, 0, 1, 0, 1 };
+
+			VkImageView view;
+			if (vkCreateImageView(device, &viewCreateInfo, nullptr, &view) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create render graph image view " + info.name + "!");
+			}
+			info.views.push_back(view);
+		}
+	}
+}
+
+void RenderGraph::planBarriers(bool recordBarriers)
+{
+	std::vector<ResourceState> states(resources.size());
+	for (uint32_t r = 0; r < resources.size(); r++)
+	{
+		const ResourceInfo& info = resources[r];
+		ResourceState& state = states[r];
+		state.layout = info.imported ? info.initialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+		if (!recordBarriers || info.async) { continue; }	// Async buffers are bound per frame, the CPU waits for their last frame
+
+		// Whatever touched the memory last (this resource or, when aliased, the one before it) must finish first
+		const ResourceState& previous = info.aliasPredecessor != INVALID ? resources[info.aliasPredecessor].endState : info.endState;
+		state.writeStages = previous.writeStages | previous.readStages | info.waitStages;
+		state.writeAccess = previous.writeAccess;
+	}
+
+	asyncReleaseBarriers = BarrierBatch();
+	asyncAcquireBarriers = BarrierBatch();
+	std::vector<uint8_t> handedOver(resources.size(), 0);
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		pass.barriers = BarrierBatch();
+		if (pass.culled) { continue; }
+
+		// Joining the async work: its buffers change queue family, released at the end of the async command buffer and
+		// acquired here (after the semaphore wait) for every graphics queue use that follows
+		if (p == asyncJoinPass)
+		{
+			for (uint32_t r = 0; r < resources.size(); r++)
+			{
+				ResourceState& state = states[r];
+				if (!state.asyncQueue) { continue; }
+
+				VkPipelineStageFlags consumerStages = 0;
+				VkAccessFlags consumerAccess = 0;
+				for (uint32_t later = p; later < passes.size(); later++)
+				{
+					if (passes[later].culled || passes[later].asyncQueue) { continue; }
+					const PassUsage* usage = findUsage(passes[later], r);
+					if (usage == nullptr) { continue; }
+					consumerStages |= usage->stages;
+					consumerAccess |= usage->access;
+				}
+				if (consumerStages == 0) { continue; }
+
+				if (recordBarriers)
+				{
+					asyncReleaseBarriers.srcStages |= state.writeStages | state.readStages;
+					asyncReleaseBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+					asyncReleaseBarriers.barriers.push_back({ r, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, state.writeAccess, 0,
+						computeFamily, graphicsFamily });
+					pass.barriers.srcStages |= asyncWaitStages;
+					pass.barriers.dstStages |= consumerStages;
+					pass.barriers.barriers.push_back({ r, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, 0, consumerAccess,
+						computeFamily, graphicsFamily });
+				}
+				handedOver[r] = 1;
+				state = ResourceState();
+				state.writeStages = consumerStages;
+				state.readStages = consumerStages;
+				state.readAccess = consumerAccess;
+			}
+		}
+
+		// No barriers inside a render pass: later subpasses wait before it begins, and attachments an earlier subpass
+		// used are ordered by the subpass dependencies instead (nothing else may change between subpasses)
+		for (const PassUsage& usage : pass.usages)
+		{
+			BarrierBatch* batch = recordBarriers ? &passes[pass.renderPassOwner].barriers : nullptr;
+			for (uint32_t earlier = pass.renderPassOwner; earlier < p; earlier++)
+			{
+				const PassUsage* earlierUsage = findUsage(passes[earlier], usage.resource);
+				if (earlierUsage == nullptr) { continue; }
+
+				if (usage.usage <= RENDER_USAGE_INPUT_ATTACHMENT && earlierUsage->usage <= RENDER_USAGE_INPUT_ATTACHMENT)
+				{
+					batch = nullptr;
+				}
+				else if (usage.writes || earlierUsage->writes || usage.layout != earlierUsage->layout)
+				{
+					throw std::runtime_error("Render graph subpass " + pass.name + " can only share " + resources[usage.resource].name
+						+ " with the subpasses before it as an attachment!");
+				}
+			}
+
+			transition(states[usage.resource], resources[usage.resource], usage.resource, usage.stages, usage.access, usage.layout,
+				usage.writes, batch);
+			states[usage.resource].asyncQueue = pass.asyncQueue;
+		}
+	}
+
+	// Imported images leave in the layout the next frame (or presentation) expects, the stages stay those of the last use
+	finalBarriers = BarrierBatch();
+	for (uint32_t r = 0; r < resources.size(); r++)
+	{
+		const ResourceInfo& info = resources[r];
+		ResourceState& state = states[r];
+		if (info.imported && info.isImage && info.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED && info.finalLayout != state.layout)
+		{
+			VkPipelineStageFlags lastStages = state.writeStages | state.readStages;
+			finalBarriers.srcStages |= lastStages != 0 ? lastStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+			finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			finalBarriers.barriers.push_back({ r, state.layout, info.finalLayout, state.writeAccess, 0 });
+			state.layout = info.finalLayout;
+		}
+
+		// Handed to the graphics queue: released back after its last use there, acquired by the next async command buffer
+		// of the frame before the async passes (exclusive buffers, their contents stay defined for the compute queue)
+		if (handedOver[r])
+		{
+			VkPipelineStageFlags asyncStages = 0;
+			VkAccessFlags asyncAccess = 0;
+			for (const Pass& pass : passes)
+			{
+				const PassUsage* usage = pass.asyncQueue ? findUsage(pass, r) : nullptr;
+				if (usage == nullptr) { continue; }
+				asyncStages |= usage->stages;
+				asyncAccess |= usage->access;
+			}
+			finalBarriers.srcStages |= state.writeStages | state.readStages;
+			finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			finalBarriers.barriers.push_back({ r, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, state.writeAccess, 0,
+				graphicsFamily, computeFamily });
+			asyncAcquireBarriers.srcStages |= asyncStages;		// Chains with the submission's wait for the releasing frame
+			asyncAcquireBarriers.dstStages |= asyncStages;
+			asyncAcquireBarriers.barriers.push_back({ r, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, 0, asyncAccess,
+				graphicsFamily, computeFamily });
+		}
+		resources[r].endState = state;
+	}
+	if (!recordBarriers)
+	{
+		finalBarriers = BarrierBatch();
+		asyncAcquireBarriers = BarrierBatch();
+	}
+}
+
+void RenderGraph::transition(ResourceState& state, const ResourceInfo& info, Resource resource, VkPipelineStageFlags stages,
+	VkAccessFlags access, VkImageLayout layout, bool writes, BarrierBatch* batch)
+{
+	bool layoutChange = info.isImage && layout != state.layout;
+
+	// Read in the same layout: only wait for the last write, unless an earlier barrier already made it visible here
+	if (!writes && !layoutChange)
+	{
+		bool visible = (state.readStages & stages) == stages && (state.readAccess & access) == access;
+		if (state.writeStages != 0 && !visible)
+		{
+			if (batch != nullptr)
+			{
+				batch->srcStages |= state.writeStages;
+				batch->dstStages |= stages;
+				batch->barriers.push_back({ resource, state.layout, layout, state.writeAccess, access });
+			}
+			state.readAccess |= access;
+		}
+		state.readStages |= stages;
+		return;
+	}
+
+	// Write or layout transition: wait for the last write and every read since (reads only need execution order)
+	VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+	if (batch != nullptr && (srcStages != 0 || layoutChange))
+	{
+		batch->srcStages |= srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		batch->dstStages |= stages;
+		batch->barriers.push_back({ resource, state.layout, layout, state.writeAccess, access });
+	}
+
+	if (writes)
+	{
+		state.writeStages = stages;
+		state.writeAccess = access & WRITE_ACCESS;
+		state.readStages = 0;
+		state.readAccess = 0;
+	}
+	else
+	{
+		// The transition itself is done by the time these stages run
+		state.writeStages = stages;
+		state.readStages = stages;
+		state.readAccess = access;
+	}
+	state.layout = layout;
+}
+
+bool RenderGraph::isReadLater(Resource resource, uint32_t afterPass) const
+{
+	for (uint32_t p = afterPass + 1; p < passes.size(); p++)
+	{
+		if (passes[p].culled) { continue; }
+		for (const PassUsage& usage : passes[p].usages)
+		{
+			if (usage.resource == resource) { return usage.reads; }
+		}
+	}
+	return resources[resource].imported;
+}
+
+const RenderGraph::Attachment* RenderGraph::findAttachment(const Pass& pass, Resource image) const
+{
+	for (const Attachment& attachment : pass.colorAttachments)
+	{
+		if (attachment.image == image) { return &attachment; }
+	}
+	for (const Attachment& attachment : pass.inputAttachments)
+	{
+		if (attachment.image == image) { return &attachment; }
+	}
+	return pass.depthAttachment.image == image ? &pass.depthAttachment : nullptr;
+}
+
+const RenderGraph::PassUsage* RenderGraph::findUsage(const Pass& pass, Resource resource) const
+{
+	for (const PassUsage& usage : pass.usages)
+	{
+		if (usage.resource == resource) { return &usage; }
+	}
+	return nullptr;
+}
+
+VkAttachmentLoadOp RenderGraph::getLoadOp(uint32_t pass, const Attachment& attachment) const
+{
+	// Loading contents nothing has defined yet this frame (transient, or imported as UNDEFINED) is wasted bandwidth
+	const ResourceInfo& info = resources[attachment.image];
+	if (attachment.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD || (info.imported && info.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED))
+	{
+		return attachment.loadOp;
+	}
+	for (uint32_t p = 0; p < pass; p++)
+	{
+		if (passes[p].culled) { continue; }
+		for (const PassUsage& usage : passes[p].usages)
+		{
+			if (usage.resource == attachment.image && usage.writes) { return VK_ATTACHMENT_LOAD_OP_LOAD; }
+		}
+	}
+	return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+}
+
+void RenderGraph::resolveAttachments()
+{
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		if (!pass.graphics || pass.culled) { continue; }
+
+		pass.attachments = pass.colorAttachments;
+		if (pass.depthAttachment.image != INVALID)
+		{
+			pass.attachments.push_back(pass.depthAttachment);
+		}
+		if (pass.attachments.empty())
+		{
+			throw std::runtime_error("Render graph pass " + pass.name + " has no attachments!");
+		}
+
+		// Layouts are already right when the pass begins (graph barriers), so it does no transitions of its own.
+		// Contents are loaded only if something earlier defined them, stored only if a later pass reads them or they outlive the frame
+		for (Attachment& attachment : pass.attachments)
+		{
+			const ResourceInfo& info = resources[attachment.image];
+			const PassUsage& usage = *findUsage(pass, attachment.image);
+
+			attachment.loadOp = getLoadOp(p, attachment);
+			attachment.storeOp = isReadLater(attachment.image, p) || !usage.writes ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.layout = usage.layout;
+			attachment.finalLayout = usage.layout;
+			if (info.samples != resources[pass.attachments[0].image].samples)
+			{
+				throw std::runtime_error("Render graph pass " + pass.name + " mixes sample counts!");
+			}
+
+			// Multisampled contents usually end here, only the resolved image is kept
+			if (attachment.resolveImage != INVALID)
+			{
+				attachment.resolveStoreOp = isReadLater(attachment.resolveImage, p) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				pass.frameCount = std::max(pass.frameCount, resources[attachment.resolveImage].views.size());
+			}
+			if (usage.usage == RENDER_USAGE_COLOR_ATTACHMENT) { pass.colorFormats.push_back(info.format); }
+			else { pass.depthFormat = info.format; }
+
+			if (info.views.empty())
+			{
+				throw std::runtime_error("Render graph attachment " + info.name + " is not bound!");
+			}
+			pass.frameCount = std::max(pass.frameCount, info.views.size());
+		}
+		for (Attachment& attachment : pass.inputAttachments)
+		{
+			attachment.loadOp = getLoadOp(p, attachment);
+			attachment.layout = findUsage(pass, attachment.image)->layout;
+			attachment.finalLayout = attachment.layout;
+			pass.frameCount = std::max(pass.frameCount, resources[attachment.image].views.size());
+		}
+		pass.extent = resources[pass.attachments[0].image].extent;
+	}
+
+	// A render pass holds the attachments of all its subpasses: each comes in as the first subpass using it begins and is
+	// stored only if a pass after the render pass reads it, what one subpass leaves for the next stays in tile memory
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& owner = passes[p];
+		if (!owner.graphics || owner.culled || owner.subpass) { continue; }
+
+		uint32_t last = p;
+		while (!passes[last].endsRenderPass) { last++; }
+
+		owner.renderPassAttachments.clear();
+		for (uint32_t s = p; s <= last; s++)
+		{
+			const Pass& subpass = passes[s];
+			if (subpass.extent.width != owner.extent.width || subpass.extent.height != owner.extent.height)
+			{
+				throw std::runtime_error("Render graph subpass " + subpass.name + " doesn't match the size of its render pass!");
+			}
+			owner.frameCount = std::max(owner.frameCount, subpass.frameCount);
+
+			std::vector<Attachment> used = subpass.attachments;
+			used.insert(used.end(), subpass.inputAttachments.begin(), subpass.inputAttachments.end());
+			for (const Attachment& attachment : used)
+			{
+				auto existing = std::find_if(owner.renderPassAttachments.begin(), owner.renderPassAttachments.end(), [&](const Attachment& candidate)
+				{
+					return candidate.image == attachment.image;
+				});
+				if (existing == owner.renderPassAttachments.end())
+				{
+					owner.renderPassAttachments.push_back(attachment);
+					existing = owner.renderPassAttachments.end() - 1;
+				}
+				existing->finalLayout = attachment.layout;
+
+				// Resolves are written to memory as their subpass ends
+				VkDeviceSize resolveBytes = attachment.resolveImage == INVALID || attachment.resolveStoreOp != VK_ATTACHMENT_STORE_OP_STORE ? 0
+					: static_cast<VkDeviceSize>(owner.extent.width) * owner.extent.height * getTexelSize(resources[attachment.resolveImage].format);
+				stats.attachmentStoreBytes += resolveBytes;
+			}
+		}
+
+		for (Attachment& attachment : owner.renderPassAttachments)
+		{
+			const ResourceInfo& info = resources[attachment.image];
+			bool written = false;
+			for (uint32_t s = p; s <= last; s++)
+			{
+				const PassUsage* usage = findUsage(passes[s], attachment.image);
+				written |= usage != nullptr && usage->writes;
+			}
+			attachment.storeOp = isReadLater(attachment.image, last) || !written ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			owner.clearValues.push_back(attachment.clearValue);
+
+			VkDeviceSize bytes = static_cast<VkDeviceSize>(info.extent.width) * info.extent.height * getTexelSize(info.format) * info.samples;
+			stats.attachmentLoadBytes += attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? bytes : 0;
+			stats.attachmentStoreBytes += written && attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? bytes : 0;
+		}
+	}
+}
+
+void RenderGraph::createRenderPasses()
+{
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& owner = passes[p];
+		if (!owner.graphics || owner.culled || owner.subpass) { continue; }
+
+		uint32_t last = p;
+		while (!passes[last].endsRenderPass) { last++; }
+		uint32_t subpassCount = last - p + 1;
+
+		// Layouts are right when the render pass begins (graph barriers), they only change between subpasses
+		std::vector<VkAttachmentDescription> descriptions;
+		for (const Attachment& attachment : owner.renderPassAttachments)
+		{
+			VkAttachmentDescription description = {};
+			description.format = resources[attachment.image].format;
+			description.samples = resources[attachment.image].samples;
+			description.loadOp = attachment.loadOp;
+			description.storeOp = attachment.storeOp;
+			description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.initialLayout = attachment.layout;
+			description.finalLayout = attachment.finalLayout;
+			descriptions.push_back(description);
+		}
+		auto indexOf = [&](Resource image)
+		{
+			for (uint32_t a = 0; a < owner.renderPassAttachments.size(); a++)
+			{
+				if (owner.renderPassAttachments[a].image == image) { return a; }
+			}
+			return static_cast<uint32_t>(VK_ATTACHMENT_UNUSED);
+		};
+
+		std::vector<std::vector<VkAttachmentReference>> colourReferences(subpassCount);
+		std::vector<std::vector<VkAttachmentReference>> resolveReferences(subpassCount);
+		std::vector<std::vector<VkAttachmentReference>> inputReferences(subpassCount);
+		std::vector<std::vector<uint32_t>> preserveReferences(subpassCount);
+		std::vector<VkAttachmentReference> depthReferences(subpassCount);
+		std::vector<VkSubpassDescription> subpasses(subpassCount);
+		std::vector<Resource> resolveTargets;
+		for (uint32_t s = 0; s < subpassCount; s++)
+		{
+			const Pass& pass = passes[p + s];
+
+			// Resolve targets follow the other attachments, one reference per colour attachment (UNUSED if it isn't resolved)
+			bool resolves = false;
+			for (const Attachment& attachment : pass.attachments)
+			{
+				VkAttachmentReference reference = { indexOf(attachment.image), attachment.layout };
+				if (attachment.image == pass.depthAttachment.image)
+				{
+					depthReferences[s] = reference;
+					continue;
+				}
+				colourReferences[s].push_back(reference);
+
+				VkAttachmentReference resolveReference = { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+				if (attachment.resolveImage != INVALID)
+				{
+					VkAttachmentDescription description = {};
+					description.format = resources[attachment.resolveImage].format;
+					description.samples = VK_SAMPLE_COUNT_1_BIT;
+					description.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					description.storeOp = attachment.resolveStoreOp;
+					description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					description.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+					resolveReference = { static_cast<uint32_t>(descriptions.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+					descriptions.push_back(description);
+					owner.clearValues.push_back({});
+					resolveTargets.push_back(attachment.resolveImage);
+					resolves = true;
+				}
+				resolveReferences[s].push_back(resolveReference);
+			}
+			for (const Attachment& attachment : pass.inputAttachments)
+			{
+				inputReferences[s].push_back({ indexOf(attachment.image), attachment.layout });
+			}
+
+			// Attachments used before and after this subpass but not by it keep their contents through it
+			for (uint32_t a = 0; a < owner.renderPassAttachments.size(); a++)
+			{
+				Resource image = owner.renderPassAttachments[a].image;
+				bool before = false;
+				bool after = false;
+				for (uint32_t other = 0; other < subpassCount; other++)
+				{
+					if (findUsage(passes[p + other], image) == nullptr) { continue; }
+					before |= other < s;
+					after |= other > s;
+				}
+				if (before && after && findUsage(pass, image) == nullptr) { preserveReferences[s].push_back(a); }
+			}
+
+			VkSubpassDescription& subpass = subpasses[s];
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.inputAttachmentCount = static_cast<uint32_t>(inputReferences[s].size());
+			subpass.pInputAttachments = inputReferences[s].data();
+			subpass.colorAttachmentCount = static_cast<uint32_t>(colourReferences[s].size());
+			subpass.pColorAttachments = colourReferences[s].data();
+			subpass.pResolveAttachments = resolves ? resolveReferences[s].data() : nullptr;
+			subpass.pDepthStencilAttachment = pass.depthAttachment.image != INVALID ? &depthReferences[s] : nullptr;
+			subpass.preserveAttachmentCount = static_cast<uint32_t>(preserveReferences[s].size());
+			subpass.pPreserveAttachments = preserveReferences[s].data();
+		}
+
+		// A subpass waits for the earlier ones that touched its attachments, pixel by pixel as it only reads its own
+		std::vector<VkSubpassDependency> dependencies;
+		for (uint32_t dst = 1; dst < subpassCount; dst++)
+		{
+			for (uint32_t src = 0; src < dst; src++)
+			{
+				VkSubpassDependency dependency = { src, dst, 0, 0, 0, 0, VK_DEPENDENCY_BY_REGION_BIT };
+				for (const PassUsage& usage : passes[p + dst].usages)
+				{
+					const PassUsage* earlier = findUsage(passes[p + src], usage.resource);
+					if (earlier == nullptr || (!earlier->writes && !usage.writes && earlier->layout == usage.layout)) { continue; }
+
+					dependency.srcStageMask |= earlier->stages;
+					dependency.dstStageMask |= usage.stages;
+					dependency.srcAccessMask |= earlier->access & WRITE_ACCESS;
+					dependency.dstAccessMask |= usage.access;
+				}
+				if (dependency.srcStageMask != 0) { dependencies.push_back(dependency); }
+			}
+		}
+
+		VkRenderPassCreateInfo renderPassCreateInfo = {};
+		renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+		renderPassCreateInfo.pAttachments = descriptions.data();
+		renderPassCreateInfo.subpassCount = subpassCount;
+		renderPassCreateInfo.pSubpasses = subpasses.data();
+		renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassCreateInfo.pDependencies = dependencies.data();
+		if (vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &owner.renderPass) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Render Pass for render graph pass " + owner.name + "!");
+		}
+
+		// One framebuffer per distinct set of attachment views (e.g. per swapchain image)
+		owner.framebuffers.resize(owner.frameCount);
+		for (size_t frame = 0; frame < owner.frameCount; frame++)
+		{
+			std::vector<VkImageView> views;
+			for (const Attachment& attachment : owner.renderPassAttachments)
+			{
+				views.push_back(getImageView(attachment.image, static_cast<uint32_t>(frame)));
+			}
+			for (Resource target : resolveTargets)
+			{
+				views.push_back(getImageView(target, static_cast<uint32_t>(frame)));
+			}
+
+			VkFramebufferCreateInfo framebufferCreateInfo = {};
+			framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferCreateInfo.renderPass = owner.renderPass;
+			framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(views.size());
+			framebufferCreateInfo.pAttachments = views.data();
+			framebufferCreateInfo.width = owner.extent.width;
+			framebufferCreateInfo.height = owner.extent.height;
+			framebufferCreateInfo.layers = 1;
+			if (vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &owner.framebuffers[frame]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create framebuffer for render graph pass " + owner.name + "!");
+			}
+		}
+	}
+}
+
+// - EXECUTE ------------------------------------------------------------------------------------------------------------------
+
+void RenderGraph::setProfiler(GpuProfiler* newProfiler, GpuProfiler* newAsyncProfiler)
+{
+	profiler = newProfiler;
+	asyncProfiler = newAsyncProfiler;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t frame, VkCommandBuffer joinCommandBuffer)
+{
+	if (!compiled)
+	{
+		throw std::runtime_error("Render graph must be compiled before it is executed!");
+	}
+	if (hasAsyncCompute() && joinCommandBuffer == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Render graph with async compute passes needs a join command buffer!");
+	}
+
+	stats.cachedPassRecordCount = 0;
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		if (pass.culled || pass.asyncQueue) { continue; }
+		recordPass(hasAsyncCompute() && p >= asyncJoinPass ? joinCommandBuffer : commandBuffer, frame, pass, profiler);
+	}
+
+	recordBarriers(hasAsyncCompute() ? joinCommandBuffer : commandBuffer, frame, finalBarriers);
+	if (hasAsyncCompute())
+	{
+		asyncReturned.resize(std::max(asyncReturned.size(), static_cast<size_t>(frame) + 1), 0);
+		asyncReturned[frame] = 1;
+	}
+}
+
+void RenderGraph::executeAsyncCompute(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	if (!compiled)
+	{
+		throw std::runtime_error("Render graph must be compiled before it is executed!");
+	}
+
+	for (Pass& pass : passes)
+	{
+		if (!pass.asyncQueue) { continue; }
+		for (const PassUsage& usage : pass.usages)
+		{
+			if (resources[usage.resource].buffers.size() < 2)
+			{
+				throw std::runtime_error("Render graph buffer " + resources[usage.resource].name + " must be bound per frame for async pass " + pass.name + "!");
+			}
+		}
+	}
+
+	// The frame's first run has nothing to take back, its buffers haven't been used on the graphics queue yet
+	if (frame < asyncReturned.size() && asyncReturned[frame])
+	{
+		recordBarriers(commandBuffer, frame, asyncAcquireBarriers);
+	}
+	for (Pass& pass : passes)
+	{
+		if (pass.asyncQueue) { recordPass(commandBuffer, frame, pass, asyncProfiler); }
+	}
+
+	recordBarriers(commandBuffer, frame, asyncReleaseBarriers);
+}
+
+bool RenderGraph::hasAsyncCompute() const
+{
+	return stats.asyncPassCount > 0;
+}
+
+VkPipelineStageFlags RenderGraph::getAsyncWaitStages() const
+{
+	return asyncWaitStages;
+}
+
+void RenderGraph::recordPass(VkCommandBuffer commandBuffer, uint32_t frame, Pass& pass, GpuProfiler* passProfiler)
+{
+	// Barriers count towards the pass waiting on them
+	uint32_t scope = passProfiler != nullptr ? passProfiler->beginScope(commandBuffer, frame, pass.name) : 0;
+	recordBarriers(commandBuffer, frame, pass.barriers);
+
+	if (!pass.graphics)
+	{
+		pass.record(commandBuffer, frame);
+	}
+	else if (cmdBeginRendering != nullptr)
+	{
+		beginRendering(commandBuffer, frame, pass);
+			recordPassContents(commandBuffer, frame, pass);
+		cmdEndRendering(commandBuffer);
+	}
+	else
+	{
+		VkSubpassContents contents = pass.cacheKey ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+		if (pass.subpassIndex == 0)
+		{
+			VkRenderPassBeginInfo renderPassBeginInfo = {};
+			renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassBeginInfo.renderPass = pass.renderPass;
+			renderPassBeginInfo.framebuffer = pass.framebuffers[frame % pass.framebuffers.size()];
+			renderPassBeginInfo.renderArea = { { 0, 0 }, pass.extent };
+			renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+			renderPassBeginInfo.pClearValues = pass.clearValues.data();
+
+			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, contents);
+		}
+		else
+		{
+			vkCmdNextSubpass(commandBuffer, contents);
+		}
+			recordPassContents(commandBuffer, frame, pass);
+		if (pass.endsRenderPass) { vkCmdEndRenderPass(commandBuffer); }
+	}
+
+	if (passProfiler != nullptr) { passProfiler->endScope(commandBuffer, frame, scope); }
+}
+
+void RenderGraph::recordPassContents(VkCommandBuffer commandBuffer, uint32_t frame, Pass& pass)
+{
+	if (!pass.cacheKey)
+	{
+		pass.record(commandBuffer, frame);
+		return;
+	}
+
+	if (pass.secondaries.size() <= frame)
+	{
+		pass.secondaries.resize(frame + 1, VK_NULL_HANDLE);
+		pass.secondaryKeys.resize(frame + 1, 0);
+		pass.secondaryValid.resize(frame + 1, 0);
+	}
+	VkCommandBuffer& secondary = pass.secondaries[frame];
+	if (secondary == VK_NULL_HANDLE)
+	{
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = secondaryCommandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocateInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocateInfo, &secondary) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate secondary command buffer for render graph pass " + pass.name + "!");
+		}
+	}
+
+	// Recorded again only when the key moved on (the frame's previous submission is done with it by now)
+	uint64_t key = pass.cacheKey(frame);
+	if (!pass.secondaryValid[frame] || pass.secondaryKeys[frame] != key)
+	{
+		// Continues the render pass (or rendering) the primary began, which it has to name up front
+		const Pass& owner = passes[pass.renderPassOwner];
+		VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance = {};
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		if (cmdBeginRendering != nullptr)
+		{
+			renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+			renderingInheritance.colorAttachmentCount = static_cast<uint32_t>(pass.colorFormats.size());
+			renderingInheritance.pColorAttachmentFormats = pass.colorFormats.data();
+			renderingInheritance.depthAttachmentFormat = pass.depthFormat;
+			renderingInheritance.stencilAttachmentFormat = hasStencil(pass.depthFormat) ? pass.depthFormat : VK_FORMAT_UNDEFINED;
+			renderingInheritance.rasterizationSamples = pass.attachments.empty() ? VK_SAMPLE_COUNT_1_BIT : resources[pass.attachments[0].image].samples;
+			inheritanceInfo.pNext = &renderingInheritance;
+		}
+		else
+		{
+			inheritanceInfo.renderPass = owner.renderPass;
+			inheritanceInfo.subpass = pass.subpassIndex;
+			inheritanceInfo.framebuffer = owner.framebuffers[frame % owner.framebuffers.size()];
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to begin secondary command buffer for render graph pass " + pass.name + "!");
+		}
+		pass.record(secondary, frame);
+		if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record secondary command buffer for render graph pass " + pass.name + "!");
+		}
+
+		pass.secondaryKeys[frame] = key;
+		pass.secondaryValid[frame] = 1;
+		stats.cachedPassRecordCount++;
+	}
+
+	vkCmdExecuteCommands(commandBuffer, 1, &secondary);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, uint32_t frame, const BarrierBatch& batch) const
+{
+	if (batch.barriers.empty()) { return; }
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	for (const Barrier& barrier : batch.barriers)
+	{
+		const ResourceInfo& info = resources[barrier.resource];
+		if (info.images.empty() && info.buffers.empty())
+		{
+			throw std::runtime_error("Render graph resource " + info.name + " is not bound!");
+		}
+
+		if (info.isImage)
+		{
+			VkImageAspectFlags aspect = info.aspect;
+			if ((aspect & VK_IMAGE_ASPECT_DEPTH_BIT) && hasStencil(info.format)) { aspect |= VK_IMAGE_ASPECT_STENCIL_BIT; }	// Both transition together
+
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask = barrier.srcAccess;
+			imageBarrier.dstAccessMask = barrier.dstAccess;
+			imageBarrier.oldLayout = barrier.oldLayout;
+			imageBarrier.newLayout = barrier.newLayout;
+			imageBarrier.srcQueueFamilyIndex = barrier.srcQueueFamily;
+			imageBarrier.dstQueueFamilyIndex = barrier.dstQueueFamily;
+			imageBarrier.image = info.images[frame % info.images.size()];
+			imageBarrier.subresourceRange = { aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+			imageBarriers.push_back(imageBarrier);
+		}
+		else
+		{
+			VkBufferMemoryBarrier bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = barrier.srcQueueFamily;
+			bufferBarrier.dstQueueFamilyIndex = barrier.dstQueueFamily;
+			bufferBarrier.buffer = info.buffers[frame % info.buffers.size()];
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(bufferBarrier);
+		}
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0, 0, nullptr,
+		static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void RenderGraph::beginRendering(VkCommandBuffer commandBuffer, uint32_t frame, const Pass& pass) const
+{
+	// Same load/store ops and layouts the render pass would have, with the views of this frame
+	std::vector<VkRenderingAttachmentInfoKHR> colourInfos;
+	VkRenderingAttachmentInfoKHR depthInfo = {};
+	for (const Attachment& attachment : pass.attachments)
+	{
+		VkRenderingAttachmentInfoKHR attachmentInfo = {};
+		attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		attachmentInfo.imageView = getImageView(attachment.image, frame);
+		attachmentInfo.imageLayout = attachment.layout;
+		attachmentInfo.loadOp = attachment.loadOp;
+		attachmentInfo.storeOp = attachment.storeOp;
+		attachmentInfo.clearValue = attachment.clearValue;
+		if (attachment.resolveImage != INVALID)
+		{
+			attachmentInfo.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+			attachmentInfo.resolveImageView = getImageView(attachment.resolveImage, frame);
+			attachmentInfo.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		}
+		if (attachment.image != pass.depthAttachment.image) { colourInfos.push_back(attachmentInfo); }
+		else { depthInfo = attachmentInfo; }
+	}
+
+	VkRenderingInfoKHR renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+	renderingInfo.renderArea = { { 0, 0 }, pass.extent };
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colourInfos.size());
+	renderingInfo.pColorAttachments = colourInfos.data();
+	renderingInfo.pDepthAttachment = pass.depthAttachment.image != INVALID ? &depthInfo : nullptr;
+	renderingInfo.pStencilAttachment = pass.depthAttachment.image != INVALID && hasStencil(pass.depthFormat) ? &depthInfo : nullptr;
+	renderingInfo.flags = pass.cacheKey ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;	// Cached contents
+
+	cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+// - QUERIES AND CLEANUP ------------------------------------------------------------------------------------------------------
+
+VkRenderPass RenderGraph::getRenderPass(uint32_t pass) const
+{
+	const Pass& target = passes.at(pass);
+	return target.renderPassOwner != INVALID ? passes[target.renderPassOwner].renderPass : VK_NULL_HANDLE;
+}
+
+uint32_t RenderGraph::getSubpass(uint32_t pass) const
+{
+	return passes.at(pass).subpassIndex;
+}
+
+VkPipelineRenderingCreateInfoKHR RenderGraph::getRenderingCreateInfo(uint32_t pass) const
+{
+	const Pass& target = passes.at(pass);
+	VkPipelineRenderingCreateInfoKHR renderingCreateInfo = {};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingCreateInfo.colorAttachmentCount = static_cast<uint32_t>(target.colorFormats.size());
+	renderingCreateInfo.pColorAttachmentFormats = target.colorFormats.data();
+	renderingCreateInfo.depthAttachmentFormat = target.depthFormat;
+	renderingCreateInfo.stencilAttachmentFormat = hasStencil(target.depthFormat) ? target.depthFormat : VK_FORMAT_UNDEFINED;
+	return renderingCreateInfo;
+}
+
+bool RenderGraph::isPassCulled(uint32_t pass) const
+{
+	return passes.at(pass).culled;
+}
+
+bool RenderGraph::isPassAsync(uint32_t pass) const
+{
+	return passes.at(pass).asyncQueue;
+}
+
+const RenderGraphStats& RenderGraph::getStats() const
+{
+	return stats;
+}
+
+void RenderGraph::destroy()
+{
+	for (Pass& pass : passes)
+	{
+		for (VkCommandBuffer secondary : pass.secondaries)
+		{
+			if (secondary != VK_NULL_HANDLE) { vkFreeCommandBuffers(device, secondaryCommandPool, 1, &secondary); }
+		}
+		pass.secondaries.clear();
+		pass.secondaryKeys.clear();
+		pass.secondaryValid.clear();
+
+		for (VkFramebuffer framebuffer : pass.framebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+		pass.framebuffers.clear();
+		if (pass.renderPass != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass(device, pass.renderPass, nullptr);
+			pass.renderPass = VK_NULL_HANDLE;
+		}
+	}
+
+	for (ResourceInfo& info : resources)
+	{
+		if (info.imported) { continue; }
+		for (VkImageView view : info.views)
+		{
+			vkDestroyImageView(device, view, nullptr);
+		}
+		for (VkImage image : info.images)
+		{
+			vkDestroyImage(device, image, nullptr);
+		}
+		info.views.clear();
+		info.images.clear();
+	}
+
+	for (VkDeviceMemory memory : memoryBlocks)
+	{
+		vkFreeMemory(device, memory, nullptr);
+	}
+	memoryBlocks.clear();
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "utilities.h"
+
+class GpuProfiler;
+
+// How a pass touches a resource: decides the image layout, the access mask and whether it counts as a write
+enum RenderUsage
+{
+	RENDER_USAGE_COLOR_ATTACHMENT,			// Set through addColorAttachment
+	RENDER_USAGE_DEPTH_ATTACHMENT,			// Set through setDepthAttachment, tested and written
+	RENDER_USAGE_DEPTH_READ_ATTACHMENT,		// Set through setDepthAttachment, tested only (read only layout)
+	RENDER_USAGE_INPUT_ATTACHMENT,			// Set through addInputAttachment, read at the same pixel in the fragment shader
+	RENDER_USAGE_SAMPLED,					// Sampled image (read only layout)
+	RENDER_USAGE_STORAGE_READ,				// Storage buffer, or storage image in GENERAL layout
+	RENDER_USAGE_STORAGE_WRITE,				// Same, read and written
+	RENDER_USAGE_INDEX_BUFFER,
+	RENDER_USAGE_INDIRECT_BUFFER,
+	RENDER_USAGE_TRANSFER_SRC,				// Copy source
+	RENDER_USAGE_TRANSFER_DST				// Copy destination, overwritten (earlier contents don't count as read)
+};
+
+struct RenderGraphStats
+{
+	uint32_t passCount = 0;
+	uint32_t renderPassCount = 0;			// Graphics passes, subpasses of one render pass count once
+	uint32_t culledPassCount = 0;			// Passes nothing kept reads the output of
+	uint32_t barrierCount = 0;				// Image and buffer barriers recorded per frame
+	uint32_t barrierBatchCount = 0;			// vkCmdPipelineBarrier calls per frame
+	uint32_t transientImageCount = 0;
+	uint32_t lazyImageCount = 0;			// Transient attachments in lazily allocated memory
+	VkDeviceSize transientBytes = 0;		// Size of the transient images added up
+	VkDeviceSize allocatedBytes = 0;		// Memory allocated for them, images with disjoint lifetimes share it
+	VkDeviceSize lazyBytes = 0;				// Part of it lazily allocated (only committed if the GPU needs to spill the attachment)
+	VkDeviceSize attachmentLoadBytes = 0;	// Per frame, attachment contents loaded into and stored out of the render passes:
+	VkDeviceSize attachmentStoreBytes = 0;	// the memory traffic of the attachments on tilers (multisampled ones at every sample)
+	uint32_t asyncPassCount = 0;			// Passes on the async compute queue
+	uint32_t cachedPassCount = 0;			// Passes replayed from secondary command buffers
+	uint32_t cachedPassRecordCount = 0;		// Of them, recorded again by the last execute (the rest were only replayed)
+};
+
+// A frame as a list of passes declaring the resources they read and write. compile() culls passes whose output is
+// never used, plans the barriers and layout transitions between the rest, creates the render passes and framebuffers
+// of graphics passes (none with dynamic rendering) and places transient images with disjoint lifetimes in the same
+// memory (lazily allocated memory for those living within one render pass). Graphics passes added with addSubpass share
+// the render pass of the pass before them. execute() records it, passes moved to the async compute queue are recorded
+// by executeAsyncCompute() into a command buffer of their own. Graphics passes given a cache key record into secondary
+// command buffers that later frames replay until the key changes
+class RenderGraph
+{
+public:
+	typedef uint32_t Resource;
+	static constexpr uint32_t INVALID = 0xffffffff;
+
+	// frame picks the handle of resources bound per frame (frame % handle count)
+	typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t frame)> RecordFunction;
+	typedef std::function<uint64_t(uint32_t frame)> CacheKeyFunction;
+
+	RenderGraph(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice);
+
+	// - Resources
+	// Transient: created and owned by the graph, contents only live within the frame
+	Resource createImage(const std::string& name, VkExtent2D extent, VkFormat format, VkImageAspectFlags aspect,
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+	// Imported: owned elsewhere and kept between frames. The frame starts with the image in initialLayout (UNDEFINED =
+	// contents discarded) and ends with it in finalLayout (UNDEFINED = initialLayout, or as last used if that is
+	// UNDEFINED too). waitStages are the stages a semaphore wait before the frame blocks (e.g. acquire)
+	Resource importImage(const std::string& name, VkExtent2D extent, VkFormat format, VkImageAspectFlags aspect,
+		VkImageLayout initialLayout, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED, VkPipelineStageFlags waitStages = 0);
+	Resource importBuffer(const std::string& name);
+
+	// Handles of an imported resource, one for every frame or one for all (attachments must be bound before compile)
+	void bindImage(Resource image, const std::vector<VkImage>& newImages, const std::vector<VkImageView>& newViews);
+	void bindBuffer(Resource buffer, const std::vector<VkBuffer>& newBuffers);
+
+	VkImageView getImageView(Resource image, uint32_t frame = 0) const;	// Transient images exist after compile
+
+	// - Passes, run in the order they were added
+	uint32_t addGraphicsPass(const std::string& name, RecordFunction record);	// Recorded inside its render pass
+	uint32_t addComputePass(const std::string& name, RecordFunction record);
+	// Graphics pass continuing the render pass of the graphics pass added just before it as its next subpass: attachments
+	// the earlier subpasses wrote are read as input attachments without leaving tile memory (render pass objects only)
+	uint32_t addSubpass(const std::string& name, RecordFunction record);
+	// Compute pass that runs on the async compute queue from the start of the frame (with setAsyncCompute) if it only uses
+	// buffers, no graphics queue pass uses them before it and none writes them at all; otherwise it stays a compute pass
+	// on the graphics queue. Buffers the graphics queue used go back to the compute family at the end of the frame, and
+	// must be bound per frame: the compute submission only waits for the last graphics frame of its own frame index
+	uint32_t addAsyncComputePass(const std::string& name, RecordFunction record);
+
+	void addColorAttachment(uint32_t pass, Resource image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+	void setDepthAttachment(uint32_t pass, Resource image, VkAttachmentLoadOp loadOp, bool depthWrite = true, float clearDepth = 1.0f);
+	// Multisampled colour attachment of the pass averaged into a single sample image as the pass ends (no extra pass)
+	void addResolveAttachment(uint32_t pass, Resource source, Resource target);
+	// Read with subpassLoad, input_attachment_index in the order they are added
+	void addInputAttachment(uint32_t pass, Resource image);
+	void use(uint32_t pass, Resource resource, RenderUsage usage, VkPipelineStageFlags shaderStages);	// Once per resource and pass
+	// Graphics pass recorded into a secondary command buffer per frame and replayed as long as cacheKey(frame) returns what
+	// it returned when recorded, so everything changing without changing the key has to come from buffers. The pass must
+	// end its render pass (the next subpass's timestamps would land in its secondary-only contents)
+	void setPassCache(uint32_t pass, CacheKeyFunction cacheKey);
+
+	// - Build and run
+	// Begin graphics passes with vkCmdBeginRenderingKHR instead of render pass objects (before compile)
+	void setDynamicRendering(PFN_vkCmdBeginRenderingKHR newCmdBeginRendering, PFN_vkCmdEndRenderingKHR newCmdEndRendering);
+	bool isDynamicRendering() const;
+	// Queue families to hand buffers over between with queue ownership transfers (before compile, families must differ)
+	void setAsyncCompute(uint32_t newGraphicsFamily, uint32_t newComputeFamily);
+	// Pool the secondary command buffers of cached passes come from: graphics family, buffers individually resettable
+	void setSecondaryCommandPool(VkCommandPool commandPool);
+
+	void compile();
+
+	// Time every pass that runs under its name (profiler frames begun by the caller), async passes on asyncProfiler
+	void setProfiler(GpuProfiler* newProfiler, GpuProfiler* newAsyncProfiler = nullptr);
+	// Graphics queue passes. With async passes, those from the first one using their results on go into
+	// joinCommandBuffer, submitted waiting for the async submission at getAsyncWaitStages
+	void execute(VkCommandBuffer commandBuffer, uint32_t frame, VkCommandBuffer joinCommandBuffer = VK_NULL_HANDLE);
+	void executeAsyncCompute(VkCommandBuffer commandBuffer, uint32_t frame);
+	bool hasAsyncCompute() const;						// After compile: some pass runs on the async compute queue
+	VkPipelineStageFlags getAsyncWaitStages() const;
+	void destroy();
+
+	VkRenderPass getRenderPass(uint32_t pass) const;	// Graphics pass, after compile (what its pipelines are created against)
+	uint32_t getSubpass(uint32_t pass) const;			// Index of the pass within that render pass
+	// Dynamic rendering equivalent: attachment formats to chain into the pipeline create info (points into the graph)
+	VkPipelineRenderingCreateInfoKHR getRenderingCreateInfo(uint32_t pass) const;
+	bool isPassCulled(uint32_t pass) const;
+	bool isPassAsync(uint32_t pass) const;				// Runs on the async compute queue
+	const RenderGraphStats& getStats() const;
+
+private:
+	struct ResourceState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;	// Last write, or layout transition
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags readStages = 0;	// Reads since then (already ordered after it)
+		VkAccessFlags readAccess = 0;			// Access the last write was made visible to
+		bool asyncQueue = false;				// Last used on the async compute queue
+	};
+
+	struct ResourceInfo
+	{
+		std::string name;
+		bool isImage = true;
+		bool imported = false;
+		VkExtent2D extent = { 0, 0 };
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkImageAspectFlags aspect = 0;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags waitStages = 0;
+
+		std::vector<VkImage> images;
+		std::vector<VkImageView> views;
+		std::vector<VkBuffer> buffers;
+
+		// Transient images
+		VkImageUsageFlags usage = 0;
+		VkMemoryRequirements memoryRequirements = {};
+		uint32_t memoryBlock = INVALID;
+		bool lazy = false;						// Lives within one render pass: TRANSIENT_ATTACHMENT, lazily allocated memory
+		bool async = false;						// Used by an async compute queue pass
+		uint32_t aliasPredecessor = INVALID;	// Last user of its memory before it (wraps to the previous frame)
+		uint32_t firstPass = INVALID;			// Lifetime over kept passes
+		uint32_t lastPass = INVALID;
+
+		ResourceState endState;					// At the end of the frame
+	};
+
+	struct PassUsage
+	{
+		Resource resource;
+		RenderUsage usage;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		bool reads;								// Depends on earlier contents
+		bool writes;
+	};
+
+	struct Attachment
+	{
+		Resource image;
+		VkAttachmentLoadOp loadOp;
+		VkClearValue clearValue;
+		Resource resolveImage = INVALID;		// Colour only
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;			// Set at compile
+		VkAttachmentStoreOp resolveStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Differs from layout across subpasses
+	};
+
+	struct Barrier
+	{
+		Resource resource;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+		uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;	// Both set for queue ownership transfers
+		uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+	};
+
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<Barrier> barriers;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		bool graphics;
+		RecordFunction record;
+		std::vector<PassUsage> usages;
+		std::vector<Attachment> colorAttachments;
+		Attachment depthAttachment = { INVALID, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {} };
+		std::vector<Attachment> inputAttachments;
+		bool subpass = false;					// Continues the render pass of the pass before it
+		bool asyncCandidate = false;			// Added with addAsyncComputePass
+		bool asyncQueue = false;				// Runs on the async compute queue, set at compile
+		bool culled = false;
+
+		uint32_t renderPassOwner = INVALID;		// Pass beginning the render pass this one runs in (itself if first), set at compile
+		uint32_t subpassIndex = 0;
+		bool endsRenderPass = true;
+
+		BarrierBatch barriers;					// Recorded before the pass
+		std::vector<Attachment> attachments;	// Colour then depth, set at compile
+		std::vector<VkFormat> colorFormats;
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		size_t frameCount = 1;					// Distinct sets of attachment views
+		VkExtent2D extent = { 0, 0 };
+		std::vector<Attachment> renderPassAttachments;	// Owner only: those of every subpass, by first use
+		std::vector<VkClearValue> clearValues;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		std::vector<VkFramebuffer> framebuffers;
+
+		CacheKeyFunction cacheKey;				// Set: recorded into secondary command buffers
+		std::vector<VkCommandBuffer> secondaries;	// Per frame, allocated by its first execute
+		std::vector<uint64_t> secondaryKeys;	// Key each was recorded with
+		std::vector<uint8_t> secondaryValid;
+	};
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	std::vector<ResourceInfo> resources;
+	std::vector<Pass> passes;
+	BarrierBatch finalBarriers;					// Imported images to their final layouts
+	BarrierBatch asyncReleaseBarriers;			// End of the async command buffer: buffers handed to the graphics queue
+	BarrierBatch asyncAcquireBarriers;			// Start of it: the same buffers taken back from the graphics queue
+	std::vector<uint8_t> asyncReturned;			// Per frame: the graphics queue released them once (an acquire needs a release)
+	std::vector<VkDeviceMemory> memoryBlocks;
+	RenderGraphStats stats;
+	bool compiled = false;
+
+	GpuProfiler* profiler = nullptr;
+	GpuProfiler* asyncProfiler = nullptr;
+
+	uint32_t graphicsFamily = VK_QUEUE_FAMILY_IGNORED;		// Set with async compute
+	uint32_t computeFamily = VK_QUEUE_FAMILY_IGNORED;
+	uint32_t asyncJoinPass = INVALID;			// First graphics queue pass after the async work (passes.size() if none uses it)
+	VkPipelineStageFlags asyncWaitStages = 0;
+
+	PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;	// Set with dynamic rendering
+	PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+	VkCommandPool secondaryCommandPool = VK_NULL_HANDLE;
+
+	uint32_t addPass(const std::string& name, bool graphics, RecordFunction record);
+	void addUsage(uint32_t pass, Resource resource, RenderUsage usage, VkPipelineStageFlags shaderStages, bool loads);
+
+	void cullPasses();
+	void assignSubpasses();
+	void assignQueues();
+	void createTransientImages();
+	void planBarriers(bool recordBarriers);
+	void transition(ResourceState& state, const ResourceInfo& info, Resource resource, VkPipelineStageFlags stages,
+		VkAccessFlags access, VkImageLayout layout, bool writes, BarrierBatch* batch);
+	VkAttachmentLoadOp getLoadOp(uint32_t pass, const Attachment& attachment) const;
+	void resolveAttachments();
+	void createRenderPasses();
+	bool isReadLater(Resource resource, uint32_t afterPass) const;
+	const Attachment* findAttachment(const Pass& pass, Resource image) const;
+	const PassUsage* findUsage(const Pass& pass, Resource resource) const;
+	void recordBarriers(VkCommandBuffer commandBuffer, uint32_t frame, const BarrierBatch& batch) const;
+	void recordPass(VkCommandBuffer commandBuffer, uint32_t frame, Pass& pass, GpuProfiler* passProfiler);
+	void recordPassContents(VkCommandBuffer commandBuffer, uint32_t frame, Pass& pass);
+	void beginRendering(VkCommandBuffer commandBuffer, uint32_t frame, const Pass& pass) const;
+};
@@ -0,0 +1,161 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "JobSystem.h"
+
+namespace {
+	const uint32_t MIN_CHUNK_ITEMS = 4096;		// Smaller chunks cost more in histograms than they save
+
+	uint64_t field(uint32_t value, uint32_t bits, uint32_t shift)
+	{
+		return static_cast<uint64_t>(value & ((1u << bits) - 1)) << shift;
+	}
+
+	uint32_t quantizeDepth(float depth)
+	{
+		const uint32_t maxDepth = (1u << RENDER_KEY_DEPTH_BITS) - 1;
+		return static_cast<uint32_t>(std::min(std::max(depth, 0.0f), 1.0f) * maxDepth + 0.5f);
+	}
+}
+
+uint64_t makeOpaqueKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+	return field(pass, RENDER_KEY_PASS_BITS, 60) | field(pipeline, RENDER_KEY_PIPELINE_BITS, 52) |
+		field(material, RENDER_KEY_MATERIAL_BITS, 36) | field(mesh, RENDER_KEY_MESH_BITS, 20) |
+		field(quantizeDepth(depth), RENDER_KEY_DEPTH_BITS, 0);
+}
+
+uint64_t makeTransparentKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+	uint32_t farToNear = ((1u << RENDER_KEY_DEPTH_BITS) - 1) - quantizeDepth(depth);
+	return field(pass, RENDER_KEY_PASS_BITS, 60) | (1ull << 59) | field(farToNear, RENDER_KEY_DEPTH_BITS, 39) |
+		field(pipeline, RENDER_KEY_PIPELINE_BITS, 32) | field(material, RENDER_KEY_MATERIAL_BITS, 16) |
+		field(mesh, RENDER_KEY_MESH_BITS, 0);
+}
+
+uint32_t getKeyPass(uint64_t key)
+{
+	return static_cast<uint32_t>(key >> 60);
+}
+
+void RenderQueue::clear()
+{
+	items.clear();
+}
+
+void RenderQueue::push(uint64_t key, uint32_t draw)
+{
+	items.push_back({ key, draw });
+}
+
+void RenderQueue::sort()
+{
+	radixSort(nullptr);
+}
+
+void RenderQueue::sort(JobSystem& jobSystem)
+{
+	radixSort(&jobSystem);
+}
+
+const std::vector<RenderItem>& RenderQueue::getItems() const
+{
+	return items;
+}
+
+void RenderQueue::getPassRange(uint32_t pass, uint32_t& begin, uint32_t& end) const
+{
+	auto first = std::lower_bound(items.begin(), items.end(), pass,
+		[](const RenderItem& item, uint32_t value) { return getKeyPass(item.key) < value; });
+	auto last = std::upper_bound(first, items.end(), pass,
+		[](uint32_t value, const RenderItem& item) { return value < getKeyPass(item.key); });
+	begin = static_cast<uint32_t>(first - items.begin());
+	end = static_cast<uint32_t>(last - items.begin());
+}
+
+void RenderQueue::radixSort(JobSystem* jobSystem)
+{
+	uint32_t count = static_cast<uint32_t>(items.size());
+	if (count < 2) { return; }
+
+	// One chunk per thread (fewer for small queues), each histograms and scatters its own items
+	uint32_t chunkCount = 1;
+	if (jobSystem != nullptr)
+	{
+		chunkCount = std::max(std::min(count / MIN_CHUNK_ITEMS, jobSystem->getThreadCount()), 1u);
+	}
+	uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+	histograms.resize(static_cast<size_t>(chunkCount) * 256);
+	scratch.resize(count);
+
+	auto forEachChunk = [&](const std::function<void(uint32_t chunk, uint32_t begin, uint32_t end)>& function)
+	{
+		if (chunkCount == 1)
+		{
+			function(0u, 0u, count);
+			return;
+		}
+		jobSystem->parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t chunk = begin; chunk < end; chunk++)
+			{
+				function(chunk, chunk * chunkSize, std::min((chunk + 1) * chunkSize, count));
+			}
+		});
+	};
+
+	RenderItem* source = items.data();
+	RenderItem* destination = scratch.data();
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		forEachChunk([&](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			uint32_t* histogram = &histograms[static_cast<size_t>(chunk) * 256];
+			std::memset(histogram, 0, sizeof(uint32_t) * 256);
+			for (uint32_t i = begin; i < end; i++)
+			{
+				histogram[(source[i].key >> shift) & 0xff]++;
+			}
+		});
+
+		// Every key has the same digit: the pass would only copy
+		uint32_t firstDigit = (source[0].key >> shift) & 0xff;
+		uint32_t firstDigitCount = 0;
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			firstDigitCount += histograms[static_cast<size_t>(chunk) * 256 + firstDigit];
+		}
+		if (firstDigitCount == count) { continue; }
+
+		// A chunk's items of a digit go after every item with a lower digit and the earlier chunks' items with the same one
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < 256; digit++)
+		{
+			for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+			{
+				uint32_t& slot = histograms[static_cast<size_t>(chunk) * 256 + digit];
+				uint32_t digitCount = slot;
+				slot = offset;
+				offset += digitCount;
+			}
+		}
+
+		forEachChunk([&](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			uint32_t* offsets = &histograms[static_cast<size_t>(chunk) * 256];
+			for (uint32_t i = begin; i < end; i++)
+			{
+				destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+			}
+		});
+		std::swap(source, destination);
+	}
+
+	if (source != items.data())
+	{
+		items.swap(scratch);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Sort key fields, most significant first. Opaque draws group by state and go near to far inside a state, transparent
+// ones go far to near (blending order) and only group by state at equal depth:
+//   opaque       pass 4 | 0 | pipeline 7 | material 16 | mesh 16 | depth 20
+//   transparent  pass 4 | 1 | depth 20 (inverted) | pipeline 7 | material 16 | mesh 16
+// Values wider than their field are truncated (only the grouping suffers), depth is clamped to [0, 1]
+const uint32_t RENDER_KEY_PASS_BITS = 4;
+const uint32_t RENDER_KEY_PIPELINE_BITS = 7;
+const uint32_t RENDER_KEY_MATERIAL_BITS = 16;
+const uint32_t RENDER_KEY_MESH_BITS = 16;
+const uint32_t RENDER_KEY_DEPTH_BITS = 20;
+
+// depth: view distance over the far distance (0 = camera, 1 = far plane)
+uint64_t makeOpaqueKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+uint64_t makeTransparentKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+uint32_t getKeyPass(uint64_t key);
+
+struct RenderItem
+{
+	uint64_t key;
+	uint32_t draw;			// Draw index
+};
+
+// Binds the recorder of a sorted queue issued, and the ones it skipped as the state was already bound (per frame)
+struct RenderQueueStats
+{
+	uint32_t drawCount = 0;
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+	uint32_t descriptorSetBinds = 0;		// Per draw sets (mesh shader vertex buffers)
+	uint32_t bindsSkipped = 0;
+};
+
+// Draws of a frame with their sort keys. sort() orders them by key with an LSD radix sort (8 bits per pass, passes
+// whose digit is the same for every key skipped), stable: equal keys stay in the order they were pushed
+class RenderQueue
+{
+public:
+	void clear();
+	void push(uint64_t key, uint32_t draw);
+
+	void sort();
+	void sort(JobSystem& jobSystem);		// Histograms and scatters of per thread chunks in parallel, same order
+
+	const std::vector<RenderItem>& getItems() const;
+	void getPassRange(uint32_t pass, uint32_t& begin, uint32_t& end) const;		// Items [begin, end) of a pass once sorted
+
+private:
+	std::vector<RenderItem> items;
+	std::vector<RenderItem> scratch;		// Scatter destination, swapped with items every pass
+	std::vector<uint32_t> histograms;		// 256 counts per chunk, then the chunk's scatter offsets
+
+	void radixSort(JobSystem* jobSystem);
+};
@@ -0,0 +1,250 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <../glm/gtc/matrix_transform.hpp>
+
+uint32_t SceneGraph::createNode(uint32_t parent)
+{
+	if (parent != INVALID_NODE && (parent >= nodePositions.size() || nodePositions[parent] == INVALID_NODE))
+	{
+		throw std::runtime_error("Scene graph parent node does not exist!");
+	}
+
+	uint32_t node;
+	if (!freeNodes.empty())
+	{
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else
+	{
+		node = static_cast<uint32_t>(nodePositions.size());
+		nodeParents.push_back(INVALID_NODE);
+		nodeFirstChildren.push_back(INVALID_NODE);
+		nodeNextSiblings.push_back(INVALID_NODE);
+		nodePositions.push_back(INVALID_NODE);
+	}
+
+	nodeFirstChildren[node] = INVALID_NODE;
+	linkNode(node, parent);
+	nodeCount++;
+
+	// Appended: still depth first for a new root, a new child needs its parent's range to grow
+	uint32_t position = static_cast<uint32_t>(sortedNodes.size());
+	nodePositions[node] = position;
+	sortedNodes.push_back(node);
+	sortedParents.push_back(parent == INVALID_NODE ? INVALID_NODE : nodePositions[parent]);
+	subtreeSizes.push_back(1);
+	localMatrices.push_back(glm::mat4(1.0f));
+	worldMatrices.push_back(glm::mat4(1.0f));
+	dirtyFlags.push_back(0);
+	markDirty(position);
+
+	if (parent != INVALID_NODE) { orderDirty = true; }
+
+	return node;
+}
+
+void SceneGraph::destroyNode(uint32_t node)
+{
+	if (node >= nodePositions.size() || nodePositions[node] == INVALID_NODE) { return; }
+
+	unlinkNode(node);
+
+	// Free the whole subtree (its entries drop out of the arrays at the next sort)
+	std::vector<uint32_t> stack = { node };
+	while (!stack.empty())
+	{
+		uint32_t current = stack.back();
+		stack.pop_back();
+
+		for (uint32_t child = nodeFirstChildren[current]; child != INVALID_NODE; child = nodeNextSiblings[child])
+		{
+			stack.push_back(child);
+		}
+
+		nodePositions[current] = INVALID_NODE;
+		nodeParents[current] = INVALID_NODE;
+		freeNodes.push_back(current);
+		nodeCount--;
+	}
+
+	orderDirty = true;
+}
+
+void SceneGraph::setParent(uint32_t node, uint32_t parent)
+{
+	if (node >= nodePositions.size() || nodePositions[node] == INVALID_NODE)
+	{
+		throw std::runtime_error("Scene graph node does not exist!");
+	}
+
+	// A node can't move below itself
+	for (uint32_t ancestor = parent; ancestor != INVALID_NODE; ancestor = nodeParents[ancestor])
+	{
+		if (ancestor == node) { throw std::runtime_error("Scene graph node can't be parented to its own subtree!"); }
+	}
+
+	unlinkNode(node);
+	linkNode(node, parent);
+	orderDirty = true;
+}
+
+void SceneGraph::setLocalTransform(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+	glm::mat4 localMatrix = glm::mat4_cast(rotation);
+	localMatrix[0] *= scale.x;
+	localMatrix[1] *= scale.y;
+	localMatrix[2] *= scale.z;
+	localMatrix[3] = glm::vec4(translation, 1.0f);
+	setLocalMatrix(node, localMatrix);
+}
+
+void SceneGraph::setLocalTransforms(const uint32_t* nodes, const TrsArrays& trs, uint32_t count)
+{
+	composedMatrices.resize(count);
+	composeTrsBatch(trs, count, composedMatrices.data());
+	for (uint32_t i = 0; i < count; i++)
+	{
+		setLocalMatrix(nodes[i], composedMatrices[i]);
+	}
+}
+
+void SceneGraph::setLocalMatrix(uint32_t node, const glm::mat4& localMatrix)
+{
+	uint32_t position = nodePositions[node];
+	localMatrices[position] = localMatrix;
+	markDirty(position);
+}
+
+const glm::mat4& SceneGraph::getLocalMatrix(uint32_t node) const
+{
+	return localMatrices[nodePositions[node]];
+}
+
+const glm::mat4& SceneGraph::getWorldMatrix(uint32_t node) const
+{
+	return worldMatrices[nodePositions[node]];
+}
+
+void SceneGraph::updateWorldTransforms()
+{
+	// Hierarchy changed: re-sort and recompute everything
+	if (orderDirty)
+	{
+		sortNodes();
+		propagateTransforms(sortedParents.data(), localMatrices.data(), worldMatrices.data(), 0, static_cast<uint32_t>(sortedNodes.size()));
+		lastUpdatedCount = static_cast<uint32_t>(sortedNodes.size());
+		return;
+	}
+
+	// Sweep the subtree range of each dirty node, skipping ones already inside an earlier range
+	std::sort(dirtyPositions.begin(), dirtyPositions.end());
+
+	lastUpdatedCount = 0;
+	uint32_t coveredEnd = 0;
+	for (uint32_t dirty : dirtyPositions)
+	{
+		dirtyFlags[dirty] = 0;
+		if (dirty < coveredEnd) { continue; }
+
+		coveredEnd = dirty + subtreeSizes[dirty];
+		propagateTransforms(sortedParents.data(), localMatrices.data(), worldMatrices.data(), dirty, coveredEnd);
+		lastUpdatedCount += subtreeSizes[dirty];
+	}
+	dirtyPositions.clear();
+}
+
+uint32_t SceneGraph::getLastUpdatedCount() const
+{
+	return lastUpdatedCount;
+}
+
+uint32_t SceneGraph::getNodeCount() const
+{
+	return nodeCount;
+}
+
+void SceneGraph::linkNode(uint32_t node, uint32_t parent)
+{
+	nodeParents[node] = parent;
+	uint32_t& firstSibling = parent == INVALID_NODE ? firstRoot : nodeFirstChildren[parent];
+	nodeNextSiblings[node] = firstSibling;
+	firstSibling = node;
+}
+
+void SceneGraph::unlinkNode(uint32_t node)
+{
+	uint32_t parent = nodeParents[node];
+	uint32_t* link = parent == INVALID_NODE ? &firstRoot : &nodeFirstChildren[parent];
+	while (*link != node)
+	{
+		link = &nodeNextSiblings[*link];
+	}
+	*link = nodeNextSiblings[node];
+
+	nodeParents[node] = INVALID_NODE;
+	nodeNextSiblings[node] = INVALID_NODE;
+}
+
+void SceneGraph::markDirty(uint32_t position)
+{
+	if (dirtyFlags[position]) { return; }
+
+	dirtyFlags[position] = 1;
+	dirtyPositions.push_back(position);
+}
+
+void SceneGraph::sortNodes()
+{
+	std::vector<uint32_t> newNodes;
+	std::vector<uint32_t> newParents;
+	std::vector<glm::mat4> newLocalMatrices;
+	newNodes.reserve(nodeCount);
+	newParents.reserve(nodeCount);
+	newLocalMatrices.reserve(nodeCount);
+
+	// Pre-order walk: a node is placed before its children, popping from a stack keeps each subtree contiguous
+	std::vector<uint32_t> stack;
+	for (uint32_t root = firstRoot; root != INVALID_NODE; root = nodeNextSiblings[root])
+	{
+		stack.push_back(root);
+	}
+
+	while (!stack.empty())
+	{
+		uint32_t node = stack.back();
+		stack.pop_back();
+
+		uint32_t position = static_cast<uint32_t>(newNodes.size());
+		newNodes.push_back(node);
+		newParents.push_back(nodeParents[node] == INVALID_NODE ? INVALID_NODE : nodePositions[nodeParents[node]]);	// Parent already moved
+		newLocalMatrices.push_back(localMatrices[nodePositions[node]]);
+		nodePositions[node] = position;
+
+		for (uint32_t child = nodeFirstChildren[node]; child != INVALID_NODE; child = nodeNextSiblings[child])
+		{
+			stack.push_back(child);
+		}
+	}
+
+	sortedNodes.swap(newNodes);
+	sortedParents.swap(newParents);
+	localMatrices.swap(newLocalMatrices);
+
+	subtreeSizes.assign(sortedNodes.size(), 1);
+	for (size_t position = sortedNodes.size(); position-- > 0;)
+	{
+		if (sortedParents[position] != INVALID_NODE)
+		{
+			subtreeSizes[sortedParents[position]] += subtreeSizes[position];
+		}
+	}
+
+	worldMatrices.resize(sortedNodes.size());
+	dirtyFlags.assign(sortedNodes.size(), 0);
+	dirtyPositions.clear();
+	orderDirty = false;
+}
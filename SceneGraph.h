@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include <../glm/gtc/quaternion.hpp>
+
+#include "utilities.h"
+#include "TransformBatch.h"
+
+// Hierarchy of nodes with local transforms, world matrices are only recomputed for subtrees that changed
+// Node data lives in arrays sorted depth first, so a node's subtree is the contiguous range after it and
+// parents always come before their children: an update is a forward sweep over the dirty ranges
+class SceneGraph
+{
+public:
+	static constexpr uint32_t INVALID_NODE = 0xffffffff;
+
+	// Returns the new node's id (stable until destroyed, then reused). Starts with an identity local transform
+	uint32_t createNode(uint32_t parent = INVALID_NODE);
+	void destroyNode(uint32_t node);		// And its whole subtree
+	void setParent(uint32_t node, uint32_t parent);
+
+	void setLocalTransform(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+	void setLocalMatrix(uint32_t node, const glm::mat4& localMatrix);
+	void setLocalTransforms(const uint32_t* nodes, const TrsArrays& trs, uint32_t count);	// Many at once (SIMD), nodes[i] gets entry i
+	const glm::mat4& getLocalMatrix(uint32_t node) const;
+
+	// Valid after updateWorldTransforms
+	const glm::mat4& getWorldMatrix(uint32_t node) const;
+
+	// Recomputes world matrices below every node changed since the last update
+	void updateWorldTransforms();
+	uint32_t getLastUpdatedCount() const;		// World matrices the last update recomputed
+
+	uint32_t getNodeCount() const;
+
+private:
+	// - Hierarchy (indexed by node id)
+	std::vector<uint32_t> nodeParents;
+	std::vector<uint32_t> nodeFirstChildren;
+	std::vector<uint32_t> nodeNextSiblings;
+	std::vector<uint32_t> nodePositions;		// Position in the sorted arrays, INVALID_NODE if the id is free
+	std::vector<uint32_t> freeNodes;
+	uint32_t firstRoot = INVALID_NODE;			// Roots are siblings of each other
+	uint32_t nodeCount = 0;
+
+	// - Depth first sorted (indexed by position)
+	std::vector<uint32_t> sortedNodes;			// Node id at each position
+	std::vector<uint32_t> sortedParents;		// Position of the parent, INVALID_NODE for roots
+	std::vector<uint32_t> subtreeSizes;			// Including the node itself
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> worldMatrices;
+
+	std::vector<glm::mat4> composedMatrices;	// setLocalTransforms scratch
+
+	std::vector<uint32_t> dirtyPositions;		// Changed since the last update (each listed once)
+	std::vector<uint8_t> dirtyFlags;
+	bool orderDirty = false;					// Hierarchy changed, arrays need sorting again
+	uint32_t lastUpdatedCount = 0;
+
+	void linkNode(uint32_t node, uint32_t parent);
+	void unlinkNode(uint32_t node);
+	void markDirty(uint32_t position);
+	void sortNodes();
+};
@@ -0,0 +1,33 @@
+// Shared by light_binning.comp and shader.frag (CLUSTERED_LIGHTS), descriptor set 0 bindings 4-6
+// Grid sizes match ClusteredLighting.h
+// Define CLUSTER_LIGHTS_ACCESS (writeonly when binning, readonly when shading) before including
+
+#define LIGHT_TILES_X 16u
+#define LIGHT_TILES_Y 9u
+#define LIGHT_SLICES 24u
+#define LIGHT_CLUSTER_COUNT (LIGHT_TILES_X * LIGHT_TILES_Y * LIGHT_SLICES)
+#define MAX_CLUSTER_LIGHTS 256u
+#define MAX_LIGHTS 16384u
+
+struct Light {
+	vec4 positionRange;		// World position, range (no light past it)
+	vec4 colour;			// Linear colour times intensity, w = cos of the inner cone angle
+	vec4 direction;			// Spot direction, w = cos of the outer cone angle (below -1 for point lights)
+};
+
+layout(set = 0, binding = 4) uniform LightGrid {
+	mat4 view;
+	vec4 projection;		// P[0][0], P[1][1], near and far distance
+	vec4 slicing;			// Slice = log(view depth) * x - y, z and w = tiles per pixel
+	uvec4 lightCount;		// x = lights this frame
+} lightGrid;
+
+layout(std430, set = 0, binding = 5) readonly buffer Lights {
+	Light lights[];
+};
+
+// Light indices of a cluster start at cluster * MAX_CLUSTER_LIGHTS / 2, two 16-bit indices per uint (low half first)
+layout(std430, set = 0, binding = 6) CLUSTER_LIGHTS_ACCESS buffer ClusterLights {
+	uint clusterLightCounts[LIGHT_CLUSTER_COUNT];
+	uint clusterLightIndices[];
+};
@@ -0,0 +1,34 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Lighting subpass of deferred shading: reads this pixel of the G-buffer as input attachments (kept on chip by tilers)
+// Variants like shader.frag: deferred_lighting{_shadows}{_lights}.frag.spv
+
+#include "lighting.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput gBufferAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput gBufferNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput gBufferDepth;
+
+layout(push_constant) uniform PushLighting {
+	mat4 inverseViewProjection;		// Clip space back to world space
+	vec4 screenSize;				// Width, height, 1 / width, 1 / height
+} pushLighting;
+
+layout(location = 0) out vec4 outColour;
+
+void main()
+{
+	float depth = subpassLoad(gBufferDepth).r;
+	if (depth >= 1.0) { discard; }			// Nothing drawn here: keep the clear colour
+
+	// World position from the depth buffer (0..1 depth is NDC z)
+	vec2 ndc = gl_FragCoord.xy * pushLighting.screenSize.zw * 2.0 - 1.0;
+	vec4 worldPos = pushLighting.inverseViewProjection * vec4(ndc, depth, 1.0);
+	worldPos /= worldPos.w;
+
+	vec3 albedo = subpassLoad(gBufferAlbedo).rgb;
+	vec3 normal = normalize(subpassLoad(gBufferNormal).xyz * 2.0 - 1.0);
+
+	outColour = vec4(albedo * computeLighting(worldPos.xyz, normal), 1.0);
+}
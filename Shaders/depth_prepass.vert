@@ -0,0 +1,22 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Depth pre-pass: positions only, from the mesh's de-interleaved position stream
+// The forward pass then tests EQUAL against this depth, so it must compute gl_Position exactly like shader.vert
+
+layout(location = 0) in vec3 pos;		// Object space, or quantized (dequantized by the object's model matrix)
+
+layout(binding = 0) uniform UboViewProjection {
+	mat4 projection;
+	mat4 view;
+} uboViewProjection;
+
+#include "object_data.glsl"
+
+invariant gl_Position;
+
+void main ()
+{
+	mat4 model = objects[pushObject.objectIndex].model;
+	gl_Position = uboViewProjection.projection * uboViewProjection.view * model * vec4(pos, 1.0);
+}
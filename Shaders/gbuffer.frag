@@ -0,0 +1,20 @@
+#version 450
+
+// G-buffer pass of deferred shading: surface attributes only, Shaders/deferred_lighting.frag lights them
+// in the next subpass (formats chosen in VulkanRenderer::createRenderGraph)
+
+layout(location = 0) in vec3 fragCol;
+layout(location = 3) in vec3 fragWorldPos;
+
+layout(location = 0) out vec4 outAlbedo;		// RGBA8
+layout(location = 1) out vec4 outNormal;		// A2B10G10R10, world normal packed to 0..1
+
+void main()
+{
+	// Face normal from the position derivatives: screen x cross screen y (down with the flipped projection)
+	// always points at the camera, so flat meshes are lit from both sides like in the forward pass
+	vec3 normal = normalize(cross(dFdy(fragWorldPos), dFdx(fragWorldPos)));
+
+	outAlbedo = vec4(fragCol, 1.0);
+	outNormal = vec4(normal * 0.5 + 0.5, 0.0);
+}
@@ -0,0 +1,96 @@
+// Lighting shared by shader.frag and deferred_lighting.frag, compiled in with -DSHADOWS and / or -DCLUSTERED_LIGHTS
+// (neither: unlit, lighting of 1)
+
+#ifdef SHADOWS
+// Directional light with cascaded shadow maps
+#define MAX_SHADOW_CASCADES 4
+
+// Matches ShadowData in VulkanRenderer.h
+layout(binding = 2) uniform ShadowData {
+	mat4 cascadeViewProjections[MAX_SHADOW_CASCADES];	// World to atlas uv (xy) and depth (z)
+	vec4 cascadeSplits;			// View distance each cascade ends at
+	vec4 cascadeTexelSizes;		// World size of a texel
+	vec4 lightDirection;		// xyz towards the light, w = cascade count
+	vec4 cameraPosition;
+	vec4 cameraForward;
+} shadowData;
+
+layout(binding = 3) uniform sampler2DShadow shadowAtlas;
+
+// 0 = shadowed, 1 = lit: 4 taps half a texel apart, each a filtered 2x2 compare
+float sampleShadow(vec3 worldPos, vec3 normal)
+{
+	float viewDistance = dot(worldPos - shadowData.cameraPosition.xyz, shadowData.cameraForward.xyz);
+	uint cascadeCount = uint(shadowData.lightDirection.w);
+	uint cascade = 0;
+	while (cascade < cascadeCount && viewDistance > shadowData.cascadeSplits[cascade]) { cascade++; }
+	if (cascade == cascadeCount) { return 1.0; }
+
+	// Normal offset of a texel and a half against acne on surfaces facing away from the light
+	vec3 offsetPos = worldPos + normal * shadowData.cascadeTexelSizes[cascade] * 1.5;
+	vec4 shadowPos = shadowData.cascadeViewProjections[cascade] * vec4(offsetPos, 1.0);
+
+	vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+	float lit = 0.0;
+	lit += texture(shadowAtlas, vec3(shadowPos.xy + vec2(-0.5, -0.5) * texel, shadowPos.z));
+	lit += texture(shadowAtlas, vec3(shadowPos.xy + vec2(0.5, -0.5) * texel, shadowPos.z));
+	lit += texture(shadowAtlas, vec3(shadowPos.xy + vec2(-0.5, 0.5) * texel, shadowPos.z));
+	lit += texture(shadowAtlas, vec3(shadowPos.xy + vec2(0.5, 0.5) * texel, shadowPos.z));
+	return lit * 0.25;
+}
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+// Point and spot lights, only those light_binning.comp found in the fragment's cluster
+#define CLUSTER_LIGHTS_ACCESS readonly
+#include "clustered_lighting.glsl"
+
+vec3 shadeClusteredLights(vec3 worldPos, vec3 normal)
+{
+	float viewDepth = -(lightGrid.view * vec4(worldPos, 1.0)).z;
+	uint slice = uint(clamp(log(viewDepth) * lightGrid.slicing.x - lightGrid.slicing.y, 0.0, float(LIGHT_SLICES - 1u)));
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * lightGrid.slicing.zw), uvec2(LIGHT_TILES_X - 1u, LIGHT_TILES_Y - 1u));
+	uint cluster = (slice * LIGHT_TILES_Y + tile.y) * LIGHT_TILES_X + tile.x;
+
+	uint count = clusterLightCounts[cluster];
+	uint indexBase = cluster * (MAX_CLUSTER_LIGHTS / 2);
+	vec3 lighting = vec3(0.0);
+	for (uint i = 0; i < count; i++)
+	{
+		uint pair = clusterLightIndices[indexBase + i / 2];
+		Light light = lights[(i & 1) == 0 ? pair & 0xffff : pair >> 16];
+
+		vec3 toLight = light.positionRange.xyz - worldPos;
+		float distanceSquared = dot(toLight, toLight);
+		float rangeSquared = light.positionRange.w * light.positionRange.w;
+		if (distanceSquared >= rangeSquared) { continue; }
+
+		// Inverse square falloff windowed to reach 0 at the range
+		vec3 direction = toLight * inversesqrt(distanceSquared);
+		float window = clamp(1.0 - (distanceSquared * distanceSquared) / (rangeSquared * rangeSquared), 0.0, 1.0);
+		float attenuation = window * window / (distanceSquared + 1.0);
+		float cone = smoothstep(light.direction.w, light.colour.w, dot(-direction, light.direction.xyz));
+
+		lighting += light.colour.rgb * max(dot(normal, direction), 0.0) * attenuation * cone;
+	}
+	return lighting;
+}
+#endif
+
+// Light reaching a surface point with this (unit, camera facing) normal, times its colour gives the shaded colour
+vec3 computeLighting(vec3 worldPos, vec3 normal)
+{
+	vec3 lighting = vec3(1.0);		// Unlit: colours as they are
+
+#ifdef SHADOWS
+	float diffuse = max(dot(normal, shadowData.lightDirection.xyz), 0.0) * sampleShadow(worldPos, normal);
+	lighting = vec3(0.3 + 0.7 * diffuse);
+#elif defined(CLUSTERED_LIGHTS)
+	lighting = vec3(0.1);			// Lit by its lights over a dim ambient
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+	lighting += shadeClusteredLights(worldPos, normal);
+#endif
+	return lighting;
+}
@@ -0,0 +1,137 @@
+// Shared by meshlet_cull.comp and meshlet.task/.mesh
+// Define CLUSTER_SET (descriptor set index of the cluster data) before including
+// Define OCCLUSION_CULLING for the two-phase Hi-Z variant (adds bindings 7-8 and meshletDrawnInPhase)
+
+struct Meshlet {
+	vec4 boundingSphere;	// Object space centre (xyz) and radius (w)
+	vec4 cone;				// Normal cone axis (xyz) and sin of cutoff (w)
+	uint vertexOffset;
+	uint triangleOffset;
+	uint vertexCount;
+	uint triangleCount;
+};
+
+struct ClusterDraw {
+	mat4 model;				// Model matrix given to the vertex stage (includes dequantization)
+	mat4 world;				// Object -> world, meshlet bounds are transformed by this
+	uint meshletOffset;		// Meshlets of the selected LOD level
+	uint meshletCount;
+	uint outputIndexOffset;	// Compute path: where this draw's compacted indices start
+	float maxScale;			// Largest axis scale of world, for sphere radii
+	uint visibilityOffset;	// Occlusion culling: this draw's first entry in meshletVisibility
+	uint padding[3];
+};
+
+layout(set = CLUSTER_SET, binding = 0) uniform CullData {
+	vec4 frustumPlanes[6];	// World space, xyz = normal (pointing inside), w = distance
+	vec4 cameraPosition;
+	mat4 viewProjection;
+	vec4 hiZSize;			// Hi-Z level 0 width, height, mip count
+	uint visibilityEpoch;	// meshletVisibility entries holding another value are stale (draw list changed)
+} cullData;
+
+layout(std430, set = CLUSTER_SET, binding = 1) readonly buffer Meshlets {
+	Meshlet meshlets[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 2) readonly buffer MeshletVertices {
+	uint meshletVertices[];
+};
+
+layout(std430, set = CLUSTER_SET, binding = 3) readonly buffer MeshletTriangles {
+	uint meshletTriangles[];	// 3 local vertex indices packed as bytes
+};
+
+layout(std430, set = CLUSTER_SET, binding = 4) readonly buffer ClusterDraws {
+	ClusterDraw draws[];
+};
+
+bool meshletVisible(Meshlet meshlet, ClusterDraw draw)
+{
+	vec3 centre = (draw.world * vec4(meshlet.boundingSphere.xyz, 1.0)).xyz;
+	float radius = meshlet.boundingSphere.w * draw.maxScale;
+
+	// Frustum: sphere entirely outside any plane
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(cullData.frustumPlanes[i].xyz, centre) + cullData.frustumPlanes[i].w < -radius)
+		{
+			return false;
+		}
+	}
+
+	// Backface: every triangle faces away from the camera (cone.w == 1 never passes this)
+	vec3 axis = normalize(mat3(draw.world) * meshlet.cone.xyz);
+	vec3 toCentre = centre - cullData.cameraPosition.xyz;
+	if (dot(toCentre, axis) >= meshlet.cone.w * length(toCentre) + radius)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+#ifdef OCCLUSION_CULLING
+// Phases of two-phase occlusion culling (matches CullPhase on the CPU side)
+const uint CULL_PHASE_EARLY = 1;	// Draw what was visible last frame
+const uint CULL_PHASE_LATE = 2;		// Test everything against the Hi-Z built from the early depth, draw what was missed
+
+layout(std430, set = CLUSTER_SET, binding = 7) buffer MeshletVisibility {
+	uint meshletVisibility[];	// Per draw and meshlet: the epoch it was visible in at the end of the last late phase
+};
+
+layout(set = CLUSTER_SET, binding = 8) uniform sampler2D hiZ;
+
+bool meshletOccluded(Meshlet meshlet, ClusterDraw draw)
+{
+	vec3 centre = (draw.world * vec4(meshlet.boundingSphere.xyz, 1.0)).xyz;
+	float radius = meshlet.boundingSphere.w * draw.maxScale;
+
+	// Screen rectangle and nearest depth of the sphere's bounding box
+	vec2 minUv = vec2(1.0);
+	vec2 maxUv = vec2(0.0);
+	float nearestDepth = 1.0;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = centre + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = cullData.viewProjection * vec4(corner, 1.0);
+		if (clip.w <= 0.0)
+		{
+			return false;	// Crosses the camera plane, can't bound it on screen
+		}
+
+		vec3 ndc = clip.xyz / clip.w;
+		minUv = min(minUv, ndc.xy * 0.5 + 0.5);
+		maxUv = max(maxUv, ndc.xy * 0.5 + 0.5);
+		nearestDepth = min(nearestDepth, ndc.z);
+	}
+	minUv = clamp(minUv, 0.0, 1.0);
+	maxUv = clamp(maxUv, 0.0, 1.0);
+
+	// Level where the rectangle covers at most 2x2 texels, so 4 samples see all of it
+	vec2 size = (maxUv - minUv) * cullData.hiZSize.xy;
+	float level = min(ceil(log2(max(max(size.x, size.y), 1.0))), cullData.hiZSize.z - 1.0);
+
+	float farthest = max(max(textureLod(hiZ, minUv, level).x, textureLod(hiZ, vec2(maxUv.x, minUv.y), level).x),
+		max(textureLod(hiZ, vec2(minUv.x, maxUv.y), level).x, textureLod(hiZ, maxUv, level).x));
+
+	return nearestDepth > farthest;
+}
+
+// Whether the draw's i-th meshlet is drawn in the given phase, the late phase also records visibility for the next frame.
+// Entries are per draw: instances of a mesh are occluded independently
+bool meshletDrawnInPhase(uint i, Meshlet meshlet, ClusterDraw draw, uint phase)
+{
+	uint entry = draw.visibilityOffset + i;
+	bool inView = meshletVisible(meshlet, draw);
+	bool wasVisible = meshletVisibility[entry] == cullData.visibilityEpoch;
+	if (phase == CULL_PHASE_EARLY)
+	{
+		return inView && wasVisible;
+	}
+
+	bool visible = inView && !meshletOccluded(meshlet, draw);
+	meshletVisibility[entry] = visible ? cullData.visibilityEpoch : 0;
+	return visible && !wasVisible;	// Already drawn in the early phase otherwise
+}
+#endif
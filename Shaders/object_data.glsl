@@ -0,0 +1,20 @@
+// Per object data shared by shader.vert, depth_prepass.vert and shadow.vert: written once per frame by the CPU,
+// each draw only pushes its index
+
+// Matches ObjectData in VulkanRenderer.h
+struct ObjectData {
+	mat4 model;				// Stored positions -> world (dequantization included)
+	uint material;
+	uint flags;				// ENTITY_FLAG_*
+	uvec2 padding;
+};
+
+layout(std430, binding = 1) readonly buffer Objects {
+	ObjectData objects[];
+};
+
+// Matches ObjectPush in VulkanRenderer.h
+layout(push_constant) uniform PushObject {
+	uint objectIndex;
+	layout(offset = 16) mat4 cascadeViewProjection;		// Shadow pass only, pushed once per cascade
+} pushObject;
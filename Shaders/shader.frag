@@ -1,10 +1,30 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 fragCol;		// Input color from vertex shader
+layout(location = 3) in vec3 fragWorldPos;
 
 layout(location = 0) out vec4 outColour; 	// Final output color (must also have location)
 
+// Variants: -DSHADOWS (shader_shadows.frag.spv), -DCLUSTERED_LIGHTS (shader_lights.frag.spv) or both (shader_shadows_lights.frag.spv)
+#include "lighting.glsl"
+
 void main()
 {
-	outColour = vec4(fragCol, 1.0);
-}
\ No newline at end of file
+	vec3 lighting = vec3(1.0);		// Unlit: vertex colours as they are
+
+#if defined(SHADOWS) || defined(CLUSTERED_LIGHTS)
+	// Face normal from the position derivatives, turned towards the camera (flat meshes are seen from both sides)
+	vec3 normal = normalize(cross(dFdx(fragWorldPos), dFdy(fragWorldPos)));
+#ifdef CLUSTERED_LIGHTS
+	vec3 cameraPosition = -transpose(mat3(lightGrid.view)) * lightGrid.view[3].xyz;
+#else
+	vec3 cameraPosition = shadowData.cameraPosition.xyz;
+#endif
+	if (dot(normal, cameraPosition - fragWorldPos) < 0.0) { normal = -normal; }
+
+	lighting = computeLighting(fragWorldPos, normal);
+#endif
+
+	outColour = vec4(fragCol * lighting, 1.0);
+}
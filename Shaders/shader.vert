@@ -1,28 +1,44 @@
 #version 450 		// use GLSL version 4.5
+#extension GL_GOOGLE_include_directive : require
 
-layout(location = 0) in vec3 pos;
+layout(location = 0) in vec3 pos;		// Object space, or quantized (dequantized by the object's model matrix)
 layout(location = 1) in vec3 col;
+layout(location = 2) in vec3 norm;		// Octahedral encoded in .xy when OCT_NORMALS is set
+layout(location = 3) in vec2 tex;
+
+// Set from the vertex format chosen on the CPU side
+layout(constant_id = 0) const bool OCT_NORMALS = false;
 
 layout(binding = 0) uniform UboViewProjection {
 	mat4 projection;
 	mat4 view;
 } uboViewProjection;
 
-// Not in use left for reference
-layout(binding = 1) uniform Model {
-	mat4 model;
-} model;
-
-layout(push_constant) uniform PushModel {
-	mat4 model;
-} pushModel;
+#include "object_data.glsl"
 
 layout(location = 0) out vec3 fragCol;
+layout(location = 1) out vec3 fragNorm;
+layout(location = 2) out vec2 fragTex;
+layout(location = 3) out vec3 fragWorldPos;		// Shadow lookups
+
+invariant gl_Position;		// Bit identical to Shaders/depth_prepass.vert for the EQUAL depth test after a pre-pass
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
 
 void main ()
 {
-	gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
+	mat4 model = objects[pushObject.objectIndex].model;
+	gl_Position = uboViewProjection.projection * uboViewProjection.view * model * vec4(pos, 1.0);
 
 	fragCol = col;
+	fragNorm = OCT_NORMALS ? octDecode(norm.xy) : norm;
+	fragTex = tex;
+	fragWorldPos = (model * vec4(pos, 1.0)).xyz;
 }
 
@@ -0,0 +1,13 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Shadow caster: position stream into one cascade's tile of the atlas (viewport set per cascade)
+
+layout(location = 0) in vec3 pos;		// Object space, or quantized (dequantized by the object's model matrix)
+
+#include "object_data.glsl"
+
+void main ()
+{
+	gl_Position = pushObject.cascadeViewProjection * objects[pushObject.objectIndex].model * vec4(pos, 1.0);
+}
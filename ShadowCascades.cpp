@@ -0,0 +1,51 @@
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <../glm/gtc/matrix_transform.hpp>
+
+void computeCascadeSplits(float nearDistance, float farDistance, uint32_t cascadeCount, float lambda, float* splits)
+{
+	for (uint32_t i = 1; i <= cascadeCount; i++)
+	{
+		float fraction = static_cast<float>(i) / cascadeCount;
+		float logarithmic = nearDistance * std::pow(farDistance / nearDistance, fraction);
+		float uniform = nearDistance + (farDistance - nearDistance) * fraction;
+		splits[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+	}
+}
+
+ShadowCascade fitCascade(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection,
+	float nearDistance, float farDistance, uint32_t resolution, uint32_t snapTexels, float casterDistance)
+{
+	// Smallest sphere around the slice: centred on the view axis, equally far from the near and far corners
+	// (squared corner distance off the axis is distance^2 * diagonal)
+	float tanX = 1.0f / projection[0][0];
+	float tanY = 1.0f / std::abs(projection[1][1]);
+	float diagonal = tanX * tanX + tanY * tanY;
+	float centreDistance = std::min(0.5f * (nearDistance + farDistance) * (1.0f + diagonal), farDistance);
+	float radius = std::sqrt((farDistance - centreDistance) * (farDistance - centreDistance) + farDistance * farDistance * diagonal);
+	glm::vec3 centre = glm::vec3(glm::inverse(view) * glm::vec4(0.0f, 0.0f, -centreDistance, 1.0f));
+
+	// Light space rotation only (no translation), the same every frame for the same light
+	glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+	glm::vec3 lightCentre = glm::vec3(lightView * glm::vec4(centre, 1.0f));
+
+	// Half extent e covers the sphere from anywhere within a step: e = radius + step / 2, step = 2e * snapTexels / resolution
+	float snap = static_cast<float>(std::max(snapTexels, 1u));
+	float extent = radius / (1.0f - snap / resolution);
+	float step = 2.0f * extent * snap / resolution;
+	glm::vec3 snapped = (glm::floor(lightCentre / step) + 0.5f) * step;
+
+	// Light looks down -z: points in front have negative z
+	float zNear = -snapped.z - extent - casterDistance;
+	float zFar = -snapped.z + extent;
+
+	ShadowCascade cascade;
+	cascade.viewProjection = glm::orthoRH_ZO(snapped.x - extent, snapped.x + extent, snapped.y - extent, snapped.y + extent, zNear, zFar) * lightView;
+	cascade.splitDistance = farDistance;
+	cascade.texelSize = 2.0f * extent / resolution;
+	return cascade;
+}
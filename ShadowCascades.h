@@ -0,0 +1,24 @@
+#pragma once
+
+#include "utilities.h"
+
+const uint32_t MAX_SHADOW_CASCADES = 4;
+
+// One cascade of a directional light's shadow map
+struct ShadowCascade
+{
+	glm::mat4 viewProjection;			// World to light clip space (orthographic, 0..1 depth)
+	float splitDistance;				// View distance the cascade covers up to
+	float texelSize;					// World size of one shadow map texel
+};
+
+// Practical split scheme: view distances the cascades end at, lambda blends uniform (0) and logarithmic (1) splits
+void computeCascadeSplits(float nearDistance, float farDistance, uint32_t cascadeCount, float lambda, float* splits);
+
+// Fits a cascade around the slice of a perspective view frustum between two view distances. The slice's bounding sphere
+// keeps its size as the camera turns, and the projection only moves in whole steps of snapTexels texels in light space
+// (the cascade is padded by half a step to still cover the sphere), so texels stay put: no shimmering edges, and a
+// cascade rendered once stays valid until the camera crosses into the next step. casterDistance extends the near plane
+// towards the light for casters outside the slice
+ShadowCascade fitCascade(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection,
+	float nearDistance, float farDistance, uint32_t resolution, uint32_t snapTexels, float casterDistance);
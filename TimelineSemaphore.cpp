@@ -0,0 +1,78 @@
+#include "TimelineSemaphore.h"
+
+#include <limits>
+#include <stdexcept>
+
+TimelineSemaphore::TimelineSemaphore(VkDevice newDevice)
+	: device(newDevice)
+{
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {};
+	semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+	if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create timeline semaphore!");
+	}
+}
+
+VkSemaphore TimelineSemaphore::getSemaphore() const
+{
+	return semaphore;
+}
+
+uint64_t TimelineSemaphore::signalNext()
+{
+	return ++lastSignal;
+}
+
+uint64_t TimelineSemaphore::getLastSignal() const
+{
+	return lastSignal;
+}
+
+uint64_t TimelineSemaphore::getCompletedValue()
+{
+	if (completedValue < lastSignal)
+	{
+		if (vkGetSemaphoreCounterValue(device, semaphore, &completedValue) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to read timeline semaphore value!");
+		}
+	}
+	return completedValue;
+}
+
+bool TimelineSemaphore::isComplete(uint64_t value)
+{
+	return value <= completedValue || value <= getCompletedValue();
+}
+
+void TimelineSemaphore::wait(uint64_t value)
+{
+	if (isComplete(value)) { return; }
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+	if (vkWaitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to wait for timeline semaphore!");
+	}
+	completedValue = value;
+}
+
+void TimelineSemaphore::destroy()
+{
+	if (semaphore != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(device, semaphore, nullptr);
+		semaphore = VK_NULL_HANDLE;
+	}
+}
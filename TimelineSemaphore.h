@@ -0,0 +1,31 @@
+#pragma once
+
+#include "utilities.h"
+
+// Timeline semaphore of one queue: every submission signals the next value, so "has the GPU finished submission N" is a
+// counter comparison. CPU waits, reuse checks and waits of other queues all name a value instead of needing a fence or
+// binary semaphore per submission (Vulkan 1.2 timelineSemaphore feature)
+class TimelineSemaphore
+{
+public:
+	explicit TimelineSemaphore(VkDevice newDevice);
+
+	VkSemaphore getSemaphore() const;
+
+	// Value for the next submission to signal (one past the last), submissions must signal them in order
+	uint64_t signalNext();
+	uint64_t getLastSignal() const;			// Reached once everything submitted so far has finished (0: nothing yet)
+
+	// GPU progress without blocking (asks the device only while the value isn't known to be reached)
+	uint64_t getCompletedValue();
+	bool isComplete(uint64_t value);
+	void wait(uint64_t value);				// Blocks until the GPU has reached it
+
+	void destroy();
+
+private:
+	VkDevice device;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	uint64_t lastSignal = 0;
+	uint64_t completedValue = 0;			// Last value the device reported
+};
@@ -0,0 +1,351 @@
+#include "TransformBatch.h"
+
+#include <immintrin.h>
+
+#include <../glm/gtc/quaternion.hpp>
+
+#include "CpuFeatures.h"
+
+namespace {
+	const uint32_t NO_PARENT = 0xffffffff;
+
+	// - SCALAR -------------------------------------------------------------------------------------------------------------------
+
+	void composeTrsScalar(const TrsArrays& trs, uint32_t begin, uint32_t end, glm::mat4* matrices)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			glm::quat rotation(trs.rotation[3][i], trs.rotation[0][i], trs.rotation[1][i], trs.rotation[2][i]);
+			glm::mat4 matrix = glm::mat4_cast(rotation);
+			matrix[0] *= trs.scale[0][i];
+			matrix[1] *= trs.scale[1][i];
+			matrix[2] *= trs.scale[2][i];
+			matrix[3] = glm::vec4(trs.translation[0][i], trs.translation[1][i], trs.translation[2][i], 1.0f);
+			matrices[i] = matrix;
+		}
+	}
+
+	// - SSE4.1 -------------------------------------------------------------------------------------------------------------------
+
+	// result = left * right, one column at a time: sum of left's columns scaled by the right column's elements
+	CPU_TARGET_SSE41 inline void multiplySse41(const __m128 left[4], const float* right, float* result)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 rightColumn = _mm_loadu_ps(right + column * 4);
+			__m128 sum = _mm_mul_ps(left[0], _mm_shuffle_ps(rightColumn, rightColumn, 0x00));
+			sum = _mm_add_ps(sum, _mm_mul_ps(left[1], _mm_shuffle_ps(rightColumn, rightColumn, 0x55)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(left[2], _mm_shuffle_ps(rightColumn, rightColumn, 0xaa)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(left[3], _mm_shuffle_ps(rightColumn, rightColumn, 0xff)));
+			_mm_storeu_ps(result + column * 4, sum);
+		}
+	}
+
+	CPU_TARGET_SSE41 inline void loadColumnsSse41(const float* matrix, __m128 columns[4])
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			columns[column] = _mm_loadu_ps(matrix + column * 4);
+		}
+	}
+
+	// 4 objects at a time: each matrix element is computed for all of them, then 4x4 transposes give each object's columns
+	CPU_TARGET_SSE41 uint32_t composeTrsSse41(const TrsArrays& trs, uint32_t count, glm::mat4* matrices)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(trs.rotation[0] + i);
+			__m128 y = _mm_loadu_ps(trs.rotation[1] + i);
+			__m128 z = _mm_loadu_ps(trs.rotation[2] + i);
+			__m128 w = _mm_loadu_ps(trs.rotation[3] + i);
+			__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+			__m128 xz = _mm_mul_ps(x, z), xy = _mm_mul_ps(x, y), yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+			__m128 scaleX = _mm_loadu_ps(trs.scale[0] + i);
+			__m128 scaleY = _mm_loadu_ps(trs.scale[1] + i);
+			__m128 scaleZ = _mm_loadu_ps(trs.scale[2] + i);
+
+			// columns[column][row], as glm::mat3_cast then scaled per column
+			__m128 columns[4][4];
+			columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+			columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+			columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+			columns[0][3] = _mm_mul_ps(zero, scaleX);	// Keeps the sign glm gives 0 * negative scale
+			columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+			columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+			columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+			columns[1][3] = _mm_mul_ps(zero, scaleY);
+			columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+			columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+			columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+			columns[2][3] = _mm_mul_ps(zero, scaleZ);
+			columns[3][0] = _mm_loadu_ps(trs.translation[0] + i);
+			columns[3][1] = _mm_loadu_ps(trs.translation[1] + i);
+			columns[3][2] = _mm_loadu_ps(trs.translation[2] + i);
+			columns[3][3] = one;
+
+			float* out = &matrices[i][0][0];
+			for (int column = 0; column < 4; column++)
+			{
+				__m128 row0 = columns[column][0], row1 = columns[column][1], row2 = columns[column][2], row3 = columns[column][3];
+				_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+				_mm_storeu_ps(out + 0 * 16 + column * 4, row0);
+				_mm_storeu_ps(out + 1 * 16 + column * 4, row1);
+				_mm_storeu_ps(out + 2 * 16 + column * 4, row2);
+				_mm_storeu_ps(out + 3 * 16 + column * 4, row3);
+			}
+		}
+		return i;
+	}
+
+	CPU_TARGET_SSE41 void multiplyMatrixSse41(const glm::mat4& left, const glm::mat4* rights, uint32_t count, glm::mat4* results)
+	{
+		__m128 leftColumns[4];
+		loadColumnsSse41(&left[0][0], leftColumns);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			multiplySse41(leftColumns, &rights[i][0][0], &results[i][0][0]);
+		}
+	}
+
+	CPU_TARGET_SSE41 void multiplyMatricesSse41(const glm::mat4* lefts, const glm::mat4* rights, uint32_t count, glm::mat4* results)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			__m128 leftColumns[4];
+			loadColumnsSse41(&lefts[i][0][0], leftColumns);
+			multiplySse41(leftColumns, &rights[i][0][0], &results[i][0][0]);
+		}
+	}
+
+	CPU_TARGET_SSE41 void propagateSse41(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			if (parents[i] == NO_PARENT)
+			{
+				worlds[i] = locals[i];
+				continue;
+			}
+
+			__m128 parentColumns[4];
+			loadColumnsSse41(&worlds[parents[i]][0][0], parentColumns);
+			multiplySse41(parentColumns, &locals[i][0][0], &worlds[i][0][0]);
+		}
+	}
+
+	// - AVX2 ---------------------------------------------------------------------------------------------------------------------
+
+	// result = left * right, two columns per register (left's columns are duplicated into both halves)
+	CPU_TARGET_AVX2 inline void multiplyAvx2(const __m256 left[4], const float* right, float* result)
+	{
+		for (int column = 0; column < 4; column += 2)
+		{
+			__m256 rightColumns = _mm256_loadu_ps(right + column * 4);
+			__m256 sum = _mm256_mul_ps(left[0], _mm256_shuffle_ps(rightColumns, rightColumns, 0x00));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(left[1], _mm256_shuffle_ps(rightColumns, rightColumns, 0x55)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(left[2], _mm256_shuffle_ps(rightColumns, rightColumns, 0xaa)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(left[3], _mm256_shuffle_ps(rightColumns, rightColumns, 0xff)));
+			_mm256_storeu_ps(result + column * 4, sum);
+		}
+	}
+
+	CPU_TARGET_AVX2 inline void loadColumnsAvx2(const float* matrix, __m256 columns[4])
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			columns[column] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix + column * 4));
+		}
+	}
+
+	// rows[k] holds element k of 8 objects, afterwards rows[k] holds the 8 elements of object k
+	CPU_TARGET_AVX2 inline void transpose8x8Avx2(__m256 rows[8])
+	{
+		__m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+		__m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+		__m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+		__m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+		__m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+		__m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+		__m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+		__m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+		__m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44);
+		__m256 s1 = _mm256_shuffle_ps(t0, t2, 0xee);
+		__m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44);
+		__m256 s3 = _mm256_shuffle_ps(t1, t3, 0xee);
+		__m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44);
+		__m256 s5 = _mm256_shuffle_ps(t4, t6, 0xee);
+		__m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44);
+		__m256 s7 = _mm256_shuffle_ps(t5, t7, 0xee);
+		rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+		rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+		rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+		rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+		rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+		rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+		rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+		rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+	}
+
+	// 8 objects at a time: the 16 elements are computed for all of them, two 8x8 transposes give each object's matrix
+	CPU_TARGET_AVX2 uint32_t composeTrsAvx2(const TrsArrays& trs, uint32_t count, glm::mat4* matrices)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(trs.rotation[0] + i);
+			__m256 y = _mm256_loadu_ps(trs.rotation[1] + i);
+			__m256 z = _mm256_loadu_ps(trs.rotation[2] + i);
+			__m256 w = _mm256_loadu_ps(trs.rotation[3] + i);
+			__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+			__m256 xz = _mm256_mul_ps(x, z), xy = _mm256_mul_ps(x, y), yz = _mm256_mul_ps(y, z);
+			__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+			__m256 scaleX = _mm256_loadu_ps(trs.scale[0] + i);
+			__m256 scaleY = _mm256_loadu_ps(trs.scale[1] + i);
+			__m256 scaleZ = _mm256_loadu_ps(trs.scale[2] + i);
+
+			// Elements in memory order: columns 0 and 1, then columns 2 and 3
+			__m256 low[8], high[8];
+			low[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), scaleX);
+			low[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), scaleX);
+			low[2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), scaleX);
+			low[3] = _mm256_mul_ps(zero, scaleX);		// Keeps the sign glm gives 0 * negative scale
+			low[4] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), scaleY);
+			low[5] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), scaleY);
+			low[6] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), scaleY);
+			low[7] = _mm256_mul_ps(zero, scaleY);
+			high[0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), scaleZ);
+			high[1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), scaleZ);
+			high[2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), scaleZ);
+			high[3] = _mm256_mul_ps(zero, scaleZ);
+			high[4] = _mm256_loadu_ps(trs.translation[0] + i);
+			high[5] = _mm256_loadu_ps(trs.translation[1] + i);
+			high[6] = _mm256_loadu_ps(trs.translation[2] + i);
+			high[7] = one;
+
+			transpose8x8Avx2(low);
+			transpose8x8Avx2(high);
+
+			float* out = &matrices[i][0][0];
+			for (int object = 0; object < 8; object++)
+			{
+				_mm256_storeu_ps(out + object * 16, low[object]);
+				_mm256_storeu_ps(out + object * 16 + 8, high[object]);
+			}
+		}
+		return i;
+	}
+
+	CPU_TARGET_AVX2 void multiplyMatrixAvx2(const glm::mat4& left, const glm::mat4* rights, uint32_t count, glm::mat4* results)
+	{
+		__m256 leftColumns[4];
+		loadColumnsAvx2(&left[0][0], leftColumns);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			multiplyAvx2(leftColumns, &rights[i][0][0], &results[i][0][0]);
+		}
+	}
+
+	CPU_TARGET_AVX2 void multiplyMatricesAvx2(const glm::mat4* lefts, const glm::mat4* rights, uint32_t count, glm::mat4* results)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			__m256 leftColumns[4];
+			loadColumnsAvx2(&lefts[i][0][0], leftColumns);
+			multiplyAvx2(leftColumns, &rights[i][0][0], &results[i][0][0]);
+		}
+	}
+
+	CPU_TARGET_AVX2 void propagateAvx2(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			if (parents[i] == NO_PARENT)
+			{
+				worlds[i] = locals[i];
+				continue;
+			}
+
+			__m256 parentColumns[4];
+			loadColumnsAvx2(&worlds[parents[i]][0][0], parentColumns);
+			multiplyAvx2(parentColumns, &locals[i][0][0], &worlds[i][0][0]);
+		}
+	}
+}
+
+TransformSimd getBestTransformSimd()
+{
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx2) { return TRANSFORM_SIMD_AVX2; }
+	if (features.sse41) { return TRANSFORM_SIMD_SSE41; }
+	return TRANSFORM_SIMD_SCALAR;
+}
+
+void composeTrsBatch(const TrsArrays& trs, uint32_t count, glm::mat4* matrices, TransformSimd simd)
+{
+	// Wide kernels leave the last few objects to the scalar one
+	uint32_t done = 0;
+	switch (simd)
+	{
+	case TRANSFORM_SIMD_AVX2: done = composeTrsAvx2(trs, count, matrices); break;
+	case TRANSFORM_SIMD_SSE41: done = composeTrsSse41(trs, count, matrices); break;
+	default: break;
+	}
+	composeTrsScalar(trs, done, count, matrices);
+}
+
+void multiplyMatrixBatch(const glm::mat4& left, const glm::mat4* rights, uint32_t count, glm::mat4* results, TransformSimd simd)
+{
+	switch (simd)
+	{
+	case TRANSFORM_SIMD_AVX2: multiplyMatrixAvx2(left, rights, count, results); break;
+	case TRANSFORM_SIMD_SSE41: multiplyMatrixSse41(left, rights, count, results); break;
+	default:
+		for (uint32_t i = 0; i < count; i++)
+		{
+			results[i] = left * rights[i];
+		}
+		break;
+	}
+}
+
+void multiplyMatricesBatch(const glm::mat4* lefts, const glm::mat4* rights, uint32_t count, glm::mat4* results, TransformSimd simd)
+{
+	switch (simd)
+	{
+	case TRANSFORM_SIMD_AVX2: multiplyMatricesAvx2(lefts, rights, count, results); break;
+	case TRANSFORM_SIMD_SSE41: multiplyMatricesSse41(lefts, rights, count, results); break;
+	default:
+		for (uint32_t i = 0; i < count; i++)
+		{
+			results[i] = lefts[i] * rights[i];
+		}
+		break;
+	}
+}
+
+void propagateTransforms(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t begin, uint32_t end, TransformSimd simd)
+{
+	switch (simd)
+	{
+	case TRANSFORM_SIMD_AVX2: propagateAvx2(parents, locals, worlds, begin, end); break;
+	case TRANSFORM_SIMD_SSE41: propagateSse41(parents, locals, worlds, begin, end); break;
+	default:
+		for (uint32_t i = begin; i < end; i++)
+		{
+			worlds[i] = parents[i] == NO_PARENT ? locals[i] : worlds[parents[i]] * locals[i];
+		}
+		break;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "utilities.h"
+
+// Kernel used by the batch transform functions
+enum TransformSimd
+{
+	TRANSFORM_SIMD_SCALAR,		// glm, one matrix at a time
+	TRANSFORM_SIMD_SSE41,		// TRS: 4 objects at a time, products: one 4 float column at a time
+	TRANSFORM_SIMD_AVX2			// TRS: 8 objects at a time, products: two columns at a time
+};
+
+// Widest kernel the running CPU supports
+TransformSimd getBestTransformSimd();
+
+// Translation, rotation (unit quaternion) and scale of count objects, one array per component
+struct TrsArrays
+{
+	const float* translation[3];	// x, y, z
+	const float* rotation[4];		// x, y, z, w
+	const float* scale[3];			// x, y, z
+};
+
+// Every kernel gives the same result as the glm expression in its comment (same operations in the same order)
+
+// matrices[i] = translate(t) * mat4_cast(r) * scale(s)
+void composeTrsBatch(const TrsArrays& trs, uint32_t count, glm::mat4* matrices, TransformSimd simd = getBestTransformSimd());
+
+// results[i] = left * rights[i] (e.g. view-projection * model)
+void multiplyMatrixBatch(const glm::mat4& left, const glm::mat4* rights, uint32_t count, glm::mat4* results,
+	TransformSimd simd = getBestTransformSimd());
+
+// results[i] = lefts[i] * rights[i]
+void multiplyMatricesBatch(const glm::mat4* lefts, const glm::mat4* rights, uint32_t count, glm::mat4* results,
+	TransformSimd simd = getBestTransformSimd());
+
+// worlds[i] = worlds[parents[i]] * locals[i] (locals[i] for parents[i] == 0xffffffff) for i in [begin, end)
+// Parents must come before their children, e.g. depth first order
+void propagateTransforms(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t begin, uint32_t end,
+	TransformSimd simd = getBestTransformSimd());
@@ -0,0 +1,161 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <limits>
+#include <gtc/packing.hpp>
+#include <../glm/gtc/matrix_transform.hpp>
+
+VertexInputDescription getVertexInputDescription(VertexFormat format)
+{
+	VertexInputDescription description = {};
+	description.binding.binding = 0;								// Can bind multiple streams of Data, this defines which one
+	description.binding.stride = getVertexStride(format);			// Size of single vertex object
+	description.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;	// Whether to advance on every vertex or every instance
+
+	// Locations: 0 = position, 1 = colour, 2 = normal, 3 = texture coords
+	if (format == VERTEX_FORMAT_FLOAT)
+	{
+		description.attributes = {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos) },
+			{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, col) },
+			{ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, norm) },
+			{ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, tex) }
+		};
+		return description;
+	}
+
+	VkFormat positionFormat = format == VERTEX_FORMAT_SNORM16 ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R16G16B16A16_SFLOAT;
+	description.attributes = {
+		{ 0, 0, positionFormat, offsetof(VertexCompact, pos) },
+		{ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(VertexCompact, col) },
+		{ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(VertexCompact, norm) },		// Shader sees (x, y, 0) and decodes the octahedron
+		{ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(VertexCompact, tex) }
+	};
+	return description;
+}
+
+uint32_t getVertexStride(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_FLOAT ? sizeof(Vertex) : sizeof(VertexCompact);
+}
+
+VertexInputDescription getPositionInputDescription(VertexFormat format)
+{
+	VertexInputDescription description = {};
+	description.binding.binding = 0;
+	description.binding.stride = getPositionStride(format);
+	description.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	// Same attribute format as the interleaved stream so both streams give the same position
+	description.attributes = { getVertexInputDescription(format).attributes[0] };
+	description.attributes[0].offset = 0;
+	return description;
+}
+
+uint32_t getPositionStride(VertexFormat format)
+{
+	return format == VERTEX_FORMAT_FLOAT ? sizeof(Vertex::pos) : sizeof(VertexCompact::pos);
+}
+
+std::vector<uint8_t> extractPositions(VertexFormat format, const std::vector<uint8_t>& vertexData)
+{
+	// Position is the first member of both layouts
+	uint32_t vertexStride = getVertexStride(format);
+	uint32_t positionStride = getPositionStride(format);
+	size_t vertexCount = vertexData.size() / vertexStride;
+
+	std::vector<uint8_t> positions(positionStride * vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		memcpy(positions.data() + i * positionStride, vertexData.data() + i * vertexStride, positionStride);
+	}
+	return positions;
+}
+
+bool isOctahedralNormalFormat(VertexFormat format)
+{
+	return format != VERTEX_FORMAT_FLOAT;
+}
+
+std::vector<uint8_t> packVertices(VertexFormat format, const std::vector<Vertex>& vertices, glm::mat4& dequantization)
+{
+	dequantization = glm::mat4(1.0f);
+
+	if (format == VERTEX_FORMAT_FLOAT)
+	{
+		std::vector<uint8_t> data(sizeof(Vertex) * vertices.size());
+		memcpy(data.data(), vertices.data(), data.size());
+		return data;
+	}
+
+	// Positions are stored relative to the centre of the mesh bounds so the precision is spent where the mesh is
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (const Vertex& vertex : vertices)
+	{
+		minPos = glm::min(minPos, vertex.pos);
+		maxPos = glm::max(maxPos, vertex.pos);
+	}
+	if (vertices.empty())
+	{
+		minPos = maxPos = glm::vec3(0.0f);
+	}
+
+	glm::vec3 centre = (minPos + maxPos) * 0.5f;
+	glm::vec3 extent = glm::max((maxPos - minPos) * 0.5f, glm::vec3(1e-6f));	// Avoid dividing by zero on flat meshes
+
+	// SNORM16 additionally scales into [-1, 1], HALF keeps the scale so only the offset is undone
+	glm::vec3 scale = format == VERTEX_FORMAT_SNORM16 ? extent : glm::vec3(1.0f);
+	dequantization = glm::scale(glm::translate(glm::mat4(1.0f), centre), scale);
+
+	std::vector<uint8_t> data(sizeof(VertexCompact) * vertices.size());
+	VertexCompact* packed = reinterpret_cast<VertexCompact*>(data.data());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& vertex = vertices[i];
+		glm::vec3 local = (vertex.pos - centre) / scale;
+
+		for (int c = 0; c < 3; c++)
+		{
+			packed[i].pos[c] = format == VERTEX_FORMAT_SNORM16 ? glm::packSnorm1x16(local[c]) : glm::packHalf1x16(local[c]);
+		}
+		packed[i].pos[3] = 0;
+
+		packed[i].col = glm::packUnorm4x8(glm::vec4(vertex.col, 1.0f));
+
+		glm::vec2 octNormal = octEncode(vertex.norm);
+		packed[i].norm[0] = static_cast<int16_t>(glm::packSnorm1x16(octNormal.x));
+		packed[i].norm[1] = static_cast<int16_t>(glm::packSnorm1x16(octNormal.y));
+
+		packed[i].tex[0] = glm::packHalf1x16(vertex.tex.x);
+		packed[i].tex[1] = glm::packHalf1x16(vertex.tex.y);
+	}
+
+	return data;
+}
+
+glm::vec2 octEncode(glm::vec3 normal)
+{
+	float l1Norm = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+	if (l1Norm <= 0.0f) { return glm::vec2(0.0f); }
+
+	// Project onto the octahedron then fold the lower hemisphere over the diagonals
+	glm::vec3 n = normal / l1Norm;
+	glm::vec2 encoded(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		glm::vec2 signs(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+		encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signs;
+	}
+	return encoded;
+}
+
+glm::vec3 octDecode(glm::vec2 encoded)
+{
+	glm::vec3 n(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+	float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
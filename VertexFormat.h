@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "utilities.h"
+
+// Layouts a mesh's vertices can be stored in on the GPU
+enum VertexFormat
+{
+	VERTEX_FORMAT_FLOAT,		// Every attribute as 32-bit floats (same as Vertex, 44 bytes)
+	VERTEX_FORMAT_SNORM16,		// 16-bit normalized position + packed colour/normal/uv (20 bytes)
+	VERTEX_FORMAT_HALF			// Half-float position + packed colour/normal/uv (20 bytes)
+};
+
+// Compact vertex used by both quantized formats
+struct VertexCompact
+{
+	uint16_t pos[4];	// Position, snorm16 or half depending on format (w is padding so the attribute is 4 byte aligned)
+	uint32_t col;		// Colour as R8G8B8A8_UNORM
+	int16_t norm[2];	// Octahedral encoded normal as R16G16_SNORM
+	uint16_t tex[2];	// Texture coords as R16G16_SFLOAT
+};
+
+static_assert(sizeof(VertexCompact) == 20, "VertexCompact must stay tightly packed");
+
+// Binding and attributes the graphics pipeline needs to read a given format
+struct VertexInputDescription
+{
+	VkVertexInputBindingDescription binding;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+VertexInputDescription getVertexInputDescription(VertexFormat format);
+uint32_t getVertexStride(VertexFormat format);
+
+// Position-only stream (location 0) split from the packed vertices, for depth-only passes
+VertexInputDescription getPositionInputDescription(VertexFormat format);
+uint32_t getPositionStride(VertexFormat format);
+std::vector<uint8_t> extractPositions(VertexFormat format, const std::vector<uint8_t>& vertexData);
+bool isOctahedralNormalFormat(VertexFormat format);
+
+// Converts vertices into the raw bytes of the given format
+// dequantization is set to the matrix that takes stored positions back to object space (fold it into the model matrix)
+std::vector<uint8_t> packVertices(VertexFormat format, const std::vector<Vertex>& vertices, glm::mat4& dequantization);
+
+// Octahedral normal encoding, maps a unit vector onto the [-1, 1] square
+glm::vec2 octEncode(glm::vec3 normal);
+glm::vec3 octDecode(glm::vec2 encoded);
@@ -17,18 +17,48 @@ namespace EngineCore {
 
 		// Initialization code for Vulkan would go here
 		try {
+			if (occlusionCulling && clusterCulling == CLUSTER_CULLING_OFF)
+			{
+				std::cout << "Occlusion culling works on meshlets and needs cluster culling, disabling it." << std::endl;
+				occlusionCulling = false;
+			}
+			if (deferredShading && occlusionCulling)
+			{
+				std::cout << "Deferred shading keeps the G-buffer in one render pass, the late occlusion phase would split it, disabling occlusion culling." << std::endl;
+				occlusionCulling = false;
+			}
+			if (deferredShading && msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+			{
+				std::cout << "Deferred shading reads a single sample G-buffer, disabling MSAA." << std::endl;
+				msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+			}
+			if (deferredShading && dynamicRendering)
+			{
+				std::cout << "Deferred shading reads the G-buffer as input attachments of a subpass, disabling dynamic rendering." << std::endl;
+				dynamicRendering = false;
+			}
+			if (occlusionCulling && msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+			{
+				std::cout << "The Hi-Z build reads single sample depth, disabling MSAA." << std::endl;
+				msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+			}
+
 			createInstance();
 			createSurface();
 			getPhysicalDevice();
 			createLogicalDevice();
 			createSwapChain();
-			createRenderPass();
+			msaaSamples = chooseMsaaSamples(msaaSamples);
+			createCommandPool();
+			createHiZResources();
+			createShadowResources();
+			createRenderGraph();
 			createDescriptorSetlayout();
 			createPushConstantRange();
 			createGraphicsPipeline();
-			createDepthBufferImage();
-			createFramebuffers();
-			createCommandPool();
+			createClusterCullPipeline();
+			createHiZPipeline();
+			createLightBinningPipeline();
 
 			// UboViewProjection matrix setup
 			uboViewProjection.projection = glm::perspective(glm::radians(45.0f), (float)swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 100.0f);
@@ -62,17 +92,47 @@ namespace EngineCore {
 				2, 3, 0  // Second Triangle
 			};
 
-			Mesh firstMesh = Mesh(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, &meshVertices, &meshIndices);
-			Mesh secondMesh = Mesh(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, &meshVertices2, &meshIndices);
+			// Generate LOD chains (appended to each mesh's own index list)
+			std::vector<uint32_t> meshIndices1 = meshIndices;
+			std::vector<uint32_t> meshIndices2 = meshIndices;
+			std::vector<MeshLod> meshLods1, meshLods2;
+			buildLodChain(meshVertices, meshIndices1, meshLods1);
+			buildLodChain(meshVertices2, meshIndices2, meshLods2);
+
+			loadedMeshes.push_back(meshes.create(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, &meshVertices, &meshIndices1, vertexFormat, &meshLods1));
+			loadedMeshes.push_back(meshes.create(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, &meshVertices2, &meshIndices2, vertexFormat, &meshLods2));
+
+			// One model per mesh
+			for (MeshHandle mesh : loadedMeshes)
+			{
+				createModel(mesh);
+			}
+
+			jobSystem = std::make_unique<JobSystem>();
 
-			meshList.push_back(firstMesh);
-			meshList.push_back(secondMesh);
+			// Low resolution depth for CPU occlusion, rasterized from each mesh's base level
+			if (softwareOcclusion)
+			{
+				occlusionCuller = std::make_unique<MaskedOcclusionCuller>(256, 192, getBestOcclusionSimd(), jobSystem.get());
+
+				occluderGeometry.resize(meshes.getSlotCount());
+				OccluderGeometry& firstOccluder = occluderGeometry[loadedMeshes[0].index];
+				OccluderGeometry& secondOccluder = occluderGeometry[loadedMeshes[1].index];
+				firstOccluder.indices.assign(meshIndices1.begin() + meshLods1[0].firstIndex, meshIndices1.begin() + meshLods1[0].firstIndex + meshLods1[0].indexCount);
+				secondOccluder.indices.assign(meshIndices2.begin() + meshLods2[0].firstIndex, meshIndices2.begin() + meshLods2[0].firstIndex + meshLods2[0].indexCount);
+				for (const Vertex& vertex : meshVertices) { firstOccluder.positions.push_back(vertex.pos); }
+				for (const Vertex& vertex : meshVertices2) { secondOccluder.positions.push_back(vertex.pos); }
+			}
 
-			createCommandBuffers();
 			//allocateDynamicBufferTransferSpace();
 			createUniformBuffers();
+			createClusterBuffers();
+			createLightBuffers();
+			bindRenderGraphBuffers();
 			createDescriptorPool();
 			createDescriptorSets();
+			createClusterDescriptorSets();
+			createHiZDescriptorSets();
 			createSyncObjects();
 		} 
 		catch (const std::runtime_error& e) {
@@ -84,11 +144,246 @@ namespace EngineCore {
 		return 0;
 	}
 
-	void VulkanRenderer::updateModel(int modelID,  glm::mat4 newModel)
+	void VulkanRenderer::setVertexFormat(VertexFormat newVertexFormat)
+	{
+		vertexFormat = newVertexFormat;
+	}
+
+	void VulkanRenderer::setLodErrorThreshold(float newThresholdPixels)
+	{
+		lodErrorThreshold = newThresholdPixels;
+	}
+
+	void VulkanRenderer::setClusterCulling(ClusterCulling newClusterCulling)
+	{
+		clusterCulling = newClusterCulling;
+	}
+
+	void VulkanRenderer::setOcclusionCulling(bool enabled)
+	{
+		occlusionCulling = enabled;
+	}
+
+	void VulkanRenderer::setSoftwareOcclusion(bool enabled)
+	{
+		softwareOcclusion = enabled;
+	}
+
+	void VulkanRenderer::setFrustumCulling(bool enabled)
+	{
+		frustumCulling = enabled;
+	}
+
+	void VulkanRenderer::setDepthPrePass(bool enabled)
+	{
+		depthPrePass = enabled;
+	}
+
+	void VulkanRenderer::setMsaaSamples(VkSampleCountFlagBits samples)
+	{
+		if (renderGraph == nullptr)
+		{
+			msaaSamples = samples;		// init checks it
+			return;
+		}
+		if (occlusionCulling || deferredShading)
+		{
+			return;
+		}
+
+		samples = chooseMsaaSamples(samples);
+		if (samples != msaaSamples)
+		{
+			msaaSamples = samples;
+			recreateRenderGraph();
+		}
+	}
+
+	VkSampleCountFlagBits VulkanRenderer::getMsaaSamples() const
+	{
+		return msaaSamples;
+	}
+
+	void VulkanRenderer::setDynamicRendering(bool enabled)
+	{
+		dynamicRendering = enabled;
+	}
+
+	void VulkanRenderer::setShadows(bool enabled)
+	{
+		shadows = enabled;
+	}
+
+	void VulkanRenderer::setShadowCascadeCount(uint32_t count)
+	{
+		shadowCascadeCount = std::min(std::max(count, 1u), MAX_SHADOW_CASCADES);
+	}
+
+	void VulkanRenderer::setShadowAtlasBudget(VkDeviceSize bytes)
+	{
+		shadowAtlasBudget = bytes;
+	}
+
+	void VulkanRenderer::setLightDirection(const glm::vec3& direction)
+	{
+		lightDirection = glm::normalize(direction);		// New cascade matrices: every static page goes stale
+	}
+
+	void VulkanRenderer::setClusteredLighting(bool enabled)
+	{
+		clusteredLighting = enabled;
+	}
+
+	void VulkanRenderer::setDeferredShading(bool enabled)
+	{
+		deferredShading = enabled;
+	}
+
+	void VulkanRenderer::setAsyncCompute(bool enabled)
+	{
+		asyncCompute = enabled;
+	}
+
+	void VulkanRenderer::setLights(const std::vector<Light>& newLights)
+	{
+		lights = newLights;		// Uploaded with the frame's uniform buffers
+	}
+
+	SceneGraph& VulkanRenderer::getSceneGraph()
+	{
+		return sceneGraph;
+	}
+
+	const std::vector<MeshHandle>& VulkanRenderer::getMeshes() const
+	{
+		return loadedMeshes;
+	}
+
+	void VulkanRenderer::destroyMesh(MeshHandle mesh)
+	{
+		Mesh* meshObject = meshes.get(mesh);
+		if (meshObject == nullptr) { return; }
+
+		// Submitted frames may still read its buffers (its meshlets stay in the shared cluster buffers, unreferenced)
+		meshObject->destroyBuffers(*deletionQueue, graphicsTimeline->getLastSignal());
+		meshes.destroy(mesh);
+		loadedMeshes.erase(std::remove(loadedMeshes.begin(), loadedMeshes.end(), mesh), loadedMeshes.end());
+	}
+
+	EntityHandle VulkanRenderer::createModel(MeshHandle mesh)
+	{
+		Mesh* meshObject = meshes.get(mesh);
+		if (meshObject == nullptr)
+		{
+			throw std::runtime_error("Mesh handle is stale or invalid!");
+		}
+
+		// Cluster buffers are sized once init has created its models
+		if (clusterDrawCapacity > 0 && (drawCount >= clusterDrawCapacity
+			|| getClusterOutputIndicesUsed() + meshObject->getMaxLodTriangleCount() * 3 > clusterOutputIndexCount
+			|| (occlusionCulling && getMeshletVisibilityUsed() + meshObject->getMaxLodMeshletCount() > meshletVisibilityCapacity)))
+		{
+			throw std::runtime_error("Model doesn't fit in the cluster culling buffers!");
+		}
+
+		// Transform driven by a scene graph node, world box kept in the BVH
+		EntityHandle entity = entities.createEntity(RENDERABLE_COMPONENTS | COMPONENT_SCENE_NODE | COMPONENT_SPATIAL);
+		entities.getBounds(entity) = meshObject->getBoundingSphere();
+		entities.getMesh(entity) = mesh;
+		entities.getFlags(entity) = ENTITY_FLAG_OCCLUDER;
+		entities.getSceneNode(entity) = sceneGraph.createNode();
+
+		uint32_t proxy = bvh.createProxy(meshObject->getBoundingBox(), 0);
+		entities.getSpatialProxy(entity) = proxy;
+		proxyModels.resize(std::max(static_cast<uint32_t>(proxyModels.size()), proxy + 1));
+		proxyModels[proxy] = entity;
+		models.push_back(entity);
+		drawCount++;
+
+		return entity;
+	}
+
+	void VulkanRenderer::destroyModel(EntityHandle model)
+	{
+		if (!entities.isAlive(model)) { return; }
+
+		sceneGraph.destroyNode(entities.getSceneNode(model));
+		bvh.destroyProxy(entities.getSpatialProxy(model));
+		entities.destroyEntity(model);
+		models.erase(std::find(models.begin(), models.end(), model));
+		drawCount--;
+	}
+
+	const std::vector<EntityHandle>& VulkanRenderer::getModels() const
+	{
+		return models;
+	}
+
+	uint32_t VulkanRenderer::getModelNode(EntityHandle model)
+	{
+		return entities.getSceneNode(model);
+	}
+
+	void VulkanRenderer::updateModel(EntityHandle model, glm::mat4 newModel)
+	{
+		sceneGraph.setLocalMatrix(entities.getSceneNode(model), newModel);
+	}
+
+	void VulkanRenderer::setModelStatic(EntityHandle model, bool isStatic)
+	{
+		uint32_t& flags = entities.getFlags(model);
+		flags = isStatic ? flags | ENTITY_FLAG_STATIC : flags & ~ENTITY_FLAG_STATIC;
+	}
+
+	const RenderGraphStats& VulkanRenderer::getRenderGraphStats() const
+	{
+		return renderGraph->getStats();
+	}
+
+	uint32_t VulkanRenderer::getShadowResolution() const
+	{
+		return shadowResolution;
+	}
+
+	VkDeviceSize VulkanRenderer::getShadowMemoryBytes() const
+	{
+		return shadowMemoryBytes;
+	}
+
+	const RenderGraphStats& VulkanRenderer::getDeferredSubpassStats() const
+	{
+		return deferredSubpassStats;
+	}
+
+	const RenderGraphStats& VulkanRenderer::getDeferredSeparatePassStats() const
 	{
-		if (modelID >= meshList.size()) return;
+		return deferredSeparatePassStats;
+	}
+
+	const RenderQueueStats& VulkanRenderer::getRenderQueueStats() const
+	{
+		return renderQueueStats;
+	}
+
+	const std::vector<GpuTiming>& VulkanRenderer::getGpuTimings() const
+	{
+		return gpuTimings;
+	}
+
+	uint64_t VulkanRenderer::getSubmittedFrameValue() const
+	{
+		return graphicsTimeline->getLastSignal();
+	}
+
+	uint64_t VulkanRenderer::getCompletedFrameValue()
+	{
+		return graphicsTimeline->getCompletedValue();
+	}
 
-		meshList[modelID].setModel(newModel);
+	EntityHandle VulkanRenderer::pickModel(const glm::vec3& origin, const glm::vec3& direction, float& hitDistance)
+	{
+		uint32_t proxy = bvh.raycast(origin, direction, std::numeric_limits<float>::max(), hitDistance);
+		return proxy == Bvh::INVALID_PROXY ? INVALID_ENTITY : proxyModels[proxy];
 	}
 
 	void VulkanRenderer::draw()
@@ -98,33 +393,121 @@ namespace EngineCore {
 		// 3. Return the image to the swap chain for presentation
 
 
-		vkWaitForFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max()); // Wait until the fence is signaled // CPU-GPU sync
-		vkResetFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame]); // Reset the fence to unsignaled state for next frame
+		// Frame slot's semaphores are free again once its last frame finished // CPU-GPU sync
+		graphicsTimeline->wait(frameTimelineValues[currentFrame]);
+		deletionQueue->flush(graphicsTimeline->getCompletedValue());	// Resources no frame in flight uses any more
+
+		// Command buffers the slot's last frame recorded, one reset per pool. Its compute submission is done as well: the
+		// join command buffer waited for it before the frame's value was signalled
+		graphicsFramePools[currentFrame]->reset();
+		if (!computeFramePools.empty())
+		{
+			computeFramePools[currentFrame]->reset();
+		}
 
 		// - Get image from swap chain --------------------------------------------------------------------------
 		uint32_t imageIndex; // Index of swap chain image to draw to and signal the semaphore when ready
 		vkAcquireNextImageKHR(mainDevice.logicalDevice, swapchain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
+		// The image's per image buffers and descriptor sets are rewritten below: its last frame (possibly from another slot)
+		// has to be done with them. Usually long finished, the swapchain has more images than frames in flight
+		graphicsTimeline->wait(imageTimelineValues[imageIndex]);
+
 		// - Update uniform buffer ------------------------------------------------------------------------------
-		recordCommand(imageIndex); // Record command buffer for this image
+		updateTransforms();
+		updateObjectBuffer(imageIndex);		// Before recording: growing it rewrites the image's descriptor set
+		if (shadows)
+		{
+			updateShadows();	// Cascades, stale static pages and casters the shadow passes record
+		}
+		recordCommand(imageIndex); // Record the frame's command buffers for this image
 		updateUniformBuffers(imageIndex);
+		if (clusterCulling != CLUSTER_CULLING_OFF)
+		{
+			updateClusterBuffers(imageIndex);	// Uses the LODs recordCommand selected
+		}
 
 		// - Execute command buffer -----------------------------------------------------------------------------
+		// Async compute first, the graphics queue runs alongside it until the join command buffer waits for its value
+		bool async = renderGraph->hasAsyncCompute();
+		uint64_t computeValue = 0;
+		VkSemaphore computeSemaphore = async ? computeTimeline->getSemaphore() : VK_NULL_HANDLE;
+		if (async)
+		{
+			computeValue = computeTimeline->signalNext();
+
+			// The image's last frame released its async buffers back to the compute family at its end: the acquire at the
+			// start of this submission has to come after it (long reached, the CPU waited for it above)
+			uint64_t releaseValue = imageTimelineValues[imageIndex];
+			VkSemaphore releaseSemaphore = graphicsTimeline->getSemaphore();
+			VkPipelineStageFlags releaseWaitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			VkTimelineSemaphoreSubmitInfo computeTimelineInfo = {};
+			computeTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			computeTimelineInfo.waitSemaphoreValueCount = 1;
+			computeTimelineInfo.pWaitSemaphoreValues = &releaseValue;
+			computeTimelineInfo.signalSemaphoreValueCount = 1;
+			computeTimelineInfo.pSignalSemaphoreValues = &computeValue;
+
+			VkSubmitInfo computeSubmitInfo = {};
+			computeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			computeSubmitInfo.pNext = &computeTimelineInfo;
+			computeSubmitInfo.waitSemaphoreCount = 1;
+			computeSubmitInfo.pWaitSemaphores = &releaseSemaphore;
+			computeSubmitInfo.pWaitDstStageMask = &releaseWaitStages;
+			computeSubmitInfo.commandBufferCount = 1;
+			computeSubmitInfo.pCommandBuffers = &computeCommandBuffer;
+			computeSubmitInfo.signalSemaphoreCount = 1;
+			computeSubmitInfo.pSignalSemaphores = &computeSemaphore;
+			if (vkQueueSubmit(computeQueue, 1, &computeSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit compute command buffer!");
+			}
+		}
+
+		// The frame's last graphics submission signals the frame's value next to the binary semaphore presentation waits on
+		uint64_t frameValue = graphicsTimeline->signalNext();
+		VkSemaphore frameSignalSemaphores[] = { renderFinishedSemaphore[currentFrame], graphicsTimeline->getSemaphore() };
+		uint64_t frameSignalValues[] = { 0, frameValue };		// Binary semaphores ignore their value
+		VkTimelineSemaphoreSubmitInfo frameTimelineInfo = {};
+		frameTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		frameTimelineInfo.signalSemaphoreValueCount = 2;
+		frameTimelineInfo.pSignalSemaphoreValues = frameSignalValues;
+
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &frameTimelineInfo;									// Timeline values of the semaphores
 		submitInfo.waitSemaphoreCount = 1;										// Number of semaphores to wait on before execution begins
 		submitInfo.pWaitSemaphores = &imageAvailableSemaphore[currentFrame];					// Semaphores to wait on before execution begins
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }; // Stages to check for before execution begins
 		submitInfo.pWaitDstStageMask = waitStages;								// Stages to check for before execution begins
 		submitInfo.commandBufferCount = 1;										// Number of command buffers to submit for execution
-		submitInfo.pCommandBuffers = &commandBuffers[imageIndex];				// Command buffers to submit for execution
-		submitInfo.signalSemaphoreCount = 1;										// Number of semaphores to signal once command buffer finishes execution
-		submitInfo.pSignalSemaphores = &renderFinishedSemaphore[currentFrame];					// Semaphores to signal once command buffer finishes execution
-		
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, drawFences[currentFrame]) != VK_SUCCESS) // Fence to signal when command buffer finishes execution
+		submitInfo.pCommandBuffers = &frameCommandBuffer;						// Command buffers to submit for execution
+		submitInfo.signalSemaphoreCount = 2;										// Number of semaphores to signal once command buffer finishes execution
+		submitInfo.pSignalSemaphores = frameSignalSemaphores;					// Semaphores to signal once command buffer finishes execution
+
+		// Async: the first command buffer signals nothing, the join command buffer waits for compute's value and finishes the frame
+		VkSubmitInfo submitInfos[2] = { submitInfo, submitInfo };
+		VkPipelineStageFlags asyncWaitStages = renderGraph->getAsyncWaitStages();
+		VkTimelineSemaphoreSubmitInfo joinTimelineInfo = frameTimelineInfo;
+		if (async)
+		{
+			submitInfos[0].pNext = nullptr;
+			submitInfos[0].signalSemaphoreCount = 0;
+			joinTimelineInfo.waitSemaphoreValueCount = 1;
+			joinTimelineInfo.pWaitSemaphoreValues = &computeValue;
+			submitInfos[1].pNext = &joinTimelineInfo;
+			submitInfos[1].pWaitSemaphores = &computeSemaphore;
+			submitInfos[1].pWaitDstStageMask = &asyncWaitStages;
+			submitInfos[1].pCommandBuffers = &joinCommandBuffer;
+		}
+
+		if (vkQueueSubmit(graphicsQueue, async ? 2 : 1, submitInfos, VK_NULL_HANDLE) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to submit draw command buffer!");
 		}
+		frameTimelineValues[currentFrame] = frameValue;
+		imageTimelineValues[imageIndex] = frameValue;
 
 		// - Return the image to the swap chain for presentation -------------------------------------------------
 		VkPresentInfoKHR presentInfo = {};
@@ -152,40 +535,129 @@ namespace EngineCore {
 
 		//_aligned_free(modelTransferSpace); // Free model transfer space C style function
 
-		vkDestroyImageView(mainDevice.logicalDevice, DepthBufferImageView, nullptr);
-		vkDestroyImage(mainDevice.logicalDevice, DepthBufferImage, nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, DepthBufferImageMemory, nullptr);
+		occlusionCuller.reset();
+		jobSystem.reset();	// Joins the worker threads
+
+		renderGraph->destroy();
+		gpuProfiler->destroy();
+		if (asyncProfiler)
+		{
+			asyncProfiler->destroy();
+		}
+
+		if (occlusionCulling)
+		{
+			vkDestroySampler(mainDevice.logicalDevice, hiZSampler, nullptr);
+			for (VkImageView mipView : hiZMipViews)
+			{
+				vkDestroyImageView(mainDevice.logicalDevice, mipView, nullptr);
+			}
+			vkDestroyImageView(mainDevice.logicalDevice, hiZImageView, nullptr);
+			vkDestroyImage(mainDevice.logicalDevice, hiZImage, nullptr);
+			vkFreeMemory(mainDevice.logicalDevice, hiZImageMemory, nullptr);
+
+			vkDestroyBuffer(mainDevice.logicalDevice, meshletVisibilityBuffer, nullptr);
+			vkFreeMemory(mainDevice.logicalDevice, meshletVisibilityBufferMemory, nullptr);
+
+			vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, hiZSetLayout, nullptr);
+			vkDestroyPipeline(mainDevice.logicalDevice, hiZPipeline, nullptr);
+			vkDestroyPipelineLayout(mainDevice.logicalDevice, hiZPipelineLayout, nullptr);
+		}
+
+		if (shadows)
+		{
+			vkDestroySampler(mainDevice.logicalDevice, shadowSampler, nullptr);
+			destroyImageResource(shadowAtlas);
+			destroyImageResource(shadowCache);
+			for (BufferHandle buffer : shadowUniformBuffers)
+			{
+				destroyBufferResource(buffer);
+			}
+		}
+
+		if (clusteredLighting)
+		{
+			for (size_t i = 0; i < swapChainImages.size(); i++)
+			{
+				destroyBufferResource(lightGridBuffers[i]);
+				destroyBufferResource(lightBuffers[i]);
+				destroyBufferResource(clusterLightBuffers[i]);
+			}
+			vkDestroyPipeline(mainDevice.logicalDevice, lightBinningPipeline, nullptr);
+			vkDestroyPipelineLayout(mainDevice.logicalDevice, lightBinningPipelineLayout, nullptr);
+		}
 
 		vkDestroyDescriptorPool(mainDevice.logicalDevice, descriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, descriptorSetLayout, nullptr);
+		if (deferredShading)
+		{
+			vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, gBufferSetLayout, nullptr);
+		}
+
+		if (clusterCulling != CLUSTER_CULLING_OFF)
+		{
+			for (size_t i = 0; i < swapChainImages.size(); i++)
+			{
+				vkDestroyBuffer(mainDevice.logicalDevice, cullDataBuffers[i], nullptr);
+				vkFreeMemory(mainDevice.logicalDevice, cullDataBuffersMemory[i], nullptr);
+				vkDestroyBuffer(mainDevice.logicalDevice, clusterDrawBuffers[i], nullptr);
+				vkFreeMemory(mainDevice.logicalDevice, clusterDrawBuffersMemory[i], nullptr);
+				if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+				{
+					vkDestroyBuffer(mainDevice.logicalDevice, clusterIndirectBuffers[i], nullptr);
+					vkFreeMemory(mainDevice.logicalDevice, clusterIndirectBuffersMemory[i], nullptr);
+					vkDestroyBuffer(mainDevice.logicalDevice, clusterIndexBuffers[i], nullptr);
+					vkFreeMemory(mainDevice.logicalDevice, clusterIndexBuffersMemory[i], nullptr);
+				}
+			}
+			vkDestroyBuffer(mainDevice.logicalDevice, meshletBuffer, nullptr);
+			vkFreeMemory(mainDevice.logicalDevice, meshletBufferMemory, nullptr);
+			vkDestroyBuffer(mainDevice.logicalDevice, meshletVertexBuffer, nullptr);
+			vkFreeMemory(mainDevice.logicalDevice, meshletVertexBufferMemory, nullptr);
+			vkDestroyBuffer(mainDevice.logicalDevice, meshletTriangleBuffer, nullptr);
+			vkFreeMemory(mainDevice.logicalDevice, meshletTriangleBufferMemory, nullptr);
+
+			vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, clusterSetLayout, nullptr);
+			vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, meshVertexSetLayout, nullptr);
+			vkDestroyPipeline(mainDevice.logicalDevice, clusterCullPipeline, nullptr);
+			vkDestroyPipelineLayout(mainDevice.logicalDevice, clusterCullPipelineLayout, nullptr);
+		}
 
 		for (size_t i = 0; i < swapChainImages.size(); i++)
 		{
-			vkDestroyBuffer(mainDevice.logicalDevice, vpUniformBuffers[i], nullptr);
-			vkFreeMemory(mainDevice.logicalDevice, vpUniformBuffersMemory[i], nullptr);
+			destroyBufferResource(vpUniformBuffers[i]);
+			destroyBufferResource(objectBuffers[i]);
 			/*vkDestroyBuffer(mainDevice.logicalDevice, modelDUniformBuffers[i], nullptr);
 			vkFreeMemory(mainDevice.logicalDevice, modelDUniformBuffersMemory[i], nullptr);*/
 		}
 
-		for (size_t i = 0; i < meshList.size(); i++)
+		meshes.forEach([](MeshHandle, Mesh& mesh)
 		{
-			meshList[i].destroyBuffers();
-		}
+			mesh.destroyBuffers();
+		});
+		meshes.clear();
 
 		for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
 		{
 			vkDestroySemaphore(mainDevice.logicalDevice, renderFinishedSemaphore[i], nullptr);
 			vkDestroySemaphore(mainDevice.logicalDevice, imageAvailableSemaphore[i], nullptr);
-			vkDestroyFence(mainDevice.logicalDevice, drawFences[i], nullptr);
+		}
+		deletionQueue->flushAll();		// Device is idle
+		graphicsTimeline->destroy();
+		if (computeTimeline)
+		{
+			computeTimeline->destroy();
 		}
 		vkDestroyCommandPool(mainDevice.logicalDevice, graphicsCommandPool, nullptr);
-		for (auto frameBuffer : swapChainFramebuffers)
+		for (auto& framePool : graphicsFramePools)
 		{
-			vkDestroyFramebuffer(mainDevice.logicalDevice, frameBuffer, nullptr);
+			framePool->destroy();
 		}
-		vkDestroyPipeline(mainDevice.logicalDevice, graphicsPipeline, nullptr); 
-		vkDestroyPipelineLayout(mainDevice.logicalDevice, pipelineLayout, nullptr);
-		vkDestroyRenderPass(mainDevice.logicalDevice, renderPass, nullptr);
+		for (auto& framePool : computeFramePools)
+		{
+			framePool->destroy();
+		}
+		destroyGraphicsPipelines();
 		for (auto image : swapChainImages)
 		{
 			vkDestroyImageView(mainDevice.logicalDevice, image.imageView, nullptr);
@@ -206,7 +678,7 @@ namespace EngineCore {
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_2;			// 1.2 for timeline semaphores and SPIR-V 1.4 (mesh shaders)
 
 		// Creation information Vulkan instance
 		VkInstanceCreateInfo createInfo{};
@@ -254,6 +726,15 @@ namespace EngineCore {
 		// vector for queue creation information and set for family indices
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily };
+		if (asyncCompute && indices.computeFamily < 0)
+		{
+			std::cout << "No compute only queue family, running async compute passes on the graphics queue." << std::endl;
+			asyncCompute = false;
+		}
+		if (asyncCompute)
+		{
+			queueFamilyIndices.insert(indices.computeFamily);
+		}
 
 		// Queue that the logical device needs to create and the info to do so (Only one for now will add more later!)
 		for (int queueFamilyIndex : queueFamilyIndices) 
@@ -273,8 +754,58 @@ namespace EngineCore {
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());						// Number of entries in the queue create info array
 		deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();			// Pointer to queue create info array
-		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(queueCreateInfos.size());						// number of enabled logical device extensions
-		deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data()	;				// Pointer to array of enabled logical device extensions
+
+		// Required extensions plus optional ones the chosen settings can use
+		std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+
+		// Timeline semaphores are required (checked by checkDeviceSuitable)
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+		deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
+
+		// Mesh shading (task + mesh stages) is optional, fall back to compute cluster culling without it
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+		if (clusterCulling == CLUSTER_CULLING_MESH_SHADER)
+		{
+			meshShaderSupported = checkMeshShaderSupport(mainDevice.physicalDevice);
+			if (meshShaderSupported)
+			{
+				enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+				meshShaderFeatures.taskShader = VK_TRUE;
+				meshShaderFeatures.meshShader = VK_TRUE;
+				meshShaderFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+				deviceCreateInfo.pNext = &meshShaderFeatures;
+			}
+			else
+			{
+				std::cout << "VK_EXT_mesh_shader not supported, using compute cluster culling." << std::endl;
+				clusterCulling = CLUSTER_CULLING_COMPUTE;
+			}
+		}
+
+		// Dynamic rendering is optional too, render pass objects work everywhere
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		if (dynamicRendering)
+		{
+			dynamicRendering = checkDynamicRenderingSupport(mainDevice.physicalDevice);
+			if (dynamicRendering)
+			{
+				enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+				dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+				dynamicRenderingFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+				deviceCreateInfo.pNext = &dynamicRenderingFeatures;
+			}
+			else
+			{
+				std::cout << "VK_KHR_dynamic_rendering not supported, using render passes." << std::endl;
+			}
+		}
+
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());						// number of enabled logical device extensions
+		deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();				// Pointer to array of enabled logical device extensions
 		
 		// Physical device features to be used by the logical device
 		VkPhysicalDeviceFeatures deviceFeatures{};
@@ -291,6 +822,21 @@ namespace EngineCore {
 		// From given logical device, of given Queue Family, of given Queue Index (0 since only one queue)
 		vkGetDeviceQueue(mainDevice.logicalDevice, indices.graphicsFamily, 0, &graphicsQueue);
 		vkGetDeviceQueue(mainDevice.logicalDevice, indices.presentationFamily, 0, &presentationQueue);
+		if (asyncCompute)
+		{
+			vkGetDeviceQueue(mainDevice.logicalDevice, indices.computeFamily, 0, &computeQueue);
+		}
+
+		// Extension commands aren't exported by the loader, fetch them from the device
+		if (meshShaderSupported)
+		{
+			cmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(mainDevice.logicalDevice, "vkCmdDrawMeshTasksEXT");
+		}
+		if (dynamicRendering)
+		{
+			cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(mainDevice.logicalDevice, "vkCmdBeginRenderingKHR");
+			cmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(mainDevice.logicalDevice, "vkCmdEndRenderingKHR");
+		}
 	}
 
     void VulkanRenderer::createSurface()
@@ -393,164 +939,530 @@ namespace EngineCore {
 		}
 	}
 
-	void VulkanRenderer::createRenderPass()
+	void VulkanRenderer::createRenderGraph()
 	{
-		// ATTACHMENTS ------------------------------------------------------------------------------------------------
-		// Colour attachment of render pass
-		VkAttachmentDescription colourAttachment = {};
-		colourAttachment.format = swapChainImageFormat;						// Format of attachment (should match swapchain)
-		colourAttachment.samples = VK_SAMPLE_COUNT_1_BIT;					// Number of samples to write for multisampling (1 = no multisampling)
-		colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;				// What to do with attachment before rendering (clear it)
-		colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;				// What to do with attachment after rendering (store it)
-		colourAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;	// What to do with stencil data before rendering (not using stencil, so don't care)
-		colourAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;	// What to do with stencil data after rendering (not using stencil, so don't care)
-		
-		// Frambuffer data will be stored as an image, but images can be of different data layouts
-		colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Layout of attachment before render pass (undefined)
-		// SubpassLayout
-		colourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;		// Layout of attachment after render pass (ready for presentation)
-
-		// Depth attachment of render pass
-		VkAttachmentDescription depthAttachment = {};
-		depthAttachment.format = chooseSupportedFormat(
-			{ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);				// Format of attachment (should match swapchain)
-		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;					// Number of samples to write for multisampling (1 = no multisampling)
-		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;				// What to do with attachment before rendering (clear it
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;			// What to do with attachment after rendering (dont care, not reading back)
-		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;	// What to do with stencil data before rendering (not using stencil, so don't care)
-		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;	// What to do with stencil data after rendering (not using stencil, so don't care)
-		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Layout of attachment before render pass (undefined)
-		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL; // Layout of attachment after render pass (depth/stencil optimal)
-
-		
-		// REFERENCES ------------------------------------------------------------------------------------------------
-		// Attachment reference uses an attachment index that refers to attachment index in the attachement list passed to renderPassCreateInfo
-		VkAttachmentReference colorAttachmentRef = {};						
-		colorAttachmentRef.attachment = 0;											// Index of attachment in array (which attachment to reference)
-		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;		// Layout to use during subpass (optimal for colour attachment)
-
-		// Depth attachment reference
-		VkAttachmentReference depthAttachmentRef = {};
-		depthAttachmentRef.attachment = 1;											// Index of attachment in array (which attachment to reference)
-		depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL; // Layout to use during subpass (optimal for depth/stencil attachment)
-
-
-		// Information about a particular subpass the render pass will use
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;			// Type of subpass (graphics or compute)
-		subpass.colorAttachmentCount = 1;										// Number of color attachments
-		subpass.pColorAttachments = &colorAttachmentRef;						// List of color attachments references
-		subpass.pDepthStencilAttachment = &depthAttachmentRef;				// Depth attachment reference
-
-
-		// Need to determine when layout transitions occur using (Subpass dependencies) --------------------------------------
-		std::array<VkSubpassDependency, 2> subpassDependencies;
-
-		// --> Transition from (VK_IMAGE_LAYOUT_UNDEFINED) -> (VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-		// -> Transition must happen after...
-		subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;							// subpass before(outside) render pass
-		subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;			// Pipeline stage to wait on
-		subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;					// Type of memory access to wait on
-
-		// -> But must happen before...
-		subpassDependencies[0].dstSubpass = 0;												// Our subpass destination
-		subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; // Pipeline stage to wait on
-		subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; // Type of memory access to wait on
-		subpassDependencies[1].dependencyFlags = 0;				// Framebuffer-local dependency
-
-		// --> Transition from (VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) -> (VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
-		// -> Transition must happen after...
-		subpassDependencies[1].srcSubpass = 0;												// Our subpass before
-		subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; // Pipeline stage to wait on
-		subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; // Type of memory access to wait on
-
-		// -> But must happen before...
-		subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;							// subpass after(outside) render pass
-		subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;			// Pipeline stage to wait on
-		subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;					// Type of memory access to wait on
-		subpassDependencies[1].dependencyFlags = 0;
-
-
-		std::array<VkAttachmentDescription, 2> renderpassAttachments = { colourAttachment, depthAttachment };
-
-		// Create render pass ------------------------------------------------------------------------------------------------
-		VkRenderPassCreateInfo renderPassCreateInfo = {};
-		renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		// Attachments describe the number of color and depth buffers there are, and how to handle them
-		renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(renderpassAttachments.size());// Number of attachments
-		renderPassCreateInfo.pAttachments = renderpassAttachments.data();	// Pointer to array of attachments
-		renderPassCreateInfo.subpassCount = 1;								// Number of subpasses
-		renderPassCreateInfo.pSubpasses = &subpass;							// Pointer to array of subpasses
-		renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size()); // Number of subpass dependencies
-		renderPassCreateInfo.pDependencies = subpassDependencies.data();		// Pointer to array of subpass dependencies
-
-		VkResult result = vkCreateRenderPass(mainDevice.logicalDevice, &renderPassCreateInfo, nullptr, &renderPass);
-		if (result != VK_SUCCESS)
+		renderGraph = std::make_unique<RenderGraph>(mainDevice.physicalDevice, mainDevice.logicalDevice);
+		if (dynamicRendering)
 		{
-			throw std::runtime_error("Failed to create a Render Pass!");
+			renderGraph->setDynamicRendering(cmdBeginRendering, cmdEndRendering);	// No render pass or framebuffer objects
 		}
-	}
-
-	void VulkanRenderer::createDescriptorSetlayout()
-	{
-		// UboViewProjection Binding info
-		VkDescriptorSetLayoutBinding vpLayoutBinding = {};
-		vpLayoutBinding.binding = 0;											// Binding index in shader where data will be accessed
-		vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;		// Type of descriptor (uniform, image sampler, etc)
-		vpLayoutBinding.descriptorCount = 1;									// Number of descriptors for binding, can be more than 1 for arrays
-		vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;				// Shader stage that will access this binding
-		vpLayoutBinding.pImmutableSamplers = nullptr;							// For Texture: Used for image sampling, not used for UBOs
 
-		// Model Binding info
-		/*
-		VkDescriptorSetLayoutBinding modelLayoutBinding = {};
-		modelLayoutBinding.binding = 1;														// Binding index in shader where data will be accessed
-		modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;		// Type of descriptor (uniform, image sampler, etc)
-		modelLayoutBinding.descriptorCount = 1;												// Number of descriptors for binding, can be more than 1 for arrays
-		modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;							// Shader stage that will access this binding
-		modelLayoutBinding.pImmutableSamplers = nullptr;									// For Texture: Used for image sampling, not used for UBOs
-		*/
-		std::vector<VkDescriptorSetLayoutBinding> layoutBindings = { vpLayoutBinding };
-
-		// Create Descriptor set layout with given bindings
-		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
-		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());		// Number of bindings in layout
-		layoutCreateInfo.pBindings = layoutBindings.data();										// Pointer to array of bindings
+		// Buffers the async passes write are handed over to the graphics family
+		QueueFamilyIndices queueFamilies = getQueueFamilies(mainDevice.physicalDevice);
+		if (asyncCompute)
+		{
+			renderGraph->setAsyncCompute(queueFamilies.graphicsFamily, queueFamilies.computeFamily);
+		}
 
-		// Create Descriptor Set Layout
-		VkResult result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout);
-		if (result != VK_SUCCESS)
+		// Timestamps per command buffer (one per swapchain image), the async compute queue's in its own queries
+		gpuProfiler = std::make_unique<GpuProfiler>(mainDevice.physicalDevice, mainDevice.logicalDevice,
+			queueFamilies.graphicsFamily, static_cast<uint32_t>(swapChainImages.size()));
+		if (asyncCompute)
 		{
-			throw std::runtime_error("Failed to create Descriptor Set Layout!");
+			asyncProfiler = std::make_unique<GpuProfiler>(mainDevice.physicalDevice, mainDevice.logicalDevice,
+				queueFamilies.computeFamily, static_cast<uint32_t>(swapChainImages.size()), 32, "async compute");
 		}
-	}
+		renderGraph->setProfiler(gpuProfiler.get(), asyncProfiler.get());
+		renderGraph->setSecondaryCommandPool(graphicsCommandPool);
 
-	void VulkanRenderer::createPushConstantRange()
+		// Draw passes are replayed from secondary command buffers while the frame's draw list is what they recorded: matrices
+		// come from the object buffer, culled counts from the indirect buffer. Growing the object buffer rewrites the frame's
+		// descriptor set, which invalidates commands that bound it
+		auto drawCacheKey = [this](uint32_t frame)
+		{
+			uint64_t key = drawListHash;
+			VkBuffer objectBuffer = buffers.get(objectBuffers[frame])->buffer;
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&objectBuffer);
+			for (size_t b = 0; b < sizeof(VkBuffer); b++)
+			{
+				key = (key ^ bytes[b]) * 1099511628211ull;
+			}
+			return key;
+		};
+
+		// Passes only declare what they touch, the graph works out barriers, layouts, load/store ops and attachment memory
+		VkPipelineStageFlags cullStage = clusterCulling == CLUSTER_CULLING_MESH_SHADER ? VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		// - Resources
+		// Swapchain image: acquired in any layout (semaphore waited at colour output), handed to presentation
+		swapchainColour = renderGraph->importImage("swapchain", swapChainExtent, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		std::vector<VkImage> swapchainImages;
+		std::vector<VkImageView> swapchainViews;
+		for (const SwapchainImage& image : swapChainImages)
+		{
+			swapchainImages.push_back(image.image);
+			swapchainViews.push_back(image.imageView);
+		}
+		renderGraph->bindImage(swapchainColour, swapchainImages, swapchainViews);
+
+		// With MSAA the passes draw into multisampled images (transient, lazily allocated) and resolve into the swapchain
+		depthBuffer = renderGraph->createImage("depth", swapChainExtent, chooseDepthFormat(), VK_IMAGE_ASPECT_DEPTH_BIT, msaaSamples);
+		RenderGraph::Resource colourTarget = swapchainColour;
+		if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			colourTarget = renderGraph->createImage("msaa colour", swapChainExtent, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, msaaSamples);
+		}
+
+		// Cluster culling output, bound once createClusterBuffers made them (one per swapchain image)
+		if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+		{
+			clusterIndices = renderGraph->importBuffer("cluster indices");
+			clusterCommands = renderGraph->importBuffer("cluster draw commands");
+		}
+
+		// Visibility carries over to the next frame, the pyramid is rebuilt every frame
+		if (occlusionCulling)
+		{
+			meshletVisibility = renderGraph->importBuffer("meshlet visibility");
+			hiZPyramid = renderGraph->importImage("hi-z", hiZExtent, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+			renderGraph->bindImage(hiZPyramid, { hiZImage }, { hiZImageView });
+		}
+
+		// Shadow atlas is rebuilt every frame (first overwritten by the copy), the cache keeps its pages (created in TRANSFER_SRC)
+		if (shadows)
+		{
+			const GpuImage& atlas = *images.get(shadowAtlas);
+			const GpuImage& cache = *images.get(shadowCache);
+			shadowAtlasImage = renderGraph->importImage("shadow atlas", atlas.extent, atlas.format, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+			renderGraph->bindImage(shadowAtlasImage, { atlas.image }, { atlas.view });
+			shadowCacheImage = renderGraph->importImage("shadow cache", cache.extent, cache.format, VK_IMAGE_ASPECT_DEPTH_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			renderGraph->bindImage(shadowCacheImage, { cache.image }, { cache.view });
+		}
+
+		// Light lists are rebuilt every frame, bound once createLightBuffers made them (one per swapchain image)
+		if (clusteredLighting)
+		{
+			clusterLightLists = renderGraph->importBuffer("cluster lights");
+		}
+
+		// Deferred G-buffer: packed to 8 bytes a pixel plus depth, written and read within one render pass (lazily allocated)
+		if (deferredShading)
+		{
+			gBufferAlbedo = renderGraph->createImage("g-buffer albedo", swapChainExtent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+			gBufferNormal = renderGraph->createImage("g-buffer normal", swapChainExtent, VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_IMAGE_ASPECT_COLOR_BIT);
+		}
+
+		// - Passes
+		if (clusteredLighting)
+		{
+			uint32_t binningPass = renderGraph->addAsyncComputePass("light binning", [this](VkCommandBuffer commandBuffer, uint32_t frame)
+			{
+				recordLightBinning(commandBuffer, frame);
+			});
+			renderGraph->use(binningPass, clusterLightLists, RENDER_USAGE_STORAGE_WRITE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+
+		// Shadows: static casters into the stale cache pages, the cache copied into the atlas, dynamic casters on top
+		if (shadows)
+		{
+			// Loads the whole cache, clears and redraws only stale pages (nothing at all most frames)
+			shadowCachePass = renderGraph->addGraphicsPass("shadow cache", [this](VkCommandBuffer commandBuffer, uint32_t frame)
+			{
+				if (staleShadowPages != 0) { recordShadowCasters(commandBuffer, frame, true); }
+			});
+			renderGraph->setDepthAttachment(shadowCachePass, shadowCacheImage, VK_ATTACHMENT_LOAD_OP_LOAD);
+
+			uint32_t copyPass = renderGraph->addComputePass("shadow cache copy", [this](VkCommandBuffer commandBuffer, uint32_t)
+			{
+				const GpuImage& cache = *images.get(shadowCache);
+				VkImageCopy region = {};
+				region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+				region.dstSubresource = region.srcSubresource;
+				region.extent = { cache.extent.width, cache.extent.height, 1 };
+				vkCmdCopyImage(commandBuffer, cache.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					images.get(shadowAtlas)->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			});
+			renderGraph->use(copyPass, shadowCacheImage, RENDER_USAGE_TRANSFER_SRC, 0);
+			renderGraph->use(copyPass, shadowAtlasImage, RENDER_USAGE_TRANSFER_DST, 0);
+
+			uint32_t casterPass = renderGraph->addGraphicsPass("shadow casters", [this](VkCommandBuffer commandBuffer, uint32_t frame)
+			{
+				recordShadowCasters(commandBuffer, frame, false);
+			});
+			renderGraph->setDepthAttachment(casterPass, shadowAtlasImage, VK_ATTACHMENT_LOAD_OP_LOAD);
+		}
+
+		// Cull (compute) then draw; with occlusion culling a second cull + draw follows the Hi-Z build. The first cull may
+		// run on the async compute queue (not with occlusion culling: the late cull writes the visibility it reads)
+		auto addPhase = [&](CullPhase phase)
+		{
+			VkAttachmentLoadOp loadOp = phase == CULL_PHASE_LATE ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+			RenderUsage visibilityUsage = phase == CULL_PHASE_LATE ? RENDER_USAGE_STORAGE_WRITE : RENDER_USAGE_STORAGE_READ;	// Late phase records it
+
+			uint32_t cullPass = RenderGraph::INVALID;
+			if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+			{
+				auto record = [this, phase](VkCommandBuffer commandBuffer, uint32_t frame)
+				{
+					if (drawCount > 0) { recordClusterCull(commandBuffer, frame, phase); }
+				};
+				cullPass = phase == CULL_PHASE_LATE ? renderGraph->addComputePass("late cluster cull", record) :
+					renderGraph->addAsyncComputePass("cluster cull", record);
+				renderGraph->use(cullPass, clusterIndices, RENDER_USAGE_STORAGE_WRITE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+				renderGraph->use(cullPass, clusterCommands, RENDER_USAGE_STORAGE_WRITE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			}
+
+			// Depth pre-pass (vertex pipelines only): the graph keeps it so the toggle needs no recompile, disabled it just clears
+			VkAttachmentLoadOp depthLoadOp = loadOp;
+			if (phase != CULL_PHASE_LATE && clusterCulling != CLUSTER_CULLING_MESH_SHADER)
+			{
+				prePass = renderGraph->addGraphicsPass("depth pre-pass", [this, phase](VkCommandBuffer commandBuffer, uint32_t frame)
+				{
+					if (depthPrePass) { recordMeshDraws(commandBuffer, frame, phase, true); }
+				});
+				renderGraph->setDepthAttachment(prePass, depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+				renderGraph->setPassCache(prePass, drawCacheKey);
+				if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+				{
+					renderGraph->use(prePass, clusterIndices, RENDER_USAGE_INDEX_BUFFER, 0);
+					renderGraph->use(prePass, clusterCommands, RENDER_USAGE_INDIRECT_BUFFER, 0);
+				}
+				depthLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			}
+
+			const char* drawPassName = deferredShading ? "g-buffer" : phase == CULL_PHASE_LATE ? "late forward" : "forward";
+			uint32_t drawPass = renderGraph->addGraphicsPass(drawPassName, [this, phase](VkCommandBuffer commandBuffer, uint32_t frame)
+			{
+				recordMeshDraws(commandBuffer, frame, phase, false);
+			});
+			if (!deferredShading)
+			{
+				renderGraph->setPassCache(drawPass, drawCacheKey);	// The G-buffer pass is followed by the lighting subpass
+			}
+			if (deferredShading)
+			{
+				renderGraph->addColorAttachment(drawPass, gBufferAlbedo, VK_ATTACHMENT_LOAD_OP_CLEAR);
+				renderGraph->addColorAttachment(drawPass, gBufferNormal, VK_ATTACHMENT_LOAD_OP_CLEAR);
+			}
+			else
+			{
+				renderGraph->addColorAttachment(drawPass, colourTarget, loadOp, { 0.6f, 0.65f, 0.4f, 1.0f });
+			}
+			renderGraph->setDepthAttachment(drawPass, depthBuffer, depthLoadOp);
+			if (colourTarget != swapchainColour)
+			{
+				renderGraph->addResolveAttachment(drawPass, colourTarget, swapchainColour);
+			}
+			if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+			{
+				renderGraph->use(drawPass, clusterIndices, RENDER_USAGE_INDEX_BUFFER, 0);
+				renderGraph->use(drawPass, clusterCommands, RENDER_USAGE_INDIRECT_BUFFER, 0);
+			}
+
+			// Deferred: the lighting subpass shades from the G-buffer, left in tile memory between the two
+			uint32_t shadingPass = drawPass;
+			if (deferredShading)
+			{
+				lightingPass = renderGraph->addSubpass("deferred lighting", [this](VkCommandBuffer commandBuffer, uint32_t frame)
+				{
+					recordDeferredLighting(commandBuffer, frame);
+				});
+				renderGraph->addColorAttachment(lightingPass, swapchainColour, VK_ATTACHMENT_LOAD_OP_CLEAR, { 0.6f, 0.65f, 0.4f, 1.0f });
+				renderGraph->addInputAttachment(lightingPass, gBufferAlbedo);
+				renderGraph->addInputAttachment(lightingPass, gBufferNormal);
+				renderGraph->addInputAttachment(lightingPass, depthBuffer);
+				shadingPass = lightingPass;
+			}
+			if (shadows)
+			{
+				renderGraph->use(shadingPass, shadowAtlasImage, RENDER_USAGE_SAMPLED, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			}
+			if (clusteredLighting)
+			{
+				renderGraph->use(shadingPass, clusterLightLists, RENDER_USAGE_STORAGE_READ, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			}
+
+			// Whichever pass culls (compute or task shader) reads the visibility, and the pyramid in the late phase
+			uint32_t cullingPass = cullPass != RenderGraph::INVALID ? cullPass : drawPass;
+			if (occlusionCulling)
+			{
+				renderGraph->use(cullingPass, meshletVisibility, visibilityUsage, cullStage);
+				if (phase == CULL_PHASE_LATE)
+				{
+					renderGraph->use(cullingPass, hiZPyramid, RENDER_USAGE_SAMPLED, cullStage);
+				}
+			}
+			return drawPass;
+		};
+
+		forwardPass = addPhase(occlusionCulling ? CULL_PHASE_EARLY : CULL_PHASE_ALL);
+		if (occlusionCulling)
+		{
+			uint32_t hiZPass = renderGraph->addComputePass("hi-z build", [this](VkCommandBuffer commandBuffer, uint32_t)
+			{
+				recordHiZBuild(commandBuffer);
+			});
+			renderGraph->use(hiZPass, depthBuffer, RENDER_USAGE_SAMPLED, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			renderGraph->use(hiZPass, hiZPyramid, RENDER_USAGE_STORAGE_WRITE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+			addPhase(CULL_PHASE_LATE);
+		}
+
+		renderGraph->compile();
+
+		// What the lighting subpass saves over a lighting render pass of its own, measured by compiling both
+		if (deferredShading)
+		{
+			deferredSubpassStats = compileDeferredComparison(true);
+			deferredSeparatePassStats = compileDeferredComparison(false);
+		}
+	}
+
+	RenderGraphStats VulkanRenderer::compileDeferredComparison(bool lightingSubpass)
+	{
+		// The frame's G-buffer and lighting passes with nothing around them (never executed). As separate render passes the
+		// G-buffer outlives the first one: it has to be stored, loaded again and backed by real memory
+		RenderGraph graph(mainDevice.physicalDevice, mainDevice.logicalDevice);
+		RenderGraph::Resource colour = graph.importImage("swapchain", swapChainExtent, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		graph.bindImage(colour, { swapChainImages[0].image }, { swapChainImages[0].imageView });
+		RenderGraph::Resource depth = graph.createImage("depth", swapChainExtent, chooseDepthFormat(), VK_IMAGE_ASPECT_DEPTH_BIT);
+		RenderGraph::Resource albedo = graph.createImage("g-buffer albedo", swapChainExtent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+		RenderGraph::Resource normal = graph.createImage("g-buffer normal", swapChainExtent, VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		auto recordNothing = [](VkCommandBuffer, uint32_t) {};
+		uint32_t gBufferPass = graph.addGraphicsPass("g-buffer", recordNothing);
+		graph.addColorAttachment(gBufferPass, albedo, VK_ATTACHMENT_LOAD_OP_CLEAR);
+		graph.addColorAttachment(gBufferPass, normal, VK_ATTACHMENT_LOAD_OP_CLEAR);
+		graph.setDepthAttachment(gBufferPass, depth, VK_ATTACHMENT_LOAD_OP_CLEAR);
+
+		uint32_t shadingPass = lightingSubpass ? graph.addSubpass("deferred lighting", recordNothing) : graph.addGraphicsPass("deferred lighting", recordNothing);
+		graph.addColorAttachment(shadingPass, colour, VK_ATTACHMENT_LOAD_OP_CLEAR);
+		graph.addInputAttachment(shadingPass, albedo);
+		graph.addInputAttachment(shadingPass, normal);
+		graph.addInputAttachment(shadingPass, depth);
+
+		graph.compile();
+		RenderGraphStats stats = graph.getStats();
+		graph.destroy();
+		return stats;
+	}
+
+	void VulkanRenderer::bindRenderGraphBuffers()
+	{
+		if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+		{
+			renderGraph->bindBuffer(clusterIndices, clusterIndexBuffers);
+			renderGraph->bindBuffer(clusterCommands, clusterIndirectBuffers);
+		}
+		if (occlusionCulling)
+		{
+			renderGraph->bindBuffer(meshletVisibility, { meshletVisibilityBuffer });
+		}
+		if (clusteredLighting)
+		{
+			std::vector<VkBuffer> lightListBuffers;
+			for (BufferHandle buffer : clusterLightBuffers)
+			{
+				lightListBuffers.push_back(buffers.get(buffer)->buffer);
+			}
+			renderGraph->bindBuffer(clusterLightLists, lightListBuffers);
+		}
+	}
+
+	void VulkanRenderer::recreateRenderGraph()
+	{
+		// Pipelines depend on the attachments (sample count, render passes), everything else stays
+		vkDeviceWaitIdle(mainDevice.logicalDevice);
+		destroyGraphicsPipelines();
+		renderGraph->destroy();
+		gpuProfiler->destroy();
+		if (asyncProfiler)
+		{
+			asyncProfiler->destroy();
+		}
+
+		createRenderGraph();
+		createGraphicsPipeline();
+		bindRenderGraphBuffers();
+	}
+
+	void VulkanRenderer::createDescriptorSetlayout()
+	{
+		// UboViewProjection Binding info
+		VkDescriptorSetLayoutBinding vpLayoutBinding = {};
+		vpLayoutBinding.binding = 0;											// Binding index in shader where data will be accessed
+		vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;		// Type of descriptor (uniform, image sampler, etc)
+		vpLayoutBinding.descriptorCount = 1;									// Number of descriptors for binding, can be more than 1 for arrays
+		vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;				// Shader stage that will access this binding
+		if (clusterCulling == CLUSTER_CULLING_MESH_SHADER)
+		{
+			vpLayoutBinding.stageFlags |= VK_SHADER_STAGE_MESH_BIT_EXT;		// Mesh shader transforms its own vertices
+		}
+		vpLayoutBinding.pImmutableSamplers = nullptr;							// For Texture: Used for image sampling, not used for UBOs
+
+		// Object data Binding info: every draw's model matrix, material and flags, indexed by the pushed object index
+		VkDescriptorSetLayoutBinding objectLayoutBinding = {};
+		objectLayoutBinding.binding = 1;
+		objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		objectLayoutBinding.descriptorCount = 1;
+		objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		std::vector<VkDescriptorSetLayoutBinding> layoutBindings = { vpLayoutBinding, objectLayoutBinding };
+
+		// Shadows: cascade data + the atlas with a compare sampler, read by the fragment shader
+		if (shadows)
+		{
+			VkDescriptorSetLayoutBinding shadowDataBinding = {};
+			shadowDataBinding.binding = 2;
+			shadowDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			shadowDataBinding.descriptorCount = 1;
+			shadowDataBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+			layoutBindings.push_back(shadowDataBinding);
+
+			VkDescriptorSetLayoutBinding shadowAtlasBinding = shadowDataBinding;
+			shadowAtlasBinding.binding = 3;
+			shadowAtlasBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			layoutBindings.push_back(shadowAtlasBinding);
+		}
+
+		// Clustered lighting: grid UBO, lights and per cluster light lists, written by the binning pass (same set)
+		if (clusteredLighting)
+		{
+			for (uint32_t binding = 4; binding <= 6; binding++)
+			{
+				VkDescriptorSetLayoutBinding lightBinding = {};
+				lightBinding.binding = binding;
+				lightBinding.descriptorType = binding == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				lightBinding.descriptorCount = 1;
+				lightBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+				layoutBindings.push_back(lightBinding);
+			}
+		}
+
+		// Create Descriptor set layout with given bindings
+		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());		// Number of bindings in layout
+		layoutCreateInfo.pBindings = layoutBindings.data();										// Pointer to array of bindings
+
+		// Create Descriptor Set Layout
+		VkResult result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Descriptor Set Layout!");
+		}
+
+		// Deferred lighting: albedo, normal and depth as input attachments (input_attachment_index = binding)
+		if (deferredShading)
+		{
+			std::array<VkDescriptorSetLayoutBinding, 3> gBufferBindings = {};
+			for (uint32_t binding = 0; binding < gBufferBindings.size(); binding++)
+			{
+				gBufferBindings[binding].binding = binding;
+				gBufferBindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				gBufferBindings[binding].descriptorCount = 1;
+				gBufferBindings[binding].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+			}
+
+			VkDescriptorSetLayoutCreateInfo gBufferLayoutCreateInfo = layoutCreateInfo;
+			gBufferLayoutCreateInfo.bindingCount = static_cast<uint32_t>(gBufferBindings.size());
+			gBufferLayoutCreateInfo.pBindings = gBufferBindings.data();
+			if (vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &gBufferLayoutCreateInfo, nullptr, &gBufferSetLayout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create G-buffer Descriptor Set Layout!");
+			}
+		}
+
+		if (clusterCulling == CLUSTER_CULLING_OFF) { return; }
+
+		// Cluster data layout (see Shaders/meshlet_common.glsl)
+		// 0 = cull data UBO, 1-4 = meshlets / meshlet vertices / meshlet triangles / draws, 5-6 = compute outputs
+		// 7-8 = meshlet visibility + Hi-Z (occlusion culling)
+		VkShaderStageFlags clusterStages = clusterCulling == CLUSTER_CULLING_MESH_SHADER
+			? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT
+			: VK_SHADER_STAGE_COMPUTE_BIT;
+
+		std::vector<VkDescriptorSetLayoutBinding> clusterBindings;
+		for (uint32_t binding = 0; binding < 7; binding++)
+		{
+			if (binding >= 5 && clusterCulling != CLUSTER_CULLING_COMPUTE) { break; }
+
+			VkDescriptorSetLayoutBinding clusterBinding = {};
+			clusterBinding.binding = binding;
+			clusterBinding.descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			clusterBinding.descriptorCount = 1;
+			clusterBinding.stageFlags = clusterStages;
+			clusterBindings.push_back(clusterBinding);
+		}
+
+		if (occlusionCulling)
+		{
+			VkDescriptorSetLayoutBinding visibilityBinding = {};
+			visibilityBinding.binding = 7;
+			visibilityBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			visibilityBinding.descriptorCount = 1;
+			visibilityBinding.stageFlags = clusterStages;
+			clusterBindings.push_back(visibilityBinding);
+
+			VkDescriptorSetLayoutBinding hiZBinding = visibilityBinding;
+			hiZBinding.binding = 8;
+			hiZBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			clusterBindings.push_back(hiZBinding);
+		}
+
+		layoutCreateInfo.bindingCount = static_cast<uint32_t>(clusterBindings.size());
+		layoutCreateInfo.pBindings = clusterBindings.data();
+		if (vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &clusterSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create cluster Descriptor Set Layout!");
+		}
+
+		// Mesh shader reads each mesh's vertex buffer directly
+		if (clusterCulling == CLUSTER_CULLING_MESH_SHADER)
+		{
+			VkDescriptorSetLayoutBinding vertexBinding = {};
+			vertexBinding.binding = 0;
+			vertexBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			vertexBinding.descriptorCount = 1;
+			vertexBinding.stageFlags = VK_SHADER_STAGE_MESH_BIT_EXT;
+
+			layoutCreateInfo.bindingCount = 1;
+			layoutCreateInfo.pBindings = &vertexBinding;
+			if (vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &meshVertexSetLayout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create mesh vertex Descriptor Set Layout!");
+			}
+		}
+	}
+
+	void VulkanRenderer::createPushConstantRange()
 	{
 		// Define push constant range no create info needed as push constant range is part of pipeline layout
 		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Stages that will access the push constant
 		pushConstantRange.offset = 0;								// Offset into the push constant data
-		pushConstantRange.size = sizeof(Model);			// Size of the push constant data
+		pushConstantRange.size = sizeof(ObjectPush);			// Size of the push constant data
 	}
 
 	void VulkanRenderer::createGraphicsPipeline()
 	{
 		auto vertexShaderCode = readFile("./Shaders/shader.vert.spv");
-		auto fragmentShaderCode = readFile("./Shaders/shader.frag.spv");
+		// Variant with the lighting enabled: shadowed (_shadows) and / or clustered lights (_lights), deferred lights later
+		std::string lightingVariant = std::string(shadows ? "_shadows" : "") + (clusteredLighting ? "_lights" : "");
+		auto fragmentShaderCode = readFile(deferredShading ? std::string("./Shaders/gbuffer.frag.spv") : "./Shaders/shader" + lightingVariant + ".frag.spv");
 
 		// Build shader modules to link to graphics pipeline
 		VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
 		VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
 
+		// Specialization constant tells the vertex shader whether normals arrive octahedral encoded
+		VkBool32 octahedralNormals = isOctahedralNormalFormat(vertexFormat) ? VK_TRUE : VK_FALSE;
+		VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(VkBool32) };	// constant_id = 0
+		VkSpecializationInfo vertexSpecializationInfo = {};
+		vertexSpecializationInfo.mapEntryCount = 1;
+		vertexSpecializationInfo.pMapEntries = &specializationEntry;
+		vertexSpecializationInfo.dataSize = sizeof(VkBool32);
+		vertexSpecializationInfo.pData = &octahedralNormals;
+
 		// Vertex shader stage creation info
 		VkPipelineShaderStageCreateInfo vertexShaderStageCreateInfo = {};
 		vertexShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		vertexShaderStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT; // Stage this shader will be used in
 		vertexShaderStageCreateInfo.module = vertexShaderModule; // Shader module to be used by stage
 		vertexShaderStageCreateInfo.pName = "main"; // Name of entry point function in shader
+		vertexShaderStageCreateInfo.pSpecializationInfo = &vertexSpecializationInfo;
 
 		// Fragment shader stage creation info
 		VkPipelineShaderStageCreateInfo fragmentShaderStageCreateInfo = {};
@@ -568,24 +1480,8 @@ namespace EngineCore {
 
 		// - VERTEX INPUT ------------------------------------------------
 		// How the data for a single vertex (including info such as position colour, texture coords, normals, etc) is as a whole
-		VkVertexInputBindingDescription bindingDescription = {};
-		bindingDescription.binding = 0;									// Can bind multiple streams of Data, this defines which one 
-		bindingDescription.stride = sizeof(Vertex);						// Size of single vertex object
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		// Whether to advance on every vertex or every instance
-
-		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
-
-		// Position Attribute
-		attributeDescriptions[0].binding = 0;								// Which binding the data comes from (should match above)
-		attributeDescriptions[0].location = 0;								// Location directive of input in vertex shader
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;		// Format of data (also helps define size of data)
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);			// Offset of attribute in vertex struct
-
-		// Color Attribute
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, col);
+		// Binding and attributes are generated from the chosen vertex format (see VertexFormat.cpp)
+		VertexInputDescription vertexInputDescription = getVertexInputDescription(vertexFormat);
 
 
 		// Tells Vulkan how to interpret the raw bytes in your vertex buffers when building a graphics pipeline.
@@ -599,9 +1495,9 @@ namespace EngineCore {
 		VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
 		vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-		vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;  // List of vertex binding descriptions (data spacing between vertices and whether the data is per-vertex or per-instance)
-		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();  // List of vertex attribute descriptions (type of attributes passed to vertex shader, which binding to load them from and at which offset)
+		vertexInputCreateInfo.pVertexBindingDescriptions = &vertexInputDescription.binding;  // List of vertex binding descriptions (data spacing between vertices and whether the data is per-vertex or per-instance)
+		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputDescription.attributes.size());
+		vertexInputCreateInfo.pVertexAttributeDescriptions = vertexInputDescription.attributes.data();  // List of vertex attribute descriptions (type of attributes passed to vertex shader, which binding to load them from and at which offset)
 
 		// - INPUT Assembly ------------------------------------------------
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -648,7 +1544,7 @@ namespace EngineCore {
 		VkPipelineMultisampleStateCreateInfo multiSamplingCreateInfo = {};
 		multiSamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 		multiSamplingCreateInfo.sampleShadingEnable = VK_FALSE;					// Enable multisample shading or not
-		multiSamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;	// Number of samples per pixelz
+		multiSamplingCreateInfo.rasterizationSamples = msaaSamples;				// Number of samples per pixel (of the attachments)
 
 		// - COLOR BLENDING ------------------------------------------------
 		//Blend Attachment state (how blending is handled)
@@ -674,6 +1570,15 @@ namespace EngineCore {
 		colorBlendingCreateInfo.attachmentCount = 1;									// Number of frame buffers to create blending for
 		colorBlendingCreateInfo.pAttachments = &colourState;						// Pointer to array of blend attachment states
 
+		// G-buffer: albedo and normal written as they are
+		std::array<VkPipelineColorBlendAttachmentState, 2> gBufferStates = { colourState, colourState };
+		if (deferredShading)
+		{
+			gBufferStates[0].blendEnable = VK_FALSE;
+			gBufferStates[1].blendEnable = VK_FALSE;
+			colorBlendingCreateInfo.attachmentCount = static_cast<uint32_t>(gBufferStates.size());
+			colorBlendingCreateInfo.pAttachments = gBufferStates.data();
+		}
 
 
 		// - PIPELINE LAYOUT ------------------------------------------------
@@ -715,8 +1620,15 @@ namespace EngineCore {
 		graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;			// Color blending state info
 		graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;						// Depth and stencil state info
 		graphicsPipelineCreateInfo.layout = pipelineLayout;								// Pipeline layout used by pipeline
-		graphicsPipelineCreateInfo.renderPass = renderPass;								// render pass description the pipeline is compatible with
-		graphicsPipelineCreateInfo.subpass = 0;											// Subpass index of render pass where this pipeline will be used
+		graphicsPipelineCreateInfo.renderPass = renderGraph->getRenderPass(forwardPass);	// render pass description the pipeline is compatible with (late pass is compatible)
+		graphicsPipelineCreateInfo.subpass = renderGraph->getSubpass(forwardPass);			// Subpass index of render pass where this pipeline will be used
+
+		// With dynamic rendering there is no render pass, the pipeline only needs the attachment formats
+		VkPipelineRenderingCreateInfoKHR renderingCreateInfo = renderGraph->getRenderingCreateInfo(forwardPass);
+		if (renderGraph->isDynamicRendering())
+		{
+			graphicsPipelineCreateInfo.pNext = &renderingCreateInfo;
+		}
 		graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;					// Handle to base pipeline if deriving from existing one
 		graphicsPipelineCreateInfo.basePipelineIndex = -1;								// Index of base pipeline in pCreateInfos array if creating multiple pipelines
 
@@ -725,56 +1637,271 @@ namespace EngineCore {
 		{
 			throw std::runtime_error("Failed to create Graphics Pipeline!");
 		}
-		// ---------------------------------------------- END --------------------------------------------------------------------------------------
 
-		// Destory Shader module -> not needed after pipeline creation
-		vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShaderModule, nullptr);
-		vkDestroyShaderModule(mainDevice.logicalDevice, vertexShaderModule, nullptr);
-	}
+		// - DEPTH PRE-PASS PIPELINES (vertex path) ------------------------------------------------
+		if (prePass != RenderGraph::INVALID)
+		{
+			// Forward pass after the pre-pass: depth is already final, only the nearest surface passes
+			VkPipelineDepthStencilStateCreateInfo equalDepthCreateInfo = depthStencilCreateInfo;
+			equalDepthCreateInfo.depthWriteEnable = VK_FALSE;
+			equalDepthCreateInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+			VkGraphicsPipelineCreateInfo equalPipelineCreateInfo = graphicsPipelineCreateInfo;
+			equalPipelineCreateInfo.pDepthStencilState = &equalDepthCreateInfo;
+			if (vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &equalPipelineCreateInfo, nullptr, &depthEqualPipeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create depth EQUAL Graphics Pipeline!");
+			}
 
-	void VulkanRenderer::createDepthBufferImage()
-	{
-		// Get supported depth image format
-		VkFormat depthFormat = chooseSupportedFormat(
-			{ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+			// Pre-pass: position stream only, no fragment shader and no colour attachment
+			auto prePassShaderCode = readFile("./Shaders/depth_prepass.vert.spv");
+			VkShaderModule prePassShaderModule = createShaderModule(prePassShaderCode);
+			VkPipelineShaderStageCreateInfo prePassStage = vertexShaderStageCreateInfo;
+			prePassStage.module = prePassShaderModule;
+			prePassStage.pSpecializationInfo = nullptr;
+
+			VertexInputDescription positionInputDescription = getPositionInputDescription(vertexFormat);
+			VkPipelineVertexInputStateCreateInfo positionInputCreateInfo = vertexInputCreateInfo;
+			positionInputCreateInfo.pVertexBindingDescriptions = &positionInputDescription.binding;
+			positionInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionInputDescription.attributes.size());
+			positionInputCreateInfo.pVertexAttributeDescriptions = positionInputDescription.attributes.data();
+
+			VkPipelineColorBlendStateCreateInfo noColourCreateInfo = colorBlendingCreateInfo;
+			noColourCreateInfo.attachmentCount = 0;
+			noColourCreateInfo.pAttachments = nullptr;
+
+			VkPipelineRenderingCreateInfoKHR prePassRenderingCreateInfo = renderGraph->getRenderingCreateInfo(prePass);
+			VkGraphicsPipelineCreateInfo prePassCreateInfo = graphicsPipelineCreateInfo;
+			prePassCreateInfo.pNext = renderGraph->isDynamicRendering() ? &prePassRenderingCreateInfo : nullptr;
+			prePassCreateInfo.stageCount = 1;
+			prePassCreateInfo.pStages = &prePassStage;
+			prePassCreateInfo.pVertexInputState = &positionInputCreateInfo;
+			prePassCreateInfo.pColorBlendState = &noColourCreateInfo;
+			prePassCreateInfo.renderPass = renderGraph->getRenderPass(prePass);
+			prePassCreateInfo.subpass = renderGraph->getSubpass(prePass);
+			if (vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &prePassCreateInfo, nullptr, &depthPrePassPipeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create depth pre-pass Graphics Pipeline!");
+			}
 
-		// Create depth image
-		DepthBufferImage = createImage(swapChainExtent.width, swapChainExtent.height,
-			depthFormat, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&DepthBufferImageMemory);
+			vkDestroyShaderModule(mainDevice.logicalDevice, prePassShaderModule, nullptr);
+		}
 
-		// Create depth image view
-		DepthBufferImageView = createImageView(DepthBufferImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-	}
+		// - SHADOW PIPELINE (optional) ------------------------------------------------
+		// Position stream into one atlas tile at a time (viewport set per cascade), both faces of the flat meshes cast,
+		// slope scaled bias against acne (the fragment shader adds a normal offset)
+		if (shadows)
+		{
+			auto shadowShaderCode = readFile("./Shaders/shadow.vert.spv");
+			VkShaderModule shadowShaderModule = createShaderModule(shadowShaderCode);
+			VkPipelineShaderStageCreateInfo shadowStage = vertexShaderStageCreateInfo;
+			shadowStage.module = shadowShaderModule;
+			shadowStage.pSpecializationInfo = nullptr;
+
+			VertexInputDescription positionInputDescription = getPositionInputDescription(vertexFormat);
+			VkPipelineVertexInputStateCreateInfo positionInputCreateInfo = vertexInputCreateInfo;
+			positionInputCreateInfo.pVertexBindingDescriptions = &positionInputDescription.binding;
+			positionInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionInputDescription.attributes.size());
+			positionInputCreateInfo.pVertexAttributeDescriptions = positionInputDescription.attributes.data();
+
+			std::array<VkDynamicState, 2> shadowDynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo shadowDynamicCreateInfo = {};
+			shadowDynamicCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			shadowDynamicCreateInfo.dynamicStateCount = static_cast<uint32_t>(shadowDynamicStates.size());
+			shadowDynamicCreateInfo.pDynamicStates = shadowDynamicStates.data();
+
+			VkPipelineRasterizationStateCreateInfo shadowRasterCreateInfo = rasterizationStateCreateInfo;
+			shadowRasterCreateInfo.cullMode = VK_CULL_MODE_NONE;
+			shadowRasterCreateInfo.depthBiasEnable = VK_TRUE;
+			shadowRasterCreateInfo.depthBiasConstantFactor = 2.0f;
+			shadowRasterCreateInfo.depthBiasSlopeFactor = 2.0f;
+
+			VkPipelineMultisampleStateCreateInfo shadowMultisampleCreateInfo = multiSamplingCreateInfo;
+			shadowMultisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkPipelineColorBlendStateCreateInfo noColourCreateInfo = colorBlendingCreateInfo;
+			noColourCreateInfo.attachmentCount = 0;
+			noColourCreateInfo.pAttachments = nullptr;
+
+			// Cache and caster passes have the same depth only attachment, so the pipeline works in both
+			VkPipelineRenderingCreateInfoKHR shadowRenderingCreateInfo = renderGraph->getRenderingCreateInfo(shadowCachePass);
+			VkGraphicsPipelineCreateInfo shadowCreateInfo = graphicsPipelineCreateInfo;
+			shadowCreateInfo.pNext = renderGraph->isDynamicRendering() ? &shadowRenderingCreateInfo : nullptr;
+			shadowCreateInfo.stageCount = 1;
+			shadowCreateInfo.pStages = &shadowStage;
+			shadowCreateInfo.pVertexInputState = &positionInputCreateInfo;
+			shadowCreateInfo.pRasterizationState = &shadowRasterCreateInfo;
+			shadowCreateInfo.pMultisampleState = &shadowMultisampleCreateInfo;
+			shadowCreateInfo.pColorBlendState = &noColourCreateInfo;
+			shadowCreateInfo.pDynamicState = &shadowDynamicCreateInfo;
+			shadowCreateInfo.renderPass = renderGraph->getRenderPass(shadowCachePass);
+			shadowCreateInfo.subpass = renderGraph->getSubpass(shadowCachePass);
+			if (vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &shadowCreateInfo, nullptr, &shadowPipeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create shadow Graphics Pipeline!");
+			}
 
-	void VulkanRenderer::createFramebuffers()
-	{
-		swapChainFramebuffers.resize(swapChainImages.size());
+			vkDestroyShaderModule(mainDevice.logicalDevice, shadowShaderModule, nullptr);
+		}
 
-		// Create a FrameBuffer for each swap chain image view
-		for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
+		// - DEFERRED LIGHTING PIPELINE (optional) ------------------------------------------------
+		// Fullscreen triangle in the lighting subpass: no vertex input, no depth test (depth is an input attachment there)
+		if (deferredShading)
 		{
-			std::array<VkImageView, 2> attachments = {
-				swapChainImages[i].imageView,
-				DepthBufferImageView
-			};
-			VkFramebufferCreateInfo framebufferCreateInfo = {};
-			framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferCreateInfo.renderPass = renderPass;											// Render pass layout the framebuffer will be used with
-			framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-			framebufferCreateInfo.pAttachments = attachments.data();								// List of attachments (1:1 with render pass)
-			framebufferCreateInfo.width = swapChainExtent.width;
-			framebufferCreateInfo.height = swapChainExtent.height;
-			framebufferCreateInfo.layers = 1;
+			auto fullscreenShaderCode = readFile("./Shaders/fullscreen.vert.spv");
+			auto lightingShaderCode = readFile("./Shaders/deferred_lighting" + lightingVariant + ".frag.spv");
+			VkShaderModule fullscreenShaderModule = createShaderModule(fullscreenShaderCode);
+			VkShaderModule lightingShaderModule = createShaderModule(lightingShaderCode);
+
+			VkPipelineShaderStageCreateInfo lightingStages[2] = { vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo };
+			lightingStages[0].module = fullscreenShaderModule;
+			lightingStages[0].pSpecializationInfo = nullptr;
+			lightingStages[1].module = lightingShaderModule;
+
+			VkPipelineVertexInputStateCreateInfo noVertexInputCreateInfo = {};
+			noVertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+			VkPipelineRasterizationStateCreateInfo lightingRasterCreateInfo = rasterizationStateCreateInfo;
+			lightingRasterCreateInfo.cullMode = VK_CULL_MODE_NONE;
+
+			VkPipelineDepthStencilStateCreateInfo noDepthCreateInfo = depthStencilCreateInfo;
+			noDepthCreateInfo.depthTestEnable = VK_FALSE;
+			noDepthCreateInfo.depthWriteEnable = VK_FALSE;
+
+			VkPipelineColorBlendAttachmentState lightingColourState = colourState;
+			lightingColourState.blendEnable = VK_FALSE;
+			VkPipelineColorBlendStateCreateInfo lightingBlendCreateInfo = colorBlendingCreateInfo;
+			lightingBlendCreateInfo.attachmentCount = 1;
+			lightingBlendCreateInfo.pAttachments = &lightingColourState;
+
+			// Sets: 0 = frame set (shadows, lights), 1 = G-buffer. Push constant = DeferredLightingPush
+			std::array<VkDescriptorSetLayout, 2> lightingSetLayouts = { descriptorSetLayout, gBufferSetLayout };
+			VkPushConstantRange lightingPushRange = {};
+			lightingPushRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+			lightingPushRange.offset = 0;
+			lightingPushRange.size = sizeof(DeferredLightingPush);
+
+			VkPipelineLayoutCreateInfo lightingLayoutCreateInfo = {};
+			lightingLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			lightingLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(lightingSetLayouts.size());
+			lightingLayoutCreateInfo.pSetLayouts = lightingSetLayouts.data();
+			lightingLayoutCreateInfo.pushConstantRangeCount = 1;
+			lightingLayoutCreateInfo.pPushConstantRanges = &lightingPushRange;
+			if (vkCreatePipelineLayout(mainDevice.logicalDevice, &lightingLayoutCreateInfo, nullptr, &deferredLightingPipelineLayout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create deferred lighting Pipeline Layout!");
+			}
+
+			VkGraphicsPipelineCreateInfo lightingCreateInfo = graphicsPipelineCreateInfo;
+			lightingCreateInfo.pStages = lightingStages;
+			lightingCreateInfo.pVertexInputState = &noVertexInputCreateInfo;
+			lightingCreateInfo.pRasterizationState = &lightingRasterCreateInfo;
+			lightingCreateInfo.pDepthStencilState = &noDepthCreateInfo;
+			lightingCreateInfo.pColorBlendState = &lightingBlendCreateInfo;
+			lightingCreateInfo.layout = deferredLightingPipelineLayout;
+			lightingCreateInfo.renderPass = renderGraph->getRenderPass(lightingPass);
+			lightingCreateInfo.subpass = renderGraph->getSubpass(lightingPass);
+			if (vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &lightingCreateInfo, nullptr, &deferredLightingPipeline) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create deferred lighting Graphics Pipeline!");
+			}
+
+			vkDestroyShaderModule(mainDevice.logicalDevice, lightingShaderModule, nullptr);
+			vkDestroyShaderModule(mainDevice.logicalDevice, fullscreenShaderModule, nullptr);
+		}
 
-			if (vkCreateFramebuffer(mainDevice.logicalDevice, &framebufferCreateInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
+		// - MESH SHADER PIPELINE (optional) ------------------------------------------------
+		// Same fixed function state, but task + mesh stages replace vertex input and assembly
+		if (clusterCulling == CLUSTER_CULLING_MESH_SHADER)
+		{
+			auto taskShaderCode = readFile(occlusionCulling ? "./Shaders/meshlet_occlusion.task.spv" : "./Shaders/meshlet.task.spv");
+			auto meshShaderCode = readFile("./Shaders/meshlet.mesh.spv");
+			VkShaderModule taskShaderModule = createShaderModule(taskShaderCode);
+			VkShaderModule meshShaderModule = createShaderModule(meshShaderCode);
+
+			// Mesh shader decodes vertices itself, so it needs to know the format
+			uint32_t vertexFormatConstant = static_cast<uint32_t>(vertexFormat);
+			VkSpecializationMapEntry formatEntry = { 0, 0, sizeof(uint32_t) };		// constant_id = 0
+			VkSpecializationInfo meshSpecializationInfo = {};
+			meshSpecializationInfo.mapEntryCount = 1;
+			meshSpecializationInfo.pMapEntries = &formatEntry;
+			meshSpecializationInfo.dataSize = sizeof(uint32_t);
+			meshSpecializationInfo.pData = &vertexFormatConstant;
+
+			VkPipelineShaderStageCreateInfo meshStages[3] = {};
+			meshStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			meshStages[0].stage = VK_SHADER_STAGE_TASK_BIT_EXT;
+			meshStages[0].module = taskShaderModule;
+			meshStages[0].pName = "main";
+			meshStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			meshStages[1].stage = VK_SHADER_STAGE_MESH_BIT_EXT;
+			meshStages[1].module = meshShaderModule;
+			meshStages[1].pName = "main";
+			meshStages[1].pSpecializationInfo = &meshSpecializationInfo;
+			meshStages[2] = fragmentShaderStageCreateInfo;
+
+			// Sets: 0 = view projection, 1 = cluster data, 2 = mesh vertices. Push constant = draw index (+ cull phase)
+			std::array<VkDescriptorSetLayout, 3> meshSetLayouts = { descriptorSetLayout, clusterSetLayout, meshVertexSetLayout };
+			VkPushConstantRange drawIndexRange = {};
+			drawIndexRange.stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+			drawIndexRange.offset = 0;
+			drawIndexRange.size = sizeof(uint32_t) * (occlusionCulling ? 2 : 1);
+
+			VkPipelineLayoutCreateInfo meshLayoutCreateInfo = {};
+			meshLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			meshLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(meshSetLayouts.size());
+			meshLayoutCreateInfo.pSetLayouts = meshSetLayouts.data();
+			meshLayoutCreateInfo.pushConstantRangeCount = 1;
+			meshLayoutCreateInfo.pPushConstantRanges = &drawIndexRange;
+			if (vkCreatePipelineLayout(mainDevice.logicalDevice, &meshLayoutCreateInfo, nullptr, &meshShaderPipelineLayout) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create mesh shader Pipeline Layout!");
+			}
+
+			graphicsPipelineCreateInfo.stageCount = 3;
+			graphicsPipelineCreateInfo.pStages = meshStages;
+			graphicsPipelineCreateInfo.pVertexInputState = nullptr;			// Must be null for mesh pipelines
+			graphicsPipelineCreateInfo.pInputAssemblyState = nullptr;
+			graphicsPipelineCreateInfo.layout = meshShaderPipelineLayout;
+
+			result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &meshShaderPipeline);
+			if (result != VK_SUCCESS)
 			{
-				throw std::runtime_error("Failed to create framebuffer!");
+				throw std::runtime_error("Failed to create mesh shader Graphics Pipeline!");
 			}
+
+			vkDestroyShaderModule(mainDevice.logicalDevice, meshShaderModule, nullptr);
+			vkDestroyShaderModule(mainDevice.logicalDevice, taskShaderModule, nullptr);
+		}
+		// ---------------------------------------------- END --------------------------------------------------------------------------------------
+
+		// Destory Shader module -> not needed after pipeline creation
+		vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShaderModule, nullptr);
+		vkDestroyShaderModule(mainDevice.logicalDevice, vertexShaderModule, nullptr);
+	}
+
+	void VulkanRenderer::destroyGraphicsPipelines()
+	{
+		vkDestroyPipeline(mainDevice.logicalDevice, graphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(mainDevice.logicalDevice, pipelineLayout, nullptr);
+		if (prePass != RenderGraph::INVALID)
+		{
+			vkDestroyPipeline(mainDevice.logicalDevice, depthPrePassPipeline, nullptr);
+			vkDestroyPipeline(mainDevice.logicalDevice, depthEqualPipeline, nullptr);
+		}
+		if (shadows)
+		{
+			vkDestroyPipeline(mainDevice.logicalDevice, shadowPipeline, nullptr);
+		}
+		if (deferredShading)
+		{
+			vkDestroyPipeline(mainDevice.logicalDevice, deferredLightingPipeline, nullptr);
+			vkDestroyPipelineLayout(mainDevice.logicalDevice, deferredLightingPipelineLayout, nullptr);
+		}
+		if (clusterCulling == CLUSTER_CULLING_MESH_SHADER)
+		{
+			vkDestroyPipeline(mainDevice.logicalDevice, meshShaderPipeline, nullptr);
+			vkDestroyPipelineLayout(mainDevice.logicalDevice, meshShaderPipelineLayout, nullptr);
 		}
 	}
 
@@ -791,23 +1918,16 @@ namespace EngineCore {
 		{
 			throw std::runtime_error("Failed to create command pool!");
 		}
-	}
 
-	void VulkanRenderer::createCommandBuffers()
-	{
-		commandBuffers.resize(swapChainFramebuffers.size());
-
-		VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
-		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		commandBufferAllocateInfo.commandPool = graphicsCommandPool;						// Command pool to allocate from (Command buffer now is sealed to work with only graphics queue families)
-		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;					// Level of command buffers (primary or secondary)
-		//commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;				// Secondary can be called from primary: Buffer directly callable by queue
-		commandBufferAllocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size()); // Number of command buffers to allocate
-		
-		// Allocate command buffers
-		if (vkAllocateCommandBuffers(mainDevice.logicalDevice, &commandBufferAllocateInfo, commandBuffers.data()) != VK_SUCCESS)
+		// Per frame in flight transient pools the frame's command buffers come from, reset wholesale when the slot is
+		// reused. Async compute command buffers can only be submitted to the compute family's queues
+		for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
 		{
-			throw std::runtime_error("Failed to allocate command buffers!");
+			graphicsFramePools.push_back(std::make_unique<FrameCommandPool>(mainDevice.logicalDevice, queueFamilyIndices.graphicsFamily));
+			if (asyncCompute)
+			{
+				computeFramePools.push_back(std::make_unique<FrameCommandPool>(mainDevice.logicalDevice, queueFamilyIndices.computeFamily));
+			}
 		}
 	}
 
@@ -815,25 +1935,29 @@ namespace EngineCore {
 	{
 		imageAvailableSemaphore.resize(MAX_FRAME_DRAWS);
 		renderFinishedSemaphore.resize(MAX_FRAME_DRAWS);
-		drawFences.resize(MAX_FRAME_DRAWS);
 
 		VkSemaphoreCreateInfo semaphoreCreateInfo = {};
 		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		// Fence creation information:
-		VkFenceCreateInfo fenceCreateInfo = {};
-		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Create the fence in signaled state so we don't wait forever on first frame
-
 		for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
 		{
 			if (vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore[i]) != VK_SUCCESS ||
-				vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphore[i]) != VK_SUCCESS ||
-				vkCreateFence(mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &drawFences[i]) != VK_SUCCESS)
+				vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphore[i]) != VK_SUCCESS)
 			{
-				throw std::runtime_error("Failed to create semaphores or fences!");
+				throw std::runtime_error("Failed to create semaphores!");
 			}
 		}
+
+		// Value 0 is reached from the start: nothing to wait for on the first frames
+		graphicsTimeline = std::make_unique<TimelineSemaphore>(mainDevice.logicalDevice);
+		if (asyncCompute)
+		{
+			computeTimeline = std::make_unique<TimelineSemaphore>(mainDevice.logicalDevice);
+		}
+		frameTimelineValues.assign(MAX_FRAME_DRAWS, 0);
+		imageTimelineValues.assign(swapChainImages.size(), 0);
+
+		deletionQueue = std::make_unique<DeletionQueue>(mainDevice.logicalDevice);
 	}
 
 	void VulkanRenderer::createUniformBuffers()
@@ -846,17 +1970,15 @@ namespace EngineCore {
 
 		// One uniform buffer per swapchain image (and by extension, command buffer)
 		vpUniformBuffers.resize(swapChainImages.size());
-		vpUniformBuffersMemory.resize(swapChainImages.size());
 		/*modelDUniformBuffers.resize(swapChainImages.size());
 		modelDUniformBuffersMemory.resize(swapChainImages.size());*/
 
 		// Create the uniform buffers
 		for (size_t i = 0; i < swapChainImages.size(); i++)
 		{
-			createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, vpBufferSize,
+			vpUniformBuffers[i] = createBufferResource(vpBufferSize,
 				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				vpUniformBuffers[i], vpUniformBuffersMemory[i]);
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 			/*createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, modelBufferSize,
 				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -864,6 +1986,22 @@ namespace EngineCore {
 				modelDUniformBuffers[i], modelDUniformBuffersMemory[i]);*/
 		}
 
+		// Object data, grown by updateObjectBuffer when the draw count outgrows it
+		objectBuffers.resize(swapChainImages.size());
+		for (size_t i = 0; i < swapChainImages.size(); i++)
+		{
+			objectBuffers[i] = createMappedBufferResource(sizeof(ObjectData) * std::max(drawCount, 64u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		}
+
+		if (shadows)
+		{
+			shadowUniformBuffers.resize(swapChainImages.size());
+			for (size_t i = 0; i < swapChainImages.size(); i++)
+			{
+				shadowUniformBuffers[i] = createBufferResource(sizeof(ShadowData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			}
+		}
 
 	}
 
@@ -882,182 +2020,1397 @@ namespace EngineCore {
 		modelPoolSize.descriptorCount = static_cast<uint32_t>(modelDUniformBuffers.size());	// Number of descriptors in pool of that type
 		*/
 
-		// Combine pool sizes into single array
-		std::vector<VkDescriptorPoolSize> poolSizes = { vpPoolSize };
+		// Combine pool sizes into single array
+		std::vector<VkDescriptorPoolSize> poolSizes = { vpPoolSize };
+		uint32_t maxSets = static_cast<uint32_t>(swapChainImages.size());
+
+		// Object data in each frame set
+		poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(objectBuffers.size()) });
+
+		// Cluster culling: per image cull data UBO + storage buffers, mesh shader path adds one vertex set per mesh
+		if (clusterCulling != CLUSTER_CULLING_OFF)
+		{
+			uint32_t imageCount = static_cast<uint32_t>(swapChainImages.size());
+			uint32_t storagePerImage = clusterCulling == CLUSTER_CULLING_COMPUTE ? 6 : 4;
+			uint32_t meshSets = clusterCulling == CLUSTER_CULLING_MESH_SHADER ? meshes.size() : 0;
+
+			poolSizes[0].descriptorCount += imageCount;
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, imageCount * (storagePerImage + (occlusionCulling ? 1 : 0)) + meshSets });
+			maxSets += imageCount + meshSets;
+		}
+
+		// Shadows: cascade data and atlas in each frame set
+		if (shadows)
+		{
+			uint32_t imageCount = static_cast<uint32_t>(swapChainImages.size());
+			poolSizes[0].descriptorCount += imageCount;
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount });
+		}
+
+		// Clustered lighting: grid, lights and light lists in each frame set
+		if (clusteredLighting)
+		{
+			uint32_t imageCount = static_cast<uint32_t>(swapChainImages.size());
+			poolSizes[0].descriptorCount += imageCount;
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, imageCount * 2 });
+		}
+
+		// Deferred shading: one G-buffer set for all frames
+		if (deferredShading)
+		{
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 3 });
+			maxSets += 1;
+		}
+
+		// Occlusion culling: Hi-Z sampled by each cluster set, one build set per Hi-Z level (source + destination)
+		if (occlusionCulling)
+		{
+			uint32_t imageCount = static_cast<uint32_t>(swapChainImages.size());
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount + hiZMipLevels });
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, hiZMipLevels });
+			maxSets += hiZMipLevels;
+		}
+
+		// Data to create Descriptor pool
+		VkDescriptorPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolCreateInfo.maxSets = maxSets;		// Maximum number of descriptor sets that can be allocated from pool
+		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());		// Number of different descriptor types
+		poolCreateInfo.pPoolSizes = poolSizes.data();								// Pointer to array of pool sizes
+
+		// Create Descriptor Pool
+		if (vkCreateDescriptorPool(mainDevice.logicalDevice, &poolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Descriptor Pool!");
+		}
+	}
+
+	void VulkanRenderer::createDescriptorSets()
+	{
+		// Resize descriptor sets to number of uniform buffers (1 per swapchain image)
+		descriptorSets.resize(swapChainImages.size());
+
+		std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), descriptorSetLayout); // All layouts will be the same
+
+		// Info to allocate descriptor sets from pool
+		VkDescriptorSetAllocateInfo descriptorSetAllocInfo = {};
+		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAllocInfo.descriptorPool = descriptorPool;										// Pool to allocate from
+		descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());	// Number of sets to allocate
+		descriptorSetAllocInfo.pSetLayouts = setLayouts.data();										// // Layouts to use to allocate sets (1:1 relationship)a
+
+		// Allocate descriptor sets (multiple)
+		if (vkAllocateDescriptorSets(mainDevice.logicalDevice, &descriptorSetAllocInfo, descriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Descriptor Sets!");
+		}
+
+		// Configure each descriptor set to point to corresponding uniform buffer
+		for (size_t i = 0; i < swapChainImages.size(); i++)
+		{
+			// View Projection UBO Descriptor info
+			// Buffer Info and Data offset info: what buffer to bind to set, offset and range of data to bind
+			VkDescriptorBufferInfo vpBufferInfo = {};
+			vpBufferInfo.buffer = buffers.get(vpUniformBuffers[i])->buffer;					// Buffer to bind to set
+			vpBufferInfo.offset = 0;									// Offset in buffer to start at
+			vpBufferInfo.range = sizeof(UboViewProjection);							// Size of data to bind
+			// Write information into descriptor set
+			VkWriteDescriptorSet vpDescriptorWrite = {};
+			vpDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			vpDescriptorWrite.dstSet = descriptorSets[i];				// Descriptor set to update
+			vpDescriptorWrite.dstBinding = 0;							// Binding in shader where data will be available
+			vpDescriptorWrite.dstArrayElement = 0;						// First array element to update
+			vpDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor
+			vpDescriptorWrite.descriptorCount = 1;						// Number of descriptors to update
+			vpDescriptorWrite.pBufferInfo = &vpBufferInfo;			// How this descriptor set is connecting with the buffer described above
+			
+			// Model Dynamic UBO Descriptor info
+			/*
+			VkDescriptorBufferInfo modelBufferInfo = {};
+			modelBufferInfo.buffer = modelDUniformBuffers[i];					// Buffer to bind to set
+			modelBufferInfo.offset = 0;										// Offset in buffer to start at
+			modelBufferInfo.range = modelUniformAlignment;					// Size of data to bind (only one model at a time)
+			// Write information into descriptor set
+			VkWriteDescriptorSet modelDescriptorWrite = {};
+			modelDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			modelDescriptorWrite.dstSet = descriptorSets[i];					// Descriptor set to update
+			modelDescriptorWrite.dstBinding = 1;								// Binding in shader where data will be available
+			modelDescriptorWrite.dstArrayElement = 0;							// First array element to update
+			modelDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Type of descriptor
+			modelDescriptorWrite.descriptorCount = 1;							// Number of descriptors to update
+			modelDescriptorWrite.pBufferInfo = &modelBufferInfo;				// How this descriptor set is connecting with the buffer described above
+			*/
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets = { vpDescriptorWrite };
+
+			VkDescriptorBufferInfo objectBufferInfo = {};
+			objectBufferInfo.buffer = buffers.get(objectBuffers[i])->buffer;
+			objectBufferInfo.range = VK_WHOLE_SIZE;
+			VkWriteDescriptorSet objectDescriptorWrite = vpDescriptorWrite;
+			objectDescriptorWrite.dstBinding = 1;
+			objectDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			objectDescriptorWrite.pBufferInfo = &objectBufferInfo;
+			writeDescriptorSets.push_back(objectDescriptorWrite);
+
+			// Atlas as the forward passes sample it (the render graph moves it to read only depth)
+			VkDescriptorBufferInfo shadowBufferInfo = {};
+			VkDescriptorImageInfo shadowImageInfo = {};
+			if (shadows)
+			{
+				shadowBufferInfo.buffer = buffers.get(shadowUniformBuffers[i])->buffer;
+				shadowBufferInfo.range = sizeof(ShadowData);
+				VkWriteDescriptorSet shadowDataWrite = vpDescriptorWrite;
+				shadowDataWrite.dstBinding = 2;
+				shadowDataWrite.pBufferInfo = &shadowBufferInfo;
+				writeDescriptorSets.push_back(shadowDataWrite);
+
+				shadowImageInfo.sampler = shadowSampler;
+				shadowImageInfo.imageView = images.get(shadowAtlas)->view;
+				shadowImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+				VkWriteDescriptorSet shadowAtlasWrite = vpDescriptorWrite;
+				shadowAtlasWrite.dstBinding = 3;
+				shadowAtlasWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				shadowAtlasWrite.pBufferInfo = nullptr;
+				shadowAtlasWrite.pImageInfo = &shadowImageInfo;
+				writeDescriptorSets.push_back(shadowAtlasWrite);
+			}
+
+			VkDescriptorBufferInfo lightBufferInfos[3] = {};
+			if (clusteredLighting)
+			{
+				BufferHandle lightHandles[3] = { lightGridBuffers[i], lightBuffers[i], clusterLightBuffers[i] };
+				for (uint32_t b = 0; b < 3; b++)
+				{
+					lightBufferInfos[b].buffer = buffers.get(lightHandles[b])->buffer;
+					lightBufferInfos[b].range = VK_WHOLE_SIZE;
+					VkWriteDescriptorSet lightWrite = vpDescriptorWrite;
+					lightWrite.dstBinding = 4 + b;
+					lightWrite.descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					lightWrite.pBufferInfo = &lightBufferInfos[b];
+					writeDescriptorSets.push_back(lightWrite);
+				}
+			}
+
+			// Update the descriptor set with new buffer/binding info:
+			vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()),
+				writeDescriptorSets.data(), 0, nullptr);
+		}
+
+		// G-buffer in the layouts the lighting subpass reads it in
+		if (deferredShading)
+		{
+			descriptorSetAllocInfo.descriptorSetCount = 1;
+			descriptorSetAllocInfo.pSetLayouts = &gBufferSetLayout;
+			if (vkAllocateDescriptorSets(mainDevice.logicalDevice, &descriptorSetAllocInfo, &gBufferDescriptorSet) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate G-buffer Descriptor Set!");
+			}
+
+			std::array<VkDescriptorImageInfo, 3> gBufferImageInfos = {};
+			gBufferImageInfos[0] = { VK_NULL_HANDLE, renderGraph->getImageView(gBufferAlbedo), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			gBufferImageInfos[1] = { VK_NULL_HANDLE, renderGraph->getImageView(gBufferNormal), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			gBufferImageInfos[2] = { VK_NULL_HANDLE, renderGraph->getImageView(depthBuffer), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+			std::array<VkWriteDescriptorSet, 3> gBufferWrites = {};
+			for (uint32_t binding = 0; binding < gBufferWrites.size(); binding++)
+			{
+				gBufferWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				gBufferWrites[binding].dstSet = gBufferDescriptorSet;
+				gBufferWrites[binding].dstBinding = binding;
+				gBufferWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				gBufferWrites[binding].descriptorCount = 1;
+				gBufferWrites[binding].pImageInfo = &gBufferImageInfos[binding];
+			}
+			vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(gBufferWrites.size()), gBufferWrites.data(), 0, nullptr);
+		}
+	}
+
+	void VulkanRenderer::createClusterCullPipeline()
+	{
+		if (clusterCulling != CLUSTER_CULLING_COMPUTE) { return; }
+
+		auto computeShaderCode = readFile(occlusionCulling ? "./Shaders/meshlet_cull_occlusion.comp.spv" : "./Shaders/meshlet_cull.comp.spv");
+		VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+		// Occlusion variant takes the phase, command offset and index offset
+		VkPushConstantRange phaseRange = {};
+		phaseRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		phaseRange.offset = 0;
+		phaseRange.size = sizeof(uint32_t) * 3;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		pipelineLayoutCreateInfo.pSetLayouts = &clusterSetLayout;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = occlusionCulling ? 1 : 0;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &phaseRange;
+		if (vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &clusterCullPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create cluster cull Pipeline Layout!");
+		}
+
+		VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		computePipelineCreateInfo.stage.module = computeShaderModule;
+		computePipelineCreateInfo.stage.pName = "main";
+		computePipelineCreateInfo.layout = clusterCullPipelineLayout;
+
+		if (vkCreateComputePipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &clusterCullPipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create cluster cull Compute Pipeline!");
+		}
+
+		vkDestroyShaderModule(mainDevice.logicalDevice, computeShaderModule, nullptr);
+	}
+
+	void VulkanRenderer::createClusterBuffers()
+	{
+		if (clusterCulling == CLUSTER_CULLING_OFF) { return; }
+
+		// Concatenate the meshlets of every mesh into shared buffers
+		MeshletData allMeshlets;
+		meshletBases.assign(meshes.getSlotCount(), 0);
+		meshes.forEach([&](MeshHandle handle, Mesh& mesh)
+		{
+			const MeshletData& meshletData = mesh.getMeshletData();
+			uint32_t vertexBase = static_cast<uint32_t>(allMeshlets.vertices.size());
+			uint32_t triangleBase = static_cast<uint32_t>(allMeshlets.triangles.size());
+
+			meshletBases[handle.index] = static_cast<uint32_t>(allMeshlets.meshlets.size());
+			for (Meshlet meshlet : meshletData.meshlets)
+			{
+				meshlet.vertexOffset += vertexBase;
+				meshlet.triangleOffset += triangleBase;
+				allMeshlets.meshlets.push_back(meshlet);
+			}
+			allMeshlets.vertices.insert(allMeshlets.vertices.end(), meshletData.vertices.begin(), meshletData.vertices.end());
+			allMeshlets.triangles.insert(allMeshlets.triangles.end(), meshletData.triangles.begin(), meshletData.triangles.end());
+		});
+
+		// Room in the compacted index output for every triangle of each init model's largest LOD, later models must fit in it
+		clusterDrawCapacity = std::max(drawCount, 1u);
+		clusterOutputIndexCount = getClusterOutputIndicesUsed();
+
+		createStagedBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
+			allMeshlets.meshlets.data(), sizeof(Meshlet) * allMeshlets.meshlets.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			meshletBuffer, meshletBufferMemory);
+		createStagedBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
+			allMeshlets.vertices.data(), sizeof(uint32_t) * allMeshlets.vertices.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			meshletVertexBuffer, meshletVertexBufferMemory);
+		createStagedBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
+			allMeshlets.triangles.data(), sizeof(uint32_t) * allMeshlets.triangles.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			meshletTriangleBuffer, meshletTriangleBufferMemory);
+
+		// Nothing is visible before the first frame, so everything goes through the late phase once
+		if (occlusionCulling)
+		{
+			meshletVisibilityCapacity = std::max(getMeshletVisibilityUsed(), 1u);
+			std::vector<uint32_t> visibility(meshletVisibilityCapacity, 0);
+			createStagedBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
+				visibility.data(), sizeof(uint32_t) * visibility.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				meshletVisibilityBuffer, meshletVisibilityBufferMemory);
+		}
+
+		// Per swapchain image: cull data + draw list written by the CPU, indirect commands + indices written by the cull pass
+		// Occlusion culling gives the early and late phase their own commands and index ranges
+		size_t imageCount = swapChainImages.size();
+		uint32_t phaseCount = occlusionCulling ? 2 : 1;
+		cullDataBuffers.resize(imageCount);
+		cullDataBuffersMemory.resize(imageCount);
+		clusterDrawBuffers.resize(imageCount);
+		clusterDrawBuffersMemory.resize(imageCount);
+		if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+		{
+			clusterIndirectBuffers.resize(imageCount);
+			clusterIndirectBuffersMemory.resize(imageCount);
+			clusterIndexBuffers.resize(imageCount);
+			clusterIndexBuffersMemory.resize(imageCount);
+		}
+
+		for (size_t i = 0; i < imageCount; i++)
+		{
+			createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, sizeof(CullData),
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				cullDataBuffers[i], cullDataBuffersMemory[i]);
+			createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, sizeof(ClusterDraw) * clusterDrawCapacity,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				clusterDrawBuffers[i], clusterDrawBuffersMemory[i]);
+
+			if (clusterCulling != CLUSTER_CULLING_COMPUTE) { continue; }
+
+			createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, sizeof(VkDrawIndexedIndirectCommand) * clusterDrawCapacity * phaseCount,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				clusterIndirectBuffers[i], clusterIndirectBuffersMemory[i]);
+			createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, sizeof(uint32_t) * std::max(clusterOutputIndexCount * phaseCount, 1u),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				clusterIndexBuffers[i], clusterIndexBuffersMemory[i]);
+		}
+	}
+
+	void VulkanRenderer::createClusterDescriptorSets()
+	{
+		if (clusterCulling == CLUSTER_CULLING_OFF) { return; }
+
+		clusterDescriptorSets.resize(swapChainImages.size());
+		std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), clusterSetLayout);
+
+		VkDescriptorSetAllocateInfo descriptorSetAllocInfo = {};
+		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAllocInfo.descriptorPool = descriptorPool;
+		descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+		descriptorSetAllocInfo.pSetLayouts = setLayouts.data();
+		if (vkAllocateDescriptorSets(mainDevice.logicalDevice, &descriptorSetAllocInfo, clusterDescriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate cluster Descriptor Sets!");
+		}
+
+		for (size_t i = 0; i < swapChainImages.size(); i++)
+		{
+			// Buffer of each binding, in binding order
+			std::vector<VkDescriptorBufferInfo> bufferInfos = {
+				{ cullDataBuffers[i], 0, sizeof(CullData) },
+				{ meshletBuffer, 0, VK_WHOLE_SIZE },
+				{ meshletVertexBuffer, 0, VK_WHOLE_SIZE },
+				{ meshletTriangleBuffer, 0, VK_WHOLE_SIZE },
+				{ clusterDrawBuffers[i], 0, VK_WHOLE_SIZE }
+			};
+			if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+			{
+				bufferInfos.push_back({ clusterIndexBuffers[i], 0, VK_WHOLE_SIZE });
+				bufferInfos.push_back({ clusterIndirectBuffers[i], 0, VK_WHOLE_SIZE });
+			}
+
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets(bufferInfos.size());
+			for (size_t binding = 0; binding < bufferInfos.size(); binding++)
+			{
+				writeDescriptorSets[binding] = {};
+				writeDescriptorSets[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writeDescriptorSets[binding].dstSet = clusterDescriptorSets[i];
+				writeDescriptorSets[binding].dstBinding = static_cast<uint32_t>(binding);
+				writeDescriptorSets[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				writeDescriptorSets[binding].descriptorCount = 1;
+				writeDescriptorSets[binding].pBufferInfo = &bufferInfos[binding];
+			}
+
+			// Occlusion culling: visibility (7) and Hi-Z (8)
+			VkDescriptorBufferInfo visibilityInfo = { meshletVisibilityBuffer, 0, VK_WHOLE_SIZE };
+			VkDescriptorImageInfo hiZInfo = { hiZSampler, hiZImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };	// Render graph transitions it after the build
+			if (occlusionCulling)
+			{
+				VkWriteDescriptorSet visibilityWrite = writeDescriptorSets[1];
+				visibilityWrite.dstBinding = 7;
+				visibilityWrite.pBufferInfo = &visibilityInfo;
+				writeDescriptorSets.push_back(visibilityWrite);
+
+				VkWriteDescriptorSet hiZWrite = visibilityWrite;
+				hiZWrite.dstBinding = 8;
+				hiZWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				hiZWrite.pBufferInfo = nullptr;
+				hiZWrite.pImageInfo = &hiZInfo;
+				writeDescriptorSets.push_back(hiZWrite);
+			}
+
+			vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()),
+				writeDescriptorSets.data(), 0, nullptr);
+		}
+
+		if (clusterCulling != CLUSTER_CULLING_MESH_SHADER) { return; }
+
+		// One set per mesh pointing at its vertex buffer
+		meshVertexDescriptorSets.assign(meshes.getSlotCount(), VK_NULL_HANDLE);
+		descriptorSetAllocInfo.descriptorSetCount = 1;
+		descriptorSetAllocInfo.pSetLayouts = &meshVertexSetLayout;
+		meshes.forEach([&](MeshHandle handle, Mesh& mesh)
+		{
+			if (vkAllocateDescriptorSets(mainDevice.logicalDevice, &descriptorSetAllocInfo, &meshVertexDescriptorSets[handle.index]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate mesh vertex Descriptor Sets!");
+			}
+
+			VkDescriptorBufferInfo vertexBufferInfo = { mesh.getVertexBuffer(), 0, VK_WHOLE_SIZE };
+
+			VkWriteDescriptorSet vertexWrite = {};
+			vertexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			vertexWrite.dstSet = meshVertexDescriptorSets[handle.index];
+			vertexWrite.dstBinding = 0;
+			vertexWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			vertexWrite.descriptorCount = 1;
+			vertexWrite.pBufferInfo = &vertexBufferInfo;
+			vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &vertexWrite, 0, nullptr);
+		});
+	}
+
+	void VulkanRenderer::createHiZPipeline()
+	{
+		if (!occlusionCulling) { return; }
+
+		// Build set: 0 = source (depth buffer or previous level), 1 = destination level
+		std::array<VkDescriptorSetLayoutBinding, 2> hiZBindings = {};
+		hiZBindings[0].binding = 0;
+		hiZBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		hiZBindings[0].descriptorCount = 1;
+		hiZBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		hiZBindings[1] = hiZBindings[0];
+		hiZBindings[1].binding = 1;
+		hiZBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutCreateInfo.bindingCount = static_cast<uint32_t>(hiZBindings.size());
+		layoutCreateInfo.pBindings = hiZBindings.data();
+		if (vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &hiZSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Hi-Z Descriptor Set Layout!");
+		}
+
+		// Push constant = source and destination sizes
+		VkPushConstantRange sizesRange = {};
+		sizesRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		sizesRange.offset = 0;
+		sizesRange.size = sizeof(int32_t) * 4;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		pipelineLayoutCreateInfo.pSetLayouts = &hiZSetLayout;
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &sizesRange;
+		if (vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &hiZPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Hi-Z Pipeline Layout!");
+		}
+
+		auto computeShaderCode = readFile("./Shaders/hiz_build.comp.spv");
+		VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+		VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		computePipelineCreateInfo.stage.module = computeShaderModule;
+		computePipelineCreateInfo.stage.pName = "main";
+		computePipelineCreateInfo.layout = hiZPipelineLayout;
+
+		if (vkCreateComputePipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &hiZPipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Hi-Z Compute Pipeline!");
+		}
+
+		vkDestroyShaderModule(mainDevice.logicalDevice, computeShaderModule, nullptr);
+	}
+
+	void VulkanRenderer::createHiZResources()
+	{
+		if (!occlusionCulling) { return; }
+
+		// Level 0 is the largest power of two inside the depth buffer so every further level halves exactly
+		hiZExtent = { 1, 1 };
+		while (hiZExtent.width * 2 <= swapChainExtent.width) { hiZExtent.width *= 2; }
+		while (hiZExtent.height * 2 <= swapChainExtent.height) { hiZExtent.height *= 2; }
+
+		hiZMipLevels = 1;
+		while ((std::max(hiZExtent.width, hiZExtent.height) >> hiZMipLevels) > 0) { hiZMipLevels++; }
+
+		hiZImage = createImage(hiZExtent.width, hiZExtent.height, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&hiZImageMemory, hiZMipLevels);
+
+		hiZImageView = createImageView(hiZImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, hiZMipLevels);
+		hiZMipViews.resize(hiZMipLevels);
+		for (uint32_t level = 0; level < hiZMipLevels; level++)
+		{
+			hiZMipViews[level] = createImageView(hiZImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level, 1);
+		}
+
+		// Point sampling, the cull pass takes the max of 4 texels itself
+		VkSamplerCreateInfo samplerCreateInfo = {};
+		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+		samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.minLod = 0.0f;
+		samplerCreateInfo.maxLod = static_cast<float>(hiZMipLevels);
+		if (vkCreateSampler(mainDevice.logicalDevice, &samplerCreateInfo, nullptr, &hiZSampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Hi-Z Sampler!");
+		}
+	}
+
+	void VulkanRenderer::createHiZDescriptorSets()
+	{
+		if (!occlusionCulling) { return; }
+
+		hiZDescriptorSets.resize(hiZMipLevels);
+		std::vector<VkDescriptorSetLayout> setLayouts(hiZMipLevels, hiZSetLayout);
+
+		VkDescriptorSetAllocateInfo descriptorSetAllocInfo = {};
+		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAllocInfo.descriptorPool = descriptorPool;
+		descriptorSetAllocInfo.descriptorSetCount = hiZMipLevels;
+		descriptorSetAllocInfo.pSetLayouts = setLayouts.data();
+		if (vkAllocateDescriptorSets(mainDevice.logicalDevice, &descriptorSetAllocInfo, hiZDescriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Hi-Z Descriptor Sets!");
+		}
+
+		for (uint32_t level = 0; level < hiZMipLevels; level++)
+		{
+			// Level 0 reduces the depth buffer (made read only by the render graph), others the level above
+			VkDescriptorImageInfo sourceInfo = level == 0
+				? VkDescriptorImageInfo{ hiZSampler, renderGraph->getImageView(depthBuffer), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL }
+				: VkDescriptorImageInfo{ hiZSampler, hiZMipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+			VkDescriptorImageInfo destinationInfo = { VK_NULL_HANDLE, hiZMipViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+			std::array<VkWriteDescriptorSet, 2> writeDescriptorSets = {};
+			writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[0].dstSet = hiZDescriptorSets[level];
+			writeDescriptorSets[0].dstBinding = 0;
+			writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeDescriptorSets[0].descriptorCount = 1;
+			writeDescriptorSets[0].pImageInfo = &sourceInfo;
+			writeDescriptorSets[1] = writeDescriptorSets[0];
+			writeDescriptorSets[1].dstBinding = 1;
+			writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writeDescriptorSets[1].pImageInfo = &destinationInfo;
+
+			vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()),
+				writeDescriptorSets.data(), 0, nullptr);
+		}
+	}
+
+	void VulkanRenderer::createShadowResources()
+	{
+		if (!shadows) { return; }
+
+		// Cascades tiled 1x1, 2x1 or 2x2. The atlas and its cache are the same size, halve the tiles until both fit
+		VkFormat shadowFormat = chooseSupportedFormat({ VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT }, VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+		VkDeviceSize texelBytes = shadowFormat == VK_FORMAT_D16_UNORM ? 2 : 4;
+		shadowAtlasColumns = shadowCascadeCount > 1 ? 2 : 1;
+		shadowAtlasRows = shadowCascadeCount > 2 ? 2 : 1;
+
+		shadowResolution = 2048;
+		auto atlasBytes = [&]() { return static_cast<VkDeviceSize>(shadowResolution) * shadowResolution * shadowAtlasColumns * shadowAtlasRows * texelBytes; };
+		while (shadowResolution > 256 && atlasBytes() * 2 > shadowAtlasBudget)
+		{
+			shadowResolution /= 2;
+		}
+
+		VkImageUsageFlags shadowUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		shadowAtlas = createImageResource(shadowResolution * shadowAtlasColumns, shadowResolution * shadowAtlasRows, shadowFormat,
+			shadowUsage | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+		shadowCache = createImageResource(shadowResolution * shadowAtlasColumns, shadowResolution * shadowAtlasRows, shadowFormat,
+			shadowUsage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+		shadowMemoryBytes = atlasBytes() * 2;
+
+		// Outside the tiles (and past the far plane) is lit
+		VkSamplerCreateInfo samplerCreateInfo = {};
+		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		samplerCreateInfo.compareEnable = VK_TRUE;
+		samplerCreateInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		if (vkCreateSampler(mainDevice.logicalDevice, &samplerCreateInfo, nullptr, &shadowSampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shadow Sampler!");
+		}
+
+		// The render graph expects the cache in TRANSFER_SRC (where every frame leaves it), every page starts stale
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = graphicsCommandPool;
+		allocInfo.commandBufferCount = 1;
+		VkCommandBuffer commandBuffer;
+		vkAllocateCommandBuffers(mainDevice.logicalDevice, &allocInfo, &commandBuffer);
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		VkImageMemoryBarrier cacheBarrier = {};
+		cacheBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		cacheBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		cacheBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		cacheBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		cacheBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		cacheBarrier.image = images.get(shadowCache)->image;
+		cacheBarrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &cacheBarrier);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		vkQueueWaitIdle(graphicsQueue);
+		vkFreeCommandBuffers(mainDevice.logicalDevice, graphicsCommandPool, 1, &commandBuffer);
+	}
+
+	void VulkanRenderer::createLightBinningPipeline()
+	{
+		if (!clusteredLighting) { return; }
+
+		// Reads the grid and lights and writes the light lists through the frame's set 0
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutCreateInfo.setLayoutCount = 1;
+		pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
+		if (vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &lightBinningPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create light binning Pipeline Layout!");
+		}
+
+		auto computeShaderCode = readFile("./Shaders/light_binning.comp.spv");
+		VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+		VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		computePipelineCreateInfo.stage.module = computeShaderModule;
+		computePipelineCreateInfo.stage.pName = "main";
+		computePipelineCreateInfo.layout = lightBinningPipelineLayout;
+
+		if (vkCreateComputePipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &lightBinningPipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create light binning Compute Pipeline!");
+		}
+
+		vkDestroyShaderModule(mainDevice.logicalDevice, computeShaderModule, nullptr);
+	}
+
+	void VulkanRenderer::createLightBuffers()
+	{
+		if (!clusteredLighting) { return; }
+
+		// Grid and lights are written by the CPU every frame, the light lists only ever by the binning pass:
+		// a count per cluster, then MAX_CLUSTER_LIGHTS 16-bit indices per cluster
+		VkDeviceSize lightListSize = sizeof(uint32_t) * LIGHT_CLUSTER_COUNT + sizeof(uint16_t) * LIGHT_CLUSTER_COUNT * MAX_CLUSTER_LIGHTS;
+		size_t imageCount = swapChainImages.size();
+		lightGridBuffers.resize(imageCount);
+		lightBuffers.resize(imageCount);
+		clusterLightBuffers.resize(imageCount);
+		for (size_t i = 0; i < imageCount; i++)
+		{
+			lightGridBuffers[i] = createBufferResource(sizeof(LightGridData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			lightBuffers[i] = createBufferResource(sizeof(Light) * MAX_LIGHTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			clusterLightBuffers[i] = createBufferResource(lightListSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+	}
+
+	void VulkanRenderer::updateTransforms()
+	{
+		// Only subtrees changed since last frame are recomputed
+		sceneGraph.updateWorldTransforms();
+
+		// Copy world matrices into the transform components
+		entities.forEachArchetype(COMPONENT_TRANSFORM | COMPONENT_SCENE_NODE, [this](Archetype& archetype)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				archetype.transforms[i] = sceneGraph.getWorldMatrix(archetype.sceneNodes[i]);
+			}
+		});
+
+		// World boxes follow (only moved ones are refitted), draw indices may have changed since last frame
+		forEachRenderable([this](Archetype& archetype, uint32_t firstDraw)
+		{
+			if (!(archetype.componentMask & COMPONENT_SPATIAL)) { return; }
+
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				const Mesh* mesh = meshes.get(archetype.meshes[i]);
+				if (mesh != nullptr)
+				{
+					bvh.moveProxy(archetype.spatialProxies[i], transformAabb(mesh->getBoundingBox(), archetype.transforms[i]));
+				}
+				bvh.setUserData(archetype.spatialProxies[i], firstDraw + i);
+			}
+		});
+		bvh.commit();
+	}
+
+	void VulkanRenderer::updateUniformBuffers(uint32_t imageIndex)
+	{
+		
+		// Map memory and write to uniform buffer
+		void* data;
+		VkDeviceMemory vpMemory = buffers.get(vpUniformBuffers[imageIndex])->memory;
+		vkMapMemory(mainDevice.logicalDevice, vpMemory, 0, sizeof(UboViewProjection), 0, &data);    // Map to pointer
+		memcpy(data, &uboViewProjection, sizeof(UboViewProjection));														// Copy data to mapped memory
+		vkUnmapMemory(mainDevice.logicalDevice, vpMemory);											// Unmap from pointer
+
+		if (shadows)
+		{
+			VkDeviceMemory shadowMemory = buffers.get(shadowUniformBuffers[imageIndex])->memory;
+			vkMapMemory(mainDevice.logicalDevice, shadowMemory, 0, sizeof(ShadowData), 0, &data);
+			memcpy(data, &shadowData, sizeof(ShadowData));
+			vkUnmapMemory(mainDevice.logicalDevice, shadowMemory);
+		}
+
+		// Grid from this frame's camera, lights as they are (the binning pass culls them)
+		if (clusteredLighting)
+		{
+			uint32_t lightCount = static_cast<uint32_t>(std::min(lights.size(), static_cast<size_t>(MAX_LIGHTS)));
+			LightGridData lightGrid = makeLightGridData(uboViewProjection.view, uboViewProjection.projection, swapChainExtent, lightCount);
+
+			VkDeviceMemory gridMemory = buffers.get(lightGridBuffers[imageIndex])->memory;
+			vkMapMemory(mainDevice.logicalDevice, gridMemory, 0, sizeof(LightGridData), 0, &data);
+			memcpy(data, &lightGrid, sizeof(LightGridData));
+			vkUnmapMemory(mainDevice.logicalDevice, gridMemory);
+
+			if (lightCount > 0)
+			{
+				VkDeviceMemory lightMemory = buffers.get(lightBuffers[imageIndex])->memory;
+				vkMapMemory(mainDevice.logicalDevice, lightMemory, 0, sizeof(Light) * lightCount, 0, &data);
+				memcpy(data, lights.data(), sizeof(Light) * lightCount);
+				vkUnmapMemory(mainDevice.logicalDevice, lightMemory);
+			}
+		}
+
+		//// Model UBOs (Dynamic)
+		//for (size_t i = 0; i < meshList.size(); i++)
+		//{
+		//	Model* thisModel = (Model*)((uint64_t)modelTransferSpace + (i * modelUniformAlignment));
+		//	*thisModel = meshList[i].getUboModel();
+		//}
+
+		//// Map the list of model data
+		//vkMapMemory(mainDevice.logicalDevice, modelDUniformBuffersMemory[imageIndex], 0, modelUniformAlignment * meshList.size(), 0, &data);
+		//memcpy(data, modelTransferSpace, modelUniformAlignment * meshList.size());
+		//vkUnmapMemory(mainDevice.logicalDevice, modelDUniformBuffersMemory[imageIndex]);
+	}
+
+	void VulkanRenderer::updateObjectBuffer(uint32_t imageIndex)
+	{
+		// Grow to twice the draws: the old buffer goes once the frames still reading it are done. The image's last frame
+		// is, so its descriptor set can point at the new one
+		if (buffers.get(objectBuffers[imageIndex])->size < sizeof(ObjectData) * drawCount)
+		{
+			destroyBufferResource(objectBuffers[imageIndex]);
+			objectBuffers[imageIndex] = createMappedBufferResource(sizeof(ObjectData) * drawCount * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+			VkDescriptorBufferInfo objectBufferInfo = {};
+			objectBufferInfo.buffer = buffers.get(objectBuffers[imageIndex])->buffer;
+			objectBufferInfo.range = VK_WHOLE_SIZE;
+
+			VkWriteDescriptorSet objectDescriptorWrite = {};
+			objectDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			objectDescriptorWrite.dstSet = descriptorSets[imageIndex];
+			objectDescriptorWrite.dstBinding = 1;
+			objectDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			objectDescriptorWrite.descriptorCount = 1;
+			objectDescriptorWrite.pBufferInfo = &objectBufferInfo;
+			vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &objectDescriptorWrite, 0, nullptr);
+		}
+
+		// Straight into the mapped memory in draw order (draws of destroyed meshes are never drawn, left as they were)
+		ObjectData* objects = static_cast<ObjectData*>(buffers.get(objectBuffers[imageIndex])->mapped);
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				const Mesh* mesh = meshes.get(archetype.meshes[i]);
+				if (mesh == nullptr) { continue; }
+
+				ObjectData& object = objects[firstDraw + i];
+				object.model = archetype.transforms[i] * mesh->getDequantization();
+				object.material = archetype.materials[i];
+				object.flags = archetype.flags[i];
+			}
+		});
+	}
+
+	void VulkanRenderer::updateClusterBuffers(uint32_t imageIndex)
+	{
+		// Frustum and camera for this frame
+		CullData cullData = {};
+		extractFrustumPlanes(uboViewProjection.projection * uboViewProjection.view, cullData.frustumPlanes);
+		cullData.cameraPosition = glm::inverse(uboViewProjection.view)[3];
+		cullData.viewProjection = uboViewProjection.projection * uboViewProjection.view;
+		cullData.hiZSize = glm::vec4(hiZExtent.width, hiZExtent.height, hiZMipLevels, 0.0f);
+
+		// Occlusion culling: each draw gets visibility entries for the meshlets of its largest LOD. When draws come, go or
+		// change mesh the entries belong to other instances, a new epoch makes them all read as not visible for a frame
+		std::vector<uint32_t> visibilityOffsets(drawCount, 0);
+		if (occlusionCulling)
+		{
+			std::vector<uint32_t> layout(drawCount * 2, 0);
+			uint32_t visibilityCount = 0;
+			forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+			{
+				for (uint32_t i = 0; i < archetype.size(); i++)
+				{
+					const Mesh* mesh = meshes.get(archetype.meshes[i]);
+					visibilityOffsets[firstDraw + i] = visibilityCount;
+					layout[(firstDraw + i) * 2] = visibilityCount;
+					layout[(firstDraw + i) * 2 + 1] = mesh != nullptr ? archetype.meshes[i].index : std::numeric_limits<uint32_t>::max();
+					visibilityCount += mesh != nullptr ? mesh->getMaxLodMeshletCount() : 0;
+				}
+			});
+			if (layout != meshletVisibilityLayout)
+			{
+				meshletVisibilityLayout.swap(layout);
+				meshletVisibilityEpoch++;
+			}
+		}
+		cullData.visibilityEpoch = meshletVisibilityEpoch;
+
+		void* data;
+		vkMapMemory(mainDevice.logicalDevice, cullDataBuffersMemory[imageIndex], 0, sizeof(CullData), 0, &data);
+		memcpy(data, &cullData, sizeof(CullData));
+		vkUnmapMemory(mainDevice.logicalDevice, cullDataBuffersMemory[imageIndex]);
+
+		// One draw per renderable covering the meshlets of its selected LOD, packed into the index output in draw order
+		// (draws of destroyed meshes stay empty)
+		std::vector<ClusterDraw> clusterDraws(drawCount);
+		std::vector<VkDrawIndexedIndirectCommand> drawCommands(drawCount * (occlusionCulling ? 2 : 1));
+		clusterOutputOffsets.resize(drawCount);
+		uint32_t outputIndexCount = 0;
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				uint32_t j = firstDraw + i;
+				const Mesh* mesh = meshes.get(archetype.meshes[i]);
+				clusterOutputOffsets[j] = outputIndexCount;
+				if (mesh == nullptr)
+				{
+					clusterDraws[j] = {};
+					continue;
+				}
+				outputIndexCount += mesh->getMaxLodTriangleCount() * 3;
+
+				const glm::mat4& transform = archetype.transforms[i];
+				const MeshletRange& meshlets = mesh->getLodMeshlets(selectedLods[j]);
+
+				clusterDraws[j].model = transform * mesh->getDequantization();
+				clusterDraws[j].world = transform;
+				clusterDraws[j].meshletOffset = meshletBases[archetype.meshes[i].index] + meshlets.firstMeshlet;
+				clusterDraws[j].meshletCount = meshlets.meshletCount;
+				clusterDraws[j].outputIndexOffset = clusterOutputOffsets[j];
+				clusterDraws[j].maxScale = std::max(glm::length(glm::vec3(transform[0])),
+					std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+				clusterDraws[j].visibilityOffset = visibilityOffsets[j];
+
+				// indexCount starts at 0, the cull pass adds the triangles that survive
+				drawCommands[j] = { 0, 1, clusterOutputOffsets[j], 0, 0 };
+				if (occlusionCulling)
+				{
+					drawCommands[drawCount + j] = { 0, 1, clusterOutputIndexCount + clusterOutputOffsets[j], 0, 0 };	// Late phase
+				}
+			}
+		});
+
+		VkDeviceSize drawsSize = sizeof(ClusterDraw) * clusterDraws.size();
+		vkMapMemory(mainDevice.logicalDevice, clusterDrawBuffersMemory[imageIndex], 0, drawsSize, 0, &data);
+		memcpy(data, clusterDraws.data(), (size_t)drawsSize);
+		vkUnmapMemory(mainDevice.logicalDevice, clusterDrawBuffersMemory[imageIndex]);
+
+		if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+		{
+			VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * drawCommands.size();
+			vkMapMemory(mainDevice.logicalDevice, clusterIndirectBuffersMemory[imageIndex], 0, commandsSize, 0, &data);
+			memcpy(data, drawCommands.data(), (size_t)commandsSize);
+			vkUnmapMemory(mainDevice.logicalDevice, clusterIndirectBuffersMemory[imageIndex]);
+		}
+	}
+
+	void VulkanRenderer::updateShadows()
+	{
+		// Cascades over the first shadowDistance of the view (near plane of the GL style perspective projection)
+		const glm::mat4& projection = uboViewProjection.projection;
+		float nearDistance = projection[3][2] / (projection[2][2] - 1.0f);
+		float splits[MAX_SHADOW_CASCADES];
+		computeCascadeSplits(nearDistance, shadowDistance, shadowCascadeCount, 0.75f, splits);
+
+		// Static casters as a hash: one appearing, going, moving or changing mesh makes every page stale (FNV-1a)
+		uint64_t staticHash = 14695981039346656037ull;
+		auto hashBytes = [&staticHash](const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t b = 0; b < size; b++)
+			{
+				staticHash = (staticHash ^ bytes[b]) * 1099511628211ull;
+			}
+		};
+		forEachRenderable([&](Archetype& archetype, uint32_t)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				if (!(archetype.flags[i] & ENTITY_FLAG_STATIC)) { continue; }
+
+				uint32_t drawn = (archetype.flags[i] & ENTITY_FLAG_HIDDEN) || !meshes.isValid(archetype.meshes[i]) ? 0 : 1;
+				hashBytes(&archetype.entities[i], sizeof(EntityHandle));
+				hashBytes(&archetype.meshes[i], sizeof(MeshHandle));
+				hashBytes(&drawn, sizeof(drawn));
+				hashBytes(&archetype.transforms[i], sizeof(glm::mat4));
+			}
+		});
+
+		// Snapped cascades only move in whole steps, a page stays valid while its cascade matrix and the static casters do
+		glm::mat4 inverseView = glm::inverse(uboViewProjection.view);
+		staleShadowPages = 0;
+		for (uint32_t c = 0; c < shadowCascadeCount; c++)
+		{
+			shadowCascades[c] = fitCascade(uboViewProjection.view, projection, lightDirection, c == 0 ? nearDistance : splits[c - 1], splits[c],
+				shadowResolution, 16, shadowCasterDistance);
+			if (staticHash != cachedStaticHash || shadowCascades[c].viewProjection != cachedCascadeViewProjections[c])
+			{
+				staleShadowPages |= 1 << c;
+				cachedCascadeViewProjections[c] = shadowCascades[c].viewProjection;
+			}
+
+			// Light clip space xy to the cascade's atlas tile
+			float column = static_cast<float>(c % shadowAtlasColumns);
+			float row = static_cast<float>(c / shadowAtlasColumns);
+			glm::mat4 tileTransform = glm::translate(glm::mat4(1.0f), glm::vec3((column + 0.5f) / shadowAtlasColumns, (row + 0.5f) / shadowAtlasRows, 0.0f))
+				* glm::scale(glm::mat4(1.0f), glm::vec3(0.5f / shadowAtlasColumns, 0.5f / shadowAtlasRows, 1.0f));
+			shadowData.cascadeViewProjections[c] = tileTransform * shadowCascades[c].viewProjection;
+			shadowData.cascadeSplits[c] = shadowCascades[c].splitDistance;
+			shadowData.cascadeTexelSizes[c] = shadowCascades[c].texelSize;
+		}
+		cachedStaticHash = staticHash;
+		shadowData.lightDirection = glm::vec4(-lightDirection, static_cast<float>(shadowCascadeCount));
+		shadowData.cameraPosition = inverseView[3];
+		shadowData.cameraForward = -inverseView[2];
+
+		// Casters of each cascade through the BVH (off screen ones too), drawables without a proxy cast into all
+		shadowCasterMasks.assign(drawCount, 0);
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			if (archetype.componentMask & COMPONENT_SPATIAL) { return; }
+			std::fill(shadowCasterMasks.begin() + firstDraw, shadowCasterMasks.begin() + firstDraw + archetype.size(), (1 << shadowCascadeCount) - 1);
+		});
+		for (uint32_t c = 0; c < shadowCascadeCount; c++)
+		{
+			shadowDraws.clear();
+			bvh.queryFrustum(extractFrustum(shadowCascades[c].viewProjection), shadowDraws);
+			for (uint32_t draw : shadowDraws)
+			{
+				shadowCasterMasks[draw] |= 1 << c;
+			}
+		}
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				if ((archetype.flags[i] & ENTITY_FLAG_HIDDEN) || !meshes.isValid(archetype.meshes[i])) { shadowCasterMasks[firstDraw + i] = 0; }
+			}
+		});
+	}
+
+	void VulkanRenderer::recordCommand(uint32_t currentImage)
+	{
+		VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;	// Submitted once, its pool is reset before the next use
+		//commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // Buffer can be resubmitted while it is also already pending execution
+
+		// Begin recording command buffer (fresh from the frame slot's pool)
+		FrameCommandPool& framePool = *graphicsFramePools[currentFrame];
+		frameCommandBuffer = framePool.allocate(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		if (vkBeginCommandBuffer(frameCommandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to begin recording command buffer!");
+		}
+
+		// Camera values LOD selection needs (same for every mesh this frame)
+		glm::vec3 cameraPosition = glm::vec3(glm::inverse(uboViewProjection.view)[3]);
+		float pixelsPerUnitAtOne = std::abs(uboViewProjection.projection[1][1]) * swapChainExtent.height * 0.5f; // Screen pixels covered by 1 unit at distance 1
+
+		selectedLods.resize(drawCount);
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				const Mesh* mesh = meshes.get(archetype.meshes[i]);
+				selectedLods[firstDraw + i] = mesh != nullptr ? selectLod(*mesh, archetype.transforms[i], cameraPosition, pixelsPerUnitAtOne) : 0;
+			}
+		});
+
+		cullDraws();
+		buildRenderQueue();
+
+		// Async compute passes into their own command buffer, the graphics passes from the first one using their results
+		// into the join command buffer (submitted after the semaphore wait)
+		bool async = renderGraph->hasAsyncCompute();
+		joinCommandBuffer = async ? framePool.allocate(VK_COMMAND_BUFFER_LEVEL_PRIMARY) : frameCommandBuffer;
+		if (async)
+		{
+			computeCommandBuffer = computeFramePools[currentFrame]->allocate(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+			if (vkBeginCommandBuffer(computeCommandBuffer, &commandBufferBeginInfo) != VK_SUCCESS ||
+				vkBeginCommandBuffer(joinCommandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to begin recording command buffer!");
+			}
+			asyncProfiler->beginFrame(computeCommandBuffer, currentImage);
+			renderGraph->executeAsyncCompute(computeCommandBuffer, currentImage);
+			if (vkEndCommandBuffer(computeCommandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to record command buffer!");
+			}
+		}
+
+		// Cull, draw (and with occlusion culling: Hi-Z build, late cull, late draw), barriers in between from the graph
+		gpuProfiler->beginFrame(frameCommandBuffer, currentImage);
+		uint32_t frameScope = gpuProfiler->beginScope(frameCommandBuffer, currentImage, "frame");
+		renderGraph->execute(frameCommandBuffer, currentImage, async ? joinCommandBuffer : VK_NULL_HANDLE);
+		gpuProfiler->endScope(joinCommandBuffer, currentImage, frameScope);
+
+		// Both queues' timings of the frame the slot last finished
+		gpuTimings = gpuProfiler->getTimings();
+		if (async)
+		{
+			gpuTimings.insert(gpuTimings.end(), asyncProfiler->getTimings().begin(), asyncProfiler->getTimings().end());
+		}
+
+		// End recording command buffer
+		VkResult result = vkEndCommandBuffer(frameCommandBuffer);
+		if (result == VK_SUCCESS && async)
+		{
+			result = vkEndCommandBuffer(joinCommandBuffer);
+		}
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record command buffer!");
+		}
+	}
+
+	void VulkanRenderer::buildRenderQueue()
+	{
+		// View distance of the bounding sphere centres over the far distance (GL style perspective projection)
+		const glm::mat4& projection = uboViewProjection.projection;
+		float farDistance = projection[3][2] / (projection[2][2] + 1.0f);
+		bool prePassDraws = depthPrePass && clusterCulling != CLUSTER_CULLING_MESH_SHADER;
+
+		// One pipeline per pass so far: the key orders by material, then mesh (vertex / index buffers), then near to far
+		renderQueue.clear();
+		drawMeshes.resize(drawCount);
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				uint32_t j = firstDraw + i;
+				drawMeshes[j] = archetype.meshes[i];
+				if (!drawVisible[j]) { continue; }	// Hidden by flags, mesh destroyed, frustum or software occlusion
+
+				glm::vec4 centre = archetype.transforms[i] * glm::vec4(glm::vec3(archetype.bounds[i]), 1.0f);
+				float depth = -(uboViewProjection.view * centre).z / farDistance;
+				uint32_t material = archetype.materials[i];
+				uint32_t mesh = archetype.meshes[i].index;
+
+				renderQueue.push(makeOpaqueKey(RENDER_QUEUE_OPAQUE, 0, material, mesh, depth), j);
+				if (prePassDraws)
+				{
+					renderQueue.push(makeOpaqueKey(RENDER_QUEUE_DEPTH_PREPASS, 0, material, mesh, depth), j);
+				}
+			}
+		});
+		renderQueue.sort(*jobSystem);
+
+		// Everything the draw passes bake into their commands: the draws in order with their mesh and LOD, the pipeline
+		// the pre-pass setting picks, and the draw count the late phase's indirect commands are offset by (FNV-1a)
+		drawListHash = 14695981039346656037ull;
+		auto hashBytes = [this](const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t b = 0; b < size; b++)
+			{
+				drawListHash = (drawListHash ^ bytes[b]) * 1099511628211ull;
+			}
+		};
+		for (const RenderItem& item : renderQueue.getItems())
+		{
+			hashBytes(&item.draw, sizeof(item.draw));
+			hashBytes(&drawMeshes[item.draw], sizeof(MeshHandle));
+			hashBytes(&selectedLods[item.draw], sizeof(uint32_t));
+		}
+		hashBytes(&depthPrePass, sizeof(depthPrePass));
+		hashBytes(&drawCount, sizeof(drawCount));
+
+		renderQueueStats = {};	// Binds of the passes recorded this frame (replayed ones record nothing)
+	}
 
-		// Data to create Descriptor pool
-		VkDescriptorPoolCreateInfo poolCreateInfo = {};
-		poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolCreateInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());		// Maximum number of descriptor sets that can be allocated from pool
-		poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());		// Number of different descriptor types
-		poolCreateInfo.pPoolSizes = poolSizes.data();								// Pointer to array of pool sizes
+	void VulkanRenderer::recordClusterCull(VkCommandBuffer commandBuffer, uint32_t currentImage, CullPhase phase)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterCullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterCullPipelineLayout,
+			0, 1, &clusterDescriptorSets[currentImage], 0, nullptr);
 
-		// Create Descriptor Pool
-		if (vkCreateDescriptorPool(mainDevice.logicalDevice, &poolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		// Late phase writes after the early phase's commands and indices
+		if (occlusionCulling)
 		{
-			throw std::runtime_error("Failed to create Descriptor Pool!");
+			uint32_t phaseConstants[3] = {
+				static_cast<uint32_t>(phase),
+				phase == CULL_PHASE_LATE ? drawCount : 0,
+				phase == CULL_PHASE_LATE ? clusterOutputIndexCount : 0
+			};
+			vkCmdPushConstants(commandBuffer, clusterCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+				0, sizeof(phaseConstants), phaseConstants);
 		}
+
+		vkCmdDispatch(commandBuffer, drawCount, 1, 1); // One workgroup per draw
 	}
 
-	void VulkanRenderer::createDescriptorSets()
+	void VulkanRenderer::recordMeshDraws(VkCommandBuffer commandBuffer, uint32_t currentImage, CullPhase phase, bool depthOnly)
 	{
-		// Resize descriptor sets to number of uniform buffers (1 per swapchain image)
-		descriptorSets.resize(swapChainImages.size());
+		if (clusterCulling == CLUSTER_CULLING_MESH_SHADER)
+		{
+			// Task shader culls meshlets, mesh shader emits the survivors
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshShaderPipeline);
+			std::array<VkDescriptorSet, 2> frameSets = { descriptorSets[currentImage], clusterDescriptorSets[currentImage] };
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshShaderPipelineLayout,
+				0, static_cast<uint32_t>(frameSets.size()), frameSets.data(), 0, nullptr);
+
+			// Sorted draws: meshes' vertex sets only bound when the mesh changes
+			uint32_t begin, end;
+			renderQueue.getPassRange(RENDER_QUEUE_OPAQUE, begin, end);
+			VkDescriptorSet boundVertexSet = VK_NULL_HANDLE;
+			for (uint32_t item = begin; item < end; item++)
+			{
+				uint32_t j = renderQueue.getItems()[item].draw;
 
-		std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), descriptorSetLayout); // All layouts will be the same
+				VkDescriptorSet vertexSet = meshVertexDescriptorSets[drawMeshes[j].index];
+				if (vertexSet != boundVertexSet)
+				{
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshShaderPipelineLayout,
+						2, 1, &vertexSet, 0, nullptr);
+					boundVertexSet = vertexSet;
+					renderQueueStats.descriptorSetBinds++;
+				}
+				else
+				{
+					renderQueueStats.bindsSkipped++;
+				}
 
-		// Info to allocate descriptor sets from pool
-		VkDescriptorSetAllocateInfo descriptorSetAllocInfo = {};
-		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		descriptorSetAllocInfo.descriptorPool = descriptorPool;										// Pool to allocate from
-		descriptorSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());	// Number of sets to allocate
-		descriptorSetAllocInfo.pSetLayouts = setLayouts.data();										// // Layouts to use to allocate sets (1:1 relationship)a
+				uint32_t drawConstants[2] = { j, static_cast<uint32_t>(phase) };	// Draw index, cull phase
+				vkCmdPushConstants(commandBuffer, meshShaderPipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
+					0, sizeof(uint32_t) * (occlusionCulling ? 2 : 1), drawConstants);
 
-		// Allocate descriptor sets (multiple)
-		if (vkAllocateDescriptorSets(mainDevice.logicalDevice, &descriptorSetAllocInfo, descriptorSets.data()) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to allocate Descriptor Sets!");
+				uint32_t meshletCount = meshes.get(drawMeshes[j])->getLodMeshlets(selectedLods[j]).meshletCount;
+				cmdDrawMeshTasks(commandBuffer, (meshletCount + 31) / 32, 1, 1); // 32 meshlets per task workgroup
+				renderQueueStats.drawCount++;
+			}
+			return;
 		}
 
-		// Configure each descriptor set to point to corresponding uniform buffer
-		for (size_t i = 0; i < swapChainImages.size(); i++)
+		// Bind graphics pipeline to be used in the Render Pass (late phase draws what the pre-pass didn't, so it tests LESS)
+		VkPipeline pipeline = graphicsPipeline;
+		if (depthOnly) { pipeline = depthPrePassPipeline; }
+		else if (depthPrePass && prePass != RenderGraph::INVALID && phase != CULL_PHASE_LATE) { pipeline = depthEqualPipeline; }
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline); // Bind graphics pipeline
+
+		// Bind Descriptor sets (uniform buffers, object data) to pipeline, once for every draw of the pass
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+			0, 1, &descriptorSets[currentImage], 0, nullptr);
+
+		// Late phase commands follow the early phase ones
+		uint32_t firstCommand = phase == CULL_PHASE_LATE ? drawCount : 0;
+
+		// Sorted draws: vertex and index buffers only bound when they change (the culled indices are one buffer for all)
+		uint32_t begin, end;
+		renderQueue.getPassRange(depthOnly ? RENDER_QUEUE_DEPTH_PREPASS : RENDER_QUEUE_OPAQUE, begin, end);
+		VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+		VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+		for (uint32_t item = begin; item < end; item++)
 		{
-			// View Projection UBO Descriptor info
-			// Buffer Info and Data offset info: what buffer to bind to set, offset and range of data to bind
-			VkDescriptorBufferInfo vpBufferInfo = {};
-			vpBufferInfo.buffer = vpUniformBuffers[i];					// Buffer to bind to set
-			vpBufferInfo.offset = 0;									// Offset in buffer to start at
-			vpBufferInfo.range = sizeof(UboViewProjection);							// Size of data to bind
-			// Write information into descriptor set
-			VkWriteDescriptorSet vpDescriptorWrite = {};
-			vpDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			vpDescriptorWrite.dstSet = descriptorSets[i];				// Descriptor set to update
-			vpDescriptorWrite.dstBinding = 0;							// Binding in shader where data will be available
-			vpDescriptorWrite.dstArrayElement = 0;						// First array element to update
-			vpDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor
-			vpDescriptorWrite.descriptorCount = 1;						// Number of descriptors to update
-			vpDescriptorWrite.pBufferInfo = &vpBufferInfo;			// How this descriptor set is connecting with the buffer described above
-			
-			// Model Dynamic UBO Descriptor info
-			/*
-			VkDescriptorBufferInfo modelBufferInfo = {};
-			modelBufferInfo.buffer = modelDUniformBuffers[i];					// Buffer to bind to set
-			modelBufferInfo.offset = 0;										// Offset in buffer to start at
-			modelBufferInfo.range = modelUniformAlignment;					// Size of data to bind (only one model at a time)
-			// Write information into descriptor set
-			VkWriteDescriptorSet modelDescriptorWrite = {};
-			modelDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			modelDescriptorWrite.dstSet = descriptorSets[i];					// Descriptor set to update
-			modelDescriptorWrite.dstBinding = 1;								// Binding in shader where data will be available
-			modelDescriptorWrite.dstArrayElement = 0;							// First array element to update
-			modelDescriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Type of descriptor
-			modelDescriptorWrite.descriptorCount = 1;							// Number of descriptors to update
-			modelDescriptorWrite.pBufferInfo = &modelBufferInfo;				// How this descriptor set is connecting with the buffer described above
-			*/
-			std::vector<VkWriteDescriptorSet> writeDescriptorSets = { vpDescriptorWrite };
+			uint32_t j = renderQueue.getItems()[item].draw;
 
-			// Update the descriptor set with new buffer/binding info:
-			vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()),
-				writeDescriptorSets.data(), 0, nullptr);
+			Mesh& mesh = *meshes.get(drawMeshes[j]);
+			VkBuffer vertexBuffers = { depthOnly ? mesh.getPositionBuffer() : mesh.getVertexBuffer() };	// Buffers to bind
+			VkDeviceSize offsets[] = { 0 };								// Offsets into buffers
+			if (vertexBuffers != boundVertexBuffer)
+			{
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffers, offsets); // Bind veretex buffer to pipeline
+				boundVertexBuffer = vertexBuffers;
+				renderQueueStats.vertexBufferBinds++;
+			}
+			else
+			{
+				renderQueueStats.bindsSkipped++;
+			}
+
+			// Bind mesh index buffer (or the culled indices the compute pass wrote)
+			VkBuffer indexBuffer = clusterCulling == CLUSTER_CULLING_COMPUTE ? clusterIndexBuffers[currentImage] : mesh.getIndexBuffer();
+			if (indexBuffer != boundIndexBuffer)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32); // Bind index buffer
+				boundIndexBuffer = indexBuffer;
+				renderQueueStats.indexBufferBinds++;
+			}
+			else
+			{
+				renderQueueStats.bindsSkipped++;
+			}
+
+			// Bind push constants (object index, the shader reads the model matrix from the object data)
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &j);
+
+			// Issue draw command
+			// Connected to GLSL gl_VertexIndex variable in vertex shader
+			//vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0); // Draw 3 vertices, 1 instance, first vertex 0, first instance 0
+			if (clusterCulling == CLUSTER_CULLING_COMPUTE)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, clusterIndirectBuffers[currentImage],
+					sizeof(VkDrawIndexedIndirectCommand) * (firstCommand + j), 1, sizeof(VkDrawIndexedIndirectCommand)); // Count written by the cull pass
+			}
+			else
+			{
+				const MeshLod& lod = mesh.getLod(selectedLods[j]);
+				vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, 0); // Draw indexed (selected level of detail)
+			}
+			renderQueueStats.drawCount++;
 		}
 	}
 
-	void VulkanRenderer::updateUniformBuffers(uint32_t imageIndex)
+	void VulkanRenderer::recordHiZBuild(VkCommandBuffer commandBuffer)
 	{
-		
-		// Map memory and write to uniform buffer
-		void* data;
-		vkMapMemory(mainDevice.logicalDevice, vpUniformBuffersMemory[imageIndex], 0, sizeof(UboViewProjection), 0, &data);    // Map to pointer
-		memcpy(data, &uboViewProjection, sizeof(UboViewProjection));														// Copy data to mapped memory
-		vkUnmapMemory(mainDevice.logicalDevice, vpUniformBuffersMemory[imageIndex]);											// Unmap from pointer
+		// The render graph moved the pyramid to GENERAL (old contents discarded) and moves it on to the late cull after
+		VkImageMemoryBarrier hiZBarrier = {};
+		hiZBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		hiZBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		hiZBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		hiZBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		hiZBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		hiZBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hiZBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hiZBarrier.image = hiZImage;
+		hiZBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipeline);
+
+		int32_t sourceWidth = static_cast<int32_t>(swapChainExtent.width);
+		int32_t sourceHeight = static_cast<int32_t>(swapChainExtent.height);
+		for (uint32_t level = 0; level < hiZMipLevels; level++)
+		{
+			int32_t sizes[4] = {
+				sourceWidth, sourceHeight,
+				std::max(static_cast<int32_t>(hiZExtent.width >> level), 1), std::max(static_cast<int32_t>(hiZExtent.height >> level), 1)
+			};
 
-		//// Model UBOs (Dynamic)
-		//for (size_t i = 0; i < meshList.size(); i++)
-		//{
-		//	Model* thisModel = (Model*)((uint64_t)modelTransferSpace + (i * modelUniformAlignment));
-		//	*thisModel = meshList[i].getUboModel();
-		//}
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipelineLayout,
+				0, 1, &hiZDescriptorSets[level], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, hiZPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(sizes), sizes);
+			vkCmdDispatch(commandBuffer, (sizes[2] + 7) / 8, (sizes[3] + 7) / 8, 1);
 
-		//// Map the list of model data
-		//vkMapMemory(mainDevice.logicalDevice, modelDUniformBuffersMemory[imageIndex], 0, modelUniformAlignment * meshList.size(), 0, &data);
-		//memcpy(data, modelTransferSpace, modelUniformAlignment * meshList.size());
-		//vkUnmapMemory(mainDevice.logicalDevice, modelDUniformBuffersMemory[imageIndex]);
+			// Level is read by the next level's build
+			if (level + 1 < hiZMipLevels)
+			{
+				hiZBarrier.subresourceRange.baseMipLevel = level;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+					0, nullptr, 0, nullptr, 1, &hiZBarrier);
+			}
+
+			sourceWidth = sizes[2];
+			sourceHeight = sizes[3];
+		}
 	}
 
-	void VulkanRenderer::recordCommand(uint32_t currentImage)
+	void VulkanRenderer::recordShadowCasters(VkCommandBuffer commandBuffer, uint32_t currentImage, bool staticCasters)
 	{
-		VkCommandBufferBeginInfo commandBufferBeginInfo = {};
-		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		//commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // Buffer can be resubmitted while it is also already pending execution
+		// Static casters redraw their stale pages of the cache, dynamic ones draw into every tile of the atlas
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+			0, 1, &descriptorSets[currentImage], 0, nullptr);
 
-		// Information to begin a render pass (only for graphical applications)
-		VkRenderPassBeginInfo renderPassBeginInfo = {};
-		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassBeginInfo.renderPass = renderPass;									// Render pass to begin
-		renderPassBeginInfo.renderArea.offset = { 0, 0 };								// Offset to start render area from
-		renderPassBeginInfo.renderArea.extent = swapChainExtent;						// Extent of render area to run within
-		
-		// Clear values for each attachment the render pass uses
-		std::array<VkClearValue, 2> clearValues = {};
-		clearValues[0].color = { 0.6f, 0.65f, 0.4f, 1.0f };
-		clearValues[1].depthStencil.depth = 1.0f;
-		renderPassBeginInfo.pClearValues = clearValues.data();					// List of clear values
-		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-
-		renderPassBeginInfo.framebuffer = swapChainFramebuffers[currentImage];					// Framebuffer to use
-
-		// Begin recording command buffer
-		if (vkBeginCommandBuffer(commandBuffers[currentImage], &commandBufferBeginInfo) != VK_SUCCESS)
+		for (uint32_t c = 0; c < shadowCascadeCount; c++)
 		{
-			throw std::runtime_error("Failed to begin recording command buffer!");
-		}
+			if (staticCasters && !(staleShadowPages & (1 << c))) { continue; }
 
-		// Begin render pass
-			
-		// vkCmd * commands go here -----------------------------------------------------
-		vkCmdBeginRenderPass(commandBuffers[currentImage], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE); // Contents will be inline (not secondary command buffers)
+			uint32_t scope = gpuProfiler->beginScope(commandBuffer, currentImage, "shadow cascade " + std::to_string(c) + (staticCasters ? " static" : ""));
 
-			// Bind graphics pipeline to be used in the Render Pass
-			vkCmdBindPipeline(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline); // Bind graphics pipeline
+			VkRect2D tile = {};
+			tile.offset = { static_cast<int32_t>((c % shadowAtlasColumns) * shadowResolution), static_cast<int32_t>((c / shadowAtlasColumns) * shadowResolution) };
+			tile.extent = { shadowResolution, shadowResolution };
+			VkViewport viewport = { static_cast<float>(tile.offset.x), static_cast<float>(tile.offset.y),
+				static_cast<float>(shadowResolution), static_cast<float>(shadowResolution), 0.0f, 1.0f };
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &tile);
 
-			for (size_t j = 0; j < meshList.size(); j++)
+			if (staticCasters)
 			{
-				VkBuffer vertexBuffers = { meshList[j].getVertexBuffer()};	// Buffers to bind
-				VkDeviceSize offsets[] = { 0 };								// Offsets into buffers
-				vkCmdBindVertexBuffers(commandBuffers[currentImage], 0, 1, &vertexBuffers, offsets); // Bind veretex buffer to pipeline
+				VkClearAttachment clearAttachment = {};
+				clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				clearAttachment.clearValue.depthStencil = { 1.0f, 0 };
+				VkClearRect clearRect = { tile, 0, 1 };
+				vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+			}
 
-				// Bind mesh index buffer
-				vkCmdBindIndexBuffer(commandBuffers[currentImage], meshList[j].getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32); // Bind index buffer
+			// Cascade once, each draw only pushes its object index in front of it
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(ObjectPush, cascadeViewProjection),
+				sizeof(glm::mat4), &shadowCascades[c].viewProjection);
 
-				// Dynamic offset for model UBO
-				//uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment * j); // Offset into dynamic UBO for this object's model data
-				// above offset will only be applied to dynamic uniform buffer bindings in the descriptor set
-				
-				// Bind push constants (model data)
-				vkCmdPushConstants(commandBuffers[currentImage], pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, 
-					sizeof(Model), &meshList[j].getUboModel());
-				
-				// Bind Descriptor sets (uniform buffers) to pipeline
-				vkCmdBindDescriptorSets(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 
-					0, 1, &descriptorSets[currentImage], 0, nullptr);
+			forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+			{
+				for (uint32_t i = 0; i < archetype.size(); i++)
+				{
+					uint32_t j = firstDraw + i;
+					bool isStatic = (archetype.flags[i] & ENTITY_FLAG_STATIC) != 0;
+					if (!(shadowCasterMasks[j] & (1 << c)) || isStatic != staticCasters) { continue; }
 
-				// Issue draw command
-				// Connected to GLSL gl_VertexIndex variable in vertex shader
-				//vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0); // Draw 3 vertices, 1 instance, first vertex 0, first instance 0
-				vkCmdDrawIndexed(commandBuffers[currentImage], static_cast<uint32_t>(meshList[j].getIndexCount()), 1, 0, 0, 0); // Draw indexed
+					Mesh& mesh = *meshes.get(archetype.meshes[i]);
+					VkBuffer positionBuffer = mesh.getPositionBuffer();
+					VkDeviceSize offset = 0;
+					vkCmdBindVertexBuffers(commandBuffer, 0, 1, &positionBuffer, &offset);
+					vkCmdBindIndexBuffer(commandBuffer, mesh.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-			}
+					vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &j);
 
-		vkCmdEndRenderPass(commandBuffers[currentImage]); // End render pass
-			
-		// End recording command buffer
-		VkResult result = vkEndCommandBuffer(commandBuffers[currentImage]);
-		if (result != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to record command buffer!");
+					// Cached pages keep the full detail level (the camera's LOD choice would make them stale)
+					const MeshLod& lod = mesh.getLod(staticCasters ? 0 : selectedLods[j]);
+					vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, 0);
+				}
+			});
+
+			gpuProfiler->endScope(commandBuffer, currentImage, scope);
 		}
 	}
 
+	void VulkanRenderer::recordLightBinning(VkCommandBuffer commandBuffer, uint32_t currentImage)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lightBinningPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lightBinningPipelineLayout,
+			0, 1, &descriptorSets[currentImage], 0, nullptr);
+		vkCmdDispatch(commandBuffer, (LIGHT_CLUSTER_COUNT + 63) / 64, 1, 1);	// One invocation per cluster
+	}
+
+	void VulkanRenderer::recordDeferredLighting(VkCommandBuffer commandBuffer, uint32_t currentImage)
+	{
+		// World positions come back from the depth buffer through the inverse of the draws' view projection
+		DeferredLightingPush push;
+		push.inverseViewProjection = glm::inverse(uboViewProjection.projection * uboViewProjection.view);
+		push.screenSize = glm::vec4(swapChainExtent.width, swapChainExtent.height, 1.0f / swapChainExtent.width, 1.0f / swapChainExtent.height);
+
+		VkDescriptorSet sets[2] = { descriptorSets[currentImage], gBufferDescriptorSet };
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, deferredLightingPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, deferredLightingPipelineLayout,
+			0, 2, sets, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, deferredLightingPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+			0, sizeof(DeferredLightingPush), &push);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);		// Fullscreen triangle
+	}
+
 	void VulkanRenderer::getPhysicalDevice()
 	{
 		// Enumerate physical devices that VkInstance can access
@@ -1088,6 +3441,178 @@ namespace EngineCore {
 		//minUniformBufferOffset = deviceProperties.limits.minUniformBufferOffsetAlignment;
 	}
 
+	uint32_t VulkanRenderer::selectLod(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition, float pixelsPerUnitAtOne) const
+	{
+		// Bounding sphere in world space (radius scaled by the largest axis scale)
+		glm::vec4 sphere = mesh.getBoundingSphere();
+		glm::vec3 centre = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+		float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		// Distance to the nearest point of the sphere (clamped so objects around the camera get full detail)
+		float distance = glm::length(centre - cameraPosition) - sphere.w * scale;
+		if (distance <= 0.1f) { return 0; }
+
+		// Screen space error of a level = world error / distance * pixels per unit at distance 1
+		float pixelsPerUnit = pixelsPerUnitAtOne / distance;
+
+		uint32_t selected = 0;
+		for (uint32_t i = 1; i < mesh.getLodCount(); i++)
+		{
+			if (mesh.getLod(i).error * scale * pixelsPerUnit > lodErrorThreshold) { break; }
+			selected = i;
+		}
+		return selected;
+	}
+
+	void VulkanRenderer::cullDraws()
+	{
+		// Hidden entities and ones whose mesh was destroyed are never drawn, the rest are unless the occlusion test hides them
+		drawVisible.resize(drawCount);
+		forEachRenderable([this](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				drawVisible[firstDraw + i] = (archetype.flags[i] & ENTITY_FLAG_HIDDEN) || !meshes.isValid(archetype.meshes[i]) ? 0 : 1;
+			}
+		});
+
+		// Then draws whose world box is outside the view, found through the BVH (only models have a proxy)
+		glm::mat4 viewProjection = uboViewProjection.projection * uboViewProjection.view;
+		if (frustumCulling)
+		{
+			std::vector<uint8_t> inFrustum(drawCount, 0);
+			forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+			{
+				if (archetype.componentMask & COMPONENT_SPATIAL) { return; }
+				std::fill(inFrustum.begin() + firstDraw, inFrustum.begin() + firstDraw + archetype.size(), 1);
+			});
+
+			frustumDraws.clear();
+			bvh.queryFrustum(extractFrustum(viewProjection), *jobSystem, frustumDraws);
+			for (uint32_t draw : frustumDraws)
+			{
+				inFrustum[draw] = 1;
+			}
+			for (uint32_t j = 0; j < drawCount; j++)
+			{
+				drawVisible[j] &= inFrustum[j];
+			}
+		}
+		if (!occlusionCuller) { return; }
+
+		// Every draw's model-view-projection, batched (SIMD)
+		drawMvps.resize(drawCount);
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			multiplyMatrixBatch(viewProjection, archetype.transforms.data(), archetype.size(), &drawMvps[firstDraw]);
+		});
+
+		occlusionCuller->clear();
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				if (!drawVisible[firstDraw + i] || !(archetype.flags[i] & ENTITY_FLAG_OCCLUDER)) { continue; }
+
+				const OccluderGeometry& occluder = occluderGeometry[archetype.meshes[i].index];
+				occlusionCuller->addOccluder(occluder.positions.data(), occluder.positions.size(), occluder.indices.data(), occluder.indices.size(),
+					drawMvps[firstDraw + i]);
+			}
+		});
+		occlusionCuller->rasterize();
+
+		// Box around the bounding sphere (occluders never hide themselves: their surface is inside their own box)
+		forEachRenderable([&](Archetype& archetype, uint32_t firstDraw)
+		{
+			for (uint32_t i = 0; i < archetype.size(); i++)
+			{
+				if (!drawVisible[firstDraw + i]) { continue; }
+
+				const glm::vec4& sphere = archetype.bounds[i];
+				drawVisible[firstDraw + i] = occlusionCuller->testAabb(glm::vec3(sphere) - sphere.w, glm::vec3(sphere) + sphere.w,
+					drawMvps[firstDraw + i]) ? 1 : 0;
+			}
+		});
+	}
+
+	uint32_t VulkanRenderer::getClusterOutputIndicesUsed()
+	{
+		// Every triangle of each draw's largest LOD
+		uint32_t indexCount = 0;
+		forEachRenderable([&](Archetype& archetype, uint32_t)
+		{
+			for (MeshHandle handle : archetype.meshes)
+			{
+				const Mesh* mesh = meshes.get(handle);
+				indexCount += mesh != nullptr ? mesh->getMaxLodTriangleCount() * 3 : 0;
+			}
+		});
+		return indexCount;
+	}
+
+	uint32_t VulkanRenderer::getMeshletVisibilityUsed()
+	{
+		// Every meshlet of each draw's largest LOD (in meshlets)
+		uint32_t entryCount = 0;
+		forEachRenderable([&](Archetype& archetype, uint32_t)
+		{
+			for (MeshHandle handle : archetype.meshes)
+			{
+				const Mesh* mesh = meshes.get(handle);
+				entryCount += mesh != nullptr ? mesh->getMaxLodMeshletCount() : 0;
+			}
+		});
+		return entryCount;
+	}
+
+	BufferHandle VulkanRenderer::createBufferResource(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+	{
+		GpuBuffer buffer;
+		buffer.size = size;
+		createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, size, usage, properties, buffer.buffer, buffer.memory);
+		return buffers.create(buffer);
+	}
+
+	BufferHandle VulkanRenderer::createMappedBufferResource(VkDeviceSize size, VkBufferUsageFlags usage)
+	{
+		BufferHandle handle = createBufferResource(size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		GpuBuffer* buffer = buffers.get(handle);
+		if (vkMapMemory(mainDevice.logicalDevice, buffer->memory, 0, VK_WHOLE_SIZE, 0, &buffer->mapped) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to map buffer memory!");
+		}
+		return handle;
+	}
+
+	void VulkanRenderer::destroyBufferResource(BufferHandle handle)
+	{
+		GpuBuffer* buffer = buffers.get(handle);
+		if (buffer == nullptr) { return; }
+
+		// Handle is released now, the buffer once the submitted frames are done with it
+		deletionQueue->destroyBuffer(graphicsTimeline->getLastSignal(), buffer->buffer, buffer->memory);
+		buffers.destroy(handle);
+	}
+
+	ImageHandle VulkanRenderer::createImageResource(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectFlags)
+	{
+		GpuImage image;
+		image.format = format;
+		image.extent = { width, height };
+		image.image = createImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &image.memory);
+		image.view = createImageView(image.image, format, aspectFlags);
+		return images.create(image);
+	}
+
+	void VulkanRenderer::destroyImageResource(ImageHandle handle)
+	{
+		GpuImage* image = images.get(handle);
+		if (image == nullptr) { return; }
+
+		deletionQueue->destroyImage(graphicsTimeline->getLastSignal(), image->image, image->view, image->memory);
+		images.destroy(handle);
+	}
+
 	void VulkanRenderer::allocateDynamicBufferTransferSpace()
 	{
 		// Calculate alignment of model data
@@ -1159,6 +3684,81 @@ namespace EngineCore {
 		return true;
 	}
 
+	bool VulkanRenderer::checkDeviceExtensionAvailable(VkPhysicalDevice phyDevice, const char* extensionName)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(phyDevice, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(phyDevice, nullptr, &extensionCount, extensions.data());
+
+		for (const auto& extension : extensions)
+		{
+			if (strcmp(extensionName, extension.extensionName) == 0) { return true; }
+		}
+		return false;
+	}
+
+	bool VulkanRenderer::checkMeshShaderSupport(VkPhysicalDevice phyDevice)
+	{
+		// Mesh shader SPIR-V is 1.4, core from Vulkan 1.2
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(phyDevice, &deviceProperties);
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_2 || !checkDeviceExtensionAvailable(phyDevice, VK_EXT_MESH_SHADER_EXTENSION_NAME))
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &meshShaderFeatures;
+		vkGetPhysicalDeviceFeatures2(phyDevice, &features2);
+
+		return meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+	}
+
+	bool VulkanRenderer::checkDynamicRenderingSupport(VkPhysicalDevice phyDevice)
+	{
+		// Extension depends on create_renderpass2 and depth_stencil_resolve, core from Vulkan 1.2
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(phyDevice, &deviceProperties);
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_2 || !checkDeviceExtensionAvailable(phyDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &dynamicRenderingFeatures;
+		vkGetPhysicalDeviceFeatures2(phyDevice, &features2);
+
+		return dynamicRenderingFeatures.dynamicRendering;
+	}
+
+	bool VulkanRenderer::checkTimelineSemaphoreSupport(VkPhysicalDevice phyDevice)
+	{
+		// Core from Vulkan 1.2, frame synchronization is built on it
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(phyDevice, &deviceProperties);
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &timelineSemaphoreFeatures;
+		vkGetPhysicalDeviceFeatures2(phyDevice, &features2);
+
+		return timelineSemaphoreFeatures.timelineSemaphore;
+	}
+
 	bool VulkanRenderer::checkDeviceSuitable(VkPhysicalDevice device)
 	{
 		/*
@@ -1182,7 +3782,7 @@ namespace EngineCore {
 			swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
 		}
 
-		return indices.isValid() && extensionSupported && swapChainValid;
+		return indices.isValid() && extensionSupported && swapChainValid && checkTimelineSemaphoreSupport(device);
 	}
 
 
@@ -1196,11 +3796,11 @@ namespace EngineCore {
 		std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
 		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyList.data());
 
-		// Go through each queue family and check if it has at least 1 required types of queue
+		// Go through each queue family and keep the first one of each type (all of them: the compute family is optional)
 		int i = 0;
 		for (const auto& queueFamily : queueFamilyList)
 		{
-			if (queueFamily.queueCount > 0 && queueFamily.queueFlags && VK_QUEUE_GRAPHICS_BIT)
+			if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && indices.graphicsFamily < 0)
 			{
 				indices.graphicsFamily = i; // If queue family has graphics capability, set its index
 			}
@@ -1209,14 +3809,16 @@ namespace EngineCore {
 			VkBool32 presentationSupport = false;
 			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
 			// If queue is presentation type (can be both graphics and presentation)
-			if (queueFamily.queueCount > 0 && presentationSupport)
+			if (queueFamily.queueCount > 0 && presentationSupport && indices.presentationFamily < 0)
 			{
 				indices.presentationFamily = i; // If queue family has presentation capability, set its index
 			}
 
-			if (indices.isValid())
+			// Dedicated compute family: runs alongside the graphics queue instead of sharing its hardware queue
+			if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+				!(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && indices.computeFamily < 0)
 			{
-				break; // If all required queue families are found, break out of loop
+				indices.computeFamily = i;
 			}
 
 			i++;
@@ -1342,7 +3944,37 @@ namespace EngineCore {
 		throw std::runtime_error("Failed to find supported format!");
 	}
 
-	VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertiesFlags, VkDeviceMemory* imageMemory)
+	VkFormat VulkanRenderer::chooseDepthFormat()
+	{
+		// Occlusion culling also samples depth to build the Hi-Z pyramid
+		VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		if (occlusionCulling)
+		{
+			depthFeatures |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		}
+
+		return chooseSupportedFormat(
+			{ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
+			VK_IMAGE_TILING_OPTIMAL,
+			depthFeatures);
+	}
+
+	VkSampleCountFlagBits VulkanRenderer::chooseMsaaSamples(VkSampleCountFlagBits requested)
+	{
+		// Highest count up to the requested one that colour and depth attachments both support
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
+		VkSampleCountFlags supported = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+
+		uint32_t samples = requested;
+		while (samples > VK_SAMPLE_COUNT_1_BIT && !(supported & samples))
+		{
+			samples >>= 1;
+		}
+		return static_cast<VkSampleCountFlagBits>(samples);
+	}
+
+	VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propertiesFlags, VkDeviceMemory* imageMemory, uint32_t mipLevels)
 	{
 		// CREATE IMAGE
 		// Image creation information
@@ -1352,7 +3984,7 @@ namespace EngineCore {
 		imageCreateInfo.extent.width = width;							// Width of image
 		imageCreateInfo.extent.height = height;							// Height of image
 		imageCreateInfo.extent.depth = 1;								// Depth of image (1 for 2D images)
-		imageCreateInfo.mipLevels = 1;									// Number of mipmap levels
+		imageCreateInfo.mipLevels = mipLevels;							// Number of mipmap levels
 		imageCreateInfo.arrayLayers = 1;								// Number of levels in image array
 		imageCreateInfo.format = format;								// Format of image data
 		imageCreateInfo.tiling = tiling;								// Tiling arrangement of data for optimal reading
@@ -1392,7 +4024,7 @@ namespace EngineCore {
 		return image;
 	}
 
-	VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+	VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t levelCount)
 	{
 		VkImageViewCreateInfo viewCreateInfo = {};
 		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1406,8 +4038,8 @@ namespace EngineCore {
 
 		// Subresources allow the view to view only a part of an image
 		viewCreateInfo.subresourceRange.aspectMask = aspectFlags;				// Which aspect of image to view (e.g. COLOR_BIT for viewing colour)
-		viewCreateInfo.subresourceRange.baseMipLevel = 0;						// Start mipmap level to view from
-		viewCreateInfo.subresourceRange.levelCount = 1;							// Number of mipmap levels to view
+		viewCreateInfo.subresourceRange.baseMipLevel = baseMipLevel;			// Start mipmap level to view from
+		viewCreateInfo.subresourceRange.levelCount = levelCount;				// Number of mipmap levels to view
 		viewCreateInfo.subresourceRange.baseArrayLayer = 0;						// Start array level to view from
 		viewCreateInfo.subresourceRange.layerCount = 1;							// Number of array levels to view
 
@@ -13,10 +13,35 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <memory>
 
 #include "utilities.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "SceneGraph.h"
+#include "TransformBatch.h"
+#include "Bvh.h"
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "TimelineSemaphore.h"
+#include "DeletionQueue.h"
+#include "FrameCommandPool.h"
+#include "EntityStore.h"
+#include "HandlePool.h"
+#include "GpuResources.h"
+#include "ShadowCascades.h"
+#include "ClusteredLighting.h"
+#include "RenderQueue.h"
 
 namespace EngineCore {
+	// How geometry is culled below whole-mesh granularity
+	enum ClusterCulling
+	{
+		CLUSTER_CULLING_OFF,			// Draw every triangle of the selected LOD
+		CLUSTER_CULLING_COMPUTE,		// Compute pass culls meshlets and writes compacted indices + indirect draws
+		CLUSTER_CULLING_MESH_SHADER		// Task shader culls, mesh shader emits (falls back to COMPUTE if unsupported)
+	};
+
 	class VulkanRenderer
 	{
 	public:
@@ -25,7 +50,108 @@ namespace EngineCore {
 
 		int init(GLFWwindow* newWindow);
 
-		void updateModel(int modelID, glm::mat4 newModel);
+		// Settings (must be set before init)
+		void setVertexFormat(VertexFormat newVertexFormat);
+
+		// LOD selection: coarsest level whose error projects to at most this many pixels
+		void setLodErrorThreshold(float newThresholdPixels);
+		void setClusterCulling(ClusterCulling newClusterCulling);
+
+		// Two-phase Hi-Z occlusion culling of meshlets (needs cluster culling)
+		void setOcclusionCulling(bool enabled);
+
+		// CPU masked occlusion culling of whole meshes (every mesh is also an occluder)
+		void setSoftwareOcclusion(bool enabled);
+
+		// CPU frustum culling of whole models through the BVH
+		void setFrustumCulling(bool enabled);
+
+		// Depth-only pass over the position streams before the forward pass, which then shades with an EQUAL depth
+		// test and no depth writes. Can be toggled at any time (no effect with mesh shaders)
+		void setDepthPrePass(bool enabled);
+
+		// Multisampled colour and depth, resolved into the swapchain image as the forward pass ends. Clamped to what the
+		// device supports; changing it after init waits for the device and rebuilds the render graph and pipelines.
+		// Not with occlusion culling (the Hi-Z build reads single sample depth)
+		void setMsaaSamples(VkSampleCountFlagBits samples);
+		VkSampleCountFlagBits getMsaaSamples() const;
+
+		// Graphics passes begin with VK_KHR_dynamic_rendering instead of render pass and framebuffer objects
+		// (falls back to render passes if unsupported)
+		void setDynamicRendering(bool enabled);
+
+		// Cascaded shadow maps of a directional light, sampled in the forward pass. Static models are drawn into cached
+		// atlas pages (one per cascade), redrawn only when the light, a static model or the cascade's snapped position
+		// changes; every frame copies the cache into the atlas and draws the dynamic models over it. Tiles get the highest
+		// resolution (up to 2048) at which the atlas and its cache fit the budget
+		void setShadows(bool enabled);
+		void setShadowCascadeCount(uint32_t count);				// 1 to MAX_SHADOW_CASCADES
+		void setShadowAtlasBudget(VkDeviceSize bytes);
+		void setLightDirection(const glm::vec3& direction);		// Any time: the direction the light travels in
+
+		// Clustered forward lighting: a compute pass bins the lights into view space clusters (screen tiles split into
+		// exponential depth slices) every frame, and the forward pass shades each fragment with its cluster's lights only.
+		// Without shadows the scene is lit by these lights over a dim ambient
+		void setClusteredLighting(bool enabled);
+		void setLights(const std::vector<Light>& newLights);	// Any time, up to MAX_LIGHTS (the rest are ignored)
+
+		// Deferred shading: the draw pass writes a G-buffer (RGBA8 albedo, 10:10:10:2 normal, depth) and a lighting subpass
+		// of the same render pass shades each pixel once from it, read as input attachments so tilers never write it to
+		// memory. Lighting matches the forward pass (shadows, clustered lights). Needs render pass objects and single
+		// sample attachments: disables dynamic rendering, MSAA and occlusion culling (its late phase splits the render pass)
+		void setDeferredShading(bool enabled);
+
+		// Async compute: light binning and compute cluster culling run on a dedicated compute queue family, submitted
+		// ahead of the graphics work and overlapping the shadow passes (and the depth pre-pass for binning); the graphics
+		// queue waits on a semaphore only at the first pass reading their output. Falls back to the graphics queue
+		// without a compute-only family, or for passes the graph has to keep there (the early cull with occlusion culling)
+		void setAsyncCompute(bool enabled);
+
+		// Meshes loaded at init, in load order (models drawing a destroyed mesh stop drawing, its buffers are freed once the
+		// frames already submitted are done with them, without waiting for the device)
+		const std::vector<MeshHandle>& getMeshes() const;
+		void destroyMesh(MeshHandle mesh);
+
+		// A model is an entity drawing one mesh from a root scene graph node, its world matrix is the model transform
+		// (re-parent nodes to build hierarchies). init creates one per mesh; with cluster culling the total can't outgrow
+		// what init sized the cluster buffers for
+		EntityHandle createModel(MeshHandle mesh);
+		void destroyModel(EntityHandle model);		// Also destroys its scene node, stale handles are ignored
+		const std::vector<EntityHandle>& getModels() const;
+
+		// Throw if the model handle is stale
+		SceneGraph& getSceneGraph();
+		uint32_t getModelNode(EntityHandle model);
+		void updateModel(EntityHandle model, glm::mat4 newModel);	// Sets the local matrix of the model's node
+		void setModelStatic(EntityHandle model, bool isStatic);		// ENTITY_FLAG_STATIC: shadow cached (moving it redraws the cache)
+
+		// Model whose world bounding box the ray enters first (as of the last drawn frame), INVALID_ENTITY if none
+		EntityHandle pickModel(const glm::vec3& origin, const glm::vec3& direction, float& hitDistance);
+
+		// Passes, barriers per frame and transient attachment memory of the frame's render graph
+		const RenderGraphStats& getRenderGraphStats() const;
+
+		// Cascade tile resolution the shadow budget allowed and the memory of the atlas and its cache (0 without shadows)
+		uint32_t getShadowResolution() const;
+		VkDeviceSize getShadowMemoryBytes() const;
+
+		// Deferred shading: the G-buffer and lighting passes alone compiled as one render pass with a lighting subpass, and
+		// as two render passes, to compare their attachment memory and traffic (empty stats without deferred shading)
+		const RenderGraphStats& getDeferredSubpassStats() const;
+		const RenderGraphStats& getDeferredSeparatePassStats() const;
+
+		// Draws the last recorded frame issued from its sorted render queue, the binds they needed and the ones skipped
+		// because the state was already bound
+		const RenderQueueStats& getRenderQueueStats() const;
+
+		// GPU time of the whole frame ("frame") and of every render graph pass, a few frames behind (empty without timestamps).
+		// Async compute passes are tagged with the "async compute" queue, on the same device clock as the graphics ones
+		const std::vector<GpuTiming>& getGpuTimings() const;
+
+		// GPU progress in graphics timeline values, one per frame: the last frame submitted, and the last one the GPU has
+		// finished (polled, never blocks). Anything a frame used is free to reuse once it has completed
+		uint64_t getSubmittedFrameValue() const;
+		uint64_t getCompletedFrameValue();
 
 		void draw();
 		void cleanup();
@@ -35,8 +161,69 @@ namespace EngineCore {
 
 		int currentFrame = 0;
 
+		// Settings
+		VertexFormat vertexFormat = VERTEX_FORMAT_FLOAT;
+		float lodErrorThreshold = 1.0f;
+		ClusterCulling clusterCulling = CLUSTER_CULLING_OFF;
+		bool occlusionCulling = false;
+		bool softwareOcclusion = false;
+		bool frustumCulling = false;
+		bool dynamicRendering = false;
+		bool depthPrePass = false;
+		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+		bool shadows = false;
+		uint32_t shadowCascadeCount = MAX_SHADOW_CASCADES;
+		VkDeviceSize shadowAtlasBudget = 32 * 1024 * 1024;
+		glm::vec3 lightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, -0.5f));
+		float shadowDistance = 20.0f;				// View distance the last cascade ends at
+		float shadowCasterDistance = 20.0f;			// How far towards the light casters outside a cascade are caught
+		bool clusteredLighting = false;
+		bool deferredShading = false;
+		bool asyncCompute = false;
+
 		// Scene Objects
-		std::vector<Mesh> meshList;
+		HandlePool<Mesh> meshes;				// GPU geometry, drawn by entities (arrays "per mesh" are indexed by handle index)
+		std::vector<MeshHandle> loadedMeshes;
+
+		// Renderable entities are numbered as draws in forEachRenderable order (changes when models are created or destroyed)
+		EntityStore entities;
+		std::vector<EntityHandle> models;
+		uint32_t drawCount = 0;
+		std::vector<uint32_t> selectedLods;		// LOD level of each draw this frame (chosen in recordCommand)
+		std::vector<uint8_t> drawVisible;		// Software occlusion result of each draw this frame
+
+		// Visible draws of the frame keyed by pass, state and depth, sorted so consecutive draws share their binds
+		enum RenderQueuePass
+		{
+			RENDER_QUEUE_DEPTH_PREPASS = 0,
+			RENDER_QUEUE_OPAQUE = 1			// Forward / G-buffer passes (early and late phase)
+		};
+		RenderQueue renderQueue;
+		RenderQueueStats renderQueueStats;
+		std::vector<MeshHandle> drawMeshes;		// Mesh of each draw this frame (the queue only holds draw indices)
+		uint64_t drawListHash = 0;				// What the draw passes record this frame: their cached command buffers' key
+
+		SceneGraph sceneGraph;
+
+		// World bounding boxes of the models, user data is the draw index (set every frame)
+		Bvh bvh;
+		std::vector<EntityHandle> proxyModels;	// Model of each BVH proxy
+		std::vector<uint32_t> frustumDraws;
+
+		// CPU work
+		std::unique_ptr<JobSystem> jobSystem;
+
+		// - Software occlusion culling
+		struct OccluderGeometry {
+			std::vector<glm::vec3> positions;		// Object space
+			std::vector<uint32_t> indices;			// Base level of detail
+		};
+
+		std::unique_ptr<MaskedOcclusionCuller> occlusionCuller;
+		std::vector<OccluderGeometry> occluderGeometry;		// Per mesh, used by entities flagged ENTITY_FLAG_OCCLUDER
+		std::vector<glm::mat4> drawMvps;					// Model-view-projection of each draw this frame
+
+		std::vector<Light> lights;							// Point and spot lights (clustered lighting)
 
 		// Scene Settings
 		struct UboViewProjection {
@@ -54,16 +241,46 @@ namespace EngineCore {
 
 		VkQueue graphicsQueue;
 		VkQueue presentationQueue;
+		VkQueue computeQueue = VK_NULL_HANDLE;		// Dedicated compute family (async compute)
 		VkSurfaceKHR surface;
 		VkSwapchainKHR swapchain;
 
 		std::vector<SwapchainImage> swapChainImages;
-		std::vector<VkFramebuffer> swapChainFramebuffers;
-		std::vector<VkCommandBuffer> commandBuffers;
-
-		VkImage DepthBufferImage;
-		VkDeviceMemory DepthBufferImageMemory;
-		VkImageView DepthBufferImageView;
+		// Command buffers of the frame being recorded, from its frame slot's pools (reset when the slot is reused)
+		VkCommandBuffer frameCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;		// Async compute passes (compute queue)
+		VkCommandBuffer joinCommandBuffer = VK_NULL_HANDLE;			// Graphics passes from the first one waiting on async compute
+
+		// Buffers and images owned through handles (released with destroyBufferResource / destroyImageResource)
+		HandlePool<GpuBuffer> buffers;
+		HandlePool<GpuImage> images;
+
+		// - Render graph: the frame's passes, their barriers, render passes, framebuffers and transient attachments (depth)
+		std::unique_ptr<RenderGraph> renderGraph;
+		RenderGraph::Resource swapchainColour = RenderGraph::INVALID;
+		RenderGraph::Resource depthBuffer = RenderGraph::INVALID;
+		RenderGraph::Resource clusterIndices = RenderGraph::INVALID;		// clusterIndexBuffers
+		RenderGraph::Resource clusterCommands = RenderGraph::INVALID;		// clusterIndirectBuffers
+		RenderGraph::Resource meshletVisibility = RenderGraph::INVALID;
+		RenderGraph::Resource hiZPyramid = RenderGraph::INVALID;
+		uint32_t forwardPass = RenderGraph::INVALID;						// Pipelines are created against its render pass
+		uint32_t prePass = RenderGraph::INVALID;							// Depth pre-pass, always clears depth (empty when disabled)
+
+		RenderGraph::Resource shadowAtlasImage = RenderGraph::INVALID;
+		RenderGraph::Resource shadowCacheImage = RenderGraph::INVALID;
+		uint32_t shadowCachePass = RenderGraph::INVALID;					// Shadow pipeline is created against its render pass
+
+		RenderGraph::Resource clusterLightLists = RenderGraph::INVALID;	// clusterLightBuffers
+
+		RenderGraph::Resource gBufferAlbedo = RenderGraph::INVALID;
+		RenderGraph::Resource gBufferNormal = RenderGraph::INVALID;
+		uint32_t lightingPass = RenderGraph::INVALID;						// Deferred lighting subpass after forwardPass (the G-buffer pass)
+		RenderGraphStats deferredSubpassStats;								// compileDeferredComparison, deferred shading only
+		RenderGraphStats deferredSeparatePassStats;
+
+		std::unique_ptr<GpuProfiler> gpuProfiler;							// Times the render graph passes
+		std::unique_ptr<GpuProfiler> asyncProfiler;							// Times the async compute passes
+		std::vector<GpuTiming> gpuTimings;									// Both profilers' timings
 
 		// - Descriptors
 		VkDescriptorSetLayout descriptorSetLayout;
@@ -73,8 +290,138 @@ namespace EngineCore {
 		VkDescriptorPool descriptorPool;
 		std::vector<VkDescriptorSet> descriptorSets;
 
-		std::vector<VkBuffer> vpUniformBuffers;
-		std::vector<VkDeviceMemory> vpUniformBuffersMemory;
+		std::vector<BufferHandle> vpUniformBuffers;
+
+		// - Per object data (set 0 binding 1, see Shaders/object_data.glsl): written once per frame, draws push only their index
+		struct ObjectData {						// Matches ObjectData in Shaders/object_data.glsl
+			glm::mat4 model;					// Stored positions -> world (dequantization included)
+			uint32_t material;
+			uint32_t flags;						// ENTITY_FLAG_*
+			uint32_t padding[2];
+		};
+
+		struct ObjectPush {						// Matches PushObject in Shaders/object_data.glsl
+			uint32_t objectIndex;				// Draw index
+			uint32_t padding[3];
+			glm::mat4 cascadeViewProjection;	// Shadow pass only, pushed once per cascade
+		};
+
+		std::vector<BufferHandle> objectBuffers;	// One per swapchain image, persistently mapped, grown with the draw count
+
+		// - Cluster culling
+		struct ClusterDraw {					// Matches ClusterDraw in Shaders/meshlet_common.glsl
+			glm::mat4 model;
+			glm::mat4 world;
+			uint32_t meshletOffset;
+			uint32_t meshletCount;
+			uint32_t outputIndexOffset;
+			float maxScale;
+			uint32_t visibilityOffset;
+			uint32_t padding[3];
+		};
+
+		struct CullData {						// Matches CullData in Shaders/meshlet_common.glsl
+			glm::vec4 frustumPlanes[6];
+			glm::vec4 cameraPosition;
+			glm::mat4 viewProjection;
+			glm::vec4 hiZSize;					// Hi-Z level 0 width, height, mip count
+			uint32_t visibilityEpoch;
+		};
+
+		// Which meshlets a cull pass / draw handles (matches CULL_PHASE_* in Shaders/meshlet_common.glsl)
+		enum CullPhase
+		{
+			CULL_PHASE_ALL = 0,					// No occlusion culling, single pass
+			CULL_PHASE_EARLY = 1,				// Meshlets visible last frame
+			CULL_PHASE_LATE = 2					// Meshlets found visible by the Hi-Z test that the early phase missed
+		};
+
+		bool meshShaderSupported = false;
+		PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks = nullptr;
+		PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+		PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+		VkDescriptorSetLayout clusterSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout meshVertexSetLayout = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> clusterDescriptorSets;		// One per swapchain image
+		std::vector<VkDescriptorSet> meshVertexDescriptorSets;	// One per mesh (mesh shader path)
+
+		VkBuffer meshletBuffer;									// Meshlets of every mesh
+		VkDeviceMemory meshletBufferMemory;
+		VkBuffer meshletVertexBuffer;
+		VkDeviceMemory meshletVertexBufferMemory;
+		VkBuffer meshletTriangleBuffer;
+		VkDeviceMemory meshletTriangleBufferMemory;
+		std::vector<uint32_t> meshletBases;						// First meshlet of each mesh in meshletBuffer
+		std::vector<uint32_t> clusterOutputOffsets;				// Where each draw's compacted indices start (rebuilt every frame)
+		uint32_t clusterOutputIndexCount = 0;					// Per phase index capacity, fixed at init
+		uint32_t clusterDrawCapacity = 0;
+
+		std::vector<VkBuffer> cullDataBuffers;
+		std::vector<VkDeviceMemory> cullDataBuffersMemory;
+		std::vector<VkBuffer> clusterDrawBuffers;
+		std::vector<VkDeviceMemory> clusterDrawBuffersMemory;
+		std::vector<VkBuffer> clusterIndirectBuffers;
+		std::vector<VkDeviceMemory> clusterIndirectBuffersMemory;
+		std::vector<VkBuffer> clusterIndexBuffers;
+		std::vector<VkDeviceMemory> clusterIndexBuffersMemory;
+
+		// - Occlusion culling
+		VkBuffer meshletVisibilityBuffer = VK_NULL_HANDLE;		// Per draw and meshlet of its largest LOD, written by the late phase
+		VkDeviceMemory meshletVisibilityBufferMemory;
+		uint32_t meshletVisibilityCapacity = 0;					// Entries, fixed at init
+		std::vector<uint32_t> meshletVisibilityLayout;			// Offset and mesh of each draw the entries were written for
+		uint32_t meshletVisibilityEpoch = 1;					// Bumped when the layout changes, older entries read as not visible
+
+		VkImage hiZImage;										// Farthest depth pyramid, GENERAL while built, read only for the late cull
+		VkDeviceMemory hiZImageMemory;
+		VkImageView hiZImageView;								// All levels, sampled by the cull pass
+		std::vector<VkImageView> hiZMipViews;					// One level each, for building
+		VkSampler hiZSampler;
+		VkExtent2D hiZExtent = { 0, 0 };
+		uint32_t hiZMipLevels = 0;
+
+		VkDescriptorSetLayout hiZSetLayout = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> hiZDescriptorSets;			// One per level: source + destination
+
+		// - Shadows
+		struct ShadowData {						// Matches ShadowData in Shaders/lighting.glsl
+			glm::mat4 cascadeViewProjections[MAX_SHADOW_CASCADES];	// World to atlas uv (xy) and depth (z)
+			glm::vec4 cascadeSplits;			// View distance each cascade ends at
+			glm::vec4 cascadeTexelSizes;		// World size of a texel (normal offset)
+			glm::vec4 lightDirection;			// xyz towards the light, w = cascade count
+			glm::vec4 cameraPosition;
+			glm::vec4 cameraForward;
+		} shadowData;
+
+		uint32_t shadowResolution = 0;							// Of a cascade's tile, from the budget at init
+		VkDeviceSize shadowMemoryBytes = 0;						// Atlas and cache
+		uint32_t shadowAtlasColumns = 1;
+		uint32_t shadowAtlasRows = 1;
+		ShadowCascade shadowCascades[MAX_SHADOW_CASCADES];		// This frame's
+		glm::mat4 cachedCascadeViewProjections[MAX_SHADOW_CASCADES] = {};	// What each static page was drawn with
+		uint64_t cachedStaticHash = 0;							// Static casters the pages were drawn with
+		uint32_t staleShadowPages = 0;							// Cascade bits the cache pass redraws this frame
+		std::vector<uint8_t> shadowCasterMasks;					// Cascade bits each draw casts into this frame
+		std::vector<uint32_t> shadowDraws;
+
+		ImageHandle shadowAtlas;								// Sampled by the forward passes, rebuilt every frame
+		ImageHandle shadowCache;								// Static casters only, kept between frames
+		VkSampler shadowSampler = VK_NULL_HANDLE;				// Depth compare, linear filtered (2x2 PCF per tap)
+		std::vector<BufferHandle> shadowUniformBuffers;
+
+		// - Clustered lighting (set 0 bindings 4-6, see Shaders/clustered_lighting.glsl), one of each per swapchain image
+		std::vector<BufferHandle> lightGridBuffers;				// LightGridData
+		std::vector<BufferHandle> lightBuffers;					// Lights, MAX_LIGHTS capacity
+		std::vector<BufferHandle> clusterLightBuffers;			// Light count and indices of each cluster, written by the binning pass
+
+		// - Deferred shading: G-buffer input attachments (set 1 of the lighting pipeline, see Shaders/deferred_lighting.frag)
+		VkDescriptorSetLayout gBufferSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSet gBufferDescriptorSet = VK_NULL_HANDLE;		// One for all frames: the graph's transient images are shared
+		struct DeferredLightingPush {			// Matches PushLighting in Shaders/deferred_lighting.frag
+			glm::mat4 inverseViewProjection;
+			glm::vec4 screenSize;				// Width, height, 1 / width, 1 / height
+		};
 
 		std::vector<VkBuffer> modelDUniformBuffers;
 		std::vector<VkDeviceMemory> modelDUniformBuffersMemory;
@@ -87,10 +434,25 @@ namespace EngineCore {
 		// - Pipeline
 		VkPipeline graphicsPipeline;
 		VkPipelineLayout pipelineLayout;
-		VkRenderPass renderPass;
+		VkPipeline depthPrePassPipeline = VK_NULL_HANDLE;		// Positions only, no fragment shader
+		VkPipeline depthEqualPipeline = VK_NULL_HANDLE;			// graphicsPipeline testing EQUAL without writes, after the pre-pass
+		VkPipeline shadowPipeline = VK_NULL_HANDLE;				// Position stream into an atlas tile (push constant = light MVP)
+
+		VkPipeline clusterCullPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout clusterCullPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline meshShaderPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout meshShaderPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline hiZPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout hiZPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline lightBinningPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout lightBinningPipelineLayout = VK_NULL_HANDLE;		// Set 0 only
+		VkPipeline deferredLightingPipeline = VK_NULL_HANDLE;			// Fullscreen triangle in the lighting subpass
+		VkPipelineLayout deferredLightingPipelineLayout = VK_NULL_HANDLE;	// Set 0 + G-buffer set, push constant = DeferredLightingPush
 
 		// - Pools
-		VkCommandPool graphicsCommandPool;
+		VkCommandPool graphicsCommandPool;		// Uploads and the render graph's cached secondaries (kept across frames)
+		std::vector<std::unique_ptr<FrameCommandPool>> graphicsFramePools;		// One per frame in flight
+		std::vector<std::unique_ptr<FrameCommandPool>> computeFramePools;		// Async compute only
 
 		// - Utility
 		VkFormat swapChainImageFormat;
@@ -99,8 +461,15 @@ namespace EngineCore {
 		// - Sync objects
 		std::vector<VkSemaphore> imageAvailableSemaphore;
 		std::vector<VkSemaphore> renderFinishedSemaphore;
+		// Timelines: each frame's last graphics submission and each async compute submission signal the next value.
+		// Binary semaphores are left for the swapchain only (acquire and present can't use timelines)
+		std::unique_ptr<TimelineSemaphore> graphicsTimeline;
+		std::unique_ptr<TimelineSemaphore> computeTimeline;
+		std::vector<uint64_t> frameTimelineValues;		// graphicsTimeline value of each frame in flight
+		std::vector<uint64_t> imageTimelineValues;		// Of each swapchain image's last frame (its buffers and descriptor sets)
 
-		std::vector<VkFence> drawFences;
+		// Destroyed buffers and images wait here for the last submitted frame, flushed as frames complete
+		std::unique_ptr<DeletionQueue> deletionQueue;
 
 		// (Vulkan methods) ------------------
 		// 1) Create functions
@@ -108,27 +477,75 @@ namespace EngineCore {
 		void createLogicalDevice();
 		void createSurface();
 		void createSwapChain();
-		void createRenderPass();
+		void createRenderGraph();
+		RenderGraphStats compileDeferredComparison(bool lightingSubpass);
+		void bindRenderGraphBuffers();
+		void recreateRenderGraph();		// Device idle: new graph and graphics pipelines for changed attachments
 		void createDescriptorSetlayout();
 		void createPushConstantRange();
 		void createGraphicsPipeline();
-		void createDepthBufferImage();
-		void createFramebuffers();
+		void destroyGraphicsPipelines();
 		void createCommandPool();
-		void createCommandBuffers();
 		void createSyncObjects();
 		
 		void createUniformBuffers();
 		void createDescriptorPool();
 		void createDescriptorSets();
 
+		void createClusterCullPipeline();
+		void createClusterBuffers();
+		void createClusterDescriptorSets();
+
+		void createHiZPipeline();
+		void createHiZResources();
+		void createHiZDescriptorSets();
+
+		void createShadowResources();
+
+		void createLightBinningPipeline();
+		void createLightBuffers();
+
+		void updateTransforms();
 		void updateUniformBuffers(uint32_t imageIndex);
+		void updateObjectBuffer(uint32_t imageIndex);
+		void updateClusterBuffers(uint32_t imageIndex);
+		void updateShadows();
 
 		// - Record Functions
 		void recordCommand(uint32_t currentImage);
+		void recordClusterCull(VkCommandBuffer commandBuffer, uint32_t currentImage, CullPhase phase);
+		void recordMeshDraws(VkCommandBuffer commandBuffer, uint32_t currentImage, CullPhase phase, bool depthOnly);
+		void recordHiZBuild(VkCommandBuffer commandBuffer);
+		void recordShadowCasters(VkCommandBuffer commandBuffer, uint32_t currentImage, bool staticCasters);
+		void recordLightBinning(VkCommandBuffer commandBuffer, uint32_t currentImage);
+		void recordDeferredLighting(VkCommandBuffer commandBuffer, uint32_t currentImage);
 
 		// - Get Functions
 		void getPhysicalDevice();
+		uint32_t selectLod(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition, float pixelsPerUnitAtOne) const;
+
+		// Calls function(archetype, firstDraw) for every archetype of renderable entities, its rows are draws firstDraw onwards
+		template <typename Function>
+		void forEachRenderable(Function function)
+		{
+			uint32_t firstDraw = 0;
+			entities.forEachArchetype(RENDERABLE_COMPONENTS, [&](Archetype& archetype)
+			{
+				function(archetype, firstDraw);
+				firstDraw += archetype.size();
+			});
+		}
+		void cullDraws();
+		void buildRenderQueue();
+		uint32_t getClusterOutputIndicesUsed();
+		uint32_t getMeshletVisibilityUsed();
+
+		// - Pooled resources
+		BufferHandle createBufferResource(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+		BufferHandle createMappedBufferResource(VkDeviceSize size, VkBufferUsageFlags usage);		// Host visible + coherent, mapped until destroyed
+		void destroyBufferResource(BufferHandle handle);
+		ImageHandle createImageResource(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectFlags);
+		void destroyImageResource(ImageHandle handle);
 
 		// - Allocate Functions
 		void allocateDynamicBufferTransferSpace();
@@ -139,6 +556,10 @@ namespace EngineCore {
 		bool checkInstanceExtensionSupport(const std::vector<const char*>* checkExtensions);
 		bool checkDeviceExtensionSupport(VkPhysicalDevice phyDevice);
 		bool checkDeviceSuitable(VkPhysicalDevice device);
+		bool checkDeviceExtensionAvailable(VkPhysicalDevice phyDevice, const char* extensionName);
+		bool checkMeshShaderSupport(VkPhysicalDevice phyDevice);
+		bool checkDynamicRenderingSupport(VkPhysicalDevice phyDevice);
+		bool checkTimelineSemaphoreSupport(VkPhysicalDevice phyDevice);
 
 		// - Get Functions
 		QueueFamilyIndices getQueueFamilies(VkPhysicalDevice device);
@@ -149,11 +570,14 @@ namespace EngineCore {
 		VkPresentModeKHR	chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& presentationModes);
 		VkExtent2D  chooseSwapExtent(const VkSurfaceCapabilitiesKHR &surfaceCapabilities);
 		VkFormat chooseSupportedFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
+		VkFormat chooseDepthFormat();
+		VkSampleCountFlagBits chooseMsaaSamples(VkSampleCountFlagBits requested);
 
 		// - Create Functions
 		VkImage createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-			VkMemoryPropertyFlags propertiesFlags, VkDeviceMemory* imageMemory);
-		VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+			VkMemoryPropertyFlags propertiesFlags, VkDeviceMemory* imageMemory, uint32_t mipLevels = 1);
+		VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+			uint32_t baseMipLevel = 0, uint32_t levelCount = 1);
 		VkShaderModule createShaderModule(const std::vector<char>& code);
 	};
 }
@@ -1,3 +1,21 @@
 D:\Vulkan\Bin\glslc.exe Shaders\shader.vert -o Shaders\shader.vert.spv
 D:\Vulkan\Bin\glslc.exe Shaders\shader.frag -o Shaders\shader.frag.spv
+D:\Vulkan\Bin\glslc.exe -DSHADOWS Shaders\shader.frag -o Shaders\shader_shadows.frag.spv
+D:\Vulkan\Bin\glslc.exe -DCLUSTERED_LIGHTS Shaders\shader.frag -o Shaders\shader_lights.frag.spv
+D:\Vulkan\Bin\glslc.exe -DSHADOWS -DCLUSTERED_LIGHTS Shaders\shader.frag -o Shaders\shader_shadows_lights.frag.spv
+D:\Vulkan\Bin\glslc.exe Shaders\meshlet_cull.comp -o Shaders\meshlet_cull.comp.spv
+D:\Vulkan\Bin\glslc.exe --target-env=vulkan1.2 Shaders\meshlet.task -o Shaders\meshlet.task.spv
+D:\Vulkan\Bin\glslc.exe --target-env=vulkan1.2 Shaders\meshlet.mesh -o Shaders\meshlet.mesh.spv
+D:\Vulkan\Bin\glslc.exe -DOCCLUSION_CULLING Shaders\meshlet_cull.comp -o Shaders\meshlet_cull_occlusion.comp.spv
+D:\Vulkan\Bin\glslc.exe --target-env=vulkan1.2 -DOCCLUSION_CULLING Shaders\meshlet.task -o Shaders\meshlet_occlusion.task.spv
+D:\Vulkan\Bin\glslc.exe Shaders\hiz_build.comp -o Shaders\hiz_build.comp.spv
+D:\Vulkan\Bin\glslc.exe Shaders\depth_prepass.vert -o Shaders\depth_prepass.vert.spv
+D:\Vulkan\Bin\glslc.exe Shaders\shadow.vert -o Shaders\shadow.vert.spv
+D:\Vulkan\Bin\glslc.exe Shaders\light_binning.comp -o Shaders\light_binning.comp.spv
+D:\Vulkan\Bin\glslc.exe Shaders\gbuffer.frag -o Shaders\gbuffer.frag.spv
+D:\Vulkan\Bin\glslc.exe Shaders\fullscreen.vert -o Shaders\fullscreen.vert.spv
+D:\Vulkan\Bin\glslc.exe Shaders\deferred_lighting.frag -o Shaders\deferred_lighting.frag.spv
+D:\Vulkan\Bin\glslc.exe -DSHADOWS Shaders\deferred_lighting.frag -o Shaders\deferred_lighting_shadows.frag.spv
+D:\Vulkan\Bin\glslc.exe -DCLUSTERED_LIGHTS Shaders\deferred_lighting.frag -o Shaders\deferred_lighting_lights.frag.spv
+D:\Vulkan\Bin\glslc.exe -DSHADOWS -DCLUSTERED_LIGHTS Shaders\deferred_lighting.frag -o Shaders\deferred_lighting_shadows_lights.frag.spv
 pause
\ No newline at end of file
@@ -2,9 +2,12 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <cstdio>
 #include <iostream>
+#include <random>
 
 #include "VulkanRenderer.h"
+#include "Benchmarks.h"
 
 GLFWwindow* window;
 EngineCore::VulkanRenderer renderer;
@@ -21,10 +24,149 @@ void initWindow(std::string wName = "Game Window", const int width = 800, const
 	window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
 }
 
-int main() {
+// What the deferred lighting subpass saves over a separate lighting render pass (nothing without deferred shading)
+void printDeferredComparison()
+{
+	const RenderGraphStats& subpassStats = renderer.getDeferredSubpassStats();
+	const RenderGraphStats& separateStats = renderer.getDeferredSeparatePassStats();
+	if (subpassStats.passCount == 0) { return; }
+
+	std::cout << "Deferred G-buffer, lighting subpass vs separate render pass: " << subpassStats.allocatedBytes / 1024
+		<< " vs " << separateStats.allocatedBytes / 1024 << " KiB of attachment memory (" << subpassStats.lazyBytes / 1024
+		<< " vs " << separateStats.lazyBytes / 1024 << " KiB lazily allocated), "
+		<< (subpassStats.attachmentLoadBytes + subpassStats.attachmentStoreBytes) / 1024 << " vs "
+		<< (separateStats.attachmentLoadBytes + separateStats.attachmentStoreBytes) / 1024
+		<< " KiB of attachment loads and stores per frame" << std::endl;
+}
+
+// Clustered lighting on the GPU: a floor of quads under 10 to 10k moving point and spot lights, average GPU time of the
+// binning pass, the shading passes (forward, or G-buffer + lighting subpass when deferred) and the whole frame at each
+// light count. After the sweep it prints the frame's attachment memory and traffic to compare the two runs (and with
+// deferred, the subpass against a separate lighting render pass). The depth pre-pass is
+// on, so with async compute the binning overlaps it on the compute queue: the overlap column is how long both queues
+// were busy at once, and gpu_timeline.json (chrome://tracing) shows the last frame's passes on both
+int runLightBenchmark(bool deferred, bool asyncCompute)
+{
+	initWindow("Vulkan Render Engine - light benchmark", 1280, 720);
+	renderer.setVertexFormat(VERTEX_FORMAT_SNORM16);
+	renderer.setClusteredLighting(true);
+	renderer.setDeferredShading(deferred);
+	renderer.setAsyncCompute(asyncCompute);
+	renderer.setDepthPrePass(true);
+	if (renderer.init(window) == EXIT_FAILURE)
+	{
+		std::cerr << "Failed to initialize Vulkan Renderer" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// 12 x 20 tiles of the first quad (0.8 wide) laid flat, from the camera 40 units down the view
+	std::vector<EntityHandle> initModels = renderer.getModels();
+	for (EntityHandle model : initModels)
+	{
+		renderer.destroyModel(model);
+	}
+	MeshHandle quad = renderer.getMeshes()[0];
+	for (int x = 0; x < 12; x++)
+	{
+		for (int z = 0; z < 20; z++)
+		{
+			glm::mat4 tile = glm::translate(glm::mat4(1.0f), glm::vec3(x * 2.0f - 11.0f, -0.6f, 1.0f - z * 2.0f));
+			tile = glm::rotate(tile, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+			renderer.updateModel(renderer.createModel(quad), glm::scale(tile, glm::vec3(2.5f)));
+		}
+	}
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const int warmUpFrames = 30, measuredFrames = 200;
+
+	std::cout << "lights   binning ms   " << (deferred ? "deferred ms" : " forward ms") << "   frame ms   overlap ms" << std::endl;
+	for (uint32_t lightCount : { 10u, 30u, 100u, 300u, 1000u, 3000u, 10000u })
+	{
+		// Every light circles around its own point above the floor, a quarter are spots pointing down
+		std::vector<glm::vec3> centres(lightCount);
+		std::vector<Light> lights(lightCount);
+		for (uint32_t i = 0; i < lightCount; i++)
+		{
+			centres[i] = glm::vec3(unit(random) * 24.0f - 12.0f, unit(random) * 2.0f - 0.4f, 1.0f - unit(random) * 40.0f);
+			glm::vec3 colour = 2.0f * glm::vec3(unit(random), unit(random), unit(random));
+			lights[i] = i % 4 == 0
+				? makeSpotLight(centres[i], glm::vec3(0.0f, -1.0f, 0.0f), 3.0f, glm::radians(20.0f), glm::radians(35.0f), colour)
+				: makePointLight(centres[i], 1.5f, colour);
+		}
+
+		double binning = 0.0, shading = 0.0, frame = 0.0, overlap = 0.0;
+		for (int f = 0; f < warmUpFrames + measuredFrames && !glfwWindowShouldClose(window); f++)
+		{
+			glfwPollEvents();
+
+			float time = static_cast<float>(glfwGetTime());
+			for (uint32_t i = 0; i < lightCount; i++)
+			{
+				float phase = time + i * 0.37f;
+				lights[i].positionRange = glm::vec4(centres[i] + 0.5f * glm::vec3(std::cos(phase), 0.0f, std::sin(phase)), lights[i].positionRange.w);
+			}
+			renderer.setLights(lights);
+			renderer.draw();
+
+			if (f < warmUpFrames) { continue; }
+			for (const GpuTiming& timing : renderer.getGpuTimings())
+			{
+				if (timing.name == "light binning") { binning += timing.milliseconds; }
+				if (timing.name == "forward" || timing.name == "g-buffer" || timing.name == "deferred lighting") { shading += timing.milliseconds; }
+				if (timing.name == "frame") { frame += timing.milliseconds; }
+			}
+			overlap += getQueueOverlap(renderer.getGpuTimings(), "graphics", "async compute");
+		}
+
+		std::printf("%6u   %10.3f   %11.3f   %8.3f   %10.3f\n", lightCount, binning / measuredFrames, shading / measuredFrames,
+			frame / measuredFrames, overlap / measuredFrames);
+	}
+	writeChromeTrace("gpu_timeline.json", renderer.getGpuTimings());
+
+	const RenderGraphStats& graphStats = renderer.getRenderGraphStats();
+	std::printf("\n%s attachments: %llu KiB allocated (%llu KiB lazily), %llu KiB loaded and %llu KiB stored per frame\n",
+		deferred ? "Deferred" : "Forward", static_cast<unsigned long long>(graphStats.allocatedBytes / 1024),
+		static_cast<unsigned long long>(graphStats.lazyBytes / 1024), static_cast<unsigned long long>(graphStats.attachmentLoadBytes / 1024),
+		static_cast<unsigned long long>(graphStats.attachmentStoreBytes / 1024));
+	printDeferredComparison();
+
+	renderer.cleanup();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	// CPU benchmarks only, no window
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		return runBenchmarks();
+	}
+
+	// GPU timings of clustered lighting over a sweep of light counts, forward or (--deferred) deferred shading, binning on
+	// the graphics or (--async-compute) the async compute queue
+	if (argc > 1 && std::string(argv[1]) == "--light-benchmark")
+	{
+		bool deferred = false, asyncCompute = false;
+		for (int i = 2; i < argc; i++)
+		{
+			deferred = deferred || std::string(argv[i]) == "--deferred";
+			asyncCompute = asyncCompute || std::string(argv[i]) == "--async-compute";
+		}
+		return runLightBenchmark(deferred, asyncCompute);
+	}
+
 	// Create Window
 	initWindow("Vulkan Render Engine", 800, 600);
 
+	// Compact vertices: 16-bit positions dequantized per mesh, packed colour/normal/uv
+	renderer.setVertexFormat(VERTEX_FORMAT_SNORM16);
+
+	// --deferred: G-buffer and lighting subpass instead of forward shading
+	renderer.setDeferredShading(argc > 1 && std::string(argv[1]) == "--deferred");
+
 	// Initialize Vulkan Renderer with the created window
 	if (renderer.init(window) == EXIT_FAILURE)
 	{
@@ -32,10 +174,20 @@ int main() {
 		return EXIT_FAILURE;
 	}
 
+	// The models init created for its two meshes
+	EntityHandle firstModel = renderer.getModels()[0];
+	EntityHandle secondModel = renderer.getModels()[1];
+
 	float angle = 0.0f;
 	float deltaTime = 0.0f; // Assuming a frame time of ~16ms for 60 FPS
 	float lastTime = 0.0f;
 
+	// P toggles the depth pre-pass, M cycles MSAA 1x/2x/4x/8x, T prints the GPU pass timings and render queue binds (compare settings per scene)
+	bool depthPrePass = false;
+	bool prePassKeyDown = false;
+	bool msaaKeyDown = false;
+	bool timingsKeyDown = false;
+
 
 	// Main loop
 	while (!glfwWindowShouldClose(window)) 
@@ -49,17 +201,68 @@ int main() {
 		angle += 10.0f * deltaTime;
 		if (angle > 360.0f) { angle -= 360.0f; }
 
-		glm::mat4 firstModel(1.0f);
-		glm::mat4 secondModel(1.0f);
+		// Local transforms only, world matrices are updated by the renderer's scene graph
+		SceneGraph& sceneGraph = renderer.getSceneGraph();
+		sceneGraph.setLocalTransform(renderer.getModelNode(firstModel), glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::angleAxis(glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f)), glm::vec3(1.0f));
+		sceneGraph.setLocalTransform(renderer.getModelNode(secondModel), glm::vec3(1.0f, 0.0f, -3.0f),
+			glm::angleAxis(glm::radians(-angle * 20), glm::normalize(glm::vec3(0.0f, 1.0f, 1.0f))), glm::vec3(1.0f));
+
+		bool prePassKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+		if (prePassKey && !prePassKeyDown)
+		{
+			depthPrePass = !depthPrePass;
+			renderer.setDepthPrePass(depthPrePass);
+			std::cout << "Depth pre-pass " << (depthPrePass ? "on" : "off") << std::endl;
+		}
+		prePassKeyDown = prePassKey;
+
+		bool msaaKey = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+		if (msaaKey && !msaaKeyDown)
+		{
+			// Back to 1x once the device maximum didn't go any higher
+			VkSampleCountFlagBits current = renderer.getMsaaSamples();
+			renderer.setMsaaSamples(current == VK_SAMPLE_COUNT_8_BIT ? VK_SAMPLE_COUNT_1_BIT : static_cast<VkSampleCountFlagBits>(current << 1));
+			if (renderer.getMsaaSamples() == current && current != VK_SAMPLE_COUNT_1_BIT)
+			{
+				renderer.setMsaaSamples(VK_SAMPLE_COUNT_1_BIT);
+			}
+		}
+		msaaKeyDown = msaaKey;
 
-		firstModel = glm::translate(firstModel, glm::vec3(0.0f, 0.0f, -1.0f));
-		firstModel = glm::rotate(firstModel, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+		bool timingsKey = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+		if (timingsKey && !timingsKeyDown)
+		{
+			std::cout << "GPU timings at " << renderer.getMsaaSamples() << "x MSAA:" << std::endl;
+			for (const GpuTiming& timing : renderer.getGpuTimings())
+			{
+				std::cout << timing.name << ": " << timing.milliseconds << " ms" << std::endl;
+			}
 
-		secondModel = glm::translate(secondModel, glm::vec3(1.0f, 0.0f, -3.0f));
-		secondModel = glm::rotate(secondModel, glm::radians(-angle * 20), glm::vec3(0.0f, 1.0f, 1.0f));
+			const RenderQueueStats& queueStats = renderer.getRenderQueueStats();
+			std::cout << "Render queue: " << queueStats.drawCount << " draws, " << queueStats.vertexBufferBinds << " vertex / "
+				<< queueStats.indexBufferBinds << " index buffer binds, " << queueStats.descriptorSetBinds << " set binds, "
+				<< queueStats.bindsSkipped << " binds skipped" << std::endl;
 
-		renderer.updateModel(0, firstModel);
-		renderer.updateModel(1, secondModel);
+			const RenderGraphStats& graphStats = renderer.getRenderGraphStats();
+			std::cout << "Render graph: " << graphStats.passCount << " passes (" << graphStats.culledPassCount << " culled), "
+				<< graphStats.barrierCount << " barriers in " << graphStats.barrierBatchCount << " batches per frame, "
+				<< graphStats.transientImageCount << " transient images in " << graphStats.allocatedBytes / 1024 << " KiB ("
+				<< (graphStats.transientBytes - graphStats.allocatedBytes) / 1024 << " KiB saved by aliasing, "
+				<< graphStats.lazyImageCount << " lazily allocated in " << graphStats.lazyBytes / 1024 << " KiB), "
+				<< graphStats.renderPassCount << " render passes loading " << graphStats.attachmentLoadBytes / 1024
+				<< " KiB and storing " << graphStats.attachmentStoreBytes / 1024 << " KiB of attachments, "
+				<< graphStats.asyncPassCount << " passes on the async compute queue" << std::endl;
+			if (renderer.getShadowResolution() > 0)
+			{
+				std::cout << "Shadows: " << renderer.getShadowResolution() << "x" << renderer.getShadowResolution()
+					<< " cascade tiles, atlas + cache " << renderer.getShadowMemoryBytes() / 1024 << " KiB" << std::endl;
+			}
+			printDeferredComparison();
+			std::cout << "Cached passes: " << graphStats.cachedPassCount << ", " << graphStats.cachedPassRecordCount
+				<< " recorded again last frame" << std::endl;
+		}
+		timingsKeyDown = timingsKey;
 
 		renderer.draw();
 	}
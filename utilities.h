@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstring>
 #include <fstream>
 
 #define GLFW_INCLUDE_VULKAN
@@ -18,12 +19,22 @@ struct Vertex
 {
 	glm::vec3 pos; // Vertex position(x,y,z)
 	glm::vec3 col; // Vertex color (r,g,b)
+	glm::vec3 norm = glm::vec3(0.0f, 0.0f, 1.0f); // Vertex normal (x,y,z)
+	glm::vec2 tex = glm::vec2(0.0f); // Texture coords (u,v)
+};
+
+// Axis aligned bounding box
+struct Aabb
+{
+	glm::vec3 min;
+	glm::vec3 max;
 };
 
 // Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices {
 	int graphicsFamily = -1;
 	int presentationFamily = -1;
+	int computeFamily = -1;			// Compute without graphics (async compute), optional
 	bool isValid()
 	{
 		return graphicsFamily >= 0 && presentationFamily >= 0;
@@ -169,4 +180,50 @@ static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool tra
 
 	// Free the command buffer now that it has been executed
 	vkFreeCommandBuffers(device, transferCommandPool, 1, &transferCommandBuffer);
-}
\ No newline at end of file
+}
+
+static void createStagedBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+	const void* data, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+{
+	// Temporary buffer to "stage" data before transfering it to GPU
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &mapped);
+	memcpy(mapped, data, (size_t)bufferSize);
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	// Device local destination, filled by a copy on the transfer queue
+	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | bufferUsage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+	copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, buffer, bufferSize);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+}
+
+// Frustum planes (xyz = normal pointing inside, w = distance) of a view projection matrix, in the space the matrix transforms from
+// Order: left, right, bottom, top, near, far
+static void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;	// -w..w depth range, conservative if the projection is 0..1
+	planes[5] = row3 - row2;
+
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}